@@ -8,6 +8,11 @@
         "src/sqlite_impl.cpp",
         "src/user_function.cpp",
         "src/aggregate_function.cpp",
+        "src/database_pool.cpp",
+        "src/changeset_stream.cpp",
+        "src/conflict_policy.cpp",
+        "src/changegroup.cpp",
+        "src/maintenance_job.cpp",
         "src/upstream/sqlite3.c"
       ],
       "include_dirs": [
@@ -29,6 +34,7 @@
         "SQLITE_DEFAULT_WAL_SYNCHRONOUS=1",
         "SQLITE_DQS=0",
         "SQLITE_ENABLE_COLUMN_METADATA",
+        "SQLITE_ENABLE_DBPAGE_VTAB",
         "SQLITE_ENABLE_DBSTAT_VTAB",
         "SQLITE_ENABLE_FTS3_PARENTHESIS",
         "SQLITE_ENABLE_FTS3",
@@ -44,6 +50,7 @@
         "SQLITE_ENABLE_SESSION",
         "SQLITE_ENABLE_SNAPSHOT",
         "SQLITE_ENABLE_STAT4",
+        "SQLITE_ENABLE_STMT_SCANSTATUS",
         "SQLITE_ENABLE_UPDATE_DELETE_LIMIT",
         "SQLITE_LIKE_DOESNT_MATCH_BLOBS",
         "SQLITE_OMIT_DEPRECATED",
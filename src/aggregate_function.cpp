@@ -14,7 +14,8 @@ CustomAggregate::CustomAggregate(Napi::Env env, DatabaseSync *db,
                                  Napi::Function step_fn,
                                  Napi::Function inverse_fn,
                                  Napi::Function result_fn)
-    : env_(env), use_bigint_args_(use_bigint_args), async_context_(nullptr) {
+    : env_(env), use_bigint_args_(use_bigint_args), async_context_(nullptr),
+      creation_thread_(std::this_thread::get_id()) {
   // Handle start value based on type
   if (start.IsNull()) {
     start_type_ = PRIMITIVE_NULL;
@@ -108,6 +109,13 @@ void CustomAggregate::xStepBase(sqlite3_context *ctx, int argc,
     return;
   }
 
+  if (std::this_thread::get_id() != self->creation_thread_) {
+    sqlite3_result_error(
+        ctx, "User-defined functions cannot run in asynchronous queries",
+        -1);
+    return;
+  }
+
   // Create HandleScope and CallbackScope for this operation
   Napi::HandleScope scope(self->env_);
   Napi::CallbackScope callback_scope(self->env_, self->async_context_);
@@ -195,6 +203,13 @@ void CustomAggregate::xValueBase(sqlite3_context *ctx, bool finalize) {
 
   CustomAggregate *self = static_cast<CustomAggregate *>(user_data);
 
+  if (std::this_thread::get_id() != self->creation_thread_) {
+    sqlite3_result_error(
+        ctx, "User-defined functions cannot run in asynchronous queries",
+        -1);
+    return;
+  }
+
   // Create HandleScope and CallbackScope for this operation
   Napi::HandleScope scope(self->env_);
   Napi::CallbackScope callback_scope(self->env_, self->async_context_);
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <thread>
 
 namespace photostructure {
 namespace sqlite {
@@ -107,6 +108,9 @@ private:
 
   // Async context for callbacks
   napi_async_context async_context_;
+
+  // JavaScript can only be called on the thread that registered the aggregate
+  std::thread::id creation_thread_;
 };
 
 } // namespace sqlite
@@ -3,6 +3,8 @@
 #include <napi.h>
 #include <set>
 
+#include "changegroup.h"
+#include "database_pool.h"
 #include "sqlite_impl.h"
 
 namespace photostructure {
@@ -31,6 +33,9 @@ void CleanupAddonData(napi_env env, void *finalize_data, void *finalize_hint) {
   if (!addon_data->sessionConstructor.IsEmpty()) {
     addon_data->sessionConstructor.Reset();
   }
+  if (!addon_data->rebaserConstructor.IsEmpty()) {
+    addon_data->rebaserConstructor.Reset();
+  }
 
   delete addon_data;
 }
@@ -80,6 +85,14 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
   StatementSync::Init(env, exports);
   StatementSyncIterator::Init(env, exports);
   Session::Init(env, exports);
+  ChangeGroup::Init(env, exports);
+  Rebaser::Init(env, exports);
+  DatabasePool::Init(env, exports);
+
+  exports.Set("memoryStatus",
+              Napi::Function::New(env, MemoryStatus, "memoryStatus"));
+  exports.Set("invertChangeset",
+              Napi::Function::New(env, InvertChangeset, "invertChangeset"));
 
   // Add SQLite constants
   Napi::Object constants = Napi::Object::New(env);
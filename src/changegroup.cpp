@@ -0,0 +1,330 @@
+#include "changegroup.h"
+
+#include <climits>
+#include <cmath>
+#include <string>
+
+#include "changeset_stream.h"
+#include "shims/sqlite_errors.h"
+
+namespace photostructure {
+namespace sqlite {
+
+// Reads a changeset argument. Returns false with a pending exception.
+static bool GetChangesetArgument(Napi::Env env, Napi::Value value,
+                                 const char *name, Napi::Uint8Array *data) {
+  if (!value.IsTypedArray() ||
+      value.As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) {
+    std::string message = std::string("The \"") + name +
+                          "\" argument must be a Buffer or Uint8Array.";
+    node::THROW_ERR_INVALID_ARG_TYPE(env, message.c_str());
+    return false;
+  }
+  *data = value.As<Napi::Uint8Array>();
+  if (data->ElementLength() > static_cast<size_t>(INT_MAX)) {
+    std::string message =
+        std::string("The \"") + name + "\" argument is too large.";
+    node::THROW_ERR_OUT_OF_RANGE(env, message.c_str());
+    return false;
+  }
+  return true;
+}
+
+static void ThrowChangesetError(Napi::Env env, int code,
+                                const std::string &message) {
+  node::ThrowEnhancedSqliteError(env, nullptr, code,
+                                 message + ": " + sqlite3_errstr(code));
+}
+
+// ChangeGroup Implementation
+
+Napi::Object ChangeGroup::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(
+      env, "ChangeGroup",
+      {InstanceMethod("add", &ChangeGroup::Add),
+       InstanceMethod("output", &ChangeGroup::Output),
+       InstanceMethod("addStream", &ChangeGroup::AddStream),
+       InstanceMethod("streamOutput", &ChangeGroup::StreamOutput),
+       InstanceMethod("close", &ChangeGroup::Close)});
+
+  exports.Set("ChangeGroup", func);
+  return exports;
+}
+
+ChangeGroup::ChangeGroup(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<ChangeGroup>(info) {
+  Napi::Env env = info.Env();
+  int r = sqlite3changegroup_new(&group_);
+  if (r != SQLITE_OK) {
+    group_ = nullptr;
+    ThrowChangesetError(env, r, "Failed to create changegroup");
+  }
+}
+
+ChangeGroup::~ChangeGroup() {
+  if (group_ != nullptr) {
+    sqlite3changegroup_delete(group_);
+    group_ = nullptr;
+  }
+}
+
+bool ChangeGroup::ValidateUsable(Napi::Env env) {
+  if (group_ == nullptr) {
+    node::THROW_ERR_INVALID_STATE(env, "changegroup is not open");
+    return false;
+  }
+  if (busy_) {
+    node::THROW_ERR_INVALID_STATE(
+        env, "changegroup is busy with a stream; wait for it to finish");
+    return false;
+  }
+  return true;
+}
+
+Napi::Value ChangeGroup::Add(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateUsable(env)) {
+    return env.Undefined();
+  }
+
+  Napi::Uint8Array changeset;
+  if (!GetChangesetArgument(env, info[0], "changeset", &changeset)) {
+    return env.Undefined();
+  }
+
+  int r = sqlite3changegroup_add(group_,
+                                 static_cast<int>(changeset.ElementLength()),
+                                 changeset.Data());
+  if (r != SQLITE_OK) {
+    ThrowChangesetError(env, r, "Failed to add changeset");
+  }
+  return env.Undefined();
+}
+
+Napi::Value ChangeGroup::Output(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateUsable(env)) {
+    return env.Undefined();
+  }
+
+  int size = 0;
+  void *data = nullptr;
+  int r = sqlite3changegroup_output(group_, &size, &data);
+  if (r != SQLITE_OK) {
+    ThrowChangesetError(env, r, "Failed to generate changeset");
+    return env.Undefined();
+  }
+  return TakeSqliteBuffer(env, data, static_cast<size_t>(size));
+}
+
+Napi::Value ChangeGroup::AddStream(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+  if (!ValidateUsable(env)) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
+
+  Napi::Value iterator = ChangesetStreamJob::OpenIterator(env, info[0]);
+  if (iterator.IsEmpty()) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
+
+  return ChangesetStreamJob::AddToGroup(env, this,
+                                        iterator.As<Napi::Object>());
+}
+
+Napi::Value ChangeGroup::StreamOutput(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+  if (!ValidateUsable(env)) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
+
+  if (!info[0].IsFunction()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"onChunk\" argument must be a function.");
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
+
+  size_t chunk_size = ChangesetStreamJob::kDefaultChunkSize;
+  if (!info[1].IsUndefined()) {
+    if (!info[1].IsObject()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options\" argument must be an object.");
+      deferred.Reject(env.GetAndClearPendingException().Value());
+      return deferred.Promise();
+    }
+    Napi::Value size_value = info[1].As<Napi::Object>().Get("chunkSize");
+    if (!size_value.IsUndefined()) {
+      if (!size_value.IsNumber()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.chunkSize\" argument must be a number.");
+        deferred.Reject(env.GetAndClearPendingException().Value());
+        return deferred.Promise();
+      }
+      double size = size_value.As<Napi::Number>().DoubleValue();
+      if (!std::isfinite(size) || size < 1 || size > INT32_MAX) {
+        node::THROW_ERR_OUT_OF_RANGE(
+            env, "The \"options.chunkSize\" argument must be a positive "
+                 "integer.");
+        deferred.Reject(env.GetAndClearPendingException().Value());
+        return deferred.Promise();
+      }
+      chunk_size = static_cast<size_t>(size);
+    }
+  }
+
+  return ChangesetStreamJob::OutputGroup(env, this, chunk_size,
+                                         info[0].As<Napi::Function>());
+}
+
+Napi::Value ChangeGroup::Close(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateUsable(env)) {
+    return env.Undefined();
+  }
+
+  sqlite3changegroup_delete(group_);
+  group_ = nullptr;
+  return env.Undefined();
+}
+
+// Rebaser Implementation
+
+Napi::Object Rebaser::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func =
+      DefineClass(env, "Rebaser",
+                  {InstanceMethod("configure", &Rebaser::Configure),
+                   InstanceMethod("rebase", &Rebaser::Rebase),
+                   InstanceMethod("close", &Rebaser::Close)});
+
+  AddonData *addon_data = GetAddonData(env);
+  if (addon_data) {
+    addon_data->rebaserConstructor = Napi::Reference<Napi::Function>::New(func);
+  }
+
+  exports.Set("Rebaser", func);
+  return exports;
+}
+
+Rebaser::Rebaser(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<Rebaser>(info) {
+  Napi::Env env = info.Env();
+  int r = sqlite3rebaser_create(&rebaser_);
+  if (r != SQLITE_OK) {
+    rebaser_ = nullptr;
+    ThrowChangesetError(env, r, "Failed to create rebaser");
+  }
+}
+
+Rebaser::~Rebaser() {
+  if (rebaser_ != nullptr) {
+    sqlite3rebaser_delete(rebaser_);
+    rebaser_ = nullptr;
+  }
+}
+
+Rebaser *Rebaser::FromValue(Napi::Env env, Napi::Value value) {
+  AddonData *addon_data = GetAddonData(env);
+  if (!addon_data || addon_data->rebaserConstructor.IsEmpty() ||
+      !value.IsObject() ||
+      !value.As<Napi::Object>().InstanceOf(
+          addon_data->rebaserConstructor.Value())) {
+    return nullptr;
+  }
+  return Napi::ObjectWrap<Rebaser>::Unwrap(value.As<Napi::Object>());
+}
+
+bool Rebaser::AddRebaseBuffer(Napi::Env env, const void *data, int size) {
+  if (rebaser_ == nullptr) {
+    node::THROW_ERR_INVALID_STATE(env, "rebaser is not open");
+    return false;
+  }
+  int r = sqlite3rebaser_configure(rebaser_, size, data);
+  if (r != SQLITE_OK) {
+    ThrowChangesetError(env, r, "Failed to configure rebaser");
+    return false;
+  }
+  return true;
+}
+
+Napi::Value Rebaser::Configure(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  Napi::Uint8Array buffer;
+  if (!GetChangesetArgument(env, info[0], "rebase", &buffer)) {
+    return env.Undefined();
+  }
+  AddRebaseBuffer(env, buffer.Data(),
+                  static_cast<int>(buffer.ElementLength()));
+  return env.Undefined();
+}
+
+Napi::Value Rebaser::Rebase(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (rebaser_ == nullptr) {
+    node::THROW_ERR_INVALID_STATE(env, "rebaser is not open");
+    return env.Undefined();
+  }
+
+  Napi::Uint8Array changeset;
+  if (!GetChangesetArgument(env, info[0], "changeset", &changeset)) {
+    return env.Undefined();
+  }
+
+  int size = 0;
+  void *data = nullptr;
+  int r = sqlite3rebaser_rebase(rebaser_,
+                                static_cast<int>(changeset.ElementLength()),
+                                changeset.Data(), &size, &data);
+  if (r != SQLITE_OK) {
+    ThrowChangesetError(env, r, "Failed to rebase changeset");
+    return env.Undefined();
+  }
+  return TakeSqliteBuffer(env, data, static_cast<size_t>(size));
+}
+
+Napi::Value Rebaser::Close(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (rebaser_ == nullptr) {
+    node::THROW_ERR_INVALID_STATE(env, "rebaser is not open");
+    return env.Undefined();
+  }
+
+  sqlite3rebaser_delete(rebaser_);
+  rebaser_ = nullptr;
+  return env.Undefined();
+}
+
+Napi::Value InvertChangeset(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  Napi::Uint8Array changeset;
+  if (!GetChangesetArgument(env, info[0], "changeset", &changeset)) {
+    return env.Undefined();
+  }
+
+  int size = 0;
+  void *data = nullptr;
+  int r = sqlite3changeset_invert(static_cast<int>(changeset.ElementLength()),
+                                  changeset.Data(), &size, &data);
+  if (r != SQLITE_OK) {
+    ThrowChangesetError(env, r, "Failed to invert changeset");
+    return env.Undefined();
+  }
+  return TakeSqliteBuffer(env, data, static_cast<size_t>(size));
+}
+
+} // namespace sqlite
+} // namespace photostructure
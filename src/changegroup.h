@@ -0,0 +1,72 @@
+#ifndef SRC_CHANGEGROUP_H_
+#define SRC_CHANGEGROUP_H_
+
+#include <napi.h>
+#include <sqlite3.h>
+
+namespace photostructure {
+namespace sqlite {
+
+// Combines changesets (or patchsets) with sqlite3changegroup_*. Changes to
+// the same row are merged, so the output is the smallest changeset with the
+// same effect as applying the inputs in order. No connection is involved.
+class ChangeGroup : public Napi::ObjectWrap<ChangeGroup> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+  explicit ChangeGroup(const Napi::CallbackInfo &info);
+  virtual ~ChangeGroup();
+
+  Napi::Value Add(const Napi::CallbackInfo &info);
+  Napi::Value Output(const Napi::CallbackInfo &info);
+  Napi::Value AddStream(const Napi::CallbackInfo &info);
+  Napi::Value StreamOutput(const Napi::CallbackInfo &info);
+  Napi::Value Close(const Napi::CallbackInfo &info);
+
+private:
+  // Throws unless the group is open and no stream is using it
+  bool ValidateUsable(Napi::Env env);
+
+  sqlite3_changegroup *group_ = nullptr;
+  // Set while a ChangesetStreamJob reads or writes the group
+  bool busy_ = false;
+
+  friend class ChangesetStreamJob;
+};
+
+// Rebases changesets with sqlite3rebaser_*. Once configured with the rebase
+// buffers of changesets applied locally, rebase() adjusts a local changeset
+// so that it no longer overrides the conflict resolutions made for them.
+// Passed to applyChangeset() as `options.rebaser`, it is configured
+// automatically.
+class Rebaser : public Napi::ObjectWrap<Rebaser> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+  explicit Rebaser(const Napi::CallbackInfo &info);
+  virtual ~Rebaser();
+
+  Napi::Value Configure(const Napi::CallbackInfo &info);
+  Napi::Value Rebase(const Napi::CallbackInfo &info);
+  Napi::Value Close(const Napi::CallbackInfo &info);
+
+  // Returns the Rebaser wrapped by `value`, or null if it is not one
+  static Rebaser *FromValue(Napi::Env env, Napi::Value value);
+
+  // Adds a rebase buffer from sqlite3changeset_apply_v2(). Returns false
+  // with a pending exception.
+  bool AddRebaseBuffer(Napi::Env env, const void *data, int size);
+
+  bool IsOpen() const { return rebaser_ != nullptr; }
+
+private:
+  sqlite3_rebaser *rebaser_ = nullptr;
+};
+
+// invertChangeset(changeset): the changeset that undoes `changeset`
+Napi::Value InvertChangeset(const Napi::CallbackInfo &info);
+
+} // namespace sqlite
+} // namespace photostructure
+
+#endif // SRC_CHANGEGROUP_H_
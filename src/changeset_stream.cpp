@@ -0,0 +1,846 @@
+#include "changeset_stream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "shims/sqlite_errors.h"
+
+namespace photostructure {
+namespace sqlite {
+
+ChangesetStreamJob::ChangesetStreamJob(Napi::Env env, DatabaseSync *database,
+                                       Kind kind)
+    : kind_(kind), env_(env), database_(database),
+      deferred_(Napi::Promise::Deferred::New(env)) {
+  if (database_ != nullptr) {
+    database_ref_ = Napi::Persistent(database_->Value());
+    query_mutex_ = database_->query_mutex();
+    connection_lock_ =
+        std::unique_lock<std::mutex>(*query_mutex_, std::defer_lock);
+  }
+}
+
+ChangesetStreamJob *ChangesetStreamJob::ForGroup(Napi::Env env,
+                                                 ChangeGroup *group,
+                                                 Kind kind) {
+  ChangesetStreamJob *job = new ChangesetStreamJob(env, nullptr, kind);
+  job->group_ = group;
+  job->group_ref_ = Napi::Persistent(group->Value());
+  group->busy_ = true;
+  return job;
+}
+
+Napi::Promise ChangesetStreamJob::Generate(Napi::Env env, Session *session,
+                                           bool patchset, size_t chunk_size,
+                                           Napi::Function on_chunk) {
+  ChangesetStreamJob *job = new ChangesetStreamJob(
+      env, session->database_, patchset ? kPatchset : kChangeset);
+  job->session_ = session->GetSession();
+  job->session_ref_ = Napi::Persistent(session->Value());
+  job->on_chunk_ = Napi::Persistent(on_chunk);
+  job->chunk_size_ = chunk_size;
+  job->ReserveChunk();
+
+  Napi::Promise promise = job->deferred_.Promise();
+  session->database_->EnqueueJob([job]() { job->Start(); });
+  return promise;
+}
+
+bool ChangesetStreamJob::ParseApplyOptions(Napi::Env env, Napi::Value value,
+                                           ApplyOptions *options) {
+  if (value.IsUndefined()) {
+    return true;
+  }
+  if (!value.IsObject()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"options\" argument must be an object.");
+    return false;
+  }
+  Napi::Object object = value.As<Napi::Object>();
+
+  Napi::Value conflict_value = object.Get("onConflict");
+  if (!conflict_value.IsUndefined()) {
+    if (!conflict_value.IsFunction()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options.onConflict\" argument must be a function.");
+      return false;
+    }
+    options->on_conflict = conflict_value.As<Napi::Function>();
+  }
+
+  Napi::Value filter_value = object.Get("filter");
+  if (!filter_value.IsUndefined()) {
+    if (!filter_value.IsFunction()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options.filter\" argument must be a function.");
+      return false;
+    }
+    options->filter = filter_value.As<Napi::Function>();
+  }
+
+  Napi::Value progress_value = object.Get("progress");
+  if (!progress_value.IsUndefined()) {
+    if (!progress_value.IsFunction()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options.progress\" argument must be a function.");
+      return false;
+    }
+    options->on_progress = progress_value.As<Napi::Function>();
+  }
+
+  // Column lookups wait until the job owns the connection
+  Napi::Value policies_value = object.Get("policies");
+  if (!policies_value.IsUndefined()) {
+    options->policies = std::make_unique<ConflictPolicies>();
+    if (!options->policies->Parse(env, policies_value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ChangesetStreamJob *ChangesetStreamJob::ForApply(Napi::Env env,
+                                                 DatabaseSync *database,
+                                                 ApplyOptions options) {
+  ChangesetStreamJob *job = new ChangesetStreamJob(env, database, kApply);
+  job->policies_ = std::move(options.policies);
+  if (!options.on_conflict.IsEmpty()) {
+    job->on_conflict_ = Napi::Persistent(options.on_conflict);
+  }
+  if (!options.filter.IsEmpty()) {
+    job->filter_ = Napi::Persistent(options.filter);
+  }
+  if (!options.on_progress.IsEmpty()) {
+    job->on_progress_ = Napi::Persistent(options.on_progress);
+  }
+  return job;
+}
+
+Napi::Promise ChangesetStreamJob::Apply(Napi::Env env, DatabaseSync *database,
+                                        Napi::Object iterator,
+                                        ApplyOptions options) {
+  ChangesetStreamJob *job = ForApply(env, database, std::move(options));
+  job->iterator_ = Napi::Persistent(iterator);
+
+  Napi::Promise promise = job->deferred_.Promise();
+  database->EnqueueJob([job]() { job->Start(); });
+  return promise;
+}
+
+Napi::Promise ChangesetStreamJob::ApplyBuffer(Napi::Env env,
+                                              DatabaseSync *database,
+                                              Napi::Uint8Array changeset,
+                                              ApplyOptions options) {
+  ChangesetStreamJob *job = ForApply(env, database, std::move(options));
+  job->from_memory_ = true;
+  job->input_done_ = true; // No iterator to close
+  // Copied: the worker reads it while JavaScript is free to modify or
+  // detach the caller's buffer
+  job->source_.assign(reinterpret_cast<const char *>(changeset.Data()),
+                      changeset.ElementLength());
+
+  Napi::Promise promise = job->deferred_.Promise();
+  database->EnqueueJob([job]() { job->Start(); });
+  return promise;
+}
+
+Napi::Promise ChangesetStreamJob::AddToGroup(Napi::Env env, ChangeGroup *group,
+                                             Napi::Object iterator) {
+  ChangesetStreamJob *job = ForGroup(env, group, kGroupAdd);
+  job->iterator_ = Napi::Persistent(iterator);
+
+  Napi::Promise promise = job->deferred_.Promise();
+  job->Start();
+  return promise;
+}
+
+Napi::Promise ChangesetStreamJob::OutputGroup(Napi::Env env,
+                                              ChangeGroup *group,
+                                              size_t chunk_size,
+                                              Napi::Function on_chunk) {
+  ChangesetStreamJob *job = ForGroup(env, group, kGroupOutput);
+  job->on_chunk_ = Napi::Persistent(on_chunk);
+  job->chunk_size_ = chunk_size;
+  job->ReserveChunk();
+
+  Napi::Promise promise = job->deferred_.Promise();
+  job->Start();
+  return promise;
+}
+
+Napi::Promise ChangesetStreamJob::Snapshot(Napi::Env env,
+                                           DatabaseSync *database,
+                                           const std::string &schema,
+                                           size_t chunk_size,
+                                           Napi::Function on_chunk, int fd,
+                                           Napi::Function on_progress) {
+  ChangesetStreamJob *job = new ChangesetStreamJob(env, database, kSnapshot);
+  job->schema_ = schema;
+  job->fd_ = fd;
+  job->chunk_size_ = chunk_size;
+  job->ReserveChunk();
+  if (!on_chunk.IsEmpty()) {
+    job->on_chunk_ = Napi::Persistent(on_chunk);
+  }
+  if (!on_progress.IsEmpty()) {
+    job->on_progress_ = Napi::Persistent(on_progress);
+  }
+
+  Napi::Promise promise = job->deferred_.Promise();
+  database->EnqueueJob([job]() { job->Start(); });
+  return promise;
+}
+
+Napi::Value ChangesetStreamJob::OpenIterator(Napi::Env env,
+                                             Napi::Value source) {
+  // Node streams are async iterables, arrays and generators are iterables
+  if (source.IsObject() && !source.IsTypedArray()) {
+    Napi::Object symbol = env.Global().Get("Symbol").As<Napi::Object>();
+    Napi::Object object = source.As<Napi::Object>();
+    Napi::Value method = object.Get(symbol.Get("asyncIterator"));
+    if (!method.IsFunction()) {
+      method = object.Get(symbol.Get("iterator"));
+    }
+    if (method.IsFunction()) {
+      try {
+        Napi::Value iterator = method.As<Napi::Function>().Call(object, {});
+        if (iterator.IsObject()) {
+          return iterator;
+        }
+      } catch (const Napi::Error &e) {
+        e.ThrowAsJavaScriptException();
+        return Napi::Value();
+      }
+    }
+  }
+  node::THROW_ERR_INVALID_ARG_TYPE(
+      env, "The \"source\" argument must be an iterable or async iterable "
+           "of Buffers.");
+  return Napi::Value();
+}
+
+void ChangesetStreamJob::Start() {
+  Napi::Env env = env_;
+  tsfn_ = Napi::ThreadSafeFunction::New(
+      env, Napi::Function::New(env, [](const Napi::CallbackInfo &) {}),
+      "SQLiteChangesetStream", 0, 1, [this](Napi::Env) {
+        // Runs after the worker has released the function or, if the
+        // environment is shutting down, while the worker may still be
+        // waiting for a callback that will never come
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          cancelled_ = true;
+        }
+        resumed_.notify_one();
+        if (thread_.joinable()) {
+          thread_.join();
+        }
+        delete this;
+      });
+  thread_ = std::thread([this]() { Run(); });
+}
+
+void ChangesetStreamJob::Run() {
+  sqlite3 *db = nullptr;
+  if (database_ != nullptr) {
+    connection_lock_.lock();
+    db = database_->connection();
+  }
+
+  switch (kind_) {
+  case kChangeset:
+  case kPatchset:
+    result_code_ = kind_ == kChangeset
+                       ? sqlite3session_changeset_strm(session_, Output, this)
+                       : sqlite3session_patchset_strm(session_, Output, this);
+    if (result_code_ == SQLITE_OK && !pending_.empty() && !FlushChunk()) {
+      result_code_ = SQLITE_ABORT;
+    }
+    if (result_code_ != SQLITE_OK) {
+      error_message_ = std::string("Failed to generate changeset: ") +
+                       sqlite3_errmsg(db);
+    }
+    break;
+  case kApply:
+    if (policies_ && !policies_->Resolve(db, &policy_error_)) {
+      break;
+    }
+    initial_changes_ = sqlite3_total_changes64(db);
+    result_code_ = ApplyChangeset(db);
+    break;
+  case kGroupAdd:
+    result_code_ = sqlite3changegroup_add_strm(group_->group_, Input, this);
+    if (result_code_ != SQLITE_OK) {
+      error_message_ = std::string("Failed to add changeset: ") +
+                       sqlite3_errstr(result_code_);
+    }
+    break;
+  case kGroupOutput:
+    result_code_ =
+        sqlite3changegroup_output_strm(group_->group_, Output, this);
+    if (result_code_ == SQLITE_OK && !pending_.empty() && !FlushChunk()) {
+      result_code_ = SQLITE_ABORT;
+    }
+    if (result_code_ != SQLITE_OK) {
+      error_message_ = std::string("Failed to generate changeset: ") +
+                       sqlite3_errstr(result_code_);
+    }
+    break;
+  case kSnapshot:
+    result_code_ = CopySnapshot(db);
+    break;
+  }
+
+  if (connection_lock_.owns_lock()) {
+    connection_lock_.unlock();
+  }
+  tsfn_.BlockingCall([this](Napi::Env env, Napi::Function) {
+    if (env != nullptr) {
+      Complete(env);
+    }
+  });
+  tsfn_.Release();
+}
+
+bool ChangesetStreamJob::CallJs(
+    std::function<Napi::Value(Napi::Env)> call,
+    std::function<bool(Napi::Env, Napi::Value)> on_result) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed_ || cancelled_) {
+      return false;
+    }
+    waiting_ = true;
+    on_result_ = std::move(on_result);
+  }
+
+  if (connection_lock_.mutex() != nullptr) {
+    connection_lock_.unlock();
+  }
+  napi_status status = tsfn_.BlockingCall(
+      [this, call](Napi::Env env, Napi::Function) {
+        if (env == nullptr) {
+          return;
+        }
+        Napi::HandleScope scope(env);
+        try {
+          Settle(env, call(env));
+        } catch (const Napi::Error &error) {
+          Fail(env, error.Value());
+        }
+      });
+
+  bool ok;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (status != napi_ok) {
+      cancelled_ = true;
+    }
+    resumed_.wait(lock, [this]() { return !waiting_ || cancelled_; });
+    ok = !failed_ && !cancelled_;
+  }
+  if (connection_lock_.mutex() != nullptr) {
+    connection_lock_.lock();
+  }
+  return ok;
+}
+
+bool ChangesetStreamJob::Failed() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return failed_;
+}
+
+int ChangesetStreamJob::ApplyChangeset(sqlite3 *db) {
+  // SQLite rolls back only when the apply itself fails. A filter that throws
+  // lets the rest of the changeset through, yet rejects the promise, so the
+  // apply runs in a savepoint of its own that is rolled back in that case.
+  int rc = sqlite3_exec(db, "SAVEPOINT phstr_changeset_apply", nullptr,
+                        nullptr, nullptr);
+  if (rc != SQLITE_OK) {
+    error_message_ =
+        std::string("Failed to apply changeset: ") + sqlite3_errmsg(db);
+    return rc;
+  }
+  rc = sqlite3changeset_apply_strm(db, Input, this,
+                                   filter_.IsEmpty() ? nullptr : Filter,
+                                   Conflict, this);
+  if (rc == SQLITE_OK && !Failed()) {
+    rc = sqlite3_exec(db, "RELEASE phstr_changeset_apply", nullptr, nullptr,
+                      nullptr);
+    if (rc == SQLITE_OK) {
+      return rc;
+    }
+  }
+  if (rc != SQLITE_OK) {
+    error_message_ =
+        std::string("Failed to apply changeset: ") + sqlite3_errmsg(db);
+    // Closing the savepoint clears the connection's error state
+    extended_code_ = sqlite3_extended_errcode(db);
+  }
+  sqlite3_exec(db,
+               "ROLLBACK TO phstr_changeset_apply; "
+               "RELEASE phstr_changeset_apply",
+               nullptr, nullptr, nullptr);
+  return rc;
+}
+
+void ChangesetStreamJob::ReserveChunk() {
+  pending_.reserve(std::min(chunk_size_, kMaxChunkReserve));
+}
+
+void ChangesetStreamJob::Settle(Napi::Env env, Napi::Value result) {
+  if (result.IsPromise()) {
+    Napi::Object promise = result.As<Napi::Object>();
+    promise.Get("then").As<Napi::Function>().Call(
+        promise,
+        {Napi::Function::New(env,
+                             [this](const Napi::CallbackInfo &info) {
+                               Settle(info.Env(), info[0]);
+                             }),
+         Napi::Function::New(env, [this](const Napi::CallbackInfo &info) {
+           Fail(info.Env(), info[0]);
+         })});
+    return;
+  }
+
+  try {
+    if (on_result_ && !on_result_(env, result)) {
+      Fail(env, env.GetAndClearPendingException().Value());
+      return;
+    }
+  } catch (const Napi::Error &error) {
+    Fail(env, error.Value());
+    return;
+  }
+  Resume();
+}
+
+void ChangesetStreamJob::Fail(Napi::Env env, Napi::Value error) {
+  if (error_.IsEmpty()) {
+    // Held in an object because primitives cannot be referenced
+    Napi::Object holder = Napi::Object::New(env);
+    holder.Set("error", error);
+    error_ = Napi::Persistent(holder);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    failed_ = true;
+  }
+  Resume();
+}
+
+void ChangesetStreamJob::Resume() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    waiting_ = false;
+    on_result_ = nullptr;
+  }
+  resumed_.notify_one();
+}
+
+bool ChangesetStreamJob::FlushChunk() {
+  if (on_chunk_.IsEmpty()) {
+    return WriteChunk();
+  }
+  // The Buffer takes over the string, so chunks are not copied again
+  auto chunk = std::make_shared<std::string>(std::move(pending_));
+  pending_.clear();
+  ReserveChunk();
+  return CallJs(
+      [this, chunk](Napi::Env env) -> Napi::Value {
+        Napi::Buffer<char> buffer = Napi::Buffer<char>::NewOrCopy(
+            env, chunk->data(), chunk->size(),
+            [chunk](Napi::Env, char *) {});
+        return on_chunk_.Call({buffer});
+      },
+      nullptr);
+}
+
+bool ChangesetStreamJob::WriteChunk() {
+  const char *data = pending_.data();
+  size_t size = pending_.size();
+  while (size > 0) {
+#ifdef _WIN32
+    int written = _write(fd_, data,
+                         static_cast<unsigned int>(
+                             std::min(size, static_cast<size_t>(INT_MAX))));
+#else
+    ssize_t written = write(fd_, data, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // Node often makes pipes non-blocking: wait for the reader
+      pollfd ready = {fd_, POLLOUT, 0};
+      poll(&ready, 1, -1);
+      continue;
+    }
+#endif
+    if (written < 0) {
+      write_errno_ = errno;
+      return false;
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+  pending_.clear();
+  return true;
+}
+
+int ChangesetStreamJob::CopySnapshot(sqlite3 *db) {
+  if (sqlite3_db_filename(db, schema_.c_str()) == nullptr) {
+    error_message_ = "unknown database " + schema_;
+    return SQLITE_ERROR;
+  }
+  // Inside an explicit transaction, sqlite_dbpage would read the
+  // transaction's uncommitted pages. A job queued earlier may have started
+  // one since streamBackup() checked.
+  if (!sqlite3_get_autocommit(db)) {
+    error_message_ = "cannot stream a backup inside a transaction";
+    return SQLITE_MISUSE;
+  }
+
+  // sqlite_dbpage reads every schema in one read transaction, held until
+  // the statement is finalized
+  sqlite3_stmt *stmt = nullptr;
+  int r = sqlite3_prepare_v2(
+      db, "SELECT data FROM sqlite_dbpage(?1) ORDER BY pgno", -1, &stmt,
+      nullptr);
+  if (r == SQLITE_OK) {
+    r = sqlite3_bind_text(stmt, 1, schema_.c_str(), -1, SQLITE_TRANSIENT);
+  }
+  while (r == SQLITE_OK && (r = sqlite3_step(stmt)) == SQLITE_ROW) {
+    const char *page = static_cast<const char *>(sqlite3_column_blob(stmt, 0));
+    int size = sqlite3_column_bytes(stmt, 0);
+    if (pages_written_ == 0 && size >= 100) {
+      // The page count in the header is valid when its version-valid-for
+      // number matches the change counter
+      const unsigned char *header =
+          reinterpret_cast<const unsigned char *>(page);
+      if (std::memcmp(header + 24, header + 92, 4) == 0) {
+        total_pages_ = (int64_t{header[28]} << 24) | (header[29] << 16) |
+                       (header[30] << 8) | header[31];
+      }
+    }
+    pending_.append(page, static_cast<size_t>(size));
+    pages_written_++;
+    r = SQLITE_OK;
+    if (pending_.size() >= chunk_size_ && !FlushChunk()) {
+      r = SQLITE_ABORT;
+    }
+    ReportSnapshotProgress(false);
+  }
+  if (r == SQLITE_DONE) {
+    r = pending_.empty() || FlushChunk() ? SQLITE_OK : SQLITE_ABORT;
+    total_pages_ = pages_written_;
+    ReportSnapshotProgress(true);
+  }
+  if (r != SQLITE_OK && r != SQLITE_ABORT) {
+    error_message_ =
+        std::string("Failed to read database pages: ") + sqlite3_errmsg(db);
+  }
+  sqlite3_finalize(stmt);
+  return r;
+}
+
+void ChangesetStreamJob::ReportSnapshotProgress(bool last) {
+  if (on_progress_.IsEmpty() || total_pages_ == 0 ||
+      (!last && pages_written_ < next_page_progress_)) {
+    return;
+  }
+  // About a hundred reports, and one at the end
+  int64_t step = std::max<int64_t>(total_pages_ / 100, 1);
+  next_page_progress_ = pages_written_ + step;
+
+  int64_t total = std::max(total_pages_, pages_written_);
+  int64_t remaining = total - pages_written_;
+  tsfn_.NonBlockingCall([this, total, remaining](Napi::Env env,
+                                                 Napi::Function) {
+    if (env == nullptr || on_progress_.IsEmpty()) {
+      return;
+    }
+    Napi::HandleScope scope(env);
+    Napi::Object progress = Napi::Object::New(env);
+    progress.Set("totalPages",
+                 Napi::Number::New(env, static_cast<double>(total)));
+    progress.Set("remainingPages",
+                 Napi::Number::New(env, static_cast<double>(remaining)));
+    try {
+      on_progress_.Call({progress});
+    } catch (...) {
+      // Like backup(), errors in the progress callback are ignored
+    }
+  });
+}
+
+bool ChangesetStreamJob::PullChunk() {
+  return CallJs(
+      [this](Napi::Env) -> Napi::Value {
+        Napi::Object iterator = iterator_.Value();
+        return iterator.Get("next").As<Napi::Function>().Call(iterator, {});
+      },
+      [this](Napi::Env env, Napi::Value result) {
+        if (!result.IsObject()) {
+          node::THROW_ERR_INVALID_ARG_TYPE(
+              env, "The changeset iterator must return result objects.");
+          return false;
+        }
+        Napi::Object entry = result.As<Napi::Object>();
+        if (entry.Get("done").ToBoolean().Value()) {
+          input_done_ = true;
+          return true;
+        }
+        Napi::Value value = entry.Get("value");
+        if (!value.IsTypedArray() ||
+            value.As<Napi::TypedArray>().TypedArrayType() !=
+                napi_uint8_array) {
+          node::THROW_ERR_INVALID_ARG_TYPE(
+              env, "Changeset chunks must be Buffers or Uint8Arrays.");
+          return false;
+        }
+        Napi::Uint8Array chunk = value.As<Napi::Uint8Array>();
+        input_.assign(reinterpret_cast<const char *>(chunk.Data()),
+                      chunk.ElementLength());
+        input_offset_ = 0;
+        return true;
+      });
+}
+
+int ChangesetStreamJob::Output(void *context, const void *data, int size) {
+  ChangesetStreamJob *job = static_cast<ChangesetStreamJob *>(context);
+  job->pending_.append(static_cast<const char *>(data),
+                       static_cast<size_t>(size));
+  if (job->pending_.size() < job->chunk_size_) {
+    return SQLITE_OK;
+  }
+  return job->FlushChunk() ? SQLITE_OK : SQLITE_ABORT;
+}
+
+int ChangesetStreamJob::Input(void *context, void *data, int *size) {
+  ChangesetStreamJob *job = static_cast<ChangesetStreamJob *>(context);
+  // A callback threw: stop reading, so that the apply fails
+  if (job->Failed()) {
+    return SQLITE_ABORT;
+  }
+  if (job->from_memory_) {
+    size_t count = std::min(static_cast<size_t>(*size),
+                            job->source_.size() - job->bytes_read_);
+    if (count > 0) {
+      std::memcpy(data, job->source_.data() + job->bytes_read_, count);
+    }
+    job->bytes_read_ += count;
+    *size = static_cast<int>(count);
+    job->ReportProgress();
+    return SQLITE_OK;
+  }
+
+  // Empty chunks are skipped; an empty read tells SQLite the input ended
+  while (job->input_offset_ == job->input_.size()) {
+    if (job->input_done_) {
+      *size = 0;
+      return SQLITE_OK;
+    }
+    if (!job->PullChunk()) {
+      return SQLITE_ABORT;
+    }
+  }
+  size_t count = std::min(static_cast<size_t>(*size),
+                          job->input_.size() - job->input_offset_);
+  std::memcpy(data, job->input_.data() + job->input_offset_, count);
+  job->input_offset_ += count;
+  job->bytes_read_ += count;
+  *size = static_cast<int>(count);
+  job->ReportProgress();
+  return SQLITE_OK;
+}
+
+void ChangesetStreamJob::ReportProgress() {
+  if (on_progress_.IsEmpty() || bytes_read_ < next_progress_) {
+    return;
+  }
+  // About a hundred reports for a buffer, and one at its end
+  size_t step = std::max(source_.size() / 100, kProgressInterval);
+  next_progress_ = bytes_read_ + step;
+  if (from_memory_ && bytes_read_ < source_.size()) {
+    next_progress_ = std::min(next_progress_, source_.size());
+  }
+
+  // SQLite reads a little ahead, so the count trails the bytes slightly
+  sqlite3_int64 changes =
+      sqlite3_total_changes64(database_->connection()) - initial_changes_;
+  size_t bytes = bytes_read_;
+  tsfn_.NonBlockingCall([this, changes, bytes](Napi::Env env,
+                                               Napi::Function) {
+    if (env == nullptr || on_progress_.IsEmpty()) {
+      return;
+    }
+    Napi::HandleScope scope(env);
+    Napi::Object progress = Napi::Object::New(env);
+    progress.Set("changes",
+                 Napi::Number::New(env, static_cast<double>(changes)));
+    progress.Set("bytes", Napi::Number::New(env, static_cast<double>(bytes)));
+    if (from_memory_) {
+      progress.Set("totalBytes",
+                   Napi::Number::New(env, static_cast<double>(source_.size())));
+    }
+    try {
+      on_progress_.Call({progress});
+    } catch (...) {
+      // Like backup(), errors in the progress callback are ignored
+    }
+  });
+}
+
+int ChangesetStreamJob::Filter(void *context, const char *table) {
+  ChangesetStreamJob *job = static_cast<ChangesetStreamJob *>(context);
+  std::string name = table;
+  // A filter that throws excludes the table, and the error rejects the
+  // promise once the apply has been rolled back
+  int include = 0;
+  job->CallJs(
+      [job, name](Napi::Env env) -> Napi::Value {
+        return job->filter_.Call({Napi::String::New(env, name)});
+      },
+      [&include](Napi::Env, Napi::Value result) {
+        include = result.ToBoolean().Value() ? 1 : 0;
+        return true;
+      });
+  return include;
+}
+
+int ChangesetStreamJob::Conflict(void *context, int type,
+                                 sqlite3_changeset_iter *iter) {
+  ChangesetStreamJob *job = static_cast<ChangesetStreamJob *>(context);
+  if (job->policies_) {
+    std::optional<int> decision = job->policies_->Decide(type, iter);
+    if (decision) {
+      return *decision;
+    }
+  }
+  if (job->on_conflict_.IsEmpty()) {
+    if (job->policies_) {
+      job->policies_->CountFallback(SQLITE_CHANGESET_OMIT, false);
+    }
+    return SQLITE_CHANGESET_OMIT;
+  }
+  int decision = SQLITE_CHANGESET_ABORT;
+  bool ok = job->CallJs(
+      [job, type](Napi::Env env) -> Napi::Value {
+        return job->on_conflict_.Call({Napi::Number::New(env, type)});
+      },
+      [&decision](Napi::Env, Napi::Value result) {
+        // SQLite rejects anything else with SQLITE_MISUSE
+        decision =
+            result.IsNumber() ? result.As<Napi::Number>().Int32Value() : -1;
+        return true;
+      });
+  if (!ok) {
+    decision = SQLITE_CHANGESET_ABORT;
+  }
+  if (job->policies_) {
+    job->policies_->CountFallback(decision, true);
+  }
+  return decision;
+}
+
+void ChangesetStreamJob::CloseIterator(Napi::Env env) {
+  // Lets the source release its resources, as for-await does on break
+  try {
+    Napi::Object iterator = iterator_.Value();
+    Napi::Value close = iterator.Get("return");
+    if (!close.IsFunction()) {
+      return;
+    }
+    Napi::Value result = close.As<Napi::Function>().Call(iterator, {});
+    if (result.IsPromise()) {
+      Napi::Object promise = result.As<Napi::Object>();
+      promise.Get("catch").As<Napi::Function>().Call(
+          promise,
+          {Napi::Function::New(env, [](const Napi::CallbackInfo &) {})});
+    }
+  } catch (const Napi::Error &) {
+    // The outcome of the apply is what gets reported
+  }
+}
+
+void ChangesetStreamJob::Complete(Napi::Env env) {
+  Napi::HandleScope scope(env);
+
+  if ((kind_ == kApply || kind_ == kGroupAdd) && !input_done_) {
+    CloseIterator(env);
+  }
+
+  bool resolved = false;
+  Napi::Value value = env.Undefined();
+  if (!error_.IsEmpty()) {
+    value = error_.Value().Get("error");
+  } else if (write_errno_ != 0) {
+    Napi::Error error = Napi::Error::New(
+        env, std::string("Failed to write backup: ") +
+                 std::strerror(write_errno_));
+    error.Set("errno", Napi::Number::New(env, write_errno_));
+    error.Set("syscall", Napi::String::New(env, "write"));
+    value = error.Value();
+  } else if (!policy_error_.empty()) {
+    node::THROW_ERR_INVALID_ARG_VALUE(env, policy_error_.c_str());
+    value = env.GetAndClearPendingException().Value();
+  } else if (result_code_ == SQLITE_OK ||
+             (kind_ == kApply && result_code_ == SQLITE_ABORT)) {
+    // SQLITE_ABORT is not an error: a conflict handler asked to abort
+    resolved = true;
+    if (kind_ == kApply && policies_) {
+      value = policies_->Result(env, result_code_ == SQLITE_OK);
+    } else if (kind_ == kApply) {
+      value = Napi::Boolean::New(env, result_code_ == SQLITE_OK);
+    } else if (kind_ == kSnapshot) {
+      value = Napi::Number::New(env, static_cast<double>(pages_written_));
+    }
+  } else {
+    // Unless ApplyChangeset() saved it, the connection has been idle since
+    // the failure, so its error state still describes it
+    node::ThrowEnhancedSqliteError(
+        env,
+        database_ != nullptr && extended_code_ == 0 ? database_->connection()
+                                                    : nullptr,
+        result_code_, error_message_);
+    value = env.GetAndClearPendingException().Value();
+    if (extended_code_ != 0) {
+      value.As<Napi::Object>().Set("sqliteExtendedCode",
+                                   Napi::Number::New(env, extended_code_));
+    }
+  }
+
+  if (resolved) {
+    deferred_.Resolve(value);
+  } else {
+    deferred_.Reject(value);
+  }
+  if (database_ != nullptr) {
+    database_->QueryFinished();
+  }
+  if (group_ != nullptr) {
+    group_->busy_ = false;
+  }
+
+  error_.Reset();
+  iterator_.Reset();
+  on_chunk_.Reset();
+  on_conflict_.Reset();
+  filter_.Reset();
+  on_progress_.Reset();
+  session_ref_.Reset();
+  group_ref_.Reset();
+  database_ref_.Reset();
+}
+
+} // namespace sqlite
+} // namespace photostructure
@@ -0,0 +1,219 @@
+#ifndef SRC_CHANGESET_STREAM_H_
+#define SRC_CHANGESET_STREAM_H_
+
+#include <napi.h>
+#include <sqlite3.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "changegroup.h"
+#include "conflict_policy.h"
+#include "sqlite_impl.h"
+
+namespace photostructure {
+namespace sqlite {
+
+// Moves a changeset between SQLite and JavaScript in chunks, with
+// sqlite3session_changeset_strm(), sqlite3session_patchset_strm(),
+// sqlite3changeset_apply_strm() and the sqlite3changegroup _strm functions.
+// Database snapshots for streamBackup() are produced the same way, page by
+// page from the sqlite_dbpage virtual table.
+//
+// The _strm functions call back synchronously for every piece of data, so
+// they run on a dedicated thread that blocks while JavaScript consumes or
+// produces a chunk. Only a chunk or two is ever held in memory, whatever the
+// size of the changeset. The libuv pool is not used because the JavaScript
+// end of a stream usually needs it (to write to a file, for example).
+//
+// Jobs on a connection are queued with DatabaseSync::EnqueueJob(), so
+// synchronous calls on the connection fail until the returned promise
+// settles. A ChangeGroup is marked busy instead.
+class ChangesetStreamJob {
+public:
+  static constexpr size_t kDefaultChunkSize = 64 * 1024;
+  // Most memory reserved for a chunk up front; larger ones grow as needed
+  static constexpr size_t kMaxChunkReserve = 1024 * 1024;
+  // Minimum input between two progress reports
+  static constexpr size_t kProgressInterval = 256 * 1024;
+
+  // { onConflict, filter, policies, progress } for the apply jobs
+  struct ApplyOptions {
+    Napi::Function on_conflict;
+    Napi::Function filter;
+    Napi::Function on_progress;
+    std::unique_ptr<ConflictPolicies> policies;
+  };
+
+  // Reads the options of applyChangesetStream() and applyChangesetAsync().
+  // Returns false with a pending exception.
+  static bool ParseApplyOptions(Napi::Env env, Napi::Value value,
+                                ApplyOptions *options);
+
+  // Calls `on_chunk` with consecutive pieces of the session's changeset (or
+  // patchset) of about `chunk_size` bytes. A promise returned by `on_chunk`
+  // is awaited before more is generated. Resolves with undefined.
+  static Napi::Promise Generate(Napi::Env env, Session *session,
+                                bool patchset, size_t chunk_size,
+                                Napi::Function on_chunk);
+
+  // Applies a changeset read from `iterator`, a sync or async iterator of
+  // Uint8Arrays. Resolves like applyChangeset(): true once applied, false if
+  // a conflict handler aborted, or a result object when `policies` is set.
+  static Napi::Promise Apply(Napi::Env env, DatabaseSync *database,
+                             Napi::Object iterator, ApplyOptions options);
+
+  // Applies `changeset` the same way, reading it from memory. The buffer is
+  // copied, so the caller may reuse it at once.
+  static Napi::Promise ApplyBuffer(Napi::Env env, DatabaseSync *database,
+                                   Napi::Uint8Array changeset,
+                                   ApplyOptions options);
+
+  // Adds a changeset read from `iterator` to `group`. Resolves with
+  // undefined.
+  static Napi::Promise AddToGroup(Napi::Env env, ChangeGroup *group,
+                                  Napi::Object iterator);
+
+  // Calls `on_chunk` with the combined changeset of `group`, like Generate()
+  static Napi::Promise OutputGroup(Napi::Env env, ChangeGroup *group,
+                                   size_t chunk_size, Napi::Function on_chunk);
+
+  // Writes the pages of `schema` to `on_chunk` (like Generate()) or, if
+  // `on_chunk` is empty, straight to the file descriptor `fd` from the
+  // worker. The pages are read by a single statement, so they form one
+  // consistent snapshot: a database file image. Resolves with the number of
+  // pages written. `on_progress` receives { totalPages, remainingPages }.
+  static Napi::Promise Snapshot(Napi::Env env, DatabaseSync *database,
+                                const std::string &schema, size_t chunk_size,
+                                Napi::Function on_chunk, int fd,
+                                Napi::Function on_progress);
+
+  // Calls source[Symbol.asyncIterator]() or source[Symbol.iterator]().
+  // Returns an empty value with a pending exception if `source` is not an
+  // iterable of chunks.
+  static Napi::Value OpenIterator(Napi::Env env, Napi::Value source);
+
+private:
+  enum Kind {
+    kChangeset,
+    kPatchset,
+    kApply,
+    kGroupAdd,
+    kGroupOutput,
+    kSnapshot
+  };
+
+  // `database` is null for changegroup jobs, which need no connection
+  ChangesetStreamJob(Napi::Env env, DatabaseSync *database, Kind kind);
+  static ChangesetStreamJob *ForApply(Napi::Env env, DatabaseSync *database,
+                                      ApplyOptions options);
+  static ChangesetStreamJob *ForGroup(Napi::Env env, ChangeGroup *group,
+                                      Kind kind);
+
+  // JS thread
+  void Start();
+  void Complete(Napi::Env env);
+  void Settle(Napi::Env env, Napi::Value result);
+  void Fail(Napi::Env env, Napi::Value error);
+  void Resume();
+  void CloseIterator(Napi::Env env);
+
+  // Worker thread
+  void Run();
+  // Runs `call` on the JS thread, waits for the promise it returns (if any)
+  // and passes the result to `on_result`, still on the JS thread. Returns
+  // false once the job has failed or been cancelled.
+  bool CallJs(std::function<Napi::Value(Napi::Env)> call,
+              std::function<bool(Napi::Env, Napi::Value)> on_result);
+  // True once a JS callback has thrown or rejected
+  bool Failed();
+  int ApplyChangeset(sqlite3 *db);
+  void ReserveChunk();
+  bool FlushChunk();
+  bool WriteChunk();
+  bool PullChunk();
+  void ReportProgress();
+  int CopySnapshot(sqlite3 *db);
+  void ReportSnapshotProgress(bool last);
+  static int Output(void *context, const void *data, int size);
+  static int Input(void *context, void *data, int *size);
+  static int Filter(void *context, const char *table);
+  static int Conflict(void *context, int type, sqlite3_changeset_iter *iter);
+
+  Kind kind_;
+  Napi::Env env_;
+  DatabaseSync *database_;
+  sqlite3_session *session_ = nullptr;
+  ChangeGroup *group_ = nullptr;
+  Napi::ObjectReference database_ref_;
+  Napi::ObjectReference session_ref_;
+  Napi::ObjectReference group_ref_;
+  Napi::ObjectReference iterator_;
+  Napi::FunctionReference on_chunk_;
+  Napi::FunctionReference on_conflict_;
+  Napi::FunctionReference filter_;
+  Napi::FunctionReference on_progress_;
+  Napi::Promise::Deferred deferred_;
+
+  std::thread thread_;
+  Napi::ThreadSafeFunction tsfn_;
+  std::shared_ptr<std::mutex> query_mutex_;
+  // Held by the worker while it uses the connection, and released while it
+  // waits for JavaScript so that statement finalizers can run
+  std::unique_lock<std::mutex> connection_lock_;
+
+  // Hand-off between the worker and the JS thread
+  std::mutex mutex_;
+  std::condition_variable resumed_;
+  bool waiting_ = false;
+  bool failed_ = false;
+  bool cancelled_ = false;
+  std::function<bool(Napi::Env, Napi::Value)> on_result_;
+  Napi::ObjectReference error_; // { error } thrown by a JS callback
+
+  // Generation: output collected until it reaches chunk_size_
+  size_t chunk_size_ = kDefaultChunkSize;
+  std::string pending_;
+
+  // Application: the last chunk pulled from the iterator
+  std::string input_;
+  size_t input_offset_ = 0;
+  bool input_done_ = false;
+
+  // Application from memory: a copy of the caller's buffer
+  bool from_memory_ = false;
+  std::string source_;
+
+  // Progress: input consumed so far, and when to report it next
+  size_t bytes_read_ = 0;
+  size_t next_progress_ = 0;
+  sqlite3_int64 initial_changes_ = 0;
+
+  // Snapshot: the schema to copy and, without on_chunk_, where to write it.
+  // A failed write sets write_errno_.
+  std::string schema_;
+  int fd_ = -1;
+  int write_errno_ = 0;
+  int64_t pages_written_ = 0;
+  int64_t total_pages_ = 0;
+  int64_t next_page_progress_ = 0;
+
+  // Decided on the worker, before on_conflict_ is consulted
+  std::unique_ptr<ConflictPolicies> policies_;
+  std::string policy_error_;
+
+  int result_code_ = SQLITE_OK;
+  std::string error_message_;
+  int extended_code_ = 0; // Saved when the connection's error is cleared
+};
+
+} // namespace sqlite
+} // namespace photostructure
+
+#endif // SRC_CHANGESET_STREAM_H_
@@ -0,0 +1,298 @@
+#include "conflict_policy.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "shims/node_errors.h"
+
+namespace photostructure {
+namespace sqlite {
+
+namespace {
+
+// Orders values like SQLite does with the BINARY collation: NULL, then
+// numbers, then text, then blobs
+int TypeRank(int type) {
+  switch (type) {
+  case SQLITE_NULL:
+    return 0;
+  case SQLITE_INTEGER:
+  case SQLITE_FLOAT:
+    return 1;
+  case SQLITE_TEXT:
+    return 2;
+  default:
+    return 3;
+  }
+}
+
+int CompareValues(sqlite3_value *a, sqlite3_value *b) {
+  int type_a = sqlite3_value_type(a);
+  int type_b = sqlite3_value_type(b);
+  int rank_a = TypeRank(type_a);
+  int rank_b = TypeRank(type_b);
+  if (rank_a != rank_b) {
+    return rank_a < rank_b ? -1 : 1;
+  }
+
+  switch (rank_a) {
+  case 0:
+    return 0;
+  case 1:
+    if (type_a == SQLITE_INTEGER && type_b == SQLITE_INTEGER) {
+      sqlite3_int64 x = sqlite3_value_int64(a);
+      sqlite3_int64 y = sqlite3_value_int64(b);
+      return x < y ? -1 : (x > y ? 1 : 0);
+    } else {
+      double x = sqlite3_value_double(a);
+      double y = sqlite3_value_double(b);
+      return x < y ? -1 : (x > y ? 1 : 0);
+    }
+  default: {
+    const void *data_a = rank_a == 2 ? sqlite3_value_text(a)
+                                     : sqlite3_value_blob(a);
+    const void *data_b = rank_a == 2 ? sqlite3_value_text(b)
+                                     : sqlite3_value_blob(b);
+    int size_a = sqlite3_value_bytes(a);
+    int size_b = sqlite3_value_bytes(b);
+    int common = std::min(size_a, size_b);
+    int result = common > 0 ? std::memcmp(data_a, data_b, common) : 0;
+    if (result != 0) {
+      return result;
+    }
+    return size_a < size_b ? -1 : (size_a > size_b ? 1 : 0);
+  }
+  }
+}
+
+} // namespace
+
+bool ConflictPolicies::ParsePolicy(Napi::Env env, const std::string &table,
+                                   Napi::Value value, Policy *policy) {
+  if (value.IsString()) {
+    std::string action = value.As<Napi::String>().Utf8Value();
+    if (action == "replace") {
+      policy->action = kReplace;
+      return true;
+    }
+    if (action == "omit") {
+      policy->action = kOmit;
+      return true;
+    }
+    if (action == "abort") {
+      policy->action = kAbort;
+      return true;
+    }
+  } else if (value.IsObject() && !value.IsArray()) {
+    Napi::Value column = value.As<Napi::Object>().Get("lastWriterWins");
+    if (column.IsString() && column.As<Napi::String>().Utf8Value() != "") {
+      policy->action = kLastWriterWins;
+      policy->column = column.As<Napi::String>().Utf8Value();
+      return true;
+    }
+  }
+
+  std::string message = "The \"options.policies['" + table +
+                        "']\" policy must be \"replace\", \"omit\", "
+                        "\"abort\" or { lastWriterWins: column }.";
+  node::THROW_ERR_INVALID_ARG_VALUE(env, message.c_str());
+  return false;
+}
+
+bool ConflictPolicies::Parse(Napi::Env env, Napi::Value value) {
+  if (!value.IsObject() || value.IsArray() || value.IsFunction()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"options.policies\" argument must be an object.");
+    return false;
+  }
+
+  Napi::Object object = value.As<Napi::Object>();
+  Napi::Array names = object.GetPropertyNames();
+  for (uint32_t i = 0; i < names.Length(); i++) {
+    std::string table = names.Get(i).ToString().Utf8Value();
+    Policy policy{kOmit, "", -1};
+    if (!ParsePolicy(env, table, object.Get(table), &policy)) {
+      return false;
+    }
+    if (table == "*") {
+      default_ = policy;
+    } else {
+      tables_[table] = policy;
+    }
+  }
+  return true;
+}
+
+bool ConflictPolicies::Resolve(sqlite3 *db, std::string *error) {
+  sqlite3_stmt *stmt = nullptr;
+
+  for (auto &entry : tables_) {
+    Policy &policy = entry.second;
+    if (policy.action != kLastWriterWins) {
+      continue;
+    }
+    int r = sqlite3_prepare_v2(
+        db, "SELECT cid FROM pragma_table_info(?1, 'main') WHERE name = ?2",
+        -1, &stmt, nullptr);
+    if (r != SQLITE_OK) {
+      *error = sqlite3_errmsg(db);
+      return false;
+    }
+    sqlite3_bind_text(stmt, 1, entry.first.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, policy.column.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      policy.column_index = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    if (policy.column_index < 0) {
+      *error = "Table \"" + entry.first + "\" has no column \"" +
+               policy.column + "\" for its lastWriterWins policy.";
+      return false;
+    }
+  }
+
+  if (default_ && default_->action == kLastWriterWins) {
+    // Tables without the column fall back instead
+    int r = sqlite3_prepare_v2(
+        db,
+        "SELECT m.name, p.cid FROM main.sqlite_schema AS m "
+        "JOIN pragma_table_info(m.name, 'main') AS p "
+        "WHERE m.type = 'table' AND p.name = ?1",
+        -1, &stmt, nullptr);
+    if (r != SQLITE_OK) {
+      *error = sqlite3_errmsg(db);
+      return false;
+    }
+    sqlite3_bind_text(stmt, 1, default_->column.c_str(), -1, SQLITE_STATIC);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      const char *table =
+          reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+      default_columns_[table] = sqlite3_column_int(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+  }
+
+  last_valid_ = false;
+  return true;
+}
+
+const ConflictPolicies::Policy *ConflictPolicies::Lookup(const char *table) {
+  if (last_valid_ && last_table_ == table) {
+    return last_policy_ ? &*last_policy_ : nullptr;
+  }
+
+  last_table_ = table;
+  last_valid_ = true;
+  last_policy_.reset();
+  auto found = tables_.find(last_table_);
+  if (found != tables_.end()) {
+    last_policy_ = found->second;
+  } else if (default_ && default_->action != kLastWriterWins) {
+    last_policy_ = default_;
+  } else if (default_) {
+    auto column = default_columns_.find(last_table_);
+    if (column != default_columns_.end()) {
+      last_policy_ = default_;
+      last_policy_->column_index = column->second;
+    }
+  }
+  return last_policy_ ? &*last_policy_ : nullptr;
+}
+
+int ConflictPolicies::Count(int decision, int64_t *by_policy) {
+  (*by_policy)++;
+  if (decision == SQLITE_CHANGESET_REPLACE) {
+    replaced_++;
+  } else if (decision == SQLITE_CHANGESET_OMIT) {
+    omitted_++;
+  }
+  return decision;
+}
+
+std::optional<int> ConflictPolicies::Decide(int type,
+                                            sqlite3_changeset_iter *iter) {
+  conflicts_++;
+
+  const char *table = nullptr;
+  int columns = 0;
+  int op = 0;
+  if (sqlite3changeset_op(iter, &table, &columns, &op, nullptr) !=
+          SQLITE_OK ||
+      table == nullptr) {
+    return std::nullopt;
+  }
+  const Policy *policy = Lookup(table);
+  if (policy == nullptr) {
+    return std::nullopt;
+  }
+
+  if (policy->action == kOmit) {
+    return Count(SQLITE_CHANGESET_OMIT, &by_omit_);
+  }
+  if (policy->action == kAbort) {
+    return Count(SQLITE_CHANGESET_ABORT, &by_abort_);
+  }
+  // SQLite only accepts REPLACE when there is a local row to replace, so
+  // NOTFOUND, CONSTRAINT and FOREIGN_KEY conflicts fall back
+  if (type != SQLITE_CHANGESET_DATA && type != SQLITE_CHANGESET_CONFLICT) {
+    return std::nullopt;
+  }
+  if (policy->action == kReplace) {
+    return Count(SQLITE_CHANGESET_REPLACE, &by_replace_);
+  }
+
+  int column = policy->column_index;
+  if (column < 0 || column >= columns) {
+    return std::nullopt;
+  }
+  sqlite3_value *local = nullptr;
+  sqlite3_value *incoming = nullptr;
+  if (sqlite3changeset_conflict(iter, column, &local) != SQLITE_OK) {
+    return std::nullopt;
+  }
+  if (op == SQLITE_DELETE) {
+    sqlite3changeset_old(iter, column, &incoming);
+  } else {
+    sqlite3changeset_new(iter, column, &incoming);
+    // An UPDATE that left the column alone carries it as the old value
+    if (incoming == nullptr && op == SQLITE_UPDATE) {
+      sqlite3changeset_old(iter, column, &incoming);
+    }
+  }
+  if (local == nullptr || incoming == nullptr) {
+    return std::nullopt;
+  }
+  // Ties keep the local row
+  return Count(CompareValues(incoming, local) > 0 ? SQLITE_CHANGESET_REPLACE
+                                                  : SQLITE_CHANGESET_OMIT,
+               &by_last_writer_wins_);
+}
+
+void ConflictPolicies::CountFallback(int decision, bool from_callback) {
+  Count(decision, from_callback ? &by_callback_ : &by_default_);
+}
+
+Napi::Object ConflictPolicies::Result(Napi::Env env, bool applied) const {
+  auto number = [env](int64_t value) {
+    return Napi::Number::New(env, static_cast<double>(value));
+  };
+
+  Napi::Object by_policy = Napi::Object::New(env);
+  by_policy.Set("replace", number(by_replace_));
+  by_policy.Set("omit", number(by_omit_));
+  by_policy.Set("abort", number(by_abort_));
+  by_policy.Set("lastWriterWins", number(by_last_writer_wins_));
+  by_policy.Set("onConflict", number(by_callback_));
+  by_policy.Set("default", number(by_default_));
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("applied", Napi::Boolean::New(env, applied));
+  result.Set("conflicts", number(conflicts_));
+  result.Set("replaced", number(replaced_));
+  result.Set("omitted", number(omitted_));
+  result.Set("byPolicy", by_policy);
+  return result;
+}
+
+} // namespace sqlite
+} // namespace photostructure
@@ -0,0 +1,84 @@
+#ifndef SRC_CONFLICT_POLICY_H_
+#define SRC_CONFLICT_POLICY_H_
+
+#include <napi.h>
+#include <sqlite3.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace photostructure {
+namespace sqlite {
+
+// Declarative conflict handling for applyChangeset() and
+// applyChangesetStream(), given as `options.policies`:
+//
+//   { items: "replace", logs: "omit", notes: { lastWriterWins: "mtime" },
+//     "*": "abort" }
+//
+// Conflicts covered by a policy are decided here, without calling into
+// JavaScript. The others fall back to `onConflict`, or are omitted.
+//
+// Decide() runs inside the conflict handler, possibly on a worker thread, so
+// it only touches the changeset iterator and the counters.
+class ConflictPolicies {
+public:
+  // Reads `options.policies`. Returns false with a pending exception.
+  bool Parse(Napi::Env env, Napi::Value value);
+
+  // Finds the lastWriterWins columns in the main schema of `db`. Must run
+  // while the connection is otherwise idle. Returns false and sets `error`
+  // if a named table lacks its column.
+  bool Resolve(sqlite3 *db, std::string *error);
+
+  // The decision for a conflict, or nothing if it should fall back
+  std::optional<int> Decide(int type, sqlite3_changeset_iter *iter);
+
+  // Records what the fallback decided for a conflict Decide() passed on
+  void CountFallback(int decision, bool from_callback);
+
+  // { applied, conflicts, replaced, omitted, byPolicy }
+  Napi::Object Result(Napi::Env env, bool applied) const;
+
+private:
+  enum Action { kReplace, kOmit, kAbort, kLastWriterWins };
+
+  struct Policy {
+    Action action;
+    std::string column;
+    // Index of `column` in the table, once resolved
+    int column_index = -1;
+  };
+
+  static bool ParsePolicy(Napi::Env env, const std::string &table,
+                          Napi::Value value, Policy *policy);
+  const Policy *Lookup(const char *table);
+  int Count(int decision, int64_t *by_policy);
+
+  std::unordered_map<std::string, Policy> tables_;
+  std::optional<Policy> default_;
+  // lastWriterWins via "*", by table, for tables that have the column
+  std::unordered_map<std::string, int> default_columns_;
+
+  // Changes arrive grouped by table, so the last lookup is usually reused
+  std::string last_table_;
+  bool last_valid_ = false;
+  std::optional<Policy> last_policy_;
+
+  int64_t conflicts_ = 0;
+  int64_t replaced_ = 0;
+  int64_t omitted_ = 0;
+  int64_t by_replace_ = 0;
+  int64_t by_omit_ = 0;
+  int64_t by_abort_ = 0;
+  int64_t by_last_writer_wins_ = 0;
+  int64_t by_callback_ = 0;
+  int64_t by_default_ = 0;
+};
+
+} // namespace sqlite
+} // namespace photostructure
+
+#endif // SRC_CONFLICT_POLICY_H_
@@ -0,0 +1,629 @@
+#include "database_pool.h"
+
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+#include "shims/sqlite_errors.h"
+
+namespace photostructure {
+namespace sqlite {
+
+namespace {
+
+// sqlite3_stmt_readonly() is true for BEGIN, COMMIT, ROLLBACK, SAVEPOINT,
+// RELEASE, ATTACH and DETACH, yet each changes the state of the connection
+// it runs on: a transaction started on a reader would hold its snapshot
+// open, and later statements of the transaction would go to other readers.
+// These run on the writer, which runs everything in call order.
+bool ChangesConnectionState(sqlite3_stmt *statement) {
+  if (sqlite3_stmt_isexplain(statement) != 0) {
+    return false;
+  }
+  const char *sql = sqlite3_sql(statement);
+  // Skip whitespace and comments before the first keyword
+  while (*sql != '\0') {
+    if (std::isspace(static_cast<unsigned char>(*sql))) {
+      sql++;
+    } else if (sql[0] == '-' && sql[1] == '-') {
+      const char *end = std::strchr(sql, '\n');
+      sql = end != nullptr ? end + 1 : sql + std::strlen(sql);
+    } else if (sql[0] == '/' && sql[1] == '*') {
+      const char *end = std::strstr(sql + 2, "*/");
+      sql = end != nullptr ? end + 2 : sql + std::strlen(sql);
+    } else {
+      break;
+    }
+  }
+
+  std::string keyword;
+  while (std::isalpha(static_cast<unsigned char>(*sql))) {
+    keyword += static_cast<char>(
+        std::toupper(static_cast<unsigned char>(*sql++)));
+  }
+  static const char *const kKeywords[] = {
+      "BEGIN",   "COMMIT", "END",    "ROLLBACK", "SAVEPOINT",
+      "RELEASE", "ATTACH", "DETACH"};
+  for (const char *candidate : kKeywords) {
+    if (keyword == candidate) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+// PoolConnection Implementation
+
+sqlite3_stmt *PoolConnection::Prepare(const std::string &sql, size_t capacity,
+                                      int *result) {
+  auto it = statements.find(sql);
+  if (it != statements.end()) {
+    lru.splice(lru.begin(), lru, it->second.lru_position);
+    *result = SQLITE_OK;
+    return it->second.statement;
+  }
+
+  sqlite3_stmt *statement = nullptr;
+  *result = sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT,
+                               &statement, nullptr);
+  if (*result != SQLITE_OK || statement == nullptr) {
+    if (*result == SQLITE_OK) {
+      // Empty or comment-only SQL
+      *result = SQLITE_MISUSE;
+    }
+    return nullptr;
+  }
+
+  if (capacity == 0) {
+    // Caching is disabled; the job finalizes the statement when it settles
+    return statement;
+  }
+
+  while (statements.size() >= capacity) {
+    auto victim = statements.find(lru.back());
+    sqlite3_finalize(victim->second.statement);
+    statements.erase(victim);
+    lru.pop_back();
+  }
+
+  lru.push_front(sql);
+  statements.emplace(sql, CachedStatement{statement, lru.begin()});
+  return statement;
+}
+
+void PoolConnection::Close() {
+  for (auto &entry : statements) {
+    sqlite3_finalize(entry.second.statement);
+  }
+  statements.clear();
+  lru.clear();
+
+  if (db) {
+    sqlite3_close_v2(db);
+    db = nullptr;
+  }
+}
+
+// DatabasePool Implementation
+
+Napi::Object DatabasePool::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(
+      env, "DatabasePool",
+      {InstanceMethod("exec", &DatabasePool::Exec),
+       InstanceMethod("run", &DatabasePool::Run),
+       InstanceMethod("get", &DatabasePool::Get),
+       InstanceMethod("all", &DatabasePool::All),
+       InstanceMethod("close", &DatabasePool::Close),
+       InstanceAccessor("isOpen", &DatabasePool::IsOpenGetter, nullptr),
+       InstanceAccessor("readers", &DatabasePool::ReadersGetter, nullptr)});
+
+  exports.Set("DatabasePool", func);
+  return exports;
+}
+
+// Opens one pool connection, or throws with the connection's error
+static sqlite3 *OpenPoolConnection(Napi::Env env, const std::string &location,
+                                   int flags, int timeout) {
+  sqlite3 *db = nullptr;
+  int result = sqlite3_open_v2(location.c_str(), &db, flags, nullptr);
+  if (result != SQLITE_OK) {
+    node::ThrowEnhancedSqliteError(env, db, result,
+                                   std::string("Failed to open database: ") +
+                                       sqlite3_errmsg(db));
+    sqlite3_close(db);
+    return nullptr;
+  }
+
+  if (timeout > 0) {
+    sqlite3_busy_timeout(db, timeout);
+  }
+  result = DenyRawPageWrites(db);
+  if (result != SQLITE_OK) {
+    node::ThrowEnhancedSqliteError(
+        env, db, result,
+        std::string("Failed to install the authorizer: ") +
+            sqlite3_errmsg(db));
+    sqlite3_close(db);
+    return nullptr;
+  }
+  return db;
+}
+
+DatabasePool::DatabasePool(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<DatabasePool>(info),
+      creation_thread_(std::this_thread::get_id()) {
+  Napi::Env env = info.Env();
+
+  std::optional<std::string> location =
+      ValidateDatabasePath(env, info[0], "path");
+  if (!location.has_value()) {
+    return; // Error already thrown by ValidateDatabasePath
+  }
+
+  if (location.value() == ":memory:" || location.value().empty()) {
+    node::THROW_ERR_INVALID_ARG_VALUE(
+        env, "DatabasePool requires a database file, which it opens in WAL "
+             "mode.");
+    return;
+  }
+
+  int reader_count = kDefaultReaderCount;
+  int timeout = 0;
+  bool enable_foreign_keys = true;
+
+  if (info.Length() > 1 && !info[1].IsUndefined()) {
+    if (!info[1].IsObject()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options\" argument must be an object.");
+      return;
+    }
+    Napi::Object options = info[1].As<Napi::Object>();
+
+    Napi::Value readers_value = options.Get("readers");
+    if (!readers_value.IsUndefined()) {
+      if (!readers_value.IsNumber()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.readers\" argument must be a number.");
+        return;
+      }
+      reader_count = readers_value.As<Napi::Number>().Int32Value();
+      if (reader_count < 1 || reader_count > kMaxReaderCount) {
+        std::string message =
+            "The \"options.readers\" argument must be between 1 and " +
+            std::to_string(kMaxReaderCount) + ".";
+        node::THROW_ERR_OUT_OF_RANGE(env, message.c_str());
+        return;
+      }
+    }
+
+    Napi::Value timeout_value = options.Get("timeout");
+    if (!timeout_value.IsUndefined()) {
+      if (!timeout_value.IsNumber()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.timeout\" argument must be a number.");
+        return;
+      }
+      timeout = timeout_value.As<Napi::Number>().Int32Value();
+    }
+
+    Napi::Value fk_value = options.Get("enableForeignKeyConstraints");
+    if (!fk_value.IsUndefined()) {
+      if (!fk_value.IsBoolean()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.enableForeignKeyConstraints\" argument must "
+                 "be a boolean.");
+        return;
+      }
+      enable_foreign_keys = fk_value.As<Napi::Boolean>().Value();
+    }
+
+    Napi::Value cache_value = options.Get("statementCacheSize");
+    if (!cache_value.IsUndefined()) {
+      if (!cache_value.IsNumber() ||
+          cache_value.As<Napi::Number>().Int64Value() < 0) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.statementCacheSize\" argument must be a "
+                 "non-negative number.");
+        return;
+      }
+      statement_cache_size_ =
+          static_cast<size_t>(cache_value.As<Napi::Number>().Int64Value());
+    }
+
+    Napi::Value big_ints_value = options.Get("readBigInts");
+    if (big_ints_value.IsBoolean()) {
+      use_big_ints_ = big_ints_value.As<Napi::Boolean>().Value();
+    }
+
+    Napi::Value arrays_value = options.Get("returnArrays");
+    if (arrays_value.IsBoolean()) {
+      return_arrays_ = arrays_value.As<Napi::Boolean>().Value();
+    }
+
+    Napi::Value bare_value = options.Get("allowBareNamedParameters");
+    if (bare_value.IsBoolean()) {
+      allow_bare_named_params_ = bare_value.As<Napi::Boolean>().Value();
+    }
+  }
+
+  // The writer creates the file and switches it to WAL, which is persistent,
+  // before any reader opens it
+  writer_ = std::make_unique<PoolConnection>();
+  writer_->db =
+      OpenPoolConnection(env, location.value(),
+                         SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, timeout);
+  if (writer_->db == nullptr) {
+    writer_.reset();
+    return;
+  }
+
+  std::string journal_mode;
+  int result = sqlite3_exec(
+      writer_->db, "PRAGMA journal_mode = WAL",
+      [](void *data, int argc, char **argv, char **) {
+        if (argc > 0 && argv[0] != nullptr) {
+          *static_cast<std::string *>(data) = argv[0];
+        }
+        return 0;
+      },
+      &journal_mode, nullptr);
+  if (result != SQLITE_OK) {
+    node::ThrowSqliteError(env, writer_->db, sqlite3_errmsg(writer_->db));
+    CloseConnections();
+    return;
+  }
+  if (journal_mode != "wal") {
+    CloseConnections();
+    std::string message =
+        "Failed to enable WAL mode (journal_mode is \"" + journal_mode + "\").";
+    node::THROW_ERR_INVALID_STATE(env, message.c_str());
+    return;
+  }
+
+  if (enable_foreign_keys) {
+    sqlite3_exec(writer_->db, "PRAGMA foreign_keys = ON", nullptr, nullptr,
+                 nullptr);
+  }
+
+  classifier_ = OpenPoolConnection(env, location.value(), SQLITE_OPEN_READONLY,
+                                   timeout);
+  if (classifier_ == nullptr) {
+    CloseConnections();
+    return;
+  }
+
+  for (int i = 0; i < reader_count; i++) {
+    auto reader = std::make_unique<PoolConnection>();
+    reader->reader = true;
+    reader->db = OpenPoolConnection(env, location.value(),
+                                    SQLITE_OPEN_READONLY, timeout);
+    if (reader->db == nullptr) {
+      CloseConnections();
+      return;
+    }
+    readers_.push_back(std::move(reader));
+  }
+}
+
+DatabasePool::~DatabasePool() { CloseConnections(); }
+
+void DatabasePool::CloseConnections() {
+  for (auto &reader : readers_) {
+    reader->Close();
+  }
+  readers_.clear();
+  if (classifier_) {
+    sqlite3_close_v2(classifier_);
+    classifier_ = nullptr;
+  }
+  if (writer_) {
+    writer_->Close();
+    writer_.reset();
+  }
+}
+
+bool DatabasePool::IsBusy() const {
+  if (writer_ && writer_->Pending() > 0) {
+    return true;
+  }
+  for (const auto &reader : readers_) {
+    if (reader->Pending() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+PoolConnection *DatabasePool::PickReader() {
+  PoolConnection *best = readers_.front().get();
+  for (const auto &reader : readers_) {
+    if (reader->Pending() < best->Pending()) {
+      best = reader.get();
+    }
+  }
+  return best;
+}
+
+bool DatabasePool::NeedsWriter(const std::string &sql) {
+  auto it = routes_.find(sql);
+  if (it != routes_.end()) {
+    return it->second;
+  }
+
+  // Classifying here, rather than on a reader that hands writes back, keeps
+  // writes in call order: a write bounced by a reader would otherwise run
+  // after writes queued behind it.
+  sqlite3_stmt *statement = nullptr;
+  int result =
+      sqlite3_prepare_v2(classifier_, sql.c_str(), -1, &statement, nullptr);
+  if (result != SQLITE_OK || statement == nullptr) {
+    // Invalid, or it refers to something the committed schema does not have
+    // yet (a table created by a queued write, an attached database). The
+    // writer runs it in order and reports any error. Not remembered, since
+    // the schema may catch up.
+    sqlite3_finalize(statement);
+    return true;
+  }
+  bool needs_writer =
+      !sqlite3_stmt_readonly(statement) || ChangesConnectionState(statement);
+  sqlite3_finalize(statement);
+
+  if (routes_.size() >= kMaxRoutes) {
+    routes_.clear();
+  }
+  routes_.emplace(sql, needs_writer);
+  return needs_writer;
+}
+
+void DatabasePool::RouteToWriter(const std::string &sql) {
+  if (routes_.size() >= kMaxRoutes) {
+    routes_.clear();
+  }
+  routes_[sql] = true;
+}
+
+void DatabasePool::Enqueue(PoolConnection *connection, PoolQueryJob *job,
+                           bool first) {
+  if (first) {
+    connection->queue.push_front(job);
+  } else {
+    connection->queue.push_back(job);
+  }
+  if (!connection->running) {
+    StartNext(connection);
+  }
+}
+
+void DatabasePool::StartNext(PoolConnection *connection) {
+  if (connection->queue.empty()) {
+    return;
+  }
+  PoolQueryJob *job = connection->queue.front();
+  connection->queue.pop_front();
+  connection->running = true;
+  job->set_connection(connection);
+  // AsyncWorker deletes itself when complete
+  job->Queue();
+}
+
+void DatabasePool::JobFinished(PoolConnection *connection) {
+  connection->running = false;
+  StartNext(connection);
+}
+
+Napi::Value DatabasePool::Query(const Napi::CallbackInfo &info, int kind) {
+  Napi::Env env = info.Env();
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+  if (std::this_thread::get_id() != creation_thread_) {
+    deferred.Reject(
+        Napi::Error::New(env,
+                         "DatabasePool cannot be used from different thread")
+            .Value());
+    return deferred.Promise();
+  }
+
+  if (!writer_) {
+    deferred.Reject(
+        Napi::Error::New(env, "DatabasePool is not open").Value());
+    return deferred.Promise();
+  }
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    deferred.Reject(
+        Napi::TypeError::New(env, "Expected SQL string").Value());
+    return deferred.Promise();
+  }
+
+  std::string sql = info[0].As<Napi::String>().Utf8Value();
+  QueryParameters parameters;
+  parameters.allow_bare_names = allow_bare_named_params_;
+  try {
+    MarshalQueryParameters(info, 1, &parameters);
+  } catch (const Napi::Error &e) {
+    deferred.Reject(e.Value());
+    return deferred.Promise();
+  }
+
+  PoolQueryJob *job =
+      new PoolQueryJob(env, this, static_cast<PoolQueryJob::Kind>(kind), sql,
+                       std::move(parameters), deferred);
+  if (kind == PoolQueryJob::kExec || NeedsWriter(sql)) {
+    Enqueue(writer_.get(), job);
+  } else {
+    Enqueue(PickReader(), job);
+  }
+  return deferred.Promise();
+}
+
+Napi::Value DatabasePool::Exec(const Napi::CallbackInfo &info) {
+  return Query(info, PoolQueryJob::kExec);
+}
+
+Napi::Value DatabasePool::Run(const Napi::CallbackInfo &info) {
+  return Query(info, PoolQueryJob::kRun);
+}
+
+Napi::Value DatabasePool::Get(const Napi::CallbackInfo &info) {
+  return Query(info, PoolQueryJob::kGet);
+}
+
+Napi::Value DatabasePool::All(const Napi::CallbackInfo &info) {
+  return Query(info, PoolQueryJob::kAll);
+}
+
+Napi::Value DatabasePool::Close(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!writer_) {
+    node::THROW_ERR_INVALID_STATE(env, "DatabasePool is not open");
+    return env.Undefined();
+  }
+
+  if (IsBusy()) {
+    node::THROW_ERR_INVALID_STATE(
+        env, "DatabasePool is busy with asynchronous queries");
+    return env.Undefined();
+  }
+
+  CloseConnections();
+  return env.Undefined();
+}
+
+Napi::Value DatabasePool::IsOpenGetter(const Napi::CallbackInfo &info) {
+  return Napi::Boolean::New(info.Env(), writer_ != nullptr);
+}
+
+Napi::Value DatabasePool::ReadersGetter(const Napi::CallbackInfo &info) {
+  return Napi::Number::New(info.Env(), static_cast<double>(readers_.size()));
+}
+
+// PoolQueryJob Implementation
+
+PoolQueryJob::PoolQueryJob(Napi::Env env, DatabasePool *pool, Kind kind,
+                           const std::string &sql, QueryParameters parameters,
+                           Napi::Promise::Deferred deferred)
+    : Napi::AsyncWorker(env, "SQLitePoolQuery"), pool_(pool),
+      pool_ref_(Napi::Persistent(pool->Value())), kind_(kind), sql_(sql),
+      parameters_(std::move(parameters)), deferred_(deferred) {}
+
+void PoolQueryJob::Execute() {
+  // Runs on a worker thread, with exclusive use of connection_
+  sqlite3 *db = connection_->db;
+
+  if (kind_ == kExec) {
+    result_code_ = sqlite3_exec(db, sql_.c_str(), nullptr, nullptr, nullptr);
+    if (result_code_ != SQLITE_OK) {
+      SetError(sqlite3_errmsg(db));
+    }
+    return;
+  }
+
+  statement_ =
+      connection_->Prepare(sql_, pool_->statement_cache_size_, &result_code_);
+  if (statement_ == nullptr) {
+    SetError(result_code_ == SQLITE_MISUSE ? "The SQL contains no statement"
+                                           : sqlite3_errmsg(db));
+    return;
+  }
+
+  if (connection_->reader && (!sqlite3_stmt_readonly(statement_) ||
+                              ChangesConnectionState(statement_))) {
+    // Classified as a read, yet not one here (the schema changed in the
+    // meantime). Hand the query back so OnOK() can requeue it on the writer.
+    needs_writer_ = true;
+    return;
+  }
+
+  std::string error;
+  if (!BindQueryParameters(statement_, parameters_, &result_code_, &error)) {
+    SetError(error.empty() ? sqlite3_errmsg(db) : error);
+    return;
+  }
+
+  size_t max_rows = kind_ == kAll ? SIZE_MAX : kind_ == kGet ? 1 : 0;
+  int r = StepQuery(statement_, max_rows, &column_names_, &cells_);
+  if (r != SQLITE_DONE) {
+    result_code_ = r;
+    SetError(sqlite3_errmsg(db));
+    return;
+  }
+
+  changes_ = sqlite3_changes64(db);
+}
+
+void PoolQueryJob::OnOK() {
+  Napi::Env env = Env();
+  Napi::HandleScope scope(env);
+  PoolConnection *connection = connection_;
+
+  if (needs_writer_) {
+    pool_->RouteToWriter(sql_);
+    PoolQueryJob *retry = new PoolQueryJob(
+        env, pool_, kind_, sql_, std::move(parameters_), deferred_);
+    Finish();
+    // Ahead of writes queued since, which were called after it
+    pool_->Enqueue(pool_->writer_.get(), retry, true);
+    pool_->JobFinished(connection);
+    return;
+  }
+
+  Napi::Value result = env.Undefined();
+  if (kind_ == kRun) {
+    // The connection stays idle until JobFinished(), so the last insert rowid
+    // still belongs to this query
+    result = CreateRunResult(env, connection->db, changes_);
+  } else if (kind_ == kAll || kind_ == kGet) {
+    Napi::Array rows =
+        BuildQueryRows(env, column_names_, cells_, pool_->use_big_ints_,
+                       pool_->return_arrays_);
+    cells_.clear();
+    if (kind_ == kAll) {
+      result = rows;
+    } else if (rows.Length() > 0) {
+      result = rows.Get(uint32_t(0));
+    }
+  }
+
+  Finish();
+  deferred_.Resolve(result);
+  pool_->JobFinished(connection);
+}
+
+void PoolQueryJob::OnError(const Napi::Error &error) {
+  Napi::Env env = Env();
+  Napi::HandleScope scope(env);
+  PoolConnection *connection = connection_;
+
+  Napi::Value reason = error.Value();
+  if (result_code_ != SQLITE_OK && result_code_ != SQLITE_MISUSE) {
+    // The connection has been idle since the failure, so its error state
+    // still describes it
+    node::ThrowEnhancedSqliteError(env, connection->db, result_code_,
+                                   error.Message());
+    reason = env.GetAndClearPendingException().Value();
+  }
+
+  Finish();
+  deferred_.Reject(reason);
+  pool_->JobFinished(connection);
+}
+
+void PoolQueryJob::Finish() {
+  if (statement_ == nullptr) {
+    return;
+  }
+  // Bindings point into parameters_, so clear them before the job goes away
+  sqlite3_reset(statement_);
+  sqlite3_clear_bindings(statement_);
+  if (pool_->statement_cache_size_ == 0) {
+    sqlite3_finalize(statement_);
+  }
+  statement_ = nullptr;
+}
+
+} // namespace sqlite
+} // namespace photostructure
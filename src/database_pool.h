@@ -0,0 +1,148 @@
+#ifndef SRC_DATABASE_POOL_H_
+#define SRC_DATABASE_POOL_H_
+
+#include <napi.h>
+#include <sqlite3.h>
+
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "sqlite_impl.h"
+
+namespace photostructure {
+namespace sqlite {
+
+class DatabasePool;
+class PoolQueryJob;
+
+// A connection owned by a DatabasePool. Jobs for one connection run one at a
+// time, in submission order, so its prepared statements are only ever used by
+// the job that is currently running.
+struct PoolConnection {
+  struct CachedStatement {
+    sqlite3_stmt *statement;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  sqlite3 *db = nullptr;
+  bool reader = false;
+  std::deque<PoolQueryJob *> queue;
+  bool running = false;
+
+  // LRU statement cache keyed by SQL text. The most recently used entry is at
+  // the front of lru.
+  std::unordered_map<std::string, CachedStatement> statements;
+  std::list<std::string> lru;
+
+  size_t Pending() const { return queue.size() + (running ? 1 : 0); }
+
+  // Returns a cached or newly prepared statement. Called on the worker thread
+  // running this connection's current job.
+  sqlite3_stmt *Prepare(const std::string &sql, size_t capacity, int *result);
+  void Close();
+};
+
+// One writer and N reader connections to a WAL database. Queries run on
+// worker threads; statements for which sqlite3_stmt_readonly() is true run on
+// the least busy reader, everything else on the writer. Transaction control,
+// ATTACH and DETACH also run on the writer. Statements are classified on the
+// JS thread before they are queued, so writes run in call order.
+class DatabasePool : public Napi::ObjectWrap<DatabasePool> {
+public:
+  static constexpr int kDefaultReaderCount = 4;
+  static constexpr int kMaxReaderCount = 64;
+  // Bound on the number of SQL strings whose route is remembered
+  static constexpr size_t kMaxRoutes = 1024;
+
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+  explicit DatabasePool(const Napi::CallbackInfo &info);
+  virtual ~DatabasePool();
+
+  Napi::Value Exec(const Napi::CallbackInfo &info);
+  Napi::Value Run(const Napi::CallbackInfo &info);
+  Napi::Value Get(const Napi::CallbackInfo &info);
+  Napi::Value All(const Napi::CallbackInfo &info);
+  Napi::Value Close(const Napi::CallbackInfo &info);
+
+  // Properties
+  Napi::Value IsOpenGetter(const Napi::CallbackInfo &info);
+  Napi::Value ReadersGetter(const Napi::CallbackInfo &info);
+
+private:
+  Napi::Value Query(const Napi::CallbackInfo &info, int kind);
+  // Queues `job` behind the connection's other jobs, or ahead of them when
+  // `first` is set
+  void Enqueue(PoolConnection *connection, PoolQueryJob *job,
+               bool first = false);
+  void StartNext(PoolConnection *connection);
+  void JobFinished(PoolConnection *connection);
+  PoolConnection *PickReader();
+  bool NeedsWriter(const std::string &sql);
+  void RouteToWriter(const std::string &sql);
+  bool IsBusy() const;
+  void CloseConnections();
+
+  std::unique_ptr<PoolConnection> writer_;
+  std::vector<std::unique_ptr<PoolConnection>> readers_;
+  // Prepares statements on the JS thread to decide where they run. It is
+  // never used by a job.
+  sqlite3 *classifier_ = nullptr;
+  // Whether each recently seen SQL text needs the writer
+  std::unordered_map<std::string, bool> routes_;
+  size_t statement_cache_size_ =
+      DatabaseOpenConfiguration::kDefaultStatementCacheSize;
+  bool use_big_ints_ = false;
+  bool return_arrays_ = false;
+  bool allow_bare_named_params_ = false;
+  std::thread::id creation_thread_;
+
+  friend class PoolQueryJob;
+};
+
+// A query running on one of a pool's connections
+class PoolQueryJob : public Napi::AsyncWorker {
+public:
+  enum Kind { kExec, kRun, kGet, kAll };
+
+  PoolQueryJob(Napi::Env env, DatabasePool *pool, Kind kind,
+               const std::string &sql, QueryParameters parameters,
+               Napi::Promise::Deferred deferred);
+
+  void set_connection(PoolConnection *connection) { connection_ = connection; }
+
+  void Execute() override;
+  void OnOK() override;
+  void OnError(const Napi::Error &error) override;
+
+private:
+  void Finish();
+
+  DatabasePool *pool_;
+  // Keeps the pool alive until the job settles
+  Napi::ObjectReference pool_ref_;
+  PoolConnection *connection_ = nullptr;
+  Kind kind_;
+  std::string sql_;
+  QueryParameters parameters_;
+
+  // Written on the worker thread, read once the job settles
+  sqlite3_stmt *statement_ = nullptr;
+  bool needs_writer_ = false;
+  int result_code_ = SQLITE_OK;
+  std::vector<std::string> column_names_;
+  std::vector<QueryValue> cells_; // Row-major
+  int64_t changes_ = 0;
+
+  Napi::Promise::Deferred deferred_;
+};
+
+} // namespace sqlite
+} // namespace photostructure
+
+#endif // SRC_DATABASE_POOL_H_
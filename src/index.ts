@@ -1,6 +1,8 @@
 // Load the native binding with support for both CJS and ESM
 import nodeGypBuild from "node-gyp-build";
 import { join } from "node:path";
+import type { Writable } from "node:stream";
+import { finished } from "node:stream/promises";
 import { _dirname } from "./dirname";
 
 // Use _dirname() helper that works in both CJS/ESM and Jest
@@ -37,6 +39,215 @@ export interface DatabaseSyncOptions {
   readonly timeout?: number;
   /** If true, enables loading of SQLite extensions. @default false */
   readonly allowExtension?: boolean;
+  /**
+   * If true, SQLite's defensive mode is on, which disallows SQL that could
+   * deliberately corrupt the database file: writes to virtual table shadow
+   * tables, `PRAGMA writable_schema` and `PRAGMA journal_mode = OFF`, among
+   * others. Writes to the `sqlite_dbpage` virtual table are refused either
+   * way.
+   *
+   * @see https://sqlite.org/c3ref/c_dbconfig_defensive.html
+   * @default false
+   */
+  readonly defensive?: boolean;
+  /**
+   * Maximum number of statements kept by {@link DatabaseSyncInstance.prepareCached}.
+   * Must be a non-negative integer; use `0` to disable caching.
+   * @default 128
+   */
+  readonly statementCacheSize?: number;
+  /**
+   * Default time limit, in milliseconds, for every call that steps a
+   * statement on this connection. See {@link QueryLimits}.
+   */
+  readonly timeLimit?: number;
+  /**
+   * Default virtual machine instruction budget for every call that steps a
+   * statement on this connection. See {@link QueryLimits}.
+   */
+  readonly instructionLimit?: number;
+  /**
+   * A database image, such as one returned by
+   * {@link DatabaseSyncInstance.serialize}, to load as the `main` database.
+   * Requires the `":memory:"` location. The bytes are copied, so the buffer
+   * may be reused once the constructor returns. The connection can grow the
+   * image unless `readOnly` is set. Images of WAL-mode databases cannot be
+   * loaded.
+   */
+  readonly deserialize?: Uint8Array;
+}
+
+/**
+ * Bounds on a single call that steps SQL, such as `exec()`, `all()` or one
+ * `next()` of an iterator. They are checked by a progress handler every 1000
+ * virtual machine instructions, so a call may run slightly past either
+ * limit. A call that exceeds a limit throws with `code` set to
+ * `"ERR_SQLITE_TIME_LIMIT"` or `"ERR_SQLITE_INSTRUCTION_LIMIT"`. `0` means
+ * unlimited.
+ */
+export interface QueryLimits {
+  /** Maximum wall-clock time in milliseconds. */
+  readonly timeLimit?: number;
+  /** Maximum number of SQLite virtual machine instructions. */
+  readonly instructionLimit?: number;
+}
+
+/**
+ * Runtime counters of a prepared statement, from `sqlite3_stmt_status()`.
+ * Counters accumulate across runs until they are reset.
+ */
+export interface StatementStatus {
+  /** Forward steps through a table or index as part of a full scan. */
+  readonly fullscanStep: number;
+  /** Sort operations. Non-zero means an index could remove a sort. */
+  readonly sort: number;
+  /** Rows inserted into automatically created transient indexes. */
+  readonly autoindex: number;
+  /** Virtual machine instructions executed. */
+  readonly vmStep: number;
+  /**
+   * Times the statement was re-prepared after a schema change. Never reset.
+   */
+  readonly reprepare: number;
+  /** Times the statement has been run to completion or reset. */
+  readonly run: number;
+  /** Bloom filter checks that skipped a join lookup. */
+  readonly filterHit: number;
+  /** Bloom filter checks that did not skip a join lookup. */
+  readonly filterMiss: number;
+  /** Bytes of heap used by the statement. Never reset. */
+  readonly memUsed: number;
+}
+
+/**
+ * Runtime statistics for one query plan loop, returned by
+ * {@link StatementSyncInstance.scanStatus}. Comparing `rowsVisited` with
+ * `loops * estimatedRows` shows how far the planner's estimates are off.
+ */
+export interface ScanStatus {
+  /** The EXPLAIN QUERY PLAN text for this loop. */
+  readonly explain: string | null;
+  /** The name of the table or index scanned by this loop. */
+  readonly name: string | null;
+  /** The id of the EXPLAIN QUERY PLAN node for this loop. */
+  readonly selectId: number;
+  /** The id of this loop's parent node. */
+  readonly parentId: number;
+  /** Number of times the loop has run. */
+  readonly loops: number;
+  /** Number of rows visited, over all runs of the loop. */
+  readonly rowsVisited: number;
+  /** The planner's estimate of the rows output by each run of the loop. */
+  readonly estimatedRows: number;
+  /** CPU cycles spent in the loop, where the platform can count them. */
+  readonly cycles: number;
+}
+
+/**
+ * One entry of {@link DatabaseSyncInstance.statementStatus}.
+ */
+export interface StatementStatusEntry extends StatementStatus {
+  /** The SQL text of the statement. */
+  readonly sql: string;
+}
+
+/**
+ * Options for {@link DatabaseSyncInstance.statementStatus}.
+ */
+export interface StatementStatusOptions {
+  /** The counter to rank statements by. @default "vmStep" */
+  readonly sortBy?: keyof StatementStatus;
+  /** Maximum number of statements returned. @default 10 */
+  readonly limit?: number;
+  /**
+   * If true, the counters of every statement on the connection are reset
+   * after they are read. @default false
+   */
+  readonly reset?: boolean;
+}
+
+/**
+ * Connection counters from `sqlite3_db_status()`, returned by
+ * {@link DatabaseSyncInstance.status}. Sizes are in bytes.
+ */
+export interface DatabaseStatus {
+  /** Page cache hits. */
+  readonly cacheHit: number;
+  /** Page cache misses. */
+  readonly cacheMiss: number;
+  /** Dirty pages written to disk. */
+  readonly cacheWrite: number;
+  /** Dirty pages written to disk mid-transaction because the cache was full. */
+  readonly cacheSpill: number;
+  /** Heap memory used by the pager caches of this connection. */
+  readonly cacheUsed: number;
+  /** Like `cacheUsed`, but with shared caches split between connections. */
+  readonly cacheUsedShared: number;
+  /** Lookaside memory slots in use. */
+  readonly lookasideUsed: number;
+  /** The most lookaside slots ever in use at once. */
+  readonly lookasideUsedHighwater: number;
+  /** Allocations served from lookaside memory. */
+  readonly lookasideHit: number;
+  /** Allocations too large for lookaside memory. */
+  readonly lookasideMissSize: number;
+  /** Allocations that missed because all lookaside slots were in use. */
+  readonly lookasideMissFull: number;
+  /** Heap memory used by the schema of every attached database. */
+  readonly schemaUsed: number;
+  /** Heap and lookaside memory used by all prepared statements. */
+  readonly stmtUsed: number;
+}
+
+/**
+ * Execution statistics for one SQL shape, returned by
+ * {@link DatabaseSyncInstance.profile}. Times are in milliseconds.
+ */
+export interface QueryProfile {
+  /**
+   * The normalized SQL, with literals replaced by `?`. Executions that differ
+   * only in their values share one entry.
+   */
+  readonly sql: string;
+  /** Number of completed executions. */
+  readonly count: number;
+  readonly totalTime: number;
+  readonly minTime: number;
+  readonly maxTime: number;
+  /**
+   * Latency histogram with 24 buckets. `histogram[i]` counts executions that
+   * took at least 2^i and less than 2^(i+1) microseconds; the first bucket
+   * also counts faster executions and the last bucket slower ones.
+   */
+  readonly histogram: number[];
+}
+
+/**
+ * A process-wide counter from `sqlite3_status64()`.
+ */
+export interface MemoryCounter {
+  readonly current: number;
+  /** The largest value since the process started or the last reset. */
+  readonly highwater: number;
+}
+
+/**
+ * Process-wide SQLite memory counters returned by {@link memoryStatus}.
+ * Sizes are in bytes.
+ */
+export interface MemoryStatus {
+  /** Heap memory allocated by SQLite. */
+  readonly memoryUsed: MemoryCounter;
+  /** Largest single allocation request (only the high-water mark is used). */
+  readonly mallocSize: MemoryCounter;
+  /** Number of outstanding allocations. */
+  readonly mallocCount: MemoryCounter;
+  /** Page cache pages in use from the static page cache buffer. */
+  readonly pagecacheUsed: MemoryCounter;
+  /** Page cache bytes that did not fit in the static buffer. */
+  readonly pagecacheOverflow: MemoryCounter;
+  /** Largest page cache allocation (only the high-water mark is used). */
+  readonly pagecacheSize: MemoryCounter;
 }
 
 /**
@@ -49,6 +260,86 @@ export interface StatementOptions {
   readonly anonymousParameters?: boolean;
 }
 
+/**
+ * One column of a result returned by {@link StatementSyncInstance.allColumns}.
+ *
+ * The `kind` describes how `values` is stored:
+ * - `"int32"`: every non-NULL value is an integer that fits in 32 bits
+ * - `"float64"`: every non-NULL value is a float, or an integer within
+ *   JavaScript's safe integer range
+ * - `"bigint64"`: integers outside the safe range, or any integer column when
+ *   `setReadBigInts(true)` is in effect
+ * - `"text"` / `"blob"`: an array of strings or Buffers
+ * - `"mixed"` / `"null"`: an array of values converted the same way as `all()`
+ *
+ * NULL cells read as `0` in typed arrays and `null` in plain arrays. Use
+ * `validity` to tell them apart.
+ */
+export interface ColumnarColumn {
+  /** The column name, as returned by sqlite3_column_name(). */
+  readonly name: string;
+  /** The storage kind chosen for this column. */
+  readonly kind:
+    | "int32"
+    | "float64"
+    | "bigint64"
+    | "text"
+    | "blob"
+    | "mixed"
+    | "null";
+  /** One entry per row. */
+  readonly values:
+    | Int32Array
+    | Float64Array
+    | BigInt64Array
+    | Array<string | Buffer | number | bigint | null>;
+  /**
+   * Validity bitmap with one bit per row, least significant bit first. Bit
+   * `row % 8` of byte `row >> 3` is set when the value is not NULL.
+   */
+  readonly validity: Uint8Array;
+}
+
+/**
+ * The result of {@link StatementSyncInstance.allColumns}.
+ */
+export interface ColumnarResult {
+  /** The number of rows in the result. */
+  readonly rowCount: number;
+  /** One entry per result column, in column order. */
+  readonly columns: ColumnarColumn[];
+}
+
+/**
+ * A typed array accepted as a parameter column by
+ * {@link StatementSyncInstance.runColumns}.
+ */
+export type NumericColumn =
+  | Int8Array
+  | Uint8Array
+  | Uint8ClampedArray
+  | Int16Array
+  | Uint16Array
+  | Int32Array
+  | Uint32Array
+  | Float32Array
+  | Float64Array
+  | BigInt64Array
+  | BigUint64Array;
+
+/**
+ * Options for {@link StatementSyncInstance.runMany} and
+ * {@link StatementSyncInstance.runColumns}.
+ */
+export interface RunManyOptions {
+  /**
+   * Wrap the batch in a transaction, or in a savepoint when a transaction is
+   * already open. On failure every row of the batch is rolled back.
+   * @default false
+   */
+  readonly transaction?: boolean;
+}
+
 /**
  * A prepared SQL statement that can be executed multiple times with different parameters.
  * This interface represents an instance of the StatementSync class.
@@ -67,6 +358,53 @@ export interface StatementSyncInstance {
     changes: number;
     lastInsertRowid: number | bigint;
   };
+  /**
+   * Executes the statement once per entry of `rows` in a single native call.
+   * Each entry is an array of positional parameters, a named-parameter
+   * object, or a single positional value.
+   *
+   * If a row fails, execution stops and the error is rethrown with
+   * `failedIndex` (the index of the failing row) and `changes` (the number of
+   * changes that were kept) properties.
+   * @param rows The parameters to bind for each execution.
+   * @param options Optional transaction handling.
+   * @returns The total number of changes and the last insert rowid.
+   */
+  runMany(
+    rows: readonly any[],
+    options?: RunManyOptions,
+  ): {
+    changes: number;
+    lastInsertRowid: number | bigint;
+  };
+  /**
+   * Executes the statement once per row, binding parameter `i + 1` of row `r`
+   * directly from element `r` of `columns[i]` without creating JavaScript
+   * values per cell. Elements follow the same rules as `run()` applies to
+   * the equivalent Number or BigInt; NaN binds as NULL. Parameters without a
+   * column are bound to NULL.
+   *
+   * Rows are bound straight from the arrays' memory. When user functions or
+   * aggregates are registered on the database, which could modify or detach
+   * an array mid-batch, the first `rowCount` elements of each column are
+   * copied before the first row runs instead, temporarily doubling the
+   * memory the columns use.
+   *
+   * Failures are reported as in {@link runMany}.
+   * @param columns One typed array per positional parameter.
+   * @param rowCount The number of rows to execute. Every column must have at
+   * least this many elements.
+   * @param options Optional transaction handling.
+   * @returns The total number of changes and the last insert rowid.
+   */
+  runColumns(
+    columns: readonly NumericColumn[],
+    rowCount: number,
+    options?: RunManyOptions,
+  ): {
+    changes: number;
+    lastInsertRowid: number | bigint;
+  };
   /**
    * This method executes a prepared statement and returns the first result row.
    * @param parameters Optional named and anonymous parameters to bind to the statement.
@@ -79,13 +417,53 @@ export interface StatementSyncInstance {
    * @returns An array of row objects from the query results.
    */
   all(...parameters: any[]): any[];
+  /**
+   * This method executes a prepared statement and returns all results in
+   * columnar form: one typed array (or dense array) per column instead of one
+   * object per row. This avoids allocating a JavaScript object per row, which
+   * is much cheaper for large, mostly numeric results.
+   * @param parameters Optional named and anonymous parameters to bind to the statement.
+   * @returns The row count and one entry per result column.
+   *
+   * @example
+   * ```typescript
+   * const { rowCount, columns } = db
+   *   .prepare("SELECT ts, value FROM samples")
+   *   .allColumns();
+   * const values = columns[1].values as Float64Array;
+   * ```
+   */
+  allColumns(...parameters: any[]): ColumnarResult;
   /**
    * This method executes a prepared statement and returns an iterable iterator of objects.
    * Each object represents a row from the query results.
    * @param parameters Optional named and anonymous parameters to bind to the statement.
    * @returns An iterable iterator of row objects.
    */
-  iterate(...parameters: any[]): IterableIterator<any>;
+  iterate(...parameters: any[]): StatementSyncIterator;
+  /**
+   * Like {@link run}, but steps the statement on a worker thread. Parameters
+   * are copied when the method is called.
+   *
+   * Asynchronous queries on one connection run one at a time, in call order.
+   * While any are pending, synchronous methods of the database and its
+   * statements throw. User-defined functions cannot be called from
+   * asynchronous queries.
+   * @param parameters Optional named and anonymous parameters to bind to the statement.
+   * @returns A promise for the number of changes and the last insert rowid.
+   */
+  runAsync(...parameters: any[]): Promise<{
+    changes: number;
+    lastInsertRowid: number | bigint;
+  }>;
+  /**
+   * Like {@link all}, but steps the statement on a worker thread and builds
+   * the rows once it completes. See {@link runAsync} for how asynchronous
+   * queries are scheduled.
+   * @param parameters Optional named and anonymous parameters to bind to the statement.
+   * @returns A promise for an array of row objects.
+   */
+  allAsync(...parameters: any[]): Promise<any[]>;
   /**
    * Set whether to read integer values as JavaScript BigInt.
    * @param readBigInts If true, read integers as BigInts. @default false
@@ -96,6 +474,26 @@ export interface StatementSyncInstance {
    * @param allowBareNamedParameters If true, allows bare named parameters. @default false
    */
   setAllowBareNamedParameters(allowBareNamedParameters: boolean): void;
+  /**
+   * Overrides the connection's query limits for this statement. Limits that
+   * are not given keep the connection's value; pass nothing to go back to the
+   * connection's limits.
+   * @param limits The limits applied to each call that steps this statement.
+   */
+  setQueryLimits(limits?: QueryLimits | null): void;
+  /**
+   * Returns the statement's runtime counters.
+   * @param options If `reset` is true, the counters are reset after they are
+   * read.
+   */
+  status(options?: { reset?: boolean }): StatementStatus;
+  /**
+   * Returns per-loop statistics from `sqlite3_stmt_scanstatus_v2()`, one
+   * entry per query plan loop. Counters accumulate across runs.
+   * @param options If `reset` is true, the counters are reset after they are
+   * read.
+   */
+  scanStatus(options?: { reset?: boolean }): ScanStatus[];
   /**
    * Set whether to return results as arrays rather than objects.
    * @param returnArrays If true, return results as arrays. @default false
@@ -116,6 +514,55 @@ export interface StatementSyncInstance {
   [Symbol.dispose](): void;
 }
 
+/**
+ * The iterator returned by {@link StatementSyncInstance.iterate}.
+ *
+ * Besides the standard iterator protocol, it can fetch rows in batches, which
+ * amortizes the cost of crossing from JavaScript into native code over many
+ * rows.
+ */
+export interface StatementSyncIterator
+  extends IterableIterator<any>,
+    AsyncIterable<any> {
+  /**
+   * Steps up to `count` rows in a single native call and returns them as an
+   * array. The cursor stays open between calls. A result shorter than `count`
+   * means the statement is exhausted, and later calls return an empty array.
+   * @param count The maximum number of rows to return. @default 256
+   * @returns An array of row objects (or row arrays, with `setReturnArrays`).
+   */
+  nextBatch(count?: number): any[];
+  /**
+   * Yields every remaining row, fetching them internally with
+   * {@link StatementSyncIterator.nextBatch}. Rows are still read synchronously;
+   * this adapter lets statements feed `for await` loops and async pipelines.
+   *
+   * @example
+   * ```typescript
+   * for await (const row of stmt.iterate()) {
+   *   await sink.write(row);
+   * }
+   * ```
+   */
+  [Symbol.asyncIterator](): AsyncIterator<any>;
+}
+
+/**
+ * Counters returned by {@link DatabaseSyncInstance.statementCacheStats}.
+ */
+export interface StatementCacheStats {
+  /** Number of statements currently cached. */
+  readonly size: number;
+  /** Maximum number of cached statements. */
+  readonly capacity: number;
+  /** Number of prepareCached() calls served from the cache. */
+  readonly hits: number;
+  /** Number of prepareCached() calls that had to prepare a statement. */
+  readonly misses: number;
+  /** Number of statements dropped from the cache. */
+  readonly evictions: number;
+}
+
 export interface UserFunctionOptions {
   /** If `true`, sets the `SQLITE_DETERMINISTIC` flag. @default false */
   readonly deterministic?: boolean;
@@ -164,12 +611,214 @@ export interface Session {
    * @returns A Buffer containing the patchset data.
    */
   patchset(): Buffer;
+  /**
+   * Streams the changeset in chunks instead of building it in one buffer, so
+   * memory use stays bounded however large the changeset is. The changeset
+   * is generated on a separate thread with `sqlite3session_changeset_strm()`,
+   * one chunk ahead of the consumer.
+   *
+   * The result works with `for await` and with `stream.pipeline()` or
+   * `Readable.from()`. The connection rejects synchronous calls until the
+   * stream has been read to the end or closed, so always consume or close it.
+   *
+   * @example
+   * ```typescript
+   * await pipeline(session.changesetStream(), fs.createWriteStream(path));
+   * ```
+   */
+  changesetStream(
+    options?: ChangesetStreamOptions,
+  ): AsyncIterableIterator<Buffer>;
+  /**
+   * Like {@link changesetStream}, but streams a patchset.
+   */
+  patchsetStream(
+    options?: ChangesetStreamOptions,
+  ): AsyncIterableIterator<Buffer>;
+  /**
+   * Generates the changeset (or patchset) on a separate thread and calls
+   * `onChunk` with each chunk. If `onChunk` returns a promise, nothing more
+   * is generated until it settles; if it throws or rejects, generation stops
+   * and the returned promise rejects with that error. This is the primitive
+   * behind {@link changesetStream}.
+   */
+  streamChangeset(
+    onChunk: (chunk: Buffer) => void | Promise<void>,
+    options?: ChangesetStreamOptions & { readonly patchset?: boolean },
+  ): Promise<void>;
+  /**
+   * Records the changes that would turn `table` in the attached database
+   * `fromDb` into the same table in the session's database, using
+   * `sqlite3session_diff()`. The rows are compared inside SQLite; only
+   * differing rows become changes. Tables without a primary key are
+   * ignored, and the two tables must have the same columns and primary key.
+   *
+   * @example
+   * ```typescript
+   * db.exec("ATTACH 'import.db' AS fresh");
+   * const session = db.createSession({ db: "fresh" });
+   * session.diff("main", "items");
+   * db.applyChangeset(session.changeset()); // main.items now matches
+   * ```
+   */
+  diff(fromDb: string, table: string): void;
   /**
    * Close the session and release its resources.
    */
   close(): void;
 }
 
+/**
+ * Merges changesets (or patchsets) with `sqlite3changegroup_*`. Changes to
+ * the same row are combined, so the output is the smallest changeset with
+ * the same effect as applying each input in turn. No connection is needed.
+ */
+export interface ChangeGroupInstance {
+  /**
+   * Adds a changeset or patchset. Changesets and patchsets cannot be mixed.
+   */
+  add(changeset: Uint8Array): void;
+  /**
+   * Adds a changeset read in chunks from `source`, with
+   * `sqlite3changegroup_add_strm()`, on a separate thread.
+   * @param source An iterable or async iterable of Buffers or Uint8Arrays.
+   */
+  addStream(
+    source: AsyncIterable<Uint8Array> | Iterable<Uint8Array>,
+  ): Promise<void>;
+  /**
+   * Returns the combined changeset of everything added so far.
+   */
+  output(): Buffer;
+  /**
+   * Like {@link output}, but streams the result in chunks, generated with
+   * `sqlite3changegroup_output_strm()` one chunk ahead of the consumer. The
+   * group rejects other calls until the stream has been read or closed.
+   */
+  outputStream(
+    options?: ChangesetStreamOptions,
+  ): AsyncIterableIterator<Buffer>;
+  /**
+   * Calls `onChunk` with each chunk of the combined changeset, waiting for
+   * any promise it returns. This is the primitive behind
+   * {@link outputStream}.
+   */
+  streamOutput(
+    onChunk: (chunk: Buffer) => void | Promise<void>,
+    options?: ChangesetStreamOptions,
+  ): Promise<void>;
+  /**
+   * Releases the group.
+   */
+  close(): void;
+}
+
+/**
+ * Rebases local changesets over remote changes with `sqlite3rebaser_*`.
+ *
+ * When a remote changeset is applied with
+ * `applyChangeset(remote, { rebaser })`, the conflict resolutions made for
+ * it are recorded in the rebaser. {@link rebase} then rewrites a local
+ * changeset so that, applied elsewhere after `remote`, it does not undo
+ * those resolutions.
+ */
+export interface RebaserInstance {
+  /**
+   * Adds a rebase buffer produced by `sqlite3changeset_apply_v2()` on
+   * another connection.
+   */
+  configure(rebase: Uint8Array): void;
+  /**
+   * Returns `changeset` rebased over the configured changes.
+   */
+  rebase(changeset: Uint8Array): Buffer;
+  /**
+   * Releases the rebaser.
+   */
+  close(): void;
+}
+
+/**
+ * Options for {@link DatabaseSyncInstance.backupTo}.
+ */
+export interface BackupStreamOptions {
+  /**
+   * Name of the database to copy: `main` or the name of an attached
+   * database. @default 'main'
+   */
+  readonly source?: string;
+  /** Approximate size of each chunk in bytes. @default 65536 */
+  readonly chunkSize?: number;
+  /** Called about a hundred times, and once the last page is written. */
+  readonly progress?: (info: {
+    totalPages: number;
+    remainingPages: number;
+  }) => void;
+  /**
+   * End the destination stream (and wait for it to finish) once the backup
+   * is written. Ignored for file descriptors, which are never closed.
+   * @default true
+   */
+  readonly end?: boolean;
+}
+
+/**
+ * Progress of a maintenance method: pages for {@link
+ * DatabaseSyncInstance.vacuumInto} and {@link
+ * DatabaseSyncInstance.incrementalVacuum}, tables for {@link
+ * DatabaseSyncInstance.reindex} and {@link DatabaseSyncInstance.analyze}.
+ */
+export interface MaintenanceProgress {
+  readonly done: number;
+  readonly total: number;
+}
+
+/**
+ * Options shared by the maintenance methods.
+ */
+export interface MaintenanceOptions {
+  /**
+   * Name of the database to maintain: `main` or the name of an attached
+   * database. @default 'main'
+   */
+  readonly schema?: string;
+  /** Busy timeout of the separate connection, in milliseconds. @default 5000 */
+  readonly timeout?: number;
+  /** Called as the operation advances. Errors thrown are ignored. */
+  readonly progress?: (info: MaintenanceProgress) => void;
+}
+
+export interface IncrementalVacuumOptions extends MaintenanceOptions {
+  /** Pages released per step and transaction. @default 128 */
+  readonly pages?: number;
+  /** Stop after releasing this many pages. By default, empty the free list. */
+  readonly maxPages?: number;
+}
+
+export interface ReindexOptions extends MaintenanceOptions {
+  /** A table, index or collation name, as accepted by REINDEX. */
+  readonly target?: string;
+}
+
+export interface AnalyzeOptions extends MaintenanceOptions {
+  /** A table or index name, as accepted by ANALYZE. */
+  readonly target?: string;
+  /**
+   * Approximate number of rows to examine in each index, via
+   * `PRAGMA analysis_limit`. 0 means no limit.
+   */
+  readonly analysisLimit?: number;
+}
+
+export interface ChangesetStreamOptions {
+  /**
+   * Approximate size of each chunk in bytes. SQLite produces output in small
+   * pieces, which are collected until a chunk is this large.
+   * @default 65536
+   */
+  readonly chunkSize?: number;
+}
+
 export interface ChangesetApplyOptions {
   /**
    * Function called when a conflict is detected during changeset application.
@@ -183,6 +832,115 @@ export interface ChangesetApplyOptions {
    * @returns true to include the table, false to skip it
    */
   readonly filter?: (tableName: string) => boolean;
+  /**
+   * Conflict policies by table name, decided natively without calling into
+   * JavaScript. `onConflict` is only called for conflicts no policy covers.
+   * When set, the apply returns a {@link ChangesetApplyResult}.
+   */
+  readonly policies?: ConflictPolicies;
+  /**
+   * Records the conflict resolutions made while applying the changeset, so
+   * that local changesets can be rebased over it.
+   */
+  readonly rebaser?: RebaserInstance;
+}
+
+/**
+ * How conflicts on a table are resolved:
+ * - `"replace"`: the incoming change wins.
+ * - `"omit"`: the local row wins and the change is skipped.
+ * - `"abort"`: the whole changeset is rolled back.
+ * - `{ lastWriterWins: column }`: the row with the greater value in `column`
+ *   (a timestamp or version, compared like SQLite sorts) wins. Ties keep the
+ *   local row.
+ *
+ * `"replace"` and `lastWriterWins` only apply where a local row exists
+ * (`SQLITE_CHANGESET_DATA` and `SQLITE_CHANGESET_CONFLICT`). Other conflicts
+ * on those tables go to `onConflict`, or are omitted.
+ */
+export type ConflictPolicy =
+  | "replace"
+  | "omit"
+  | "abort"
+  | { readonly lastWriterWins: string };
+
+/**
+ * Conflict policies keyed by table name. The `"*"` key applies to every
+ * other table; with `lastWriterWins` it covers the tables that have the
+ * column.
+ */
+export type ConflictPolicies = { readonly [table: string]: ConflictPolicy };
+
+/**
+ * Outcome of applying a changeset with conflict policies.
+ */
+export interface ChangesetApplyResult {
+  /** false if the changeset was aborted and rolled back. */
+  readonly applied: boolean;
+  /** Number of conflicts encountered. */
+  readonly conflicts: number;
+  /** Conflicts resolved with SQLITE_CHANGESET_REPLACE. */
+  readonly replaced: number;
+  /** Conflicts resolved with SQLITE_CHANGESET_OMIT. */
+  readonly omitted: number;
+  /**
+   * Conflicts decided by each kind of policy, by the `onConflict` fallback,
+   * and by the default (omit) when neither applied.
+   */
+  readonly byPolicy: {
+    readonly replace: number;
+    readonly omit: number;
+    readonly abort: number;
+    readonly lastWriterWins: number;
+    readonly onConflict: number;
+    readonly default: number;
+  };
+}
+
+/**
+ * Progress of {@link DatabaseSyncInstance.backup}, reported after each step.
+ */
+export interface BackupProgress {
+  readonly totalPages: number;
+  readonly remainingPages: number;
+  /** Average pages copied per second since the backup started. */
+  readonly pagesPerSecond: number;
+  /** Average bytes copied per second, when the page size is known. */
+  readonly bytesPerSecond?: number;
+  /** Pages copied per step; changes over time with `adaptive`. */
+  readonly stepPages: number;
+}
+
+/**
+ * Progress of {@link DatabaseSyncInstance.applyChangesetAsync} and
+ * {@link DatabaseSyncInstance.applyChangesetStream}.
+ */
+export interface ChangesetApplyProgress {
+  /** Rows changed so far. Trails `bytes` slightly, as SQLite reads ahead. */
+  readonly changes: number;
+  /** Bytes of the changeset read so far. */
+  readonly bytes: number;
+  /** Size of the changeset, when it is applied from a buffer. */
+  readonly totalBytes?: number;
+}
+
+/**
+ * Options for {@link DatabaseSyncInstance.applyChangesetAsync} and
+ * {@link DatabaseSyncInstance.applyChangesetStream}. The callbacks behave as
+ * in {@link ChangesetApplyOptions}, but may also return promises. If
+ * `onConflict` or `filter` throws or rejects, the promise rejects and
+ * nothing is applied.
+ */
+export interface ChangesetStreamApplyOptions {
+  readonly onConflict?: (conflictType: number) => number | Promise<number>;
+  readonly filter?: (tableName: string) => boolean | Promise<boolean>;
+  /** See {@link ChangesetApplyOptions.policies}. */
+  readonly policies?: ConflictPolicies;
+  /**
+   * Called as the changeset is read, about every 1% of a buffer (and at
+   * least every 256 KiB). Errors it throws are ignored.
+   */
+  readonly progress?: (progress: ChangesetApplyProgress) => void;
 }
 
 /**
@@ -221,13 +979,102 @@ export interface DatabaseSyncInstance {
    * @returns A StatementSyncInstance object that can be executed multiple times.
    */
   prepare(sql: string, options?: StatementOptions): StatementSyncInstance;
+  /**
+   * Returns a prepared statement for `sql` from a bounded LRU cache keyed by
+   * the SQL text, preparing (with `SQLITE_PREPARE_PERSISTENT`) and caching it
+   * on a miss.
+   *
+   * The same statement object is returned for identical SQL, so it must not
+   * be used by two callers at once (for example, while one of them is still
+   * iterating it). Calling `finalize()` on a cached statement removes it from
+   * the cache. The cache size is set with the `statementCacheSize` option.
+   * @param sql The SQL statement to prepare.
+   * @returns A shared StatementSyncInstance for `sql`.
+   */
+  prepareCached(sql: string): StatementSyncInstance;
+  /**
+   * Returns hit, miss and eviction counters for the statement cache used by
+   * {@link DatabaseSyncInstance.prepareCached}.
+   */
+  statementCacheStats(): StatementCacheStats;
+  /**
+   * Ranks every statement prepared on this connection by one runtime
+   * counter, highest first, to find the statements that scan, sort or build
+   * automatic indexes the most. Statements whose counter is zero are left
+   * out.
+   * @param options The counter to rank by, the number of entries, and
+   * whether to reset all counters afterwards.
+   */
+  statementStatus(options?: StatementStatusOptions): StatementStatusEntry[];
+  /**
+   * Returns page cache, lookaside and memory counters for this connection.
+   * Useful for sizing the page cache: a high `cacheMiss` to `cacheHit` ratio
+   * means the cache is too small.
+   * @param options If `reset` is true, the cache hit/miss/write/spill and
+   * lookaside counters are reset after they are read.
+   */
+  status(options?: { reset?: boolean }): DatabaseStatus;
+  /**
+   * Starts or stops the profiler. While it runs, SQLite reports the duration
+   * of every statement execution (`SQLITE_TRACE_PROFILE`), and the timings
+   * are aggregated natively per normalized SQL shape. At most 10,000 shapes
+   * are tracked. Stopping the profiler keeps the collected data.
+   * @param enable Whether to profile. @default true
+   */
+  enableProfiler(enable?: boolean): void;
+  /**
+   * Returns profiler statistics, ordered by total time, highest first.
+   * @param options `limit` (default 10) caps the number of entries; if
+   * `reset` is true, the collected data is discarded after it is read.
+   */
+  profile(options?: { limit?: number; reset?: boolean }): QueryProfile[];
+  /**
+   * Returns the content of a database as a single buffer, in the same format
+   * as the database file. This works for in-memory and file databases alike;
+   * pass the buffer to the `deserialize` option to open a copy.
+   * @param schema The attached database to serialize. @default "main"
+   */
+  serialize(schema?: string): Buffer;
+  /**
+   * Drops every statement from the statement cache. Statements still held by
+   * callers remain usable.
+   */
+  clearStatementCache(): void;
   /**
    * This method allows one or more SQL statements to be executed without
    * returning any results. This is useful for commands like CREATE TABLE,
    * INSERT, UPDATE, or DELETE.
    * @param sql The SQL statement(s) to execute.
+   * @param options Limits for this call, overriding the connection's.
+   */
+  exec(sql: string, options?: QueryLimits): void;
+
+  /**
+   * Like {@link exec}, but runs the SQL on a worker thread. Asynchronous
+   * queries on one connection run one at a time, in call order, and
+   * synchronous methods throw while any are pending.
+   * @param sql The SQL statement(s) to execute.
+   * @param options Limits for this call, overriding the connection's. The
+   * time limit starts when the query starts running, not when it is queued.
+   * @returns A promise that settles once the SQL has run.
    */
-  exec(sql: string): void;
+  execAsync(sql: string, options?: QueryLimits): Promise<void>;
+
+  /**
+   * Interrupts the statement that an asynchronous query is currently
+   * stepping, which then fails with `SQLITE_INTERRUPT`. Does nothing if no
+   * statement is running. To interrupt a synchronous query, call
+   * {@link SqliteModule.DatabaseSync.interrupt} with {@link interruptHandle}
+   * from another thread.
+   */
+  interrupt(): void;
+
+  /**
+   * A number identifying this connection to
+   * `DatabaseSync.interrupt(handle)`. It can be posted to a worker thread
+   * that acts as a watchdog.
+   */
+  readonly interruptHandle: number;
 
   /**
    * This method creates SQLite user-defined functions, wrapping sqlite3_create_function_v2().
@@ -259,9 +1106,58 @@ export interface DatabaseSyncInstance {
    * Apply a changeset to the database.
    * @param changeset The changeset data to apply.
    * @param options Optional configuration for applying the changeset.
-   * @returns true if successful, false if aborted.
+   * @returns true if successful, false if aborted. With `policies`, a
+   * {@link ChangesetApplyResult} instead.
    */
+  applyChangeset(
+    changeset: Buffer,
+    options: ChangesetApplyOptions & { readonly policies: ConflictPolicies },
+  ): ChangesetApplyResult;
   applyChangeset(changeset: Buffer, options?: ChangesetApplyOptions): boolean;
+  /**
+   * Applies a changeset read in chunks from `source`, such as a readable
+   * stream or an async generator of Buffers, with
+   * `sqlite3changeset_apply_strm()`. Only one chunk is held in memory at a
+   * time. The changeset is applied on a separate thread; `onConflict` and
+   * `filter` are still called on this thread and may return promises.
+   * Synchronous calls on the connection throw until the promise settles.
+   * @param source An iterable or async iterable of Buffers or Uint8Arrays.
+   * @param options Conflict and filter callbacks.
+   * @returns A promise resolving to true if the changeset was applied, or
+   * false if a conflict handler aborted it. With `policies`, it resolves to
+   * a {@link ChangesetApplyResult} instead.
+   */
+  applyChangesetStream(
+    source: AsyncIterable<Uint8Array> | Iterable<Uint8Array>,
+    options: ChangesetStreamApplyOptions & {
+      readonly policies: ConflictPolicies;
+    },
+  ): Promise<ChangesetApplyResult>;
+  applyChangesetStream(
+    source: AsyncIterable<Uint8Array> | Iterable<Uint8Array>,
+    options?: ChangesetStreamApplyOptions,
+  ): Promise<boolean>;
+  /**
+   * Applies a changeset on a separate thread, like `backup()`, so that large
+   * changesets do not block the event loop. `policies` are decided on that
+   * thread; `onConflict` and `filter` are still called on this one and may
+   * return promises. Synchronous calls on the connection throw until the
+   * promise settles. The changeset is copied first, so the buffer may be
+   * reused as soon as this returns.
+   * @param changeset The changeset to apply.
+   * @param options Conflict handling and a progress callback.
+   * @returns A promise resolving like {@link applyChangesetStream}.
+   */
+  applyChangesetAsync(
+    changeset: Uint8Array,
+    options: ChangesetStreamApplyOptions & {
+      readonly policies: ConflictPolicies;
+    },
+  ): Promise<ChangesetApplyResult>;
+  applyChangesetAsync(
+    changeset: Uint8Array,
+    options?: ChangesetStreamApplyOptions,
+  ): Promise<boolean>;
   /**
    * Enables or disables the loading of SQLite extensions.
    * @param enable If true, enables extension loading. If false, disables it.
@@ -287,7 +1183,12 @@ export interface DatabaseSyncInstance {
    * @param options.rate Number of pages to be transmitted in each batch of the backup. @default 100
    * @param options.source Name of the source database. This can be 'main' (the default primary database) or any other database that have been added with ATTACH DATABASE. @default 'main'
    * @param options.target Name of the target database. This can be 'main' (the default primary database) or any other database that have been added with ATTACH DATABASE. @default 'main'
-   * @param options.progress Callback function that will be called with the number of pages copied and the total number of pages.
+   * @param options.progress Callback function that will be called with the number of pages copied and the total number of pages, plus the average throughput so far and the current step size.
+   * @param options.pagesPerSecond Target copy rate. The backup pauses between steps to stay under it. Pauses are timers on the event loop, so a paced backup does not hold a libuv pool thread while it waits.
+   * @param options.bytesPerSecond Target copy rate in bytes, using the page size of the database. If both rates are given, the lower one wins.
+   * @param options.sleep Milliseconds to pause between steps, giving writers a window to take the lock. @default 0
+   * @param options.adaptive Shrink the step size when a step takes longer than `maxStepTime` or the source is busy or locked (backing off exponentially between retries), and grow it back towards `rate` while steps are fast. @default false
+   * @param options.maxStepTime Milliseconds a single step may hold the source's read lock before `adaptive` halves the step size. @default 20
    * @returns A promise that resolves when the backup is completed and rejects if an error occurs.
    *
    * @example
@@ -302,6 +1203,13 @@ export interface DatabaseSyncInstance {
    *     console.log(`Progress: ${totalPages - remainingPages}/${totalPages}`);
    *   }
    * });
+   *
+   * @example
+   * // Background backup that yields to a busy application
+   * await db.backup('./backup.db', {
+   *   bytesPerSecond: 8 * 1024 * 1024,
+   *   adaptive: true,
+   * });
    */
   backup(
     path: string | Buffer | URL,
@@ -309,14 +1217,218 @@ export interface DatabaseSyncInstance {
       rate?: number;
       source?: string;
       target?: string;
-      progress?: (info: { totalPages: number; remainingPages: number }) => void;
+      progress?: (info: BackupProgress) => void;
+      pagesPerSecond?: number;
+      bytesPerSecond?: number;
+      sleep?: number;
+      adaptive?: boolean;
+      maxStepTime?: number;
     },
   ): Promise<number>;
 
+  /**
+   * Streams a backup of the database to a writable stream or a file
+   * descriptor, without staging a copy on disk. The pages are read on a
+   * separate thread by a single statement, so the output is a consistent
+   * snapshot: a complete database file. Only a chunk or two is held in memory
+   * at a time; the worker waits whenever the stream's buffer is full, and
+   * writes to a file descriptor block the worker rather than the event loop.
+   *
+   * Like {@link DatabaseSyncInstance.applyChangesetAsync}, the connection is
+   * busy until the promise settles. Changes made by other connections after
+   * the backup starts are not included. Rejects with `ERR_INVALID_STATE`
+   * inside an explicit transaction, whose uncommitted pages would otherwise
+   * be part of the snapshot.
+   *
+   * @param destination A Writable (a pipe to a compressor, an upload, a
+   * socket) or a file descriptor open for writing.
+   * @returns A promise for the number of pages written.
+   *
+   * @example
+   * const gzip = zlib.createGzip();
+   * gzip.pipe(fs.createWriteStream("./nightly.db.gz"));
+   * await db.backupTo(gzip);
+   */
+  backupTo(
+    destination: Writable | number,
+    options?: BackupStreamOptions,
+  ): Promise<number>;
+
+  /**
+   * The primitive underneath {@link DatabaseSyncInstance.backupTo}: calls
+   * `onChunk` with consecutive pieces of the database file, awaiting any
+   * promise it returns before reading more, or writes them to a file
+   * descriptor.
+   */
+  streamBackup(
+    destination: ((chunk: Buffer) => Promise<void> | void) | number,
+    options?: Omit<BackupStreamOptions, "end">,
+  ): Promise<number>;
+
+  /**
+   * Runs `VACUUM INTO destination` on a separate connection, in the libuv
+   * thread pool, writing a compacted copy of the database without blocking
+   * the event loop. This connection stays usable meanwhile.
+   *
+   * Maintenance methods need a database file, as the separate connection
+   * cannot see in-memory or temporary databases. Functions, collations and
+   * extensions registered on this connection are not available to it.
+   *
+   * Progress is reported in pages, estimated from the size of the file
+   * written so far.
+   *
+   * @returns A promise for the number of pages in the copy.
+   */
+  vacuumInto(
+    destination: string | Buffer | URL,
+    options?: MaintenanceOptions,
+  ): Promise<number>;
+
+  /**
+   * Releases free pages with `PRAGMA incremental_vacuum(pages)` on a
+   * separate connection, one transaction per step so that writers can get
+   * in between. Requires `PRAGMA auto_vacuum = INCREMENTAL`.
+   *
+   * @returns A promise for the number of pages released.
+   */
+  incrementalVacuum(options?: IncrementalVacuumOptions): Promise<number>;
+
+  /**
+   * Runs REINDEX on a separate connection, one table at a time, or once for
+   * `options.target`.
+   *
+   * Indexes on expressions that call functions registered with `function()`
+   * or `aggregate()` cannot be rebuilt there, and reject with an error
+   * naming the function; use `exec("REINDEX")` on this connection instead.
+   *
+   * @returns A promise for the number of tables (or targets) reindexed.
+   */
+  reindex(options?: ReindexOptions): Promise<number>;
+
+  /**
+   * Runs ANALYZE on a separate connection, one table at a time, optionally
+   * with `PRAGMA analysis_limit`. Once done, this connection reloads the
+   * statistics if it is idle and not in a transaction.
+   *
+   * Like {@link reindex}, this rejects with an error naming the function
+   * when sampling an index needs one registered with `function()` or
+   * `aggregate()`.
+   *
+   * @returns A promise for the number of tables (or targets) analyzed.
+   */
+  analyze(options?: AnalyzeOptions): Promise<number>;
+
   /** Dispose of the database resources using the explicit resource management protocol. */
   [Symbol.dispose](): void;
 }
 
+/**
+ * Options for creating a {@link DatabasePoolInstance}.
+ */
+export interface DatabasePoolOptions {
+  /**
+   * Number of read-only connections.
+   * @default 4
+   */
+  readonly readers?: number;
+  /** Sets the busy timeout in milliseconds on every connection. */
+  readonly timeout?: number;
+  /** If true, foreign key constraints are enforced. @default true */
+  readonly enableForeignKeyConstraints?: boolean;
+  /**
+   * Maximum number of prepared statements cached per connection.
+   * @default 128
+   */
+  readonly statementCacheSize?: number;
+  /** If true, integers are read as BigInts. @default false */
+  readonly readBigInts?: boolean;
+  /** If true, rows are returned as arrays. @default false */
+  readonly returnArrays?: boolean;
+  /** If true, named parameters may be given without prefix. @default false */
+  readonly allowBareNamedParameters?: boolean;
+}
+
+/**
+ * Merges and compacts changesets natively, with `sqlite3changegroup_*`.
+ *
+ * @example
+ * ```typescript
+ * const group = new ChangeGroup();
+ * for (const changeset of pending) {
+ *   group.add(changeset);
+ * }
+ * const combined = group.output();
+ * group.close();
+ * ```
+ */
+export const ChangeGroup = binding.ChangeGroup as SqliteModule["ChangeGroup"];
+
+/**
+ * Rebases changesets with `sqlite3rebaser_*`.
+ *
+ * @example
+ * ```typescript
+ * const rebaser = new Rebaser();
+ * db.applyChangeset(remote, { rebaser, onConflict: () => REPLACE });
+ * send(rebaser.rebase(local));
+ * ```
+ */
+export const Rebaser = binding.Rebaser as SqliteModule["Rebaser"];
+
+/**
+ * Returns the inverse of a changeset: applying it undoes the original.
+ * Patchsets cannot be inverted.
+ */
+export const invertChangeset =
+  binding.invertChangeset as SqliteModule["invertChangeset"];
+
+/**
+ * A pool of one writer and several reader connections to a database in WAL
+ * mode. Every query runs on a worker thread (from the libuv thread pool, see
+ * `UV_THREADPOOL_SIZE`) and returns a promise.
+ *
+ * Statements for which SQLite reports `sqlite3_stmt_readonly()` run on the
+ * least busy reader; everything else, and all of `exec()`, runs on the writer.
+ * So do transaction control statements (`BEGIN`, `COMMIT`, `ROLLBACK`,
+ * `SAVEPOINT`, `RELEASE`), `ATTACH` and `DETACH`. Queries on one connection
+ * run one at a time, in call order. Statements are classified when they are
+ * called, so writes run in call order even the first time a statement is
+ * seen. Reads on a reader do not see uncommitted changes of an explicit
+ * transaction on the writer.
+ */
+export interface DatabasePoolInstance {
+  /** Whether the pool's connections are open. */
+  readonly isOpen: boolean;
+  /** The number of reader connections. */
+  readonly readers: number;
+  /**
+   * Runs one or more SQL statements on the writer.
+   * @param sql The SQL statement(s) to execute.
+   */
+  exec(sql: string): Promise<void>;
+  /**
+   * Prepares (or reuses) `sql` on a connection chosen by routing, binds the
+   * parameters, and steps it once.
+   * @returns The number of changes and the last insert rowid.
+   */
+  run(
+    sql: string,
+    ...parameters: any[]
+  ): Promise<{ changes: number; lastInsertRowid: number | bigint }>;
+  /**
+   * Like {@link run}, but resolves with the first result row, if any.
+   */
+  get(sql: string, ...parameters: any[]): Promise<any>;
+  /**
+   * Like {@link run}, but resolves with all result rows.
+   */
+  all(sql: string, ...parameters: any[]): Promise<any[]>;
+  /**
+   * Closes every connection. Throws while queries are pending.
+   */
+  close(): void;
+}
+
 /**
  * The main SQLite module interface.
  */
@@ -325,10 +1437,20 @@ export interface SqliteModule {
    * The DatabaseSync class represents a synchronous connection to a SQLite database.
    * All operations are performed synchronously, blocking until completion.
    */
-  DatabaseSync: new (
-    location?: string | Buffer | URL,
-    options?: DatabaseSyncOptions,
-  ) => DatabaseSyncInstance;
+  DatabaseSync: {
+    new (
+      location?: string | Buffer | URL,
+      options?: DatabaseSyncOptions,
+    ): DatabaseSyncInstance;
+    /**
+     * Interrupts whatever statement the connection identified by `handle`
+     * (see {@link DatabaseSyncInstance.interruptHandle}) is running. Safe to
+     * call from any thread, including a worker thread while the owning thread
+     * is blocked in a synchronous query.
+     * @returns false if no open connection has this handle.
+     */
+    interrupt(handle: number): boolean;
+  };
   /**
    * The StatementSync class represents a synchronous prepared statement.
    * This class should not be instantiated directly; use Database.prepare() instead.
@@ -343,6 +1465,29 @@ export interface SqliteModule {
    * This class should not be instantiated directly; use Database.createSession() instead.
    */
   Session: new () => Session;
+  /**
+   * Merges changesets into one.
+   */
+  ChangeGroup: new () => ChangeGroupInstance;
+  /**
+   * Rebases changesets over conflict resolutions made locally.
+   */
+  Rebaser: new () => RebaserInstance;
+  /**
+   * Returns the changeset that undoes `changeset`.
+   */
+  invertChangeset: (changeset: Uint8Array) => Buffer;
+  /**
+   * A pool of one writer and several reader connections to a WAL database.
+   */
+  DatabasePool: new (
+    location: string | Buffer | URL,
+    options?: DatabasePoolOptions,
+  ) => DatabasePoolInstance;
+  /**
+   * Returns process-wide SQLite memory counters.
+   */
+  memoryStatus: (options?: { reset?: boolean }) => MemoryStatus;
   /**
    * SQLite constants for various operations and flags.
    */
@@ -395,6 +1540,183 @@ if (binding.StatementSync && typeof Symbol.dispose !== "undefined") {
   };
 }
 
+if (binding.StatementSyncIterator) {
+  binding.StatementSyncIterator.prototype[Symbol.asyncIterator] =
+    async function* (this: StatementSyncIterator) {
+      // Match the native default so each batch is one native call
+      const batchSize = 256;
+      try {
+        while (true) {
+          const rows = this.nextBatch(batchSize);
+          yield* rows;
+          if (rows.length < batchSize) return;
+        }
+      } finally {
+        // Reset the statement if the consumer stops early
+        try {
+          this.return?.();
+        } catch {
+          // Ignore errors if the statement was finalized in the meantime
+        }
+      }
+    };
+}
+
+// Turns the callbacks of Session.streamChangeset() or
+// ChangeGroup.streamOutput() into an async iterator. The native side produces
+// at most one chunk ahead of the consumer.
+async function* changesetChunks(
+  stream: (
+    onChunk: (chunk: Buffer) => Promise<void> | undefined,
+  ) => Promise<void>,
+): AsyncGenerator<Buffer, void, undefined> {
+  const chunks: Buffer[] = [];
+  let resume: ((proceed: boolean) => void) | undefined;
+  let wake: (() => void) | undefined;
+  let settled = false;
+  let failed = false;
+  let failure: unknown;
+  let stopped = false;
+
+  const finished = stream((chunk) => {
+    if (stopped) {
+      return Promise.reject(new Error("The changeset stream was closed"));
+    }
+    chunks.push(chunk);
+    wake?.();
+    if (chunks.length < 2) return undefined;
+    return new Promise<void>((resolve, reject) => {
+      resume = (proceed) =>
+        proceed
+          ? resolve()
+          : reject(new Error("The changeset stream was closed"));
+    });
+  }).then(
+    () => {
+      settled = true;
+      wake?.();
+    },
+    (error: unknown) => {
+      settled = true;
+      failed = true;
+      failure = error;
+      wake?.();
+    },
+  );
+
+  try {
+    for (;;) {
+      const chunk = chunks.shift();
+      if (chunk === undefined) {
+        if (settled) break;
+        await new Promise<void>((resolve) => (wake = resolve));
+        wake = undefined;
+        continue;
+      }
+      const proceed = resume;
+      resume = undefined;
+      proceed?.(true);
+      yield chunk;
+    }
+    if (failed) throw failure;
+  } finally {
+    if (!settled) {
+      // The consumer stopped early: abort generation and wait for the
+      // connection to be released
+      stopped = true;
+      const proceed = resume;
+      resume = undefined;
+      proceed?.(false);
+      await finished;
+    }
+  }
+}
+
+if (binding.Session) {
+  binding.Session.prototype.changesetStream = function (
+    this: Session,
+    options?: ChangesetStreamOptions,
+  ) {
+    return changesetChunks((onChunk) =>
+      this.streamChangeset(onChunk, { ...options, patchset: false }),
+    );
+  };
+  binding.Session.prototype.patchsetStream = function (
+    this: Session,
+    options?: ChangesetStreamOptions,
+  ) {
+    return changesetChunks((onChunk) =>
+      this.streamChangeset(onChunk, { ...options, patchset: true }),
+    );
+  };
+}
+
+if (binding.ChangeGroup) {
+  binding.ChangeGroup.prototype.outputStream = function (
+    this: ChangeGroupInstance,
+    options?: ChangesetStreamOptions,
+  ) {
+    return changesetChunks((onChunk) => this.streamOutput(onChunk, options));
+  };
+}
+
+// Resolves once `stream` wants more data. Rejects if it fails or closes
+// first, as 'drain' would never come.
+function drained(stream: Writable): Promise<void> {
+  return new Promise<void>((resolve, reject) => {
+    const cleanup = () => {
+      stream.off("drain", onDrain);
+      stream.off("error", onError);
+      stream.off("close", onClose);
+    };
+    const onDrain = () => {
+      cleanup();
+      resolve();
+    };
+    const onError = (error: Error) => {
+      cleanup();
+      reject(error);
+    };
+    const onClose = () => {
+      cleanup();
+      reject(
+        new Error("The backup destination closed before the backup ended"),
+      );
+    };
+    stream.on("drain", onDrain);
+    stream.on("error", onError);
+    stream.on("close", onClose);
+  });
+}
+
+if (binding.DatabaseSync) {
+  binding.DatabaseSync.prototype.backupTo = async function (
+    this: DatabaseSyncInstance,
+    destination: Writable | number,
+    options: BackupStreamOptions = {},
+  ) {
+    const { end = true, ...streamOptions } = options;
+    if (typeof destination === "number") {
+      return this.streamBackup(destination, streamOptions);
+    }
+    const pages = await this.streamBackup((chunk) => {
+      if (destination.destroyed || destination.writableEnded) {
+        throw (
+          destination.errored ??
+          new Error("The backup destination closed before the backup ended")
+        );
+      }
+      return destination.write(chunk) ? undefined : drained(destination);
+    }, streamOptions);
+    if (end) {
+      destination.end();
+      // Only the writable side: a Transform's output may still be unread
+      await finished(destination, { readable: false });
+    }
+    return pages;
+  };
+}
+
 // Export the native binding with TypeScript types
 
 /**
@@ -446,6 +1768,38 @@ export const StatementSync =
  */
 export const Session = binding.Session as SqliteModule["Session"];
 
+/**
+ * A pool of one writer and several reader connections to a database in WAL
+ * mode, with read-only statements routed to the readers automatically.
+ *
+ * @example
+ * ```typescript
+ * const pool = new DatabasePool('./data.db', { readers: 4 });
+ * await pool.run('INSERT INTO users (name) VALUES (?)', 'alice');
+ * const users = await pool.all('SELECT * FROM users');
+ * pool.close();
+ * ```
+ */
+export const DatabasePool =
+  binding.DatabasePool as SqliteModule["DatabasePool"];
+
+/**
+ * Returns SQLite's process-wide memory counters, with their high-water marks.
+ * The counters cover every connection in the process, including those opened
+ * by worker threads.
+ *
+ * @param options If `reset` is true, the high-water marks are reset to the
+ * current values after they are read.
+ *
+ * @example
+ * ```typescript
+ * const { memoryUsed } = memoryStatus();
+ * console.log(`SQLite heap: ${memoryUsed.current} (peak ${memoryUsed.highwater})`);
+ * ```
+ */
+export const memoryStatus =
+  binding.memoryStatus as SqliteModule["memoryStatus"];
+
 /**
  * SQLite constants for various operations and flags.
  *
@@ -0,0 +1,488 @@
+#include "maintenance_job.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+#include "shims/sqlite_errors.h"
+
+namespace photostructure {
+namespace sqlite {
+
+Napi::Value MaintenanceJob::Start(const Napi::CallbackInfo &info,
+                                  DatabaseSync *database,
+                                  Operation operation) {
+  Napi::Env env = info.Env();
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+  auto reject = [&env, &deferred]() {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  };
+
+  if (!database->IsOpen()) {
+    deferred.Reject(Napi::Error::New(env, "database is not open").Value());
+    return deferred.Promise();
+  }
+
+  // vacuumInto(destination, options); the others only take options
+  size_t options_index = 0;
+  std::string path;
+  if (operation == kVacuumInto) {
+    std::optional<std::string> destination =
+        ValidateDatabasePath(env, info[0], "destination");
+    if (!destination.has_value()) {
+      if (!env.IsExceptionPending()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"destination\" argument must be a string, Buffer or "
+                 "URL.");
+      }
+      return reject();
+    }
+    path = destination.value();
+    options_index = 1;
+  }
+
+  std::string schema = "main";
+  std::string target;
+  int64_t timeout = kDefaultTimeout;
+  int64_t step_pages = kDefaultIncrementalPages;
+  int64_t max_pages = -1;
+  int64_t analysis_limit = -1;
+  Napi::Function progress_func;
+
+  Napi::Value options_value = info[options_index];
+  if (!options_value.IsUndefined()) {
+    if (!options_value.IsObject()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options\" argument must be an object.");
+      return reject();
+    }
+    Napi::Object options = options_value.As<Napi::Object>();
+
+    auto get_string = [&env, &options](const char *name, std::string *value) {
+      Napi::Value option = options.Get(name);
+      if (option.IsUndefined()) {
+        return true;
+      }
+      if (!option.IsString()) {
+        std::string message = std::string("The \"options.") + name +
+                              "\" argument must be a string.";
+        node::THROW_ERR_INVALID_ARG_TYPE(env, message.c_str());
+        return false;
+      }
+      *value = option.As<Napi::String>().Utf8Value();
+      return true;
+    };
+    auto get_integer = [&env, &options](const char *name, int64_t minimum,
+                                        int64_t *value) {
+      Napi::Value option = options.Get(name);
+      if (option.IsUndefined()) {
+        return true;
+      }
+      std::string prefix = std::string("The \"options.") + name + "\"";
+      if (!option.IsNumber()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, (prefix + " argument must be a number.").c_str());
+        return false;
+      }
+      double number = option.As<Napi::Number>().DoubleValue();
+      if (number != std::floor(number) || number < minimum ||
+          number > INT_MAX) {
+        std::string message = prefix + " argument must be an integer >= " +
+                              std::to_string(minimum) + ".";
+        node::THROW_ERR_OUT_OF_RANGE(env, message.c_str());
+        return false;
+      }
+      *value = static_cast<int64_t>(number);
+      return true;
+    };
+
+    if (!get_string("schema", &schema) ||
+        !get_integer("timeout", 0, &timeout)) {
+      return reject();
+    }
+    if (operation == kIncrementalVacuum &&
+        (!get_integer("pages", 1, &step_pages) ||
+         !get_integer("maxPages", 0, &max_pages))) {
+      return reject();
+    }
+    if ((operation == kReindex || operation == kAnalyze) &&
+        !get_string("target", &target)) {
+      return reject();
+    }
+    if (operation == kAnalyze &&
+        !get_integer("analysisLimit", 0, &analysis_limit)) {
+      return reject();
+    }
+
+    Napi::Value progress_value = options.Get("progress");
+    if (!progress_value.IsUndefined()) {
+      if (!progress_value.IsFunction()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.progress\" argument must be a function.");
+        return reject();
+      }
+      progress_func = progress_value.As<Napi::Function>();
+    }
+  }
+
+  const char *filename =
+      sqlite3_db_filename(database->connection(), schema.c_str());
+  if (filename == nullptr) {
+    std::string message = "unknown database " + schema;
+    node::THROW_ERR_INVALID_ARG_VALUE(env, message.c_str());
+    return reject();
+  }
+  if (filename[0] == '\0') {
+    node::THROW_ERR_INVALID_STATE(
+        env, "Maintenance runs on a separate connection, which cannot open "
+             "an in-memory or temporary database.");
+    return reject();
+  }
+
+  MaintenanceJob *job =
+      new MaintenanceJob(env, database, operation, progress_func, deferred);
+  job->filename_ = filename;
+  job->schema_ = schema;
+  job->path_ = path;
+  job->target_ = target;
+  job->timeout_ = static_cast<int>(timeout);
+  job->step_pages_ = step_pages;
+  job->max_pages_ = max_pages;
+  job->analysis_limit_ = analysis_limit;
+
+  // Queue the async work - AsyncWorker will delete itself when complete
+  job->Queue();
+  return deferred.Promise();
+}
+
+MaintenanceJob::MaintenanceJob(Napi::Env env, DatabaseSync *database,
+                               Operation operation,
+                               Napi::Function progress_func,
+                               Napi::Promise::Deferred deferred)
+    : Napi::AsyncProgressWorker<MaintenanceProgress>(
+          !progress_func.IsEmpty()
+              ? progress_func
+              : Napi::Function::New(env, [](const Napi::CallbackInfo &) {})),
+      operation_(operation), database_(database),
+      database_ref_(Napi::Persistent(database->Value())),
+      deferred_(deferred) {
+  if (!progress_func.IsEmpty()) {
+    progress_func_ = Napi::Persistent(progress_func);
+  }
+}
+
+void MaintenanceJob::Execute(const ExecutionProgress &progress) {
+  // This method is executed on a worker thread, on a connection of its own
+  progress_ = &progress;
+
+  status_ = sqlite3_open_v2(filename_.c_str(), &db_, SQLITE_OPEN_READWRITE,
+                            nullptr);
+  if (status_ != SQLITE_OK) {
+    message_ = std::string("Failed to open database: ") +
+               (db_ != nullptr ? sqlite3_errmsg(db_) : sqlite3_errstr(status_));
+  } else {
+    sqlite3_busy_timeout(db_, timeout_);
+    switch (operation_) {
+    case kVacuumInto:
+      VacuumInto();
+      break;
+    case kIncrementalVacuum:
+      IncrementalVacuum();
+      break;
+    case kReindex:
+      Reindex();
+      break;
+    case kAnalyze:
+      Analyze();
+      break;
+    }
+  }
+
+  if (db_ != nullptr) {
+    sqlite3_close_v2(db_);
+    db_ = nullptr;
+  }
+  if (status_ != SQLITE_OK) {
+    SetError(message_);
+  }
+}
+
+bool MaintenanceJob::Exec(const std::string &sql) {
+  char *error = nullptr;
+  status_ = sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &error);
+  if (status_ != SQLITE_OK) {
+    message_ = error != nullptr ? error : sqlite3_errstr(status_);
+  }
+  sqlite3_free(error);
+  return status_ == SQLITE_OK;
+}
+
+bool MaintenanceJob::QueryInt(const char *sql, int64_t *value) {
+  sqlite3_stmt *stmt = nullptr;
+  status_ = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+  if (status_ == SQLITE_OK) {
+    status_ = sqlite3_step(stmt);
+    *value = status_ == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+    if (status_ == SQLITE_ROW || status_ == SQLITE_DONE) {
+      status_ = SQLITE_OK;
+    }
+  }
+  if (status_ != SQLITE_OK) {
+    message_ = sqlite3_errmsg(db_);
+  }
+  sqlite3_finalize(stmt);
+  return status_ == SQLITE_OK;
+}
+
+bool MaintenanceJob::ListTables(bool include_internal,
+                                std::vector<std::string> *tables) {
+  if (!target_.empty()) {
+    tables->push_back(target_);
+    return true;
+  }
+  const char *sql =
+      include_internal
+          ? "SELECT name FROM sqlite_schema WHERE type = 'table'"
+          : "SELECT name FROM sqlite_schema WHERE type = 'table' "
+            "AND name NOT LIKE 'sqlite\\_%' ESCAPE '\\'";
+  sqlite3_stmt *stmt = nullptr;
+  status_ = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+  while (status_ == SQLITE_OK && (status_ = sqlite3_step(stmt)) == SQLITE_ROW) {
+    tables->emplace_back(
+        reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)));
+    status_ = SQLITE_OK;
+  }
+  if (status_ == SQLITE_DONE) {
+    status_ = SQLITE_OK;
+  } else {
+    message_ = sqlite3_errmsg(db_);
+  }
+  sqlite3_finalize(stmt);
+  return status_ == SQLITE_OK;
+}
+
+void MaintenanceJob::ExplainMissingFunction(const std::string &table) {
+  // Schemas load without the functions their indexes use, so a missing one
+  // only shows once REINDEX or ANALYZE evaluates an index expression
+  if (message_.rfind("no such function", 0) != 0) {
+    return;
+  }
+  message_ = table + ": " + message_ +
+             ". Maintenance runs on a separate connection, which does not "
+             "have the functions registered with function() or aggregate(); "
+             "use exec() on this connection instead.";
+}
+
+void MaintenanceJob::Report(int64_t done) {
+  if (progress_func_.IsEmpty()) {
+    return;
+  }
+  MaintenanceProgress data = {done, total_};
+  progress_->Send(&data, 1);
+}
+
+bool MaintenanceJob::VacuumInto() {
+  if (!QueryInt("PRAGMA page_count", &total_) ||
+      !QueryInt("PRAGMA page_size", &page_size_)) {
+    return false;
+  }
+  if (!progress_func_.IsEmpty()) {
+    next_report_ = std::chrono::steady_clock::now() +
+                   std::chrono::milliseconds(kProgressInterval);
+    sqlite3_progress_handler(db_, 1000, VacuumProgress, this);
+  }
+
+  sqlite3_stmt *stmt = nullptr;
+  status_ = sqlite3_prepare_v2(db_, "VACUUM INTO ?1", -1, &stmt, nullptr);
+  if (status_ == SQLITE_OK) {
+    status_ =
+        sqlite3_bind_text(stmt, 1, path_.c_str(), -1, SQLITE_TRANSIENT);
+  }
+  if (status_ == SQLITE_OK && (status_ = sqlite3_step(stmt)) == SQLITE_DONE) {
+    status_ = SQLITE_OK;
+  }
+  if (status_ != SQLITE_OK) {
+    message_ = std::string("Failed to vacuum into ") + path_ + ": " +
+               sqlite3_errmsg(db_);
+  }
+  sqlite3_finalize(stmt);
+  sqlite3_progress_handler(db_, 0, nullptr, nullptr);
+  if (status_ != SQLITE_OK) {
+    return false;
+  }
+
+  // Free pages are left behind, so the copy is usually smaller
+  sqlite3 *copy = nullptr;
+  sqlite3_stmt *count = nullptr;
+  if (sqlite3_open_v2(path_.c_str(), &copy, SQLITE_OPEN_READONLY, nullptr) ==
+          SQLITE_OK &&
+      sqlite3_prepare_v2(copy, "PRAGMA page_count", -1, &count, nullptr) ==
+          SQLITE_OK &&
+      sqlite3_step(count) == SQLITE_ROW) {
+    total_ = sqlite3_column_int64(count, 0);
+  }
+  sqlite3_finalize(count);
+  sqlite3_close_v2(copy);
+
+  result_ = total_;
+  Report(total_);
+  return true;
+}
+
+int MaintenanceJob::VacuumProgress(void *context) {
+  MaintenanceJob *job = static_cast<MaintenanceJob *>(context);
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (now < job->next_report_) {
+    return 0;
+  }
+  job->next_report_ = now + std::chrono::milliseconds(kProgressInterval);
+
+  // VACUUM INTO attaches the destination as "vacuum_<random>" after main
+  // and temp. Its size shows how much has been written so far.
+  const char *name = sqlite3_db_name(job->db_, 2);
+  sqlite3_file *file = nullptr;
+  sqlite3_int64 size = 0;
+  if (name != nullptr && std::strncmp(name, "vacuum_", 7) == 0 &&
+      sqlite3_file_control(job->db_, name, SQLITE_FCNTL_FILE_POINTER,
+                           &file) == SQLITE_OK &&
+      file != nullptr && file->pMethods != nullptr &&
+      file->pMethods->xFileSize(file, &size) == SQLITE_OK &&
+      job->page_size_ > 0) {
+    job->Report(std::min(size / job->page_size_, job->total_));
+  }
+  return 0;
+}
+
+bool MaintenanceJob::IncrementalVacuum() {
+  int64_t auto_vacuum = 0;
+  int64_t free_pages = 0;
+  if (!QueryInt("PRAGMA auto_vacuum", &auto_vacuum) ||
+      !QueryInt("PRAGMA freelist_count", &free_pages)) {
+    return false;
+  }
+  // With auto_vacuum = FULL the free list is always empty
+  if (auto_vacuum == 0) {
+    status_ = SQLITE_MISUSE;
+    message_ = "incremental_vacuum needs PRAGMA auto_vacuum = INCREMENTAL";
+    return false;
+  }
+
+  total_ = max_pages_ >= 0 ? std::min(free_pages, max_pages_) : free_pages;
+  // One transaction per step, so writers get the lock in between
+  while (result_ < total_) {
+    int64_t step = std::min(step_pages_, total_ - result_);
+    int64_t remaining = 0;
+    if (!Exec("PRAGMA incremental_vacuum(" + std::to_string(step) + ")") ||
+        !QueryInt("PRAGMA freelist_count", &remaining)) {
+      return false;
+    }
+    if (remaining >= free_pages) {
+      break; // Writers refilled the free list as fast as it drained
+    }
+    result_ += free_pages - remaining;
+    free_pages = remaining;
+    Report(std::min(result_, total_));
+  }
+  return true;
+}
+
+bool MaintenanceJob::Reindex() {
+  std::vector<std::string> tables;
+  if (!ListTables(true, &tables)) {
+    return false;
+  }
+  total_ = static_cast<int64_t>(tables.size());
+  for (const std::string &table : tables) {
+    // A target may also name a collation, which a schema prefix would rule
+    // out. Table names are qualified so they can't be taken for one.
+    char *sql = target_.empty()
+                    ? sqlite3_mprintf("REINDEX main.\"%w\"", table.c_str())
+                    : sqlite3_mprintf("REINDEX \"%w\"", table.c_str());
+    bool ok = Exec(sql);
+    sqlite3_free(sql);
+    if (!ok) {
+      ExplainMissingFunction(table);
+      return false;
+    }
+    Report(++result_);
+  }
+  return true;
+}
+
+bool MaintenanceJob::Analyze() {
+  if (analysis_limit_ >= 0 &&
+      !Exec("PRAGMA analysis_limit = " + std::to_string(analysis_limit_))) {
+    return false;
+  }
+  std::vector<std::string> tables;
+  if (!ListTables(false, &tables)) {
+    return false;
+  }
+  total_ = static_cast<int64_t>(tables.size());
+  for (const std::string &table : tables) {
+    char *sql = sqlite3_mprintf("ANALYZE main.\"%w\"", table.c_str());
+    bool ok = Exec(sql);
+    sqlite3_free(sql);
+    if (!ok) {
+      ExplainMissingFunction(table);
+      return false;
+    }
+    Report(++result_);
+  }
+  return true;
+}
+
+void MaintenanceJob::OnOK() {
+  // This runs on the main thread after Execute completes successfully
+  Napi::HandleScope scope(Env());
+
+  // Connections read sqlite_stat1 when they load the schema, and ANALYZE
+  // does not make them reload it. Reload it on the caller's connection if
+  // nothing else is using it.
+  if (operation_ == kAnalyze && database_->IsOpen() && database_->IsIdle() &&
+      sqlite3_get_autocommit(database_->connection())) {
+    std::unique_lock<std::mutex> lock(*database_->query_mutex(),
+                                      std::try_to_lock);
+    if (lock.owns_lock()) {
+      char *sql =
+          sqlite3_mprintf("ANALYZE \"%w\".sqlite_schema", schema_.c_str());
+      sqlite3_exec(database_->connection(), sql, nullptr, nullptr, nullptr);
+      sqlite3_free(sql);
+    }
+  }
+
+  deferred_.Resolve(Napi::Number::New(Env(), static_cast<double>(result_)));
+  database_ref_.Reset();
+}
+
+void MaintenanceJob::OnError(const Napi::Error &error) {
+  // This runs on the main thread if Execute encounters an error
+  Napi::HandleScope scope(Env());
+  node::ThrowEnhancedSqliteError(Env(), nullptr, status_, message_);
+  deferred_.Reject(Env().GetAndClearPendingException().Value());
+  database_ref_.Reset();
+}
+
+void MaintenanceJob::OnProgress(const MaintenanceProgress *data,
+                                size_t count) {
+  // This runs on the main thread
+  if (progress_func_.IsEmpty() || count == 0) {
+    return;
+  }
+  Napi::HandleScope scope(Env());
+  Napi::Object progress_info = Napi::Object::New(Env());
+  progress_info.Set("done",
+                    Napi::Number::New(Env(), static_cast<double>(data->done)));
+  progress_info.Set(
+      "total", Napi::Number::New(Env(), static_cast<double>(data->total)));
+  try {
+    progress_func_.Call(Env().Null(), {progress_info});
+  } catch (...) {
+    // Like backup(), errors in the progress callback are ignored
+  }
+}
+
+} // namespace sqlite
+} // namespace photostructure
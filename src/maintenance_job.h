@@ -0,0 +1,98 @@
+#ifndef SRC_MAINTENANCE_JOB_H_
+#define SRC_MAINTENANCE_JOB_H_
+
+#include <napi.h>
+#include <sqlite3.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sqlite_impl.h"
+
+namespace photostructure {
+namespace sqlite {
+
+// Progress data for maintenance progress updates. The unit depends on the
+// operation: pages for the vacuums, tables for REINDEX and ANALYZE.
+struct MaintenanceProgress {
+  int64_t done;
+  int64_t total;
+};
+
+// Runs VACUUM INTO, incremental_vacuum, REINDEX or ANALYZE on a connection of
+// its own, opened on a libuv pool thread like a backup's destination. The
+// caller's connection stays usable: the job competes for SQLite's file locks
+// like any other connection, and takes them one bounded step at a time.
+class MaintenanceJob : public Napi::AsyncProgressWorker<MaintenanceProgress> {
+public:
+  enum Operation { kVacuumInto, kIncrementalVacuum, kReindex, kAnalyze };
+
+  static constexpr int kDefaultTimeout = 5000;        // Milliseconds
+  static constexpr int kDefaultIncrementalPages = 128; // Pages per step
+  // Minimum time between progress reports of VACUUM INTO, which are read
+  // from the size of the file being written
+  static constexpr int kProgressInterval = 100; // Milliseconds
+
+  // Parses the arguments of vacuumInto(), incrementalVacuum(), reindex() or
+  // analyze() and queues the job. Returns a promise for the number of pages
+  // written or released, or of tables processed.
+  static Napi::Value Start(const Napi::CallbackInfo &info,
+                           DatabaseSync *database, Operation operation);
+
+  void Execute(const ExecutionProgress &progress) override;
+  void OnOK() override;
+  void OnError(const Napi::Error &error) override;
+  void OnProgress(const MaintenanceProgress *data, size_t count) override;
+
+private:
+  MaintenanceJob(Napi::Env env, DatabaseSync *database, Operation operation,
+                 Napi::Function progress_func,
+                 Napi::Promise::Deferred deferred);
+
+  // Worker thread. Each returns false with status_ and message_ set.
+  bool VacuumInto();
+  bool IncrementalVacuum();
+  bool Reindex();
+  bool Analyze();
+  bool Exec(const std::string &sql);
+  bool QueryInt(const char *sql, int64_t *value);
+  // Tables of the database, or just target_ if it is set
+  bool ListTables(bool include_internal, std::vector<std::string> *tables);
+  // Points at the cause when an index of table uses an app-defined function
+  void ExplainMissingFunction(const std::string &table);
+  void Report(int64_t done);
+  static int VacuumProgress(void *context);
+
+  Operation operation_;
+  DatabaseSync *database_;
+  Napi::ObjectReference database_ref_;
+  Napi::FunctionReference progress_func_;
+  Napi::Promise::Deferred deferred_;
+
+  // Options, read on the JS thread
+  std::string filename_; // Of the schema to maintain
+  std::string schema_;   // Its name on the caller's connection
+  std::string path_;     // VACUUM INTO destination
+  std::string target_;   // Table, index or collation for REINDEX / ANALYZE
+  int timeout_ = kDefaultTimeout;
+  int64_t step_pages_ = kDefaultIncrementalPages;
+  int64_t max_pages_ = -1;     // No limit
+  int64_t analysis_limit_ = -1; // Leave SQLite's default
+
+  // These are only accessed in Execute() on worker thread
+  sqlite3 *db_ = nullptr;
+  const ExecutionProgress *progress_ = nullptr;
+  std::chrono::steady_clock::time_point next_report_;
+  int64_t page_size_ = 0;
+  int64_t total_ = 0;
+  int64_t result_ = 0;
+  int status_ = SQLITE_OK;
+  std::string message_;
+};
+
+} // namespace sqlite
+} // namespace photostructure
+
+#endif // SRC_MAINTENANCE_JOB_H_
@@ -4,9 +4,15 @@
 #include <cctype>
 #include <climits>
 #include <cmath>
+#include <cstring>
+#include <exception>
 #include <iostream>
 
 #include "aggregate_function.h"
+#include "changegroup.h"
+#include "changeset_stream.h"
+#include "conflict_policy.h"
+#include "maintenance_job.h"
 #include "shims/sqlite_errors.h"
 #include "sqlite_exception.h"
 #include "user_function.h"
@@ -228,12 +234,104 @@ std::optional<std::string> ValidateDatabasePath(Napi::Env env, Napi::Value path,
   return std::nullopt;
 }
 
+static int RawPageAuthorizer(void *, int action, const char *table,
+                             const char *detail, const char *,
+                             const char *) {
+  switch (action) {
+  case SQLITE_INSERT:
+  case SQLITE_UPDATE:
+  case SQLITE_DELETE:
+    // `table` is the name of the table written to
+    return table != nullptr && sqlite3_stricmp(table, "sqlite_dbpage") == 0
+               ? SQLITE_DENY
+               : SQLITE_OK;
+  case SQLITE_CREATE_VTABLE:
+    // `detail` is the module: a table created with it would be writable too
+    return detail != nullptr && sqlite3_stricmp(detail, "sqlite_dbpage") == 0
+               ? SQLITE_DENY
+               : SQLITE_OK;
+  default:
+    return SQLITE_OK;
+  }
+}
+
+int DenyRawPageWrites(sqlite3 *db) {
+  return sqlite3_set_authorizer(db, RawPageAuthorizer, nullptr);
+}
+
 // Note: Static constructors removed to fix worker thread issues
 // Constructors are now stored in per-instance AddonData
 
 // Forward declarations for addon data access
 extern AddonData *GetAddonData(napi_env env);
 
+// Reads { statementCacheSize } from the open options. Returns false with a
+// pending exception if it is not a non-negative integer.
+static bool ParseStatementCacheSize(Napi::Env env, Napi::Object options,
+                                    DatabaseOpenConfiguration *config) {
+  Napi::Value value = options.Get("statementCacheSize");
+  if (value.IsUndefined()) {
+    return true;
+  }
+  if (!value.IsNumber()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"options.statementCacheSize\" argument must be a number.");
+    return false;
+  }
+  double size = value.As<Napi::Number>().DoubleValue();
+  if (!std::isfinite(size) || size < 0 || size > INT32_MAX ||
+      size != std::floor(size)) {
+    node::THROW_ERR_OUT_OF_RANGE(
+        env, "The \"options.statementCacheSize\" argument must be a "
+             "non-negative integer.");
+    return false;
+  }
+  config->set_statement_cache_size(static_cast<size_t>(size));
+  return true;
+}
+
+// Reads { defensive } from the open options
+static bool ParseDefensiveOption(Napi::Env env, Napi::Object options,
+                                 DatabaseOpenConfiguration *config) {
+  Napi::Value value = options.Get("defensive");
+  if (value.IsUndefined()) {
+    return true;
+  }
+  if (!value.IsBoolean()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"options.defensive\" argument must be a boolean.");
+    return false;
+  }
+  config->set_defensive(value.As<Napi::Boolean>().Value());
+  return true;
+}
+
+// Reads the "deserialize" open option into config. Returns false with a
+// pending exception if the value is invalid.
+static bool ParseDeserializeOption(Napi::Env env, Napi::Object options,
+                                   DatabaseOpenConfiguration *config) {
+  Napi::Value value = options.Get("deserialize");
+  if (value.IsUndefined()) {
+    return true;
+  }
+  if (!value.IsTypedArray() ||
+      value.As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env,
+        "The \"options.deserialize\" argument must be a Buffer or Uint8Array.");
+    return false;
+  }
+  if (config->location() != ":memory:") {
+    node::THROW_ERR_INVALID_ARG_VALUE(
+        env, "The \"options.deserialize\" option requires the \":memory:\" "
+             "location.");
+    return false;
+  }
+  Napi::Uint8Array image = value.As<Napi::Uint8Array>();
+  config->set_deserialize(image.Data(), image.ElementLength());
+  return true;
+}
+
 // DatabaseSync Implementation
 Napi::Object DatabaseSync::Init(Napi::Env env, Napi::Object exports) {
   Napi::Function func = DefineClass(
@@ -241,7 +339,18 @@ Napi::Object DatabaseSync::Init(Napi::Env env, Napi::Object exports) {
       {InstanceMethod("open", &DatabaseSync::Open),
        InstanceMethod("close", &DatabaseSync::Close),
        InstanceMethod("prepare", &DatabaseSync::Prepare),
+       InstanceMethod("prepareCached", &DatabaseSync::PrepareCached),
+       InstanceMethod("statementCacheStats",
+                      &DatabaseSync::StatementCacheStats),
+       InstanceMethod("clearStatementCache",
+                      &DatabaseSync::ClearStatementCache),
+       InstanceMethod("statementStatus", &DatabaseSync::StatementStatus),
+       InstanceMethod("status", &DatabaseSync::Status),
+       InstanceMethod("enableProfiler", &DatabaseSync::EnableProfiler),
+       InstanceMethod("profile", &DatabaseSync::Profile),
+       InstanceMethod("serialize", &DatabaseSync::Serialize),
        InstanceMethod("exec", &DatabaseSync::Exec),
+       InstanceMethod("execAsync", &DatabaseSync::ExecAsync),
        InstanceMethod("function", &DatabaseSync::CustomFunction),
        InstanceMethod("aggregate", &DatabaseSync::AggregateFunction),
        InstanceMethod("enableLoadExtension",
@@ -249,11 +358,24 @@ Napi::Object DatabaseSync::Init(Napi::Env env, Napi::Object exports) {
        InstanceMethod("loadExtension", &DatabaseSync::LoadExtension),
        InstanceMethod("createSession", &DatabaseSync::CreateSession),
        InstanceMethod("applyChangeset", &DatabaseSync::ApplyChangeset),
+       InstanceMethod("applyChangesetStream",
+                      &DatabaseSync::ApplyChangesetStream),
+       InstanceMethod("applyChangesetAsync",
+                      &DatabaseSync::ApplyChangesetAsync),
        InstanceMethod("backup", &DatabaseSync::Backup),
+       InstanceMethod("streamBackup", &DatabaseSync::StreamBackup),
+       InstanceMethod("vacuumInto", &DatabaseSync::VacuumInto),
+       InstanceMethod("incrementalVacuum", &DatabaseSync::IncrementalVacuum),
+       InstanceMethod("reindex", &DatabaseSync::Reindex),
+       InstanceMethod("analyze", &DatabaseSync::Analyze),
        InstanceMethod("location", &DatabaseSync::LocationMethod),
+       InstanceMethod("interrupt", &DatabaseSync::Interrupt),
+       StaticMethod("interrupt", &DatabaseSync::InterruptByHandle),
        InstanceAccessor("isOpen", &DatabaseSync::IsOpenGetter, nullptr),
        InstanceAccessor("isTransaction", &DatabaseSync::IsTransactionGetter,
-                        nullptr)});
+                        nullptr),
+       InstanceAccessor("interruptHandle",
+                        &DatabaseSync::InterruptHandleGetter, nullptr)});
 
   // Store constructor in per-instance addon data instead of static variable
   AddonData *addon_data = GetAddonData(env);
@@ -326,6 +448,21 @@ DatabaseSync::DatabaseSync(const Napi::CallbackInfo &info)
         allow_load_extension_ =
             options.Get("allowExtension").As<Napi::Boolean>().Value();
       }
+
+      if (!ParseStatementCacheSize(info.Env(), options, &config)) {
+        return;
+      }
+
+      QueryLimits limits;
+      if (!ParseQueryLimits(info.Env(), options, &limits)) {
+        return;
+      }
+      config.set_query_limits(limits);
+
+      if (!ParseDefensiveOption(info.Env(), options, &config) ||
+          !ParseDeserializeOption(info.Env(), options, &config)) {
+        return;
+      }
     }
 
     InternalOpen(config);
@@ -406,6 +543,21 @@ Napi::Value DatabaseSync::Open(const Napi::CallbackInfo &info) {
         config_obj.Get("allowExtension").As<Napi::Boolean>().Value();
   }
 
+  if (!ParseStatementCacheSize(env, config_obj, &config)) {
+    return env.Undefined();
+  }
+
+  QueryLimits limits;
+  if (!ParseQueryLimits(env, config_obj, &limits)) {
+    return env.Undefined();
+  }
+  config.set_query_limits(limits);
+
+  if (!ParseDefensiveOption(env, config_obj, &config) ||
+      !ParseDeserializeOption(env, config_obj, &config)) {
+    return env.Undefined();
+  }
+
   try {
     InternalOpen(config);
   } catch (const SqliteException &e) {
@@ -424,12 +576,19 @@ Napi::Value DatabaseSync::Close(const Napi::CallbackInfo &info) {
     return env.Undefined();
   }
 
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
   if (!IsOpen()) {
     node::THROW_ERR_INVALID_STATE(env, "Database is not open");
     return env.Undefined();
   }
 
   try {
+    // Cached statements are owned by this connection, so finalize them now
+    // rather than leaving the connection as a zombie until they are collected.
+    ReleaseStatementCache(true);
     InternalClose();
   } catch (const std::exception &e) {
     node::THROW_ERR_SQLITE_ERROR(env, e.what());
@@ -445,6 +604,10 @@ Napi::Value DatabaseSync::Prepare(const Napi::CallbackInfo &info) {
     return env.Undefined();
   }
 
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
   if (!IsOpen()) {
     node::THROW_ERR_INVALID_STATE(env, "Database is not open");
     return env.Undefined();
@@ -458,34 +621,42 @@ Napi::Value DatabaseSync::Prepare(const Napi::CallbackInfo &info) {
   std::string sql = info[0].As<Napi::String>().Utf8Value();
 
   try {
-    // Create new StatementSync instance using addon data constructor
-    AddonData *addon_data = GetAddonData(env);
-    if (!addon_data || addon_data->statementSyncConstructor.IsEmpty()) {
-      node::THROW_ERR_INVALID_STATE(
-          env, "StatementSync constructor not initialized");
-      return env.Undefined();
-    }
-    Napi::Object stmt_obj =
-        addon_data->statementSyncConstructor.New({}).As<Napi::Object>();
-
-    // Initialize the statement
-    StatementSync *stmt = StatementSync::Unwrap(stmt_obj);
-    stmt->InitStatement(this, sql);
-
-    return stmt_obj;
+    return CreateStatement(env, sql, 0);
   } catch (const std::exception &e) {
     node::THROW_ERR_SQLITE_ERROR(env, e.what());
     return env.Undefined();
   }
 }
 
-Napi::Value DatabaseSync::Exec(const Napi::CallbackInfo &info) {
+Napi::Object DatabaseSync::CreateStatement(Napi::Env env,
+                                           const std::string &sql,
+                                           unsigned int prepare_flags) {
+  // Create new StatementSync instance using addon data constructor
+  AddonData *addon_data = GetAddonData(env);
+  if (!addon_data || addon_data->statementSyncConstructor.IsEmpty()) {
+    throw std::runtime_error("StatementSync constructor not initialized");
+  }
+  Napi::Object stmt_obj =
+      addon_data->statementSyncConstructor.New({}).As<Napi::Object>();
+
+  // Initialize the statement
+  StatementSync *stmt = StatementSync::Unwrap(stmt_obj);
+  stmt->InitStatement(this, sql, prepare_flags);
+
+  return stmt_obj;
+}
+
+Napi::Value DatabaseSync::PrepareCached(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
   if (!ValidateThread(env)) {
     return env.Undefined();
   }
 
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
   if (!IsOpen()) {
     node::THROW_ERR_INVALID_STATE(env, "Database is not open");
     return env.Undefined();
@@ -498,421 +669,641 @@ Napi::Value DatabaseSync::Exec(const Napi::CallbackInfo &info) {
 
   std::string sql = info[0].As<Napi::String>().Utf8Value();
 
-  char *error_msg = nullptr;
-  int result =
-      sqlite3_exec(connection(), sql.c_str(), nullptr, nullptr, &error_msg);
+  try {
+    auto cached = statement_cache_.find(sql);
+    if (cached != statement_cache_.end()) {
+      if (!cached->second.statement_ptr->IsFinalized()) {
+        // Move to the front of the LRU list without reallocating the node
+        statement_lru_.splice(statement_lru_.begin(), statement_lru_,
+                              cached->second.lru_position);
+        statement_cache_hits_++;
+        return cached->second.statement.Value();
+      }
 
-  if (result != SQLITE_OK) {
-    std::string error = error_msg ? error_msg : "Unknown SQLite error";
-    if (error_msg)
-      sqlite3_free(error_msg);
-    // Use enhanced error throwing with database handle
-    node::ThrowSqliteError(env, connection(), error);
-  }
+      // The caller finalized a shared statement; prepare a fresh one
+      statement_lru_.erase(cached->second.lru_position);
+      statement_cache_.erase(cached);
+    }
 
-  return env.Undefined();
-}
+    statement_cache_misses_++;
 
-Napi::Value DatabaseSync::LocationMethod(const Napi::CallbackInfo &info) {
-  Napi::Env env = info.Env();
+    if (statement_cache_capacity_ == 0) {
+      return CreateStatement(env, sql, 0);
+    }
 
-  if (!IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
+    // Cached statements are expected to be reused many times, which is
+    // exactly what SQLITE_PREPARE_PERSISTENT tells SQLite to optimize for.
+    Napi::Object stmt_obj =
+        CreateStatement(env, sql, SQLITE_PREPARE_PERSISTENT);
+
+    EvictStatements(statement_cache_capacity_ - 1);
+    statement_lru_.push_front(sql);
+    CachedStatement &entry = statement_cache_[sql];
+    entry.statement = Napi::Persistent(stmt_obj);
+    entry.statement_ptr = StatementSync::Unwrap(stmt_obj);
+    entry.lru_position = statement_lru_.begin();
+
+    return stmt_obj;
+  } catch (const std::exception &e) {
+    node::THROW_ERR_SQLITE_ERROR(env, e.what());
     return env.Undefined();
   }
+}
 
-  // Default to "main" if no dbName provided
-  std::string db_name = "main";
-  if (info.Length() > 0 && info[0].IsString()) {
-    db_name = info[0].As<Napi::String>().Utf8Value();
+void DatabaseSync::EvictStatements(size_t capacity) {
+  while (statement_cache_.size() > capacity && !statement_lru_.empty()) {
+    // Evicted statements are not finalized: callers may still hold them, and
+    // they are released normally once unreachable.
+    statement_cache_.erase(statement_lru_.back());
+    statement_lru_.pop_back();
+    statement_cache_evictions_++;
   }
+}
 
-  // Use sqlite3_db_filename() to get the database file path
-  const char *filename = sqlite3_db_filename(connection(), db_name.c_str());
-
-  // Return null for in-memory databases, non-existent databases, or if database
-  // not found
-  if (filename == nullptr || strlen(filename) == 0) {
-    return env.Null();
+void DatabaseSync::ReleaseStatementCache(bool finalize_statements) {
+  if (finalize_statements) {
+    for (auto &entry : statement_cache_) {
+      entry.second.statement_ptr->Finalize();
+    }
   }
-
-  return Napi::String::New(env, filename);
+  statement_cache_.clear();
+  statement_lru_.clear();
 }
 
-Napi::Value DatabaseSync::IsOpenGetter(const Napi::CallbackInfo &info) {
-  return Napi::Boolean::New(info.Env(), IsOpen());
-}
+Napi::Value DatabaseSync::StatementCacheStats(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
 
-Napi::Value DatabaseSync::IsTransactionGetter(const Napi::CallbackInfo &info) {
-  // Check if we're in a transaction
-  bool in_transaction = IsOpen() && !sqlite3_get_autocommit(connection());
-  return Napi::Boolean::New(info.Env(), in_transaction);
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("size", Napi::Number::New(
+                        env, static_cast<double>(statement_cache_.size())));
+  stats.Set("capacity",
+            Napi::Number::New(env,
+                              static_cast<double>(statement_cache_capacity_)));
+  stats.Set("hits",
+            Napi::Number::New(env, static_cast<double>(statement_cache_hits_)));
+  stats.Set("misses", Napi::Number::New(
+                          env, static_cast<double>(statement_cache_misses_)));
+  stats.Set("evictions",
+            Napi::Number::New(
+                env, static_cast<double>(statement_cache_evictions_)));
+  return stats;
 }
 
-void DatabaseSync::InternalOpen(DatabaseOpenConfiguration config) {
-  location_ = config.location();
-  read_only_ = config.get_read_only();
-
-  int flags = SQLITE_OPEN_CREATE;
-  if (read_only_) {
-    flags = SQLITE_OPEN_READONLY;
-  } else {
-    flags |= SQLITE_OPEN_READWRITE;
-  }
+// sqlite3_stmt_status() counters, in the order they are reported
+struct StatementCounter {
+  const char *name;
+  int op;
+  bool resettable;
+};
 
-  int result = sqlite3_open_v2(location_.c_str(), &connection_, flags, nullptr);
+// MEMUSED is a gauge. REPREPARE is never reset either: StatementSync checks
+// it to notice re-prepares, and a reset could bring it back to the value the
+// column key cache was built at.
+static const StatementCounter kStatementCounters[] = {
+    {"fullscanStep", SQLITE_STMTSTATUS_FULLSCAN_STEP, true},
+    {"sort", SQLITE_STMTSTATUS_SORT, true},
+    {"autoindex", SQLITE_STMTSTATUS_AUTOINDEX, true},
+    {"vmStep", SQLITE_STMTSTATUS_VM_STEP, true},
+    {"reprepare", SQLITE_STMTSTATUS_REPREPARE, false},
+    {"run", SQLITE_STMTSTATUS_RUN, true},
+    {"filterHit", SQLITE_STMTSTATUS_FILTER_HIT, true},
+    {"filterMiss", SQLITE_STMTSTATUS_FILTER_MISS, true},
+    {"memUsed", SQLITE_STMTSTATUS_MEMUSED, false},
+};
 
-  if (result != SQLITE_OK) {
-    std::string error = sqlite3_errmsg(connection_);
-    // Capture error info before closing
-    SqliteException ex(connection_, result,
-                       "Failed to open database: " + error);
-    if (connection_) {
-      sqlite3_close(connection_);
-      connection_ = nullptr;
-    }
-    throw ex;
-  }
+// Reads every counter of stmt into a new object, resetting the resettable
+// ones if asked.
+static Napi::Object ReadStatementCounters(Napi::Env env, sqlite3_stmt *stmt,
+                                          bool reset) {
+  Napi::Object counters = Napi::Object::New(env);
+  for (const StatementCounter &counter : kStatementCounters) {
+    int value = sqlite3_stmt_status(stmt, counter.op,
+                                    reset && counter.resettable ? 1 : 0);
+    counters.Set(counter.name, Napi::Number::New(env, value));
+  }
+  return counters;
+}
 
-  // Configure database
-  if (config.get_enable_foreign_keys()) {
-    sqlite3_exec(connection(), "PRAGMA foreign_keys = ON", nullptr, nullptr,
-                 nullptr);
+// Reads { limit } from an options object. Returns false with a pending
+// exception if it is not a positive integer.
+static bool ParseLimitOption(Napi::Env env, Napi::Object options,
+                             uint32_t *limit) {
+  Napi::Value limit_value = options.Get("limit");
+  if (limit_value.IsUndefined()) {
+    return true;
+  }
+  double value =
+      limit_value.IsNumber() ? limit_value.As<Napi::Number>().DoubleValue() : 0;
+  if (!(value >= 1) || value > UINT32_MAX || value != std::floor(value)) {
+    node::THROW_ERR_OUT_OF_RANGE(
+        env, "The \"options.limit\" argument must be a positive integer.");
+    return false;
   }
+  *limit = static_cast<uint32_t>(value);
+  return true;
+}
 
-  if (config.get_timeout() > 0) {
-    sqlite3_busy_timeout(connection(), config.get_timeout());
+// Reads { reset } from an options argument. Returns false with a pending
+// exception if the options are invalid.
+static bool ParseResetOption(Napi::Env env, Napi::Value options,
+                             bool *reset) {
+  if (options.IsUndefined()) {
+    return true;
   }
-
-  // Configure double-quoted string literals
-  if (config.get_enable_dqs()) {
-    int dqs_enable = 1;
-    result = sqlite3_db_config(connection(), SQLITE_DBCONFIG_DQS_DML,
-                               dqs_enable, nullptr);
-    if (result != SQLITE_OK) {
-      std::string error = sqlite3_errmsg(connection());
-      SqliteException ex(connection_, result,
-                         "Failed to configure DQS_DML: " + error);
-      sqlite3_close(connection_);
-      connection_ = nullptr;
-      throw ex;
-    }
-
-    result = sqlite3_db_config(connection(), SQLITE_DBCONFIG_DQS_DDL,
-                               dqs_enable, nullptr);
-    if (result != SQLITE_OK) {
-      std::string error = sqlite3_errmsg(connection());
-      SqliteException ex(connection_, result,
-                         "Failed to configure DQS_DDL: " + error);
-      sqlite3_close(connection_);
-      connection_ = nullptr;
-      throw ex;
-    }
+  if (!options.IsObject()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"options\" argument must be an object.");
+    return false;
   }
-}
-
-void DatabaseSync::InternalClose() {
-  if (connection_) {
-    // Finalize all prepared statements
-    prepared_statements_.clear();
-
-    // Delete all sessions before closing the database
-    // This is required by SQLite to avoid undefined behavior
-    DeleteAllSessions();
-
-    // Close the database connection
-    int result = sqlite3_close(connection_);
-    if (result != SQLITE_OK) {
-      // Force close even if there are outstanding statements
-      sqlite3_close_v2(connection_);
+  Napi::Value reset_value = options.As<Napi::Object>().Get("reset");
+  if (!reset_value.IsUndefined()) {
+    if (!reset_value.IsBoolean()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options.reset\" argument must be a boolean.");
+      return false;
     }
-    connection_ = nullptr;
+    *reset = reset_value.As<Napi::Boolean>().Value();
   }
-  location_.clear();
-  enable_load_extension_ = false;
+  return true;
 }
 
-Napi::Value DatabaseSync::CustomFunction(const Napi::CallbackInfo &info) {
+Napi::Value DatabaseSync::StatementStatus(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
-  if (!IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
+  if (!ValidateThread(env)) {
     return env.Undefined();
   }
 
-  if (info.Length() < 2) {
-    node::THROW_ERR_INVALID_ARG_TYPE(
-        env, "Expected at least 2 arguments: name and function");
+  if (!ValidateIdle(env)) {
     return env.Undefined();
   }
 
-  if (!info[0].IsString()) {
-    node::THROW_ERR_INVALID_ARG_TYPE(env, "Function name must be a string");
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
     return env.Undefined();
   }
 
-  // Parse arguments: function(name, [options], callback)
-  int fn_index = info.Length() < 3 ? 1 : 2;
-  bool use_bigint_args = false;
-  bool varargs = false;
-  bool deterministic = false;
-  bool direct_only = false;
+  bool reset = false;
+  if (!ParseResetOption(env, info[0], &reset)) {
+    return env.Undefined();
+  }
 
-  // Parse options object if provided
-  if (fn_index > 1 && info[1].IsObject()) {
-    Napi::Object options = info[1].As<Napi::Object>();
+  int sort_op = SQLITE_STMTSTATUS_VM_STEP;
+  uint32_t limit = kDefaultStatementStatusLimit;
+  if (info[0].IsObject()) {
+    Napi::Object options = info[0].As<Napi::Object>();
 
-    if (options.Has("useBigIntArguments") &&
-        options.Get("useBigIntArguments").IsBoolean()) {
-      use_bigint_args =
-          options.Get("useBigIntArguments").As<Napi::Boolean>().Value();
+    Napi::Value sort_value = options.Get("sortBy");
+    if (!sort_value.IsUndefined()) {
+      std::string sort_by =
+          sort_value.IsString() ? sort_value.As<Napi::String>().Utf8Value()
+                                : "";
+      auto counter = std::find_if(
+          std::begin(kStatementCounters), std::end(kStatementCounters),
+          [&](const StatementCounter &c) { return sort_by == c.name; });
+      if (counter == std::end(kStatementCounters)) {
+        node::THROW_ERR_INVALID_ARG_VALUE(
+            env, "The \"options.sortBy\" argument must name a statement "
+                 "counter.");
+        return env.Undefined();
+      }
+      sort_op = counter->op;
     }
 
-    if (options.Has("varargs") && options.Get("varargs").IsBoolean()) {
-      varargs = options.Get("varargs").As<Napi::Boolean>().Value();
+    if (!ParseLimitOption(env, options, &limit)) {
+      return env.Undefined();
     }
+  }
 
-    if (options.Has("deterministic") &&
-        options.Get("deterministic").IsBoolean()) {
-      deterministic = options.Get("deterministic").As<Napi::Boolean>().Value();
+  // Walk every statement prepared on the connection, whether it was made by
+  // prepare(), prepareCached() or internally
+  std::vector<std::pair<int, sqlite3_stmt *>> offenders;
+  for (sqlite3_stmt *stmt = sqlite3_next_stmt(connection(), nullptr);
+       stmt != nullptr; stmt = sqlite3_next_stmt(connection(), stmt)) {
+    int value = sqlite3_stmt_status(stmt, sort_op, 0);
+    if (value > 0) {
+      offenders.emplace_back(value, stmt);
     }
-
-    if (options.Has("directOnly") && options.Get("directOnly").IsBoolean()) {
-      direct_only = options.Get("directOnly").As<Napi::Boolean>().Value();
+  }
+  std::stable_sort(
+      offenders.begin(), offenders.end(),
+      [](const auto &a, const auto &b) { return a.first > b.first; });
+  if (offenders.size() > limit) {
+    offenders.resize(limit);
+  }
+
+  Napi::Array report = Napi::Array::New(env, offenders.size());
+  for (size_t i = 0; i < offenders.size(); i++) {
+    sqlite3_stmt *stmt = offenders[i].second;
+    Napi::Object entry = ReadStatementCounters(env, stmt, false);
+    const char *sql = sqlite3_sql(stmt);
+    entry.Set("sql", sql ? Napi::String::New(env, sql)
+                         : Napi::String::New(env, ""));
+    report.Set(static_cast<uint32_t>(i), entry);
+  }
+
+  if (reset) {
+    for (sqlite3_stmt *stmt = sqlite3_next_stmt(connection(), nullptr);
+         stmt != nullptr; stmt = sqlite3_next_stmt(connection(), stmt)) {
+      for (const StatementCounter &counter : kStatementCounters) {
+        if (counter.resettable) {
+          sqlite3_stmt_status(stmt, counter.op, 1);
+        }
+      }
     }
   }
 
-  if (!info[fn_index].IsFunction()) {
-    node::THROW_ERR_INVALID_ARG_TYPE(env, "Callback must be a function");
+  return report;
+}
+
+// sqlite3_db_status() counters reported by db.status(). Depending on the
+// counter, SQLite reports the value as the current value, the high-water
+// mark, or both.
+struct DatabaseCounter {
+  int op;
+  const char *current_name;   // nullptr if the current value is not used
+  const char *highwater_name; // nullptr if the high-water mark is not used
+};
+
+static const DatabaseCounter kDatabaseCounters[] = {
+    {SQLITE_DBSTATUS_CACHE_HIT, "cacheHit", nullptr},
+    {SQLITE_DBSTATUS_CACHE_MISS, "cacheMiss", nullptr},
+    {SQLITE_DBSTATUS_CACHE_WRITE, "cacheWrite", nullptr},
+    {SQLITE_DBSTATUS_CACHE_SPILL, "cacheSpill", nullptr},
+    {SQLITE_DBSTATUS_CACHE_USED, "cacheUsed", nullptr},
+    {SQLITE_DBSTATUS_CACHE_USED_SHARED, "cacheUsedShared", nullptr},
+    {SQLITE_DBSTATUS_LOOKASIDE_USED, "lookasideUsed",
+     "lookasideUsedHighwater"},
+    {SQLITE_DBSTATUS_LOOKASIDE_HIT, nullptr, "lookasideHit"},
+    {SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE, nullptr, "lookasideMissSize"},
+    {SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, nullptr, "lookasideMissFull"},
+    {SQLITE_DBSTATUS_SCHEMA_USED, "schemaUsed", nullptr},
+    {SQLITE_DBSTATUS_STMT_USED, "stmtUsed", nullptr},
+};
+
+Napi::Value DatabaseSync::Status(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateThread(env)) {
     return env.Undefined();
   }
 
-  std::string name = info[0].As<Napi::String>().Utf8Value();
-  Napi::Function fn = info[fn_index].As<Napi::Function>();
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
 
-  // Determine argument count
-  int argc = -1; // Default to varargs
-  if (!varargs) {
-    // Try to get function.length
-    Napi::Value length_prop = fn.Get("length");
-    if (length_prop.IsNumber()) {
-      argc = length_prop.As<Napi::Number>().Int32Value();
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
+    return env.Undefined();
+  }
+
+  bool reset = false;
+  if (!ParseResetOption(env, info[0], &reset)) {
+    return env.Undefined();
+  }
+
+  Napi::Object status = Napi::Object::New(env);
+  for (const DatabaseCounter &counter : kDatabaseCounters) {
+    int current = 0;
+    int highwater = 0;
+    sqlite3_db_status(connection(), counter.op, &current, &highwater,
+                      reset ? 1 : 0);
+    if (counter.current_name != nullptr) {
+      status.Set(counter.current_name, Napi::Number::New(env, current));
+    }
+    if (counter.highwater_name != nullptr) {
+      status.Set(counter.highwater_name, Napi::Number::New(env, highwater));
     }
   }
+  return status;
+}
 
-  // Create UserDefinedFunction wrapper
-  UserDefinedFunction *user_data =
-      new UserDefinedFunction(env, fn, this, use_bigint_args);
+// sqlite3_status64() counters reported by memoryStatus()
+struct MemoryCounter {
+  int op;
+  const char *name;
+};
 
-  // Set SQLite flags
-  int flags = SQLITE_UTF8;
-  if (deterministic) {
-    flags |= SQLITE_DETERMINISTIC;
+static const MemoryCounter kMemoryCounters[] = {
+    {SQLITE_STATUS_MEMORY_USED, "memoryUsed"},
+    {SQLITE_STATUS_MALLOC_SIZE, "mallocSize"},
+    {SQLITE_STATUS_MALLOC_COUNT, "mallocCount"},
+    {SQLITE_STATUS_PAGECACHE_USED, "pagecacheUsed"},
+    {SQLITE_STATUS_PAGECACHE_OVERFLOW, "pagecacheOverflow"},
+    {SQLITE_STATUS_PAGECACHE_SIZE, "pagecacheSize"},
+};
+
+Napi::Value MemoryStatus(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  bool reset = false;
+  if (!ParseResetOption(env, info[0], &reset)) {
+    return env.Undefined();
   }
-  if (direct_only) {
-    flags |= SQLITE_DIRECTONLY;
+
+  // These are process-wide, so they include every connection on every thread
+  Napi::Object status = Napi::Object::New(env);
+  for (const MemoryCounter &counter : kMemoryCounters) {
+    sqlite3_int64 current = 0;
+    sqlite3_int64 highwater = 0;
+    sqlite3_status64(counter.op, &current, &highwater, reset ? 1 : 0);
+    Napi::Object value = Napi::Object::New(env);
+    value.Set("current",
+              Napi::Number::New(env, static_cast<double>(current)));
+    value.Set("highwater",
+              Napi::Number::New(env, static_cast<double>(highwater)));
+    status.Set(counter.name, value);
+  }
+  return status;
+}
+
+void QueryProfile::Record(int64_t nanoseconds) {
+  count++;
+  total_time += nanoseconds;
+  min_time = std::min(min_time, nanoseconds);
+  max_time = std::max(max_time, nanoseconds);
+
+  int64_t microseconds = nanoseconds / 1000;
+  size_t bucket = 0;
+  while (microseconds > 1 && bucket + 1 < kHistogramBuckets) {
+    microseconds >>= 1;
+    bucket++;
   }
+  histogram[bucket]++;
+}
 
-  // Register with SQLite
-  int result =
-      sqlite3_create_function_v2(connection(), name.c_str(), argc, flags,
-                                 user_data, UserDefinedFunction::xFunc,
-                                 nullptr, // No aggregate step
-                                 nullptr, // No aggregate final
-                                 UserDefinedFunction::xDestroy);
+int DatabaseSync::TraceCallback(unsigned type, void *context, void *p,
+                                void *x) {
+  if (type != SQLITE_TRACE_PROFILE) {
+    return 0;
+  }
 
-  if (result != SQLITE_OK) {
-    delete user_data; // Clean up on failure
-    std::string error = "Failed to create function: ";
-    error += sqlite3_errmsg(connection());
-    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
+  // Runs on the thread that stepped the statement, which may be a worker
+  // thread. Only one thread uses the connection at a time.
+  DatabaseSync *db = static_cast<DatabaseSync *>(context);
+  sqlite3_stmt *stmt = static_cast<sqlite3_stmt *>(p);
+  int64_t nanoseconds = *static_cast<sqlite3_int64 *>(x);
+
+  // Literals are replaced by "?", so executions that differ only in their
+  // values share one entry. SQLite caches the result on the statement.
+  const char *sql = sqlite3_normalized_sql(stmt);
+  if (sql == nullptr) {
+    sql = sqlite3_sql(stmt);
+  }
+  if (sql == nullptr) {
+    return 0;
   }
 
-  return env.Undefined();
+  // Reuse one key buffer so that recording a known shape does not allocate
+  db->profile_key_.assign(sql);
+  auto it = db->profiles_.find(db->profile_key_);
+  if (it == db->profiles_.end()) {
+    if (db->profiles_.size() >= kMaxProfiledShapes) {
+      return 0;
+    }
+    it = db->profiles_.emplace(db->profile_key_, QueryProfile()).first;
+  }
+  it->second.Record(nanoseconds);
+  return 0;
 }
 
-Napi::Value DatabaseSync::AggregateFunction(const Napi::CallbackInfo &info) {
+Napi::Value DatabaseSync::EnableProfiler(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
-  if (!IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
+  if (!ValidateThread(env)) {
     return env.Undefined();
   }
 
-  if (info.Length() < 2) {
-    node::THROW_ERR_INVALID_ARG_TYPE(
-        env, "Expected at least 2 arguments: name and options");
+  if (!ValidateIdle(env)) {
     return env.Undefined();
   }
 
-  if (!info[0].IsString()) {
-    node::THROW_ERR_INVALID_ARG_TYPE(env, "Function name must be a string");
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
     return env.Undefined();
   }
 
-  if (!info[1].IsObject()) {
-    node::THROW_ERR_INVALID_ARG_TYPE(env, "Options must be an object");
-    return env.Undefined();
+  bool enable = true;
+  if (info.Length() > 0 && !info[0].IsUndefined()) {
+    if (!info[0].IsBoolean()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"enable\" argument must be a boolean.");
+      return env.Undefined();
+    }
+    enable = info[0].As<Napi::Boolean>().Value();
   }
 
-  std::string name = info[0].As<Napi::String>().Utf8Value();
-  Napi::Object options = info[1].As<Napi::Object>();
-
-  // Parse required options - start can be undefined, will default to null
-  Napi::Value start = env.Null();
-  if (options.Has("start") && !options.Get("start").IsUndefined()) {
-    start = options.Get("start");
+  if (enable) {
+    sqlite3_trace_v2(connection(), SQLITE_TRACE_PROFILE, TraceCallback, this);
+  } else {
+    sqlite3_trace_v2(connection(), 0, nullptr, nullptr);
   }
+  return env.Undefined();
+}
 
-  if (!options.Has("step") || !options.Get("step").IsFunction()) {
-    node::THROW_ERR_INVALID_ARG_TYPE(env, "options.step must be a function");
+static double NanosecondsToMilliseconds(int64_t nanoseconds) {
+  return static_cast<double>(nanoseconds) / 1e6;
+}
+
+Napi::Value DatabaseSync::Profile(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateThread(env)) {
     return env.Undefined();
   }
 
-  Napi::Function step_fn = options.Get("step").As<Napi::Function>();
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
 
-  // Parse optional options
-  Napi::Function inverse_fn;
-  if (options.Has("inverse") && options.Get("inverse").IsFunction()) {
-    inverse_fn = options.Get("inverse").As<Napi::Function>();
+  bool reset = false;
+  if (!ParseResetOption(env, info[0], &reset)) {
+    return env.Undefined();
   }
 
-  Napi::Function result_fn;
-  if (options.Has("result") && options.Get("result").IsFunction()) {
-    result_fn = options.Get("result").As<Napi::Function>();
+  uint32_t limit = kDefaultProfileLimit;
+  if (info[0].IsObject() &&
+      !ParseLimitOption(env, info[0].As<Napi::Object>(), &limit)) {
+    return env.Undefined();
   }
 
-  bool use_bigint_args = false;
-  if (options.Has("useBigIntArguments") &&
-      options.Get("useBigIntArguments").IsBoolean()) {
-    use_bigint_args =
-        options.Get("useBigIntArguments").As<Napi::Boolean>().Value();
+  using ProfileEntry = std::pair<const std::string, QueryProfile>;
+  std::vector<const ProfileEntry *> entries;
+  entries.reserve(profiles_.size());
+  for (const ProfileEntry &entry : profiles_) {
+    entries.push_back(&entry);
+  }
+  size_t count = std::min<size_t>(entries.size(), limit);
+  std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+                    [](const ProfileEntry *a, const ProfileEntry *b) {
+                      return a->second.total_time > b->second.total_time;
+                    });
+
+  Napi::Array report = Napi::Array::New(env, count);
+  for (size_t i = 0; i < count; i++) {
+    const QueryProfile &profile = entries[i]->second;
+    Napi::Object item = Napi::Object::New(env);
+    item.Set("sql", Napi::String::New(env, entries[i]->first));
+    item.Set("count",
+             Napi::Number::New(env, static_cast<double>(profile.count)));
+    item.Set("totalTime", Napi::Number::New(env, NanosecondsToMilliseconds(
+                                                     profile.total_time)));
+    item.Set("minTime", Napi::Number::New(env, NanosecondsToMilliseconds(
+                                                   profile.min_time)));
+    item.Set("maxTime", Napi::Number::New(env, NanosecondsToMilliseconds(
+                                                   profile.max_time)));
+    Napi::Array histogram =
+        Napi::Array::New(env, QueryProfile::kHistogramBuckets);
+    for (size_t bucket = 0; bucket < QueryProfile::kHistogramBuckets;
+         bucket++) {
+      histogram.Set(static_cast<uint32_t>(bucket),
+                    Napi::Number::New(env, static_cast<double>(
+                                               profile.histogram[bucket])));
+    }
+    item.Set("histogram", histogram);
+    report.Set(static_cast<uint32_t>(i), item);
   }
 
-  bool varargs = false;
-  if (options.Has("varargs") && options.Get("varargs").IsBoolean()) {
-    varargs = options.Get("varargs").As<Napi::Boolean>().Value();
+  if (reset) {
+    profiles_.clear();
   }
+  return report;
+}
 
-  bool deterministic = false;
-  if (options.Has("deterministic") &&
-      options.Get("deterministic").IsBoolean()) {
-    deterministic = options.Get("deterministic").As<Napi::Boolean>().Value();
+Napi::Value DatabaseSync::Serialize(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateThread(env)) {
+    return env.Undefined();
   }
 
-  bool direct_only = false;
-  if (options.Has("directOnly") && options.Get("directOnly").IsBoolean()) {
-    direct_only = options.Get("directOnly").As<Napi::Boolean>().Value();
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
   }
 
-  // Determine argument count
-  int argc = -1; // Default to varargs
-  if (!varargs) {
-    Napi::Value length_prop = step_fn.Get("length");
-    if (length_prop.IsNumber()) {
-      // Subtract 1 because the first argument is the aggregate value
-      argc = length_prop.As<Napi::Number>().Int32Value() - 1;
-    }
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
+    return env.Undefined();
+  }
 
-    // Also check inverse function length if provided
-    if (!inverse_fn.IsEmpty()) {
-      Napi::Value inverse_length = inverse_fn.Get("length");
-      if (inverse_length.IsNumber()) {
-        int inverse_argc = inverse_length.As<Napi::Number>().Int32Value() - 1;
-        argc = std::max({argc, inverse_argc, 0});
-      }
+  std::string schema = "main";
+  if (!info[0].IsUndefined()) {
+    if (!info[0].IsString()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"schema\" argument must be a string.");
+      return env.Undefined();
     }
-
-    // Ensure argc is non-negative
-    argc = std::max(argc, 0);
+    schema = info[0].As<Napi::String>().Utf8Value();
   }
 
-  // Set SQLite flags
-  int flags = SQLITE_UTF8;
-  if (deterministic) {
-    flags |= SQLITE_DETERMINISTIC;
+  sqlite3_int64 size = 0;
+  unsigned char *data =
+      sqlite3_serialize(connection(), schema.c_str(), &size, 0);
+  if (size < 0) {
+    node::THROW_ERR_INVALID_ARG_VALUE(
+        env, ("Unknown database schema: " + schema).c_str());
+    return env.Undefined();
   }
-  if (direct_only) {
-    flags |= SQLITE_DIRECTONLY;
+  if (data == nullptr) {
+    if (size == 0) {
+      return Napi::Buffer<uint8_t>::New(env, 0);
+    }
+    int code = sqlite3_errcode(connection());
+    node::ThrowEnhancedSqliteError(env, connection(),
+                                   code != SQLITE_OK ? code : SQLITE_NOMEM,
+                                   "Failed to serialize database");
+    return env.Undefined();
   }
 
-  // Create CustomAggregate wrapper
-  CustomAggregate *user_data;
-  try {
-    user_data = new CustomAggregate(env, this, use_bigint_args, start, step_fn,
-                                    inverse_fn, result_fn);
-  } catch (const std::exception &e) {
-    std::string error = "Failed to create CustomAggregate: ";
-    error += e.what();
-    node::THROW_ERR_INVALID_ARG_VALUE(env, error.c_str());
+  return TakeSqliteBuffer(env, data, static_cast<size_t>(size));
+}
+
+Napi::Buffer<uint8_t> TakeSqliteBuffer(Napi::Env env, void *data,
+                                       size_t size) {
+  if (data == nullptr) {
+    return Napi::Buffer<uint8_t>::New(env, 0);
+  }
+  // Report the memory to V8 so that large buffers still drive garbage
+  // collection. NewOrCopy() runs the finalizer immediately when it has to
+  // copy, which undoes the adjustment.
+  int64_t length = static_cast<int64_t>(size);
+  Napi::MemoryManagement::AdjustExternalMemory(env, length);
+  return Napi::Buffer<uint8_t>::NewOrCopy(
+      env, static_cast<uint8_t *>(data), size,
+      [length](Napi::Env finalize_env, uint8_t *owned) {
+        sqlite3_free(owned);
+        Napi::MemoryManagement::AdjustExternalMemory(finalize_env, -length);
+      });
+}
+
+Napi::Value DatabaseSync::ClearStatementCache(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateThread(env)) {
     return env.Undefined();
   }
 
-  // Register with SQLite - Node.js always uses sqlite3_create_window_function
-  // for aggregates
-  auto xInverse = !inverse_fn.IsEmpty() ? CustomAggregate::xInverse : nullptr;
-  auto xValue = xInverse ? CustomAggregate::xValue : nullptr;
-  int result = sqlite3_create_window_function(
-      connection(), name.c_str(), argc, flags, user_data,
-      CustomAggregate::xStep, CustomAggregate::xFinal, xValue, xInverse,
-      CustomAggregate::xDestroy);
-
-  if (result != SQLITE_OK) {
-    delete user_data; // Clean up on failure
-    std::string error = "Failed to create aggregate function '";
-    error += name;
-    error += "': ";
-    error += sqlite3_errmsg(connection());
-    error += " (SQLite error code: ";
-    error += std::to_string(result);
-    error += ")";
-    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
   }
 
+  statement_cache_evictions_ += statement_cache_.size();
+  ReleaseStatementCache(false);
   return env.Undefined();
 }
 
-Napi::Value DatabaseSync::EnableLoadExtension(const Napi::CallbackInfo &info) {
+Napi::Value DatabaseSync::Exec(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
-  if (!IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
+  if (!ValidateThread(env)) {
     return env.Undefined();
   }
 
-  if (info.Length() < 1 || !info[0].IsBoolean()) {
-    node::THROW_ERR_INVALID_ARG_TYPE(
-        env, "The \"allow\" argument must be a boolean.");
+  if (!ValidateIdle(env)) {
     return env.Undefined();
   }
 
-  bool enable = info[0].As<Napi::Boolean>().Value();
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
+    return env.Undefined();
+  }
 
-  // Check if extension loading was disallowed at database creation
-  if (!allow_load_extension_ && enable) {
-    node::THROW_ERR_INVALID_STATE(env,
-                                  "Cannot enable extension loading because it "
-                                  "was disabled at database creation.");
+  if (info.Length() < 1 || !info[0].IsString()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(env, "Expected SQL string");
     return env.Undefined();
   }
 
-  enable_load_extension_ = enable;
+  std::string sql = info[0].As<Napi::String>().Utf8Value();
 
-  // Configure SQLite to enable/disable extension loading
+  QueryLimits limits = query_limits_;
+  if (info.Length() > 1 && !info[1].IsUndefined()) {
+    if (!info[1].IsObject()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options\" argument must be an object.");
+      return env.Undefined();
+    }
+    if (!ParseQueryLimits(env, info[1].As<Napi::Object>(), &limits)) {
+      return env.Undefined();
+    }
+  }
+  QueryLimitScope limit_scope(env, this, limits);
+
+  char *error_msg = nullptr;
   int result =
-      sqlite3_db_config(connection(), SQLITE_DBCONFIG_ENABLE_LOAD_EXTENSION,
-                        enable ? 1 : 0, nullptr);
+      sqlite3_exec(connection(), sql.c_str(), nullptr, nullptr, &error_msg);
 
   if (result != SQLITE_OK) {
-    std::string error = "Failed to configure extension loading: ";
-    error += sqlite3_errmsg(connection());
-    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
+    std::string error = error_msg ? error_msg : "Unknown SQLite error";
+    if (error_msg)
+      sqlite3_free(error_msg);
+    // Use enhanced error throwing with database handle
+    node::ThrowSqliteError(env, connection(), error);
   }
 
   return env.Undefined();
 }
 
-Napi::Value DatabaseSync::LoadExtension(const Napi::CallbackInfo &info) {
+Napi::Value DatabaseSync::LocationMethod(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
   if (!IsOpen()) {
@@ -920,1517 +1311,4377 @@ Napi::Value DatabaseSync::LoadExtension(const Napi::CallbackInfo &info) {
     return env.Undefined();
   }
 
-  if (!allow_load_extension_) {
-    node::THROW_ERR_INVALID_STATE(env, "Extension loading is not allowed");
-    return env.Undefined();
+  // Default to "main" if no dbName provided
+  std::string db_name = "main";
+  if (info.Length() > 0 && info[0].IsString()) {
+    db_name = info[0].As<Napi::String>().Utf8Value();
   }
 
-  if (!enable_load_extension_) {
-    node::THROW_ERR_INVALID_STATE(env, "Extension loading is not enabled");
-    return env.Undefined();
-  }
+  // Use sqlite3_db_filename() to get the database file path
+  const char *filename = sqlite3_db_filename(connection(), db_name.c_str());
 
-  if (info.Length() < 1 || !info[0].IsString()) {
-    node::THROW_ERR_INVALID_ARG_TYPE(env,
-                                     "The \"path\" argument must be a string.");
-    return env.Undefined();
+  // Return null for in-memory databases, non-existent databases, or if database
+  // not found
+  if (filename == nullptr || strlen(filename) == 0) {
+    return env.Null();
   }
 
-  std::string path = info[0].As<Napi::String>().Utf8Value();
+  return Napi::String::New(env, filename);
+}
 
-  // Optional entry point parameter
-  const char *entry_point = nullptr;
-  std::string entry_point_str;
-  if (info.Length() > 1 && info[1].IsString()) {
-    entry_point_str = info[1].As<Napi::String>().Utf8Value();
-    entry_point = entry_point_str.c_str();
-  }
+Napi::Value DatabaseSync::IsOpenGetter(const Napi::CallbackInfo &info) {
+  return Napi::Boolean::New(info.Env(), IsOpen());
+}
 
-  // Load the extension
-  char *errmsg = nullptr;
-  int result =
-      sqlite3_load_extension(connection(), path.c_str(), entry_point, &errmsg);
+Napi::Value DatabaseSync::IsTransactionGetter(const Napi::CallbackInfo &info) {
+  // Check if we're in a transaction
+  bool in_transaction = IsOpen() && !sqlite3_get_autocommit(connection());
+  return Napi::Boolean::New(info.Env(), in_transaction);
+}
 
-  if (result != SQLITE_OK) {
-    std::string error = "Failed to load extension '";
-    error += path;
-    error += "': ";
-    if (errmsg) {
-      error += errmsg;
-      sqlite3_free(errmsg);
-    } else {
-      error += sqlite3_errmsg(connection());
-    }
-    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
-    return env.Undefined();
+// Query limits and cancellation
+
+// The progress handler runs every this many virtual machine instructions
+// (or every instruction_limit instructions, if that is smaller)
+constexpr int64_t kQueryLimitCheckInterval = 1000;
+// Keeps the deadline arithmetic well inside steady_clock's range (~35 years)
+constexpr int64_t kMaxTimeLimit = int64_t{1} << 40;
+
+// Open connections by interrupt handle. sqlite3_interrupt() may be called from
+// any thread, but only while the connection is open, so closing removes the
+// entry under the same lock. The addon is loaded once per process, so worker
+// threads share this registry.
+static std::mutex interrupt_registry_mutex;
+static std::unordered_map<uint64_t, sqlite3 *> interrupt_registry;
+static uint64_t next_interrupt_handle = 1;
+
+static bool ParseQueryLimit(Napi::Env env, Napi::Object options,
+                            const char *name, int64_t *limit) {
+  Napi::Value value = options.Get(name);
+  if (value.IsUndefined()) {
+    return true;
+  }
+  if (!value.IsNumber()) {
+    std::string message = std::string("The \"options.") + name +
+                          "\" argument must be a number.";
+    node::THROW_ERR_INVALID_ARG_TYPE(env, message.c_str());
+    return false;
   }
-
-  return env.Undefined();
+  double number = value.As<Napi::Number>().DoubleValue();
+  if (!std::isfinite(number) || number < 0) {
+    std::string message = std::string("The \"options.") + name +
+                          "\" argument must be a non-negative number.";
+    node::THROW_ERR_OUT_OF_RANGE(env, message.c_str());
+    return false;
+  }
+  *limit = static_cast<int64_t>(std::min(number, 9007199254740991.0));
+  return true;
 }
 
-Napi::Value DatabaseSync::CreateSession(const Napi::CallbackInfo &info) {
-  Napi::Env env = info.Env();
+bool ParseQueryLimits(Napi::Env env, Napi::Object options,
+                      QueryLimits *limits) {
+  return ParseQueryLimit(env, options, "timeLimit", &limits->time_limit) &&
+         ParseQueryLimit(env, options, "instructionLimit",
+                         &limits->instruction_limit);
+}
 
-  if (!IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "database is not open");
-    return env.Undefined();
+void AnnotateQueryLimitError(Napi::Error error, QueryLimit exceeded,
+                             const QueryLimits &limits) {
+  Napi::Env env = error.Env();
+  std::string message;
+  const char *code;
+  if (exceeded == QueryLimit::kTime) {
+    message = "Query exceeded its time limit of " +
+              std::to_string(limits.time_limit) + " ms";
+    code = "ERR_SQLITE_TIME_LIMIT";
+  } else {
+    message = "Query exceeded its limit of " +
+              std::to_string(limits.instruction_limit) + " instructions";
+    code = "ERR_SQLITE_INSTRUCTION_LIMIT";
   }
+  error.Set("message", Napi::String::New(env, message));
+  error.Set("code", Napi::String::New(env, code));
+}
 
-  std::string table;
-  std::string db_name = "main";
+bool DatabaseSync::ArmQueryLimits(const QueryLimits &limits) {
+  if (query_limits_armed_ || !limits.IsSet() || connection_ == nullptr) {
+    return false;
+  }
 
-  // Parse options if provided
-  if (info.Length() > 0) {
-    if (!info[0].IsObject()) {
-      node::THROW_ERR_INVALID_ARG_TYPE(
-          env, "The \"options\" argument must be an object.");
-      return env.Undefined();
-    }
+  query_limits_armed_ = true;
+  active_limits_ = limits;
+  limit_exceeded_ = QueryLimit::kNone;
+  instructions_ = 0;
+  if (limits.time_limit > 0) {
+    deadline_ = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(
+                    std::min(limits.time_limit, kMaxTimeLimit));
+  }
+  progress_interval_ = kQueryLimitCheckInterval;
+  if (limits.instruction_limit > 0) {
+    progress_interval_ =
+        std::min(progress_interval_, limits.instruction_limit);
+  }
+  sqlite3_progress_handler(connection_, static_cast<int>(progress_interval_),
+                           ProgressHandler, this);
+  return true;
+}
 
-    Napi::Object options = info[0].As<Napi::Object>();
+QueryLimit DatabaseSync::DisarmQueryLimits() {
+  // A user-defined function may have closed the connection mid-call
+  if (connection_ != nullptr) {
+    sqlite3_progress_handler(connection_, 0, nullptr, nullptr);
+  }
+  query_limits_armed_ = false;
+  return limit_exceeded_;
+}
 
-    // Get table option
-    if (options.Has("table")) {
-      Napi::Value table_value = options.Get("table");
-      if (table_value.IsString()) {
-        table = table_value.As<Napi::String>().Utf8Value();
-      } else {
-        node::THROW_ERR_INVALID_ARG_TYPE(
-            env, "The \"options.table\" argument must be a string.");
-        return env.Undefined();
-      }
-    }
+int DatabaseSync::ProgressHandler(void *data) {
+  // Runs on the thread that is stepping, which may be a worker thread
+  DatabaseSync *db = static_cast<DatabaseSync *>(data);
+  const QueryLimits &limits = db->active_limits_;
 
-    // Get db option
-    if (options.Has("db")) {
-      Napi::Value db_value = options.Get("db");
-      if (db_value.IsString()) {
-        db_name = db_value.As<Napi::String>().Utf8Value();
-      } else {
-        node::THROW_ERR_INVALID_ARG_TYPE(
-            env, "The \"options.db\" argument must be a string.");
-        return env.Undefined();
-      }
+  if (limits.instruction_limit > 0) {
+    db->instructions_ += db->progress_interval_;
+    if (db->instructions_ >= limits.instruction_limit) {
+      db->limit_exceeded_ = QueryLimit::kInstructions;
+      return 1;
     }
   }
 
-  // Create the session
-  sqlite3_session *pSession;
-  int r = sqlite3session_create(connection(), db_name.c_str(), &pSession);
-
-  if (r != SQLITE_OK) {
-    std::string error = "Failed to create session: ";
-    error += sqlite3_errmsg(connection());
-    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
-    return env.Undefined();
+  if (limits.time_limit > 0 &&
+      std::chrono::steady_clock::now() >= db->deadline_) {
+    db->limit_exceeded_ = QueryLimit::kTime;
+    return 1;
   }
 
-  // Attach table if specified
-  r = sqlite3session_attach(pSession, table.empty() ? nullptr : table.c_str());
+  return 0;
+}
 
-  if (r != SQLITE_OK) {
-    sqlite3session_delete(pSession);
-    std::string error = "Failed to attach table to session: ";
-    error += sqlite3_errmsg(connection());
-    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
-    return env.Undefined();
+void DatabaseSync::RegisterInterruptHandle() {
+  std::lock_guard<std::mutex> lock(interrupt_registry_mutex);
+  if (interrupt_handle_ == 0) {
+    interrupt_handle_ = next_interrupt_handle++;
   }
-
-  // Create and return the Session object
-  return Session::Create(env, this, pSession);
+  interrupt_registry[interrupt_handle_] = connection_;
 }
 
-void DatabaseSync::AddSession(Session *session) {
-  std::lock_guard<std::mutex> lock(sessions_mutex_);
-  sessions_.insert(session);
+void DatabaseSync::UnregisterInterruptHandle() {
+  std::lock_guard<std::mutex> lock(interrupt_registry_mutex);
+  interrupt_registry.erase(interrupt_handle_);
 }
 
-void DatabaseSync::RemoveSession(Session *session) {
-  std::lock_guard<std::mutex> lock(sessions_mutex_);
-  sessions_.erase(session);
-}
+Napi::Value DatabaseSync::Interrupt(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
 
-void DatabaseSync::DeleteAllSessions() {
-  std::lock_guard<std::mutex> lock(sessions_mutex_);
-  // Copy the set to avoid iterator invalidation
-  std::set<Session *> sessions_copy = sessions_;
-  sessions_.clear(); // Clear first to prevent re-entrance
+  if (!ValidateThread(env)) {
+    return env.Undefined();
+  }
 
-  // Now delete each session
-  for (auto *session : sessions_copy) {
-    // Direct SQLite cleanup since we're in database destruction
-    if (session->GetSession()) {
-      sqlite3session_delete(session->GetSession());
-      // Clear the session's internal pointers
-      session->session_ = nullptr;
-      session->database_ = nullptr;
-    }
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
+    return env.Undefined();
   }
+
+  // Stops the statement an asynchronous query is stepping, if any
+  sqlite3_interrupt(connection());
+  return env.Undefined();
 }
 
-// Context structure for changeset callbacks to avoid global state
-struct ChangesetCallbacks {
-  std::function<int(int)> conflictCallback;
-  std::function<bool(std::string)> filterCallback;
-  Napi::Env env;
-};
+Napi::Value DatabaseSync::InterruptByHandle(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
 
-static int xConflict(void *pCtx, int eConflict, sqlite3_changeset_iter *pIter) {
-  if (!pCtx)
-    return SQLITE_CHANGESET_OMIT;
-  ChangesetCallbacks *callbacks = static_cast<ChangesetCallbacks *>(pCtx);
-  if (!callbacks->conflictCallback)
-    return SQLITE_CHANGESET_OMIT;
-  return callbacks->conflictCallback(eConflict);
-}
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"handle\" argument must be a number.");
+    return env.Undefined();
+  }
 
-static int xFilter(void *pCtx, const char *zTab) {
-  if (!pCtx)
-    return 1;
-  ChangesetCallbacks *callbacks = static_cast<ChangesetCallbacks *>(pCtx);
-  if (!callbacks->filterCallback)
-    return 1;
-  return callbacks->filterCallback(zTab) ? 1 : 0;
+  double handle = info[0].As<Napi::Number>().DoubleValue();
+  if (!(handle >= 1 && handle <= 9007199254740991.0)) {
+    return Napi::Boolean::New(env, false);
+  }
+
+  std::lock_guard<std::mutex> lock(interrupt_registry_mutex);
+  auto it = interrupt_registry.find(static_cast<uint64_t>(handle));
+  if (it == interrupt_registry.end()) {
+    return Napi::Boolean::New(env, false);
+  }
+  sqlite3_interrupt(it->second);
+  return Napi::Boolean::New(env, true);
 }
 
-Napi::Value DatabaseSync::ApplyChangeset(const Napi::CallbackInfo &info) {
+Napi::Value
+DatabaseSync::InterruptHandleGetter(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
   if (!IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "database is not open");
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
     return env.Undefined();
   }
 
-  if (info.Length() < 1 || !info[0].IsBuffer()) {
-    node::THROW_ERR_INVALID_ARG_TYPE(
-        env, "The \"changeset\" argument must be a Buffer.");
-    return env.Undefined();
-  }
+  return Napi::Number::New(env, static_cast<double>(interrupt_handle_));
+}
 
-  // Create callback context to avoid global state
-  ChangesetCallbacks callbacks{nullptr, nullptr, env};
+QueryLimitScope::QueryLimitScope(Napi::Env env, DatabaseSync *database,
+                                 const QueryLimits &limits)
+    : env_(env), database_(database), limits_(limits),
+      armed_(database->ArmQueryLimits(limits)) {}
 
-  // Parse options if provided
-  if (info.Length() > 1 && !info[1].IsUndefined()) {
-    if (!info[1].IsObject()) {
-      node::THROW_ERR_INVALID_ARG_TYPE(
-          env, "The \"options\" argument must be an object.");
-      return env.Undefined();
+QueryLimitScope::~QueryLimitScope() {
+  if (!armed_) {
+    return;
+  }
+  QueryLimit exceeded = database_->DisarmQueryLimits();
+  // Errors are reported as pending JS exceptions; leave C++ exceptions alone
+  if (exceeded != QueryLimit::kNone && std::uncaught_exceptions() == 0 &&
+      env_.IsExceptionPending()) {
+    Napi::Error error = env_.GetAndClearPendingException();
+    if (error.Value().IsObject()) {
+      AnnotateQueryLimitError(error, exceeded, limits_);
     }
+    error.ThrowAsJavaScriptException();
+  }
+}
 
-    Napi::Object options = info[1].As<Napi::Object>();
+void DatabaseSync::InternalOpen(DatabaseOpenConfiguration config) {
+  location_ = config.location();
+  read_only_ = config.get_read_only();
+  statement_cache_capacity_ = config.get_statement_cache_size();
 
-    // Handle onConflict callback
-    if (options.Has("onConflict")) {
-      Napi::Value conflictValue = options.Get("onConflict");
-      if (!conflictValue.IsUndefined()) {
-        if (!conflictValue.IsFunction()) {
-          node::THROW_ERR_INVALID_ARG_TYPE(
-              env, "The \"options.onConflict\" argument must be a function.");
-          return env.Undefined();
-        }
+  int flags = SQLITE_OPEN_CREATE;
+  if (read_only_) {
+    flags = SQLITE_OPEN_READONLY;
+  } else {
+    flags |= SQLITE_OPEN_READWRITE;
+  }
 
-        Napi::Function conflictFunc = conflictValue.As<Napi::Function>();
-        callbacks.conflictCallback = [env,
-                                      conflictFunc](int conflictType) -> int {
-          Napi::HandleScope scope(env);
-          Napi::Value result =
-              conflictFunc.Call({Napi::Number::New(env, conflictType)});
+  int result = sqlite3_open_v2(location_.c_str(), &connection_, flags, nullptr);
 
-          if (env.IsExceptionPending()) {
-            // If callback threw, abort the changeset apply
-            return SQLITE_CHANGESET_ABORT;
-          }
+  if (result != SQLITE_OK) {
+    std::string error = sqlite3_errmsg(connection_);
+    // Capture error info before closing
+    SqliteException ex(connection_, result,
+                       "Failed to open database: " + error);
+    if (connection_) {
+      sqlite3_close(connection_);
+      connection_ = nullptr;
+    }
+    throw ex;
+  }
 
-          if (!result.IsNumber()) {
-            return -1; // Invalid value
-          }
+  query_limits_ = config.get_query_limits();
 
-          return result.As<Napi::Number>().Int32Value();
-        };
-      }
+  if (config.get_deserialize_data() != nullptr) {
+    // SQLite owns the copy from here on and frees it on close, or right away
+    // if sqlite3_deserialize() fails.
+    sqlite3_int64 size =
+        static_cast<sqlite3_int64>(config.get_deserialize_size());
+    unsigned char *image = static_cast<unsigned char *>(
+        sqlite3_malloc64(static_cast<sqlite3_uint64>(std::max<int64_t>(size,
+                                                                       1))));
+    if (image == nullptr) {
+      result = SQLITE_NOMEM;
+    } else {
+      memcpy(image, config.get_deserialize_data(), static_cast<size_t>(size));
+      unsigned int deserialize_flags =
+          SQLITE_DESERIALIZE_FREEONCLOSE |
+          (read_only_ ? SQLITE_DESERIALIZE_READONLY
+                      : SQLITE_DESERIALIZE_RESIZEABLE);
+      result = sqlite3_deserialize(connection_, "main", image, size, size,
+                                   deserialize_flags);
+    }
+    // Reading the schema rejects images that are not databases up front
+    if (result == SQLITE_OK) {
+      result = sqlite3_exec(connection_, "SELECT 1 FROM sqlite_schema LIMIT 1",
+                            nullptr, nullptr, nullptr);
+    }
+    if (result != SQLITE_OK) {
+      SqliteException ex(connection_, result,
+                         std::string("Failed to deserialize database: ") +
+                             sqlite3_errstr(result));
+      sqlite3_close(connection_);
+      connection_ = nullptr;
+      throw ex;
     }
+  }
 
-    // Handle filter callback
-    if (options.Has("filter")) {
-      Napi::Value filterValue = options.Get("filter");
-      if (!filterValue.IsFunction()) {
-        node::THROW_ERR_INVALID_ARG_TYPE(
-            env, "The \"options.filter\" argument must be a function.");
-        return env.Undefined();
-      }
-
-      Napi::Function filterFunc = filterValue.As<Napi::Function>();
-      callbacks.filterCallback = [env,
-                                  filterFunc](std::string tableName) -> bool {
-        Napi::HandleScope scope(env);
-        Napi::Value result =
-            filterFunc.Call({Napi::String::New(env, tableName)});
-
-        if (env.IsExceptionPending()) {
-          // If callback threw, exclude the table
-          return false;
-        }
-
-        return result.ToBoolean().Value();
-      };
-    }
+  // Configure database
+  if (config.get_enable_foreign_keys()) {
+    sqlite3_exec(connection(), "PRAGMA foreign_keys = ON", nullptr, nullptr,
+                 nullptr);
   }
 
-  // Get the changeset buffer
-  Napi::Buffer<uint8_t> buffer = info[0].As<Napi::Buffer<uint8_t>>();
+  if (config.get_timeout() > 0) {
+    sqlite3_busy_timeout(connection(), config.get_timeout());
+  }
 
-  // Apply the changeset with context instead of global state
-  int r = sqlite3changeset_apply(connection(), buffer.Length(), buffer.Data(),
-                                 xFilter, xConflict, &callbacks);
+  // Configure double-quoted string literals
+  if (config.get_enable_dqs()) {
+    int dqs_enable = 1;
+    result = sqlite3_db_config(connection(), SQLITE_DBCONFIG_DQS_DML,
+                               dqs_enable, nullptr);
+    if (result != SQLITE_OK) {
+      std::string error = sqlite3_errmsg(connection());
+      SqliteException ex(connection_, result,
+                         "Failed to configure DQS_DML: " + error);
+      sqlite3_close(connection_);
+      connection_ = nullptr;
+      throw ex;
+    }
 
-  if (r == SQLITE_OK) {
-    return Napi::Boolean::New(env, true);
+    result = sqlite3_db_config(connection(), SQLITE_DBCONFIG_DQS_DDL,
+                               dqs_enable, nullptr);
+    if (result != SQLITE_OK) {
+      std::string error = sqlite3_errmsg(connection());
+      SqliteException ex(connection_, result,
+                         "Failed to configure DQS_DDL: " + error);
+      sqlite3_close(connection_);
+      connection_ = nullptr;
+      throw ex;
+    }
   }
 
-  if (r == SQLITE_ABORT) {
-    // Not an error, just means the operation was aborted
-    return Napi::Boolean::New(env, false);
+  result = DenyRawPageWrites(connection());
+  if (result != SQLITE_OK) {
+    std::string error = sqlite3_errmsg(connection());
+    SqliteException ex(connection_, result,
+                       "Failed to install the authorizer: " + error);
+    sqlite3_close(connection_);
+    connection_ = nullptr;
+    throw ex;
   }
 
-  // Other errors
-  std::string error = "Failed to apply changeset: ";
-  error += sqlite3_errmsg(connection());
-  node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
-  return env.Undefined();
-}
-
-// StatementSync Implementation
-Napi::Object StatementSync::Init(Napi::Env env, Napi::Object exports) {
-  Napi::Function func = DefineClass(
-      env, "StatementSync",
-      {InstanceMethod("run", &StatementSync::Run),
-       InstanceMethod("get", &StatementSync::Get),
-       InstanceMethod("all", &StatementSync::All),
-       InstanceMethod("iterate", &StatementSync::Iterate),
-       InstanceMethod("finalize", &StatementSync::FinalizeStatement),
-       InstanceMethod("setReadBigInts", &StatementSync::SetReadBigInts),
-       InstanceMethod("setReturnArrays", &StatementSync::SetReturnArrays),
-       InstanceMethod("setAllowBareNamedParameters",
-                      &StatementSync::SetAllowBareNamedParameters),
-       InstanceMethod("columns", &StatementSync::Columns),
-       InstanceAccessor("sourceSQL", &StatementSync::SourceSQLGetter, nullptr),
-       InstanceAccessor("expandedSQL", &StatementSync::ExpandedSQLGetter,
-                        nullptr)});
-
-  // Store constructor in per-instance addon data instead of static variable
-  AddonData *addon_data = GetAddonData(env);
-  if (addon_data) {
-    addon_data->statementSyncConstructor =
-        Napi::Reference<Napi::Function>::New(func);
+  if (config.get_defensive()) {
+    result = sqlite3_db_config(connection(), SQLITE_DBCONFIG_DEFENSIVE, 1,
+                               nullptr);
+    if (result != SQLITE_OK) {
+      std::string error = sqlite3_errmsg(connection());
+      SqliteException ex(connection_, result,
+                         "Failed to configure DEFENSIVE: " + error);
+      sqlite3_close(connection_);
+      connection_ = nullptr;
+      throw ex;
+    }
   }
 
-  exports.Set("StatementSync", func);
-  return exports;
-}
-
-StatementSync::StatementSync(const Napi::CallbackInfo &info)
-    : Napi::ObjectWrap<StatementSync>(info),
-      creation_thread_(std::this_thread::get_id()) {
-  // Constructor - initialization happens in InitStatement
+  RegisterInterruptHandle();
 }
 
-void StatementSync::InitStatement(DatabaseSync *database,
-                                  const std::string &sql) {
-  if (!database || !database->IsOpen()) {
-    throw std::runtime_error("Database is not open");
-  }
-
-  database_ = database;
-  source_sql_ = sql;
+void DatabaseSync::InternalClose() {
+  if (connection_) {
+    // Release cached prepared statements
+    ReleaseStatementCache(false);
 
-  // Prepare the statement
-  const char *tail = nullptr;
-  int result = sqlite3_prepare_v2(database->connection(), sql.c_str(), -1,
-                                  &statement_, &tail);
+    // Delete all sessions before closing the database
+    // This is required by SQLite to avoid undefined behavior
+    DeleteAllSessions();
 
-  if (result != SQLITE_OK) {
-    std::string error = sqlite3_errmsg(database->connection());
-    throw std::runtime_error("Failed to prepare statement: " + error);
-  }
-}
+    UnregisterInterruptHandle();
 
-StatementSync::~StatementSync() {
-  if (statement_ && !finalized_) {
-    sqlite3_finalize(statement_);
+    // Close the database connection
+    int result = sqlite3_close(connection_);
+    if (result != SQLITE_OK) {
+      // Force close even if there are outstanding statements
+      sqlite3_close_v2(connection_);
+    }
+    connection_ = nullptr;
   }
+  location_.clear();
+  enable_load_extension_ = false;
+  has_js_functions_ = false;
 }
 
-Napi::Value StatementSync::Run(const Napi::CallbackInfo &info) {
+Napi::Value DatabaseSync::CustomFunction(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
-  if (!ValidateThread(env)) {
+  if (!ValidateIdle(env)) {
     return env.Undefined();
   }
 
-  if (finalized_) {
-    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
     return env.Undefined();
   }
 
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+  if (info.Length() < 2) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "Expected at least 2 arguments: name and function");
     return env.Undefined();
   }
 
-  if (!statement_) {
-    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+  if (!info[0].IsString()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(env, "Function name must be a string");
     return env.Undefined();
   }
 
-  try {
-    Reset();
-    BindParameters(info);
+  // Parse arguments: function(name, [options], callback)
+  int fn_index = info.Length() < 3 ? 1 : 2;
+  bool use_bigint_args = false;
+  bool varargs = false;
+  bool deterministic = false;
+  bool direct_only = false;
 
-    int result = sqlite3_step(statement_);
+  // Parse options object if provided
+  if (fn_index > 1 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
 
-    if (result != SQLITE_DONE && result != SQLITE_ROW) {
-      std::string error = sqlite3_errmsg(database_->connection());
-      node::ThrowEnhancedSqliteError(env, database_->connection(), result,
-                                     error);
-      return env.Undefined();
+    if (options.Has("useBigIntArguments") &&
+        options.Get("useBigIntArguments").IsBoolean()) {
+      use_bigint_args =
+          options.Get("useBigIntArguments").As<Napi::Boolean>().Value();
     }
 
-    // Create result object
-    Napi::Object result_obj = Napi::Object::New(env);
-    result_obj.Set(
-        "changes",
-        Napi::Number::New(env, sqlite3_changes(database_->connection())));
+    if (options.Has("varargs") && options.Get("varargs").IsBoolean()) {
+      varargs = options.Get("varargs").As<Napi::Boolean>().Value();
+    }
 
-    sqlite3_int64 last_rowid =
-        sqlite3_last_insert_rowid(database_->connection());
-    // Use JavaScript's safe integer limits (2^53 - 1)
-    if (last_rowid > JS_MAX_SAFE_INTEGER || last_rowid < JS_MIN_SAFE_INTEGER) {
-      result_obj.Set("lastInsertRowid",
-                     Napi::BigInt::New(env, static_cast<int64_t>(last_rowid)));
-    } else {
-      result_obj.Set("lastInsertRowid",
-                     Napi::Number::New(env, static_cast<double>(last_rowid)));
+    if (options.Has("deterministic") &&
+        options.Get("deterministic").IsBoolean()) {
+      deterministic = options.Get("deterministic").As<Napi::Boolean>().Value();
     }
 
-    return result_obj;
-  } catch (const std::exception &e) {
-    node::THROW_ERR_SQLITE_ERROR(env, e.what());
+    if (options.Has("directOnly") && options.Get("directOnly").IsBoolean()) {
+      direct_only = options.Get("directOnly").As<Napi::Boolean>().Value();
+    }
+  }
+
+  if (!info[fn_index].IsFunction()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(env, "Callback must be a function");
     return env.Undefined();
   }
+
+  std::string name = info[0].As<Napi::String>().Utf8Value();
+  Napi::Function fn = info[fn_index].As<Napi::Function>();
+
+  // Determine argument count
+  int argc = -1; // Default to varargs
+  if (!varargs) {
+    // Try to get function.length
+    Napi::Value length_prop = fn.Get("length");
+    if (length_prop.IsNumber()) {
+      argc = length_prop.As<Napi::Number>().Int32Value();
+    }
+  }
+
+  // Create UserDefinedFunction wrapper
+  UserDefinedFunction *user_data =
+      new UserDefinedFunction(env, fn, this, use_bigint_args);
+
+  // Set SQLite flags
+  int flags = SQLITE_UTF8;
+  if (deterministic) {
+    flags |= SQLITE_DETERMINISTIC;
+  }
+  if (direct_only) {
+    flags |= SQLITE_DIRECTONLY;
+  }
+
+  // Register with SQLite
+  int result =
+      sqlite3_create_function_v2(connection(), name.c_str(), argc, flags,
+                                 user_data, UserDefinedFunction::xFunc,
+                                 nullptr, // No aggregate step
+                                 nullptr, // No aggregate final
+                                 UserDefinedFunction::xDestroy);
+
+  if (result != SQLITE_OK) {
+    delete user_data; // Clean up on failure
+    std::string error = "Failed to create function: ";
+    error += sqlite3_errmsg(connection());
+    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
+  } else {
+    has_js_functions_ = true;
+  }
+
+  return env.Undefined();
 }
 
-Napi::Value StatementSync::Get(const Napi::CallbackInfo &info) {
+Napi::Value DatabaseSync::AggregateFunction(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
-  if (!ValidateThread(env)) {
+  if (!ValidateIdle(env)) {
     return env.Undefined();
   }
 
-  if (finalized_) {
-    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
     return env.Undefined();
   }
 
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+  if (info.Length() < 2) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "Expected at least 2 arguments: name and options");
     return env.Undefined();
   }
 
-  if (!statement_) {
-    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+  if (!info[0].IsString()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(env, "Function name must be a string");
     return env.Undefined();
   }
 
-  try {
-    Reset();
-    BindParameters(info);
-
-    int result = sqlite3_step(statement_);
+  if (!info[1].IsObject()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(env, "Options must be an object");
+    return env.Undefined();
+  }
 
-    if (result == SQLITE_ROW) {
-      return CreateResult();
-    } else if (result == SQLITE_DONE) {
-      return env.Undefined();
-    } else {
-      std::string error = sqlite3_errmsg(database_->connection());
-      node::ThrowEnhancedSqliteError(env, database_->connection(), result,
-                                     error);
-      return env.Undefined();
-    }
-  } catch (const std::exception &e) {
-    node::THROW_ERR_SQLITE_ERROR(env, e.what());
-    return env.Undefined();
-  }
-}
-
-Napi::Value StatementSync::All(const Napi::CallbackInfo &info) {
-  Napi::Env env = info.Env();
-
-  if (finalized_) {
-    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
-    return env.Undefined();
-  }
+  std::string name = info[0].As<Napi::String>().Utf8Value();
+  Napi::Object options = info[1].As<Napi::Object>();
 
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
-    return env.Undefined();
+  // Parse required options - start can be undefined, will default to null
+  Napi::Value start = env.Null();
+  if (options.Has("start") && !options.Get("start").IsUndefined()) {
+    start = options.Get("start");
   }
 
-  if (!statement_) {
-    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+  if (!options.Has("step") || !options.Get("step").IsFunction()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(env, "options.step must be a function");
     return env.Undefined();
   }
 
-  try {
-    Reset();
-    BindParameters(info);
-
-    Napi::Array results = Napi::Array::New(env);
-    uint32_t index = 0;
-
-    while (true) {
-      int result = sqlite3_step(statement_);
-
-      if (result == SQLITE_ROW) {
-        results.Set(index++, CreateResult());
-      } else if (result == SQLITE_DONE) {
-        break;
-      } else {
-        std::string error = sqlite3_errmsg(database_->connection());
-        node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
-        return env.Undefined();
-      }
-    }
+  Napi::Function step_fn = options.Get("step").As<Napi::Function>();
 
-    return results;
-  } catch (const std::exception &e) {
-    node::THROW_ERR_SQLITE_ERROR(env, e.what());
-    return env.Undefined();
+  // Parse optional options
+  Napi::Function inverse_fn;
+  if (options.Has("inverse") && options.Get("inverse").IsFunction()) {
+    inverse_fn = options.Get("inverse").As<Napi::Function>();
   }
-}
 
-Napi::Value StatementSync::Iterate(const Napi::CallbackInfo &info) {
-  if (finalized_) {
-    node::THROW_ERR_INVALID_STATE(info.Env(), "statement has been finalized");
-    return info.Env().Undefined();
+  Napi::Function result_fn;
+  if (options.Has("result") && options.Get("result").IsFunction()) {
+    result_fn = options.Get("result").As<Napi::Function>();
   }
 
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(info.Env(), "Database connection is closed");
-    return info.Env().Undefined();
+  bool use_bigint_args = false;
+  if (options.Has("useBigIntArguments") &&
+      options.Get("useBigIntArguments").IsBoolean()) {
+    use_bigint_args =
+        options.Get("useBigIntArguments").As<Napi::Boolean>().Value();
   }
 
-  if (!statement_) {
-    node::THROW_ERR_INVALID_STATE(info.Env(),
-                                  "Statement is not properly initialized");
-    return info.Env().Undefined();
+  bool varargs = false;
+  if (options.Has("varargs") && options.Get("varargs").IsBoolean()) {
+    varargs = options.Get("varargs").As<Napi::Boolean>().Value();
   }
 
-  // Reset the statement first
-  int r = sqlite3_reset(statement_);
-  if (r != SQLITE_OK) {
-    node::THROW_ERR_SQLITE_ERROR(info.Env(),
-                                 sqlite3_errmsg(database_->connection()));
-    return info.Env().Undefined();
+  bool deterministic = false;
+  if (options.Has("deterministic") &&
+      options.Get("deterministic").IsBoolean()) {
+    deterministic = options.Get("deterministic").As<Napi::Boolean>().Value();
   }
 
-  // Bind parameters if provided
-  BindParameters(info, 0);
-
-  // Create and return iterator
-  return StatementSyncIterator::Create(info.Env(), this);
-}
-
-Napi::Value StatementSync::FinalizeStatement(const Napi::CallbackInfo &info) {
-  if (statement_ && !finalized_) {
-    // It's safe to finalize even if database is closed
-    // SQLite handles this gracefully
-    sqlite3_finalize(statement_);
-    statement_ = nullptr;
-    finalized_ = true;
+  bool direct_only = false;
+  if (options.Has("directOnly") && options.Get("directOnly").IsBoolean()) {
+    direct_only = options.Get("directOnly").As<Napi::Boolean>().Value();
   }
-  return info.Env().Undefined();
-}
 
-Napi::Value StatementSync::SourceSQLGetter(const Napi::CallbackInfo &info) {
-  return Napi::String::New(info.Env(), source_sql_);
-}
+  // Determine argument count
+  int argc = -1; // Default to varargs
+  if (!varargs) {
+    Napi::Value length_prop = step_fn.Get("length");
+    if (length_prop.IsNumber()) {
+      // Subtract 1 because the first argument is the aggregate value
+      argc = length_prop.As<Napi::Number>().Int32Value() - 1;
+    }
 
-Napi::Value StatementSync::ExpandedSQLGetter(const Napi::CallbackInfo &info) {
-  if (finalized_) {
-    node::THROW_ERR_INVALID_STATE(info.Env(), "Statement has been finalized");
-    return info.Env().Undefined();
-  }
+    // Also check inverse function length if provided
+    if (!inverse_fn.IsEmpty()) {
+      Napi::Value inverse_length = inverse_fn.Get("length");
+      if (inverse_length.IsNumber()) {
+        int inverse_argc = inverse_length.As<Napi::Number>().Int32Value() - 1;
+        argc = std::max({argc, inverse_argc, 0});
+      }
+    }
 
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(info.Env(), "Database connection is closed");
-    return info.Env().Undefined();
+    // Ensure argc is non-negative
+    argc = std::max(argc, 0);
   }
 
-  if (statement_) {
-    char *expanded = sqlite3_expanded_sql(statement_);
-    if (expanded) {
-      Napi::String result = Napi::String::New(info.Env(), expanded);
-      sqlite3_free(expanded);
-      return result;
-    }
+  // Set SQLite flags
+  int flags = SQLITE_UTF8;
+  if (deterministic) {
+    flags |= SQLITE_DETERMINISTIC;
   }
-  return info.Env().Undefined();
-}
-
-Napi::Value StatementSync::SetReadBigInts(const Napi::CallbackInfo &info) {
-  Napi::Env env = info.Env();
-
-  if (finalized_) {
-    node::THROW_ERR_INVALID_STATE(env, "The statement has been finalized");
-    return env.Undefined();
+  if (direct_only) {
+    flags |= SQLITE_DIRECTONLY;
   }
 
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+  // Create CustomAggregate wrapper
+  CustomAggregate *user_data;
+  try {
+    user_data = new CustomAggregate(env, this, use_bigint_args, start, step_fn,
+                                    inverse_fn, result_fn);
+  } catch (const std::exception &e) {
+    std::string error = "Failed to create CustomAggregate: ";
+    error += e.what();
+    node::THROW_ERR_INVALID_ARG_VALUE(env, error.c_str());
     return env.Undefined();
   }
 
-  if (info.Length() < 1 || !info[0].IsBoolean()) {
-    node::THROW_ERR_INVALID_ARG_TYPE(
-        env, "The \"readBigInts\" argument must be a boolean.");
-    return env.Undefined();
+  // Register with SQLite - Node.js always uses sqlite3_create_window_function
+  // for aggregates
+  auto xInverse = !inverse_fn.IsEmpty() ? CustomAggregate::xInverse : nullptr;
+  auto xValue = xInverse ? CustomAggregate::xValue : nullptr;
+  int result = sqlite3_create_window_function(
+      connection(), name.c_str(), argc, flags, user_data,
+      CustomAggregate::xStep, CustomAggregate::xFinal, xValue, xInverse,
+      CustomAggregate::xDestroy);
+
+  if (result != SQLITE_OK) {
+    delete user_data; // Clean up on failure
+    std::string error = "Failed to create aggregate function '";
+    error += name;
+    error += "': ";
+    error += sqlite3_errmsg(connection());
+    error += " (SQLite error code: ";
+    error += std::to_string(result);
+    error += ")";
+    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
+  } else {
+    has_js_functions_ = true;
   }
 
-  use_big_ints_ = info[0].As<Napi::Boolean>().Value();
   return env.Undefined();
 }
 
-Napi::Value StatementSync::SetReturnArrays(const Napi::CallbackInfo &info) {
+Napi::Value DatabaseSync::EnableLoadExtension(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
-  if (finalized_) {
-    node::THROW_ERR_INVALID_STATE(env, "The statement has been finalized");
+  if (!ValidateIdle(env)) {
     return env.Undefined();
   }
 
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
     return env.Undefined();
   }
 
   if (info.Length() < 1 || !info[0].IsBoolean()) {
     node::THROW_ERR_INVALID_ARG_TYPE(
-        env, "The \"returnArrays\" argument must be a boolean.");
+        env, "The \"allow\" argument must be a boolean.");
     return env.Undefined();
   }
 
-  return_arrays_ = info[0].As<Napi::Boolean>().Value();
-  return env.Undefined();
-}
-
-Napi::Value
-StatementSync::SetAllowBareNamedParameters(const Napi::CallbackInfo &info) {
-  Napi::Env env = info.Env();
+  bool enable = info[0].As<Napi::Boolean>().Value();
 
-  if (finalized_) {
-    node::THROW_ERR_INVALID_STATE(env, "The statement has been finalized");
+  // Check if extension loading was disallowed at database creation
+  if (!allow_load_extension_ && enable) {
+    node::THROW_ERR_INVALID_STATE(env,
+                                  "Cannot enable extension loading because it "
+                                  "was disabled at database creation.");
     return env.Undefined();
   }
 
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
-    return env.Undefined();
-  }
+  enable_load_extension_ = enable;
 
-  if (info.Length() < 1 || !info[0].IsBoolean()) {
-    node::THROW_ERR_INVALID_ARG_TYPE(
-        env, "The \"allowBareNamedParameters\" argument must be a boolean.");
-    return env.Undefined();
+  // Configure SQLite to enable/disable extension loading
+  int result =
+      sqlite3_db_config(connection(), SQLITE_DBCONFIG_ENABLE_LOAD_EXTENSION,
+                        enable ? 1 : 0, nullptr);
+
+  if (result != SQLITE_OK) {
+    std::string error = "Failed to configure extension loading: ";
+    error += sqlite3_errmsg(connection());
+    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
   }
 
-  allow_bare_named_params_ = info[0].As<Napi::Boolean>().Value();
   return env.Undefined();
 }
 
-Napi::Value StatementSync::Columns(const Napi::CallbackInfo &info) {
+Napi::Value DatabaseSync::LoadExtension(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
-  if (finalized_) {
-    node::THROW_ERR_INVALID_STATE(env, "The statement has been finalized");
+  if (!ValidateIdle(env)) {
     return env.Undefined();
   }
 
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
     return env.Undefined();
   }
 
-  if (!statement_) {
-    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+  if (!allow_load_extension_) {
+    node::THROW_ERR_INVALID_STATE(env, "Extension loading is not allowed");
     return env.Undefined();
   }
 
-  int column_count = sqlite3_column_count(statement_);
-  Napi::Array columns = Napi::Array::New(env, column_count);
-
-  for (int i = 0; i < column_count; i++) {
-    Napi::Object column_info = Napi::Object::New(env);
+  if (!enable_load_extension_) {
+    node::THROW_ERR_INVALID_STATE(env, "Extension loading is not enabled");
+    return env.Undefined();
+  }
 
-    // column: The original column name (sqlite3_column_origin_name)
-    const char *origin_name = sqlite3_column_origin_name(statement_, i);
-    if (origin_name) {
-      column_info.Set("column", Napi::String::New(env, origin_name));
-    } else {
-      column_info.Set("column", env.Null());
-    }
+  if (info.Length() < 1 || !info[0].IsString()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(env,
+                                     "The \"path\" argument must be a string.");
+    return env.Undefined();
+  }
 
-    // database: The database name (sqlite3_column_database_name)
-    const char *database_name = sqlite3_column_database_name(statement_, i);
-    if (database_name) {
-      column_info.Set("database", Napi::String::New(env, database_name));
-    } else {
-      column_info.Set("database", env.Null());
-    }
+  std::string path = info[0].As<Napi::String>().Utf8Value();
 
-    // name: The column name/alias (sqlite3_column_name)
-    const char *column_name = sqlite3_column_name(statement_, i);
-    if (column_name) {
-      column_info.Set("name", Napi::String::New(env, column_name));
-    } else {
-      column_info.Set("name", env.Null());
-    }
+  // Optional entry point parameter
+  const char *entry_point = nullptr;
+  std::string entry_point_str;
+  if (info.Length() > 1 && info[1].IsString()) {
+    entry_point_str = info[1].As<Napi::String>().Utf8Value();
+    entry_point = entry_point_str.c_str();
+  }
 
-    // table: The table name (sqlite3_column_table_name)
-    const char *table_name = sqlite3_column_table_name(statement_, i);
-    if (table_name) {
-      column_info.Set("table", Napi::String::New(env, table_name));
-    } else {
-      column_info.Set("table", env.Null());
-    }
+  // Load the extension
+  char *errmsg = nullptr;
+  int result =
+      sqlite3_load_extension(connection(), path.c_str(), entry_point, &errmsg);
 
-    // type: The declared type (sqlite3_column_decltype)
-    const char *decl_type = sqlite3_column_decltype(statement_, i);
-    if (decl_type) {
-      column_info.Set("type", Napi::String::New(env, decl_type));
+  if (result != SQLITE_OK) {
+    std::string error = "Failed to load extension '";
+    error += path;
+    error += "': ";
+    if (errmsg) {
+      error += errmsg;
+      sqlite3_free(errmsg);
     } else {
-      column_info.Set("type", env.Null());
+      error += sqlite3_errmsg(connection());
     }
-
-    columns.Set(i, column_info);
+    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
+    return env.Undefined();
   }
 
-  return columns;
+  return env.Undefined();
 }
 
-void StatementSync::BindParameters(const Napi::CallbackInfo &info,
-                                   size_t start_index) {
+Napi::Value DatabaseSync::CreateSession(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
-  // Safety checks
-  if (finalized_) {
-    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
-    return;
-  }
-
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
-    return;
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
   }
 
-  if (!statement_) {
-    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
-    return;
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "database is not open");
+    return env.Undefined();
   }
 
-  // Check if we have a single object for named parameters
-  if (info.Length() == start_index + 1 && info[start_index].IsObject() &&
-      !info[start_index].IsBuffer() && !info[start_index].IsArray()) {
-    // Named parameters binding
-    Napi::Object obj = info[start_index].As<Napi::Object>();
-
-    // Build bare named params map if needed
-    if (allow_bare_named_params_ && !bare_named_params_.has_value()) {
-      bare_named_params_.emplace();
-      int param_count = sqlite3_bind_parameter_count(statement_);
-
-      // Parameter indexing starts at one
-      for (int i = 1; i <= param_count; ++i) {
-        const char *name = sqlite3_bind_parameter_name(statement_, i);
-        if (name == nullptr) {
-          continue;
-        }
+  std::string table;
+  std::string db_name = "main";
 
-        std::string bare_name = std::string(name + 1); // Skip the : or $ prefix
-        std::string full_name = std::string(name);
-        auto insertion = bare_named_params_->insert({bare_name, full_name});
-
-        if (!insertion.second) {
-          // Check if the existing mapping is the same
-          auto existing_full_name = insertion.first->second;
-          if (full_name != existing_full_name) {
-            std::string error_msg =
-                "Cannot create bare named parameter '" + bare_name +
-                "' because of conflicting names '" + existing_full_name +
-                "' and '" + full_name + "'.";
-            node::THROW_ERR_INVALID_STATE(env, error_msg.c_str());
-            return;
-          }
-        }
-      }
+  // Parse options if provided
+  if (info.Length() > 0) {
+    if (!info[0].IsObject()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options\" argument must be an object.");
+      return env.Undefined();
     }
 
-    // Bind named parameters
-    Napi::Array keys = obj.GetPropertyNames();
-    for (uint32_t j = 0; j < keys.Length(); j++) {
-      Napi::Value key = keys[j];
-      std::string key_str = key.As<Napi::String>().Utf8Value();
-
-      int param_index =
-          sqlite3_bind_parameter_index(statement_, key_str.c_str());
-      if (param_index == 0 && allow_bare_named_params_ &&
-          bare_named_params_.has_value()) {
-        // Try to find bare named parameter
-        auto lookup = bare_named_params_->find(key_str);
-        if (lookup != bare_named_params_->end()) {
-          param_index =
-              sqlite3_bind_parameter_index(statement_, lookup->second.c_str());
-        }
-      }
+    Napi::Object options = info[0].As<Napi::Object>();
 
-      if (param_index > 0) {
-        Napi::Value value = obj.Get(key_str);
-        try {
-          BindSingleParameter(param_index, value);
-        } catch (const Napi::Error &e) {
-          // Re-throw with parameter info
-          std::string msg =
-              "Error binding parameter '" + key_str + "': " + e.Message();
-          node::THROW_ERR_INVALID_ARG_VALUE(env, msg.c_str());
-          return;
-        }
-      }
-    }
-  } else {
-    // Positional parameters binding
-    for (size_t i = start_index; i < info.Length(); i++) {
-      int param_index = static_cast<int>(i - start_index + 1);
-      try {
-        BindSingleParameter(param_index, info[i]);
-      } catch (const Napi::Error &e) {
-        // Re-throw with parameter info
-        std::string msg = "Error binding parameter " +
-                          std::to_string(param_index) + ": " + e.Message();
-        node::THROW_ERR_INVALID_ARG_VALUE(env, msg.c_str());
-        return;
+    // Get table option
+    if (options.Has("table")) {
+      Napi::Value table_value = options.Get("table");
+      if (table_value.IsString()) {
+        table = table_value.As<Napi::String>().Utf8Value();
+      } else {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.table\" argument must be a string.");
+        return env.Undefined();
       }
     }
-  }
-}
-
-void StatementSync::BindSingleParameter(int param_index, Napi::Value param) {
-  // Safety check - statement_ should be valid if we got here
-  if (!statement_ || finalized_) {
-    return; // Silent return since error was already thrown by caller
-  }
 
-  try {
-    if (param.IsNull() || param.IsUndefined()) {
-      sqlite3_bind_null(statement_, param_index);
-    } else if (param.IsBigInt()) {
-      // Handle BigInt before IsNumber since BigInt values should bind as int64
-      bool lossless;
-      int64_t bigint_val = param.As<Napi::BigInt>().Int64Value(&lossless);
-      if (lossless) {
-        sqlite3_bind_int64(statement_, param_index,
-                           static_cast<sqlite3_int64>(bigint_val));
-      } else {
-        // BigInt too large, convert to text
-        std::string bigint_str =
-            param.As<Napi::BigInt>().ToString().Utf8Value();
-        sqlite3_bind_text(statement_, param_index, bigint_str.c_str(), -1,
-                          SQLITE_TRANSIENT);
-      }
-    } else if (param.IsNumber()) {
-      double val = param.As<Napi::Number>().DoubleValue();
-      if (val == std::floor(val) && val >= INT32_MIN && val <= INT32_MAX) {
-        sqlite3_bind_int(statement_, param_index,
-                         param.As<Napi::Number>().Int32Value());
+    // Get db option
+    if (options.Has("db")) {
+      Napi::Value db_value = options.Get("db");
+      if (db_value.IsString()) {
+        db_name = db_value.As<Napi::String>().Utf8Value();
       } else {
-        sqlite3_bind_double(statement_, param_index,
-                            param.As<Napi::Number>().DoubleValue());
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.db\" argument must be a string.");
+        return env.Undefined();
       }
-    } else if (param.IsString()) {
-      std::string str = param.As<Napi::String>().Utf8Value();
-      sqlite3_bind_text(statement_, param_index, str.c_str(), -1,
-                        SQLITE_TRANSIENT);
-    } else if (param.IsBoolean()) {
-      sqlite3_bind_int(statement_, param_index,
-                       param.As<Napi::Boolean>().Value() ? 1 : 0);
-    } else if (param.IsBuffer()) {
-      Napi::Buffer<uint8_t> buffer = param.As<Napi::Buffer<uint8_t>>();
-      sqlite3_bind_blob(statement_, param_index, buffer.Data(),
-                        static_cast<int>(buffer.Length()), SQLITE_TRANSIENT);
-    } else if (param.IsFunction()) {
-      // Functions cannot be stored in SQLite - bind as NULL
-      sqlite3_bind_null(statement_, param_index);
-    } else if (param.IsObject()) {
-      // Try to convert object to string
-      Napi::String str_value = param.ToString();
-      std::string str = str_value.Utf8Value();
-      sqlite3_bind_text(statement_, param_index, str.c_str(), -1,
-                        SQLITE_TRANSIENT);
-    } else {
-      // For any other type, bind as NULL
-      sqlite3_bind_null(statement_, param_index);
     }
-  } catch (const Napi::Error &e) {
-    // Re-throw Napi errors
-    throw;
-  } catch (const std::exception &e) {
-    // Convert standard exceptions to Napi errors
-    throw Napi::Error::New(Env(), e.what());
   }
-}
 
-Napi::Value StatementSync::CreateResult() {
-  Napi::Env env = Env();
+  // Create the session
+  sqlite3_session *pSession;
+  int r = sqlite3session_create(connection(), db_name.c_str(), &pSession);
 
-  // Safety checks
-  if (!statement_ || finalized_) {
-    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+  if (r != SQLITE_OK) {
+    std::string error = "Failed to create session: ";
+    error += sqlite3_errmsg(connection());
+    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
     return env.Undefined();
   }
 
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+  // Attach table if specified
+  r = sqlite3session_attach(pSession, table.empty() ? nullptr : table.c_str());
+
+  if (r != SQLITE_OK) {
+    sqlite3session_delete(pSession);
+    std::string error = "Failed to attach table to session: ";
+    error += sqlite3_errmsg(connection());
+    node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
     return env.Undefined();
   }
 
-  int column_count = sqlite3_column_count(statement_);
+  // Create and return the Session object
+  return Session::Create(env, this, pSession);
+}
 
-  if (return_arrays_) {
-    // Return result as array when returnArrays is true
-    Napi::Array result = Napi::Array::New(env, column_count);
+void DatabaseSync::AddSession(Session *session) {
+  std::lock_guard<std::mutex> lock(sessions_mutex_);
+  sessions_.insert(session);
+}
 
-    for (int i = 0; i < column_count; i++) {
-      int column_type = sqlite3_column_type(statement_, i);
-      Napi::Value value;
+void DatabaseSync::RemoveSession(Session *session) {
+  std::lock_guard<std::mutex> lock(sessions_mutex_);
+  sessions_.erase(session);
+}
 
-      switch (column_type) {
-      case SQLITE_NULL:
-        value = env.Null();
-        break;
-      case SQLITE_INTEGER: {
-        sqlite3_int64 int_val = sqlite3_column_int64(statement_, i);
-        if (use_big_ints_) {
-          // Always return BigInt when readBigInts is true
-          value = Napi::BigInt::New(env, static_cast<int64_t>(int_val));
-        } else if (int_val > JS_MAX_SAFE_INTEGER ||
-                   int_val < JS_MIN_SAFE_INTEGER) {
-          // Return BigInt for values outside JavaScript's safe integer range
-          value = Napi::BigInt::New(env, static_cast<int64_t>(int_val));
-        } else {
-          value = Napi::Number::New(env, static_cast<double>(int_val));
-        }
-        break;
-      }
-      case SQLITE_FLOAT:
-        value = Napi::Number::New(env, sqlite3_column_double(statement_, i));
-        break;
-      case SQLITE_TEXT: {
-        const unsigned char *text = sqlite3_column_text(statement_, i);
-        value = Napi::String::New(env, reinterpret_cast<const char *>(text));
-        break;
-      }
-      case SQLITE_BLOB: {
-        const void *blob_data = sqlite3_column_blob(statement_, i);
-        int blob_size = sqlite3_column_bytes(statement_, i);
-        value = Napi::Buffer<uint8_t>::Copy(
-            env, static_cast<const uint8_t *>(blob_data), blob_size);
-        break;
-      }
-      default:
-        value = env.Null();
-        break;
-      }
+void DatabaseSync::DeleteAllSessions() {
+  std::lock_guard<std::mutex> lock(sessions_mutex_);
+  // Copy the set to avoid iterator invalidation
+  std::set<Session *> sessions_copy = sessions_;
+  sessions_.clear(); // Clear first to prevent re-entrance
 
-      result.Set(i, value);
-    }
+  // Now delete each session
+  for (auto *session : sessions_copy) {
+    // Direct SQLite cleanup since we're in database destruction
+    if (session->GetSession()) {
+      sqlite3session_delete(session->GetSession());
+      // Clear the session's internal pointers
+      session->session_ = nullptr;
+      session->database_ = nullptr;
+    }
+  }
+}
+
+// Context structure for changeset callbacks to avoid global state
+struct ChangesetCallbacks {
+  std::function<int(int)> conflictCallback;
+  std::function<bool(std::string)> filterCallback;
+  Napi::Env env;
+  ConflictPolicies *policies = nullptr;
+};
+
+static int xConflict(void *pCtx, int eConflict, sqlite3_changeset_iter *pIter) {
+  if (!pCtx)
+    return SQLITE_CHANGESET_OMIT;
+  ChangesetCallbacks *callbacks = static_cast<ChangesetCallbacks *>(pCtx);
+  if (callbacks->policies) {
+    // Native policies first; JavaScript only sees what they leave over
+    std::optional<int> decision =
+        callbacks->policies->Decide(eConflict, pIter);
+    if (decision)
+      return *decision;
+  }
+  int decision = callbacks->conflictCallback
+                     ? callbacks->conflictCallback(eConflict)
+                     : SQLITE_CHANGESET_OMIT;
+  if (callbacks->policies)
+    callbacks->policies->CountFallback(decision,
+                                       bool(callbacks->conflictCallback));
+  return decision;
+}
+
+static int xFilter(void *pCtx, const char *zTab) {
+  if (!pCtx)
+    return 1;
+  ChangesetCallbacks *callbacks = static_cast<ChangesetCallbacks *>(pCtx);
+  if (!callbacks->filterCallback)
+    return 1;
+  return callbacks->filterCallback(zTab) ? 1 : 0;
+}
+
+Napi::Value DatabaseSync::ApplyChangeset(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "database is not open");
+    return env.Undefined();
+  }
+
+  if (info.Length() < 1 || !info[0].IsBuffer()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"changeset\" argument must be a Buffer.");
+    return env.Undefined();
+  }
+
+  // Create callback context to avoid global state
+  ChangesetCallbacks callbacks{nullptr, nullptr, env};
+  ConflictPolicies policies;
+  Rebaser *rebaser = nullptr;
+
+  // Parse options if provided
+  if (info.Length() > 1 && !info[1].IsUndefined()) {
+    if (!info[1].IsObject()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options\" argument must be an object.");
+      return env.Undefined();
+    }
+
+    Napi::Object options = info[1].As<Napi::Object>();
+
+    // Handle onConflict callback
+    if (options.Has("onConflict")) {
+      Napi::Value conflictValue = options.Get("onConflict");
+      if (!conflictValue.IsUndefined()) {
+        if (!conflictValue.IsFunction()) {
+          node::THROW_ERR_INVALID_ARG_TYPE(
+              env, "The \"options.onConflict\" argument must be a function.");
+          return env.Undefined();
+        }
+
+        Napi::Function conflictFunc = conflictValue.As<Napi::Function>();
+        callbacks.conflictCallback = [env,
+                                      conflictFunc](int conflictType) -> int {
+          Napi::HandleScope scope(env);
+          Napi::Value result =
+              conflictFunc.Call({Napi::Number::New(env, conflictType)});
+
+          if (env.IsExceptionPending()) {
+            // If callback threw, abort the changeset apply
+            return SQLITE_CHANGESET_ABORT;
+          }
+
+          if (!result.IsNumber()) {
+            return -1; // Invalid value
+          }
+
+          return result.As<Napi::Number>().Int32Value();
+        };
+      }
+    }
+
+    // Handle filter callback
+    if (options.Has("filter")) {
+      Napi::Value filterValue = options.Get("filter");
+      if (!filterValue.IsFunction()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.filter\" argument must be a function.");
+        return env.Undefined();
+      }
+
+      Napi::Function filterFunc = filterValue.As<Napi::Function>();
+      callbacks.filterCallback = [env,
+                                  filterFunc](std::string tableName) -> bool {
+        Napi::HandleScope scope(env);
+        Napi::Value result =
+            filterFunc.Call({Napi::String::New(env, tableName)});
+
+        if (env.IsExceptionPending()) {
+          // If callback threw, exclude the table
+          return false;
+        }
+
+        return result.ToBoolean().Value();
+      };
+    }
+
+    // Handle native conflict policies
+    Napi::Value policiesValue = options.Get("policies");
+    if (!policiesValue.IsUndefined()) {
+      if (!policies.Parse(env, policiesValue)) {
+        return env.Undefined();
+      }
+      std::string error;
+      if (!policies.Resolve(connection(), &error)) {
+        node::THROW_ERR_INVALID_ARG_VALUE(env, error.c_str());
+        return env.Undefined();
+      }
+      callbacks.policies = &policies;
+    }
+
+    // Handle rebaser, configured with the conflict resolutions made here
+    Napi::Value rebaserValue = options.Get("rebaser");
+    if (!rebaserValue.IsUndefined()) {
+      rebaser = Rebaser::FromValue(env, rebaserValue);
+      if (!rebaser) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.rebaser\" argument must be a Rebaser.");
+        return env.Undefined();
+      }
+      if (!rebaser->IsOpen()) {
+        node::THROW_ERR_INVALID_STATE(env, "rebaser is not open");
+        return env.Undefined();
+      }
+    }
+  }
+
+  // Get the changeset buffer
+  Napi::Buffer<uint8_t> buffer = info[0].As<Napi::Buffer<uint8_t>>();
+
+  // Apply the changeset with context instead of global state
+  void *rebase = nullptr;
+  int rebaseSize = 0;
+  int r = sqlite3changeset_apply_v2(
+      connection(), buffer.Length(), buffer.Data(), xFilter, xConflict,
+      &callbacks, rebaser ? &rebase : nullptr, rebaser ? &rebaseSize : nullptr,
+      0);
+  // A rolled back changeset leaves nothing to rebase against
+  bool configured = true;
+  if (rebase && r == SQLITE_OK) {
+    configured = rebaser->AddRebaseBuffer(env, rebase, rebaseSize);
+  }
+  sqlite3_free(rebase);
+  if (!configured) {
+    return env.Undefined();
+  }
+
+  if (r == SQLITE_OK || r == SQLITE_ABORT) {
+    // SQLITE_ABORT is not an error, just means the operation was aborted
+    if (callbacks.policies) {
+      return policies.Result(env, r == SQLITE_OK);
+    }
+    return Napi::Boolean::New(env, r == SQLITE_OK);
+  }
+
+  // Other errors
+  std::string error = "Failed to apply changeset: ";
+  error += sqlite3_errmsg(connection());
+  node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
+  return env.Undefined();
+}
+
+Napi::Value
+DatabaseSync::ApplyChangesetStream(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+  if (!ValidateThread(env)) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
+
+  if (!IsOpen()) {
+    deferred.Reject(Napi::Error::New(env, "database is not open").Value());
+    return deferred.Promise();
+  }
+
+  Napi::Value iterator = ChangesetStreamJob::OpenIterator(env, info[0]);
+  if (iterator.IsEmpty()) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
+
+  ChangesetStreamJob::ApplyOptions options;
+  if (!ChangesetStreamJob::ParseApplyOptions(env, info[1], &options)) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
+
+  return ChangesetStreamJob::Apply(env, this, iterator.As<Napi::Object>(),
+                                   std::move(options));
+}
+
+Napi::Value DatabaseSync::ApplyChangesetAsync(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+  if (!ValidateThread(env)) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
+
+  if (!IsOpen()) {
+    deferred.Reject(Napi::Error::New(env, "database is not open").Value());
+    return deferred.Promise();
+  }
+
+  if (!info[0].IsTypedArray() ||
+      info[0].As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"changeset\" argument must be a Buffer or Uint8Array.");
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
+
+  ChangesetStreamJob::ApplyOptions options;
+  if (!ChangesetStreamJob::ParseApplyOptions(env, info[1], &options)) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
+
+  return ChangesetStreamJob::ApplyBuffer(
+      env, this, info[0].As<Napi::Uint8Array>(), std::move(options));
+}
+
+// StatementSync Implementation
+Napi::Object StatementSync::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(
+      env, "StatementSync",
+      {InstanceMethod("run", &StatementSync::Run),
+       InstanceMethod("get", &StatementSync::Get),
+       InstanceMethod("all", &StatementSync::All),
+       InstanceMethod("allColumns", &StatementSync::AllColumns),
+       InstanceMethod("iterate", &StatementSync::Iterate),
+       InstanceMethod("finalize", &StatementSync::FinalizeStatement),
+       InstanceMethod("runAsync", &StatementSync::RunAsync),
+       InstanceMethod("allAsync", &StatementSync::AllAsync),
+       InstanceMethod("setReadBigInts", &StatementSync::SetReadBigInts),
+       InstanceMethod("setReturnArrays", &StatementSync::SetReturnArrays),
+       InstanceMethod("setAllowBareNamedParameters",
+                      &StatementSync::SetAllowBareNamedParameters),
+       InstanceMethod("setQueryLimits", &StatementSync::SetQueryLimits),
+       InstanceMethod("status", &StatementSync::Status),
+       InstanceMethod("scanStatus", &StatementSync::ScanStatus),
+       InstanceMethod("columns", &StatementSync::Columns),
+       InstanceAccessor("sourceSQL", &StatementSync::SourceSQLGetter, nullptr),
+       InstanceAccessor("expandedSQL", &StatementSync::ExpandedSQLGetter,
+                        nullptr)});
+
+  // Store constructor in per-instance addon data instead of static variable
+  AddonData *addon_data = GetAddonData(env);
+  if (addon_data) {
+    addon_data->statementSyncConstructor =
+        Napi::Reference<Napi::Function>::New(func);
+  }
+
+  exports.Set("StatementSync", func);
+  return exports;
+}
+
+StatementSync::StatementSync(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<StatementSync>(info),
+      creation_thread_(std::this_thread::get_id()) {
+  // Constructor - initialization happens in InitStatement
+}
+
+void StatementSync::InitStatement(DatabaseSync *database,
+                                  const std::string &sql,
+                                  unsigned int prepare_flags) {
+  if (!database || !database->IsOpen()) {
+    throw std::runtime_error("Database is not open");
+  }
+
+  database_ = database;
+  source_sql_ = sql;
+  query_mutex_ = database->query_mutex();
+
+  // Prepare the statement
+  const char *tail = nullptr;
+  int result = sqlite3_prepare_v3(database->connection(), sql.c_str(), -1,
+                                  prepare_flags, &statement_, &tail);
+
+  if (result != SQLITE_OK) {
+    std::string error = sqlite3_errmsg(database->connection());
+    throw std::runtime_error("Failed to prepare statement: " + error);
+  }
+}
+
+StatementSync::~StatementSync() {
+  if (statement_ && !finalized_) {
+    // GC may finalize a statement while another statement of the same
+    // connection is stepping on a worker thread
+    std::unique_lock<std::mutex> lock;
+    if (query_mutex_) {
+      lock = std::unique_lock<std::mutex>(*query_mutex_);
+    }
+    sqlite3_finalize(statement_);
+  }
+}
+
+// Builds the { changes, lastInsertRowid } object returned by run()
+Napi::Object CreateRunResult(Napi::Env env, sqlite3 *db, int64_t changes) {
+  Napi::Object result_obj = Napi::Object::New(env);
+  result_obj.Set("changes",
+                 Napi::Number::New(env, static_cast<double>(changes)));
+
+  sqlite3_int64 last_rowid = sqlite3_last_insert_rowid(db);
+  // Use JavaScript's safe integer limits (2^53 - 1)
+  if (last_rowid > JS_MAX_SAFE_INTEGER || last_rowid < JS_MIN_SAFE_INTEGER) {
+    result_obj.Set("lastInsertRowid",
+                   Napi::BigInt::New(env, static_cast<int64_t>(last_rowid)));
+  } else {
+    result_obj.Set("lastInsertRowid",
+                   Napi::Number::New(env, static_cast<double>(last_rowid)));
+  }
+
+  return result_obj;
+}
+
+Napi::Value StatementSync::Run(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateThread(env)) {
+    return env.Undefined();
+  }
+
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (!statement_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+    return env.Undefined();
+  }
+
+  QueryLimitScope limit_scope(env, database_, query_limits());
+
+  try {
+    Reset();
+    BindParameters(info);
+
+    int result = sqlite3_step(statement_);
+
+    if (result != SQLITE_DONE && result != SQLITE_ROW) {
+      std::string error = sqlite3_errmsg(database_->connection());
+      node::ThrowEnhancedSqliteError(env, database_->connection(), result,
+                                     error);
+      return env.Undefined();
+    }
+
+    return CreateRunResult(env, database_->connection(),
+                           sqlite3_changes64(database_->connection()));
+  } catch (const std::exception &e) {
+    node::THROW_ERR_SQLITE_ERROR(env, e.what());
+    return env.Undefined();
+  }
+}
+
+// Shared driver for the bulk execution methods (runMany, runColumns). The
+// batch optionally runs inside a transaction, or inside a savepoint when one
+// is already open, so that a failure only rolls back the batch.
+struct BulkRun {
+  BulkRun(Napi::Env env, sqlite3 *db, sqlite3_stmt *stmt)
+      : env(env), db(db), stmt(stmt) {}
+
+  // Reads { transaction } from the options argument. Returns false with a
+  // pending exception if the options are invalid.
+  bool ParseOptions(Napi::Value options) {
+    if (options.IsUndefined()) {
+      return true;
+    }
+    if (!options.IsObject()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options\" argument must be an object.");
+      return false;
+    }
+
+    Napi::Value transaction_value =
+        options.As<Napi::Object>().Get("transaction");
+    if (!transaction_value.IsUndefined()) {
+      if (!transaction_value.IsBoolean()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.transaction\" argument must be a boolean.");
+        return false;
+      }
+      use_transaction = transaction_value.As<Napi::Boolean>().Value();
+    }
+    return true;
+  }
+
+  bool Begin() {
+    if (!use_transaction) {
+      return true;
+    }
+
+    const char *begin_sql;
+    if (sqlite3_get_autocommit(db)) {
+      begin_sql = "BEGIN";
+      commit_sql = "COMMIT";
+      rollback_sql = "ROLLBACK";
+    } else {
+      begin_sql = "SAVEPOINT phstr_bulk_run";
+      commit_sql = "RELEASE phstr_bulk_run";
+      rollback_sql = "ROLLBACK TO phstr_bulk_run; RELEASE phstr_bulk_run";
+    }
+
+    if (sqlite3_exec(db, begin_sql, nullptr, nullptr, nullptr) != SQLITE_OK) {
+      commit_sql = rollback_sql = nullptr;
+      node::ThrowSqliteError(env, db, sqlite3_errmsg(db));
+      return false;
+    }
+    return true;
+  }
+
+  // Steps the bound statement once. Returns false with a pending exception
+  // if the step failed.
+  bool Step() {
+    sqlite3_int64 before = sqlite3_total_changes64(db);
+    int result = sqlite3_step(stmt);
+    if (result != SQLITE_DONE && result != SQLITE_ROW) {
+      node::ThrowEnhancedSqliteError(env, db, result, sqlite3_errmsg(db));
+      return false;
+    }
+    // Rows are not read. The change counts are only updated once the
+    // statement halts, which for RETURNING is after its last row.
+    if (result == SQLITE_ROW) {
+      sqlite3_reset(stmt);
+    }
+    // sqlite3_changes64() keeps the count of the last INSERT, UPDATE or
+    // DELETE, so a step that changed nothing (a SELECT, DDL) must not add it
+    if (sqlite3_total_changes64(db) != before) {
+      total_changes += sqlite3_changes64(db);
+    }
+    return true;
+  }
+
+  // Stops the batch: rolls back when wrapped, and rethrows the error with the
+  // index of the failing row and the number of changes that were kept.
+  Napi::Value Fail(Napi::Error error, uint32_t index) {
+    sqlite3_reset(stmt);
+    if (rollback_sql != nullptr) {
+      sqlite3_exec(db, rollback_sql, nullptr, nullptr, nullptr);
+      total_changes = 0;
+    }
+    error.Set("failedIndex", Napi::Number::New(env, index));
+    error.Set("changes",
+              Napi::Number::New(env, static_cast<double>(total_changes)));
+    error.ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Napi::Value FailPending(uint32_t index) {
+    return Fail(env.GetAndClearPendingException(), index);
+  }
+
+  Napi::Value Finish() {
+    sqlite3_reset(stmt);
+    if (commit_sql != nullptr &&
+        sqlite3_exec(db, commit_sql, nullptr, nullptr, nullptr) != SQLITE_OK) {
+      node::ThrowSqliteError(env, db, sqlite3_errmsg(db));
+      sqlite3_exec(db, rollback_sql, nullptr, nullptr, nullptr);
+      return env.Undefined();
+    }
+    return CreateRunResult(env, db, total_changes);
+  }
+
+  Napi::Env env;
+  sqlite3 *db;
+  sqlite3_stmt *stmt;
+  bool use_transaction = false;
+  const char *commit_sql = nullptr;
+  const char *rollback_sql = nullptr;
+  int64_t total_changes = 0;
+};
+
+Napi::Value StatementSync::RunMany(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateThread(env)) {
+    return env.Undefined();
+  }
+
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (!statement_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+    return env.Undefined();
+  }
+
+  QueryLimitScope limit_scope(env, database_, query_limits());
+
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(env,
+                                     "The \"rows\" argument must be an array.");
+    return env.Undefined();
+  }
+
+  BulkRun bulk(env, database_->connection(), statement_);
+  if (!bulk.ParseOptions(info[1]) || !bulk.Begin()) {
+    return env.Undefined();
+  }
+
+  Napi::Array rows = info[0].As<Napi::Array>();
+  uint32_t row_count = rows.Length();
+
+  // Reused across rows to avoid a per-row allocation
+  std::vector<Napi::Value> row_args;
+
+  for (uint32_t index = 0; index < row_count; index++) {
+    try {
+      Napi::Value row = rows.Get(index);
+      row_args.clear();
+      if (row.IsArray()) {
+        Napi::Array row_array = row.As<Napi::Array>();
+        uint32_t param_count = row_array.Length();
+        for (uint32_t j = 0; j < param_count; j++) {
+          row_args.push_back(row_array.Get(j));
+        }
+      } else if (!row.IsUndefined()) {
+        // A named-parameter object, or a single positional value
+        row_args.push_back(row);
+      }
+
+      Reset();
+      BindParameterList(env, row_args, 0, row_args.size());
+      if (env.IsExceptionPending() || !bulk.Step()) {
+        return bulk.FailPending(index);
+      }
+    } catch (const Napi::Error &e) {
+      return bulk.Fail(e, index);
+    }
+  }
+
+  return bulk.Finish();
+}
+
+// A typed array bound as one parameter column by runColumns()
+struct BoundColumn {
+  napi_typedarray_type type;
+  const uint8_t *data;
+  std::vector<uint8_t> copy; // Backs `data` when the column was copied
+};
+
+Napi::Value StatementSync::RunColumns(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateThread(env)) {
+    return env.Undefined();
+  }
+
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (!statement_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+    return env.Undefined();
+  }
+
+  QueryLimitScope limit_scope(env, database_, query_limits());
+
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"columns\" argument must be an array.");
+    return env.Undefined();
+  }
+
+  if (info.Length() < 2 || !info[1].IsNumber()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"rowCount\" argument must be a number.");
+    return env.Undefined();
+  }
+
+  double row_count_value = info[1].As<Napi::Number>().DoubleValue();
+  if (row_count_value < 0 || row_count_value > UINT32_MAX ||
+      row_count_value != std::floor(row_count_value)) {
+    node::THROW_ERR_OUT_OF_RANGE(
+        env, "The \"rowCount\" argument must be a non-negative integer.");
+    return env.Undefined();
+  }
+  uint32_t row_count = static_cast<uint32_t>(row_count_value);
+
+  Napi::Array column_values = info[0].As<Napi::Array>();
+  uint32_t column_count = column_values.Length();
+  if (column_count >
+      static_cast<uint32_t>(sqlite3_bind_parameter_count(statement_))) {
+    node::THROW_ERR_OUT_OF_RANGE(
+        env, "The \"columns\" argument has more entries than the statement "
+             "has parameters.");
+    return env.Undefined();
+  }
+
+  // Options and array elements can be getters, so read them all before
+  // taking any pointers into column memory
+  BulkRun bulk(env, database_->connection(), statement_);
+  if (!bulk.ParseOptions(info[2])) {
+    return env.Undefined();
+  }
+
+  std::vector<Napi::TypedArray> arrays;
+  arrays.reserve(column_count);
+  for (uint32_t i = 0; i < column_count; i++) {
+    Napi::Value value = column_values.Get(i);
+    if (!value.IsTypedArray()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"columns\" argument must contain only typed arrays.");
+      return env.Undefined();
+    }
+
+    Napi::TypedArray array = value.As<Napi::TypedArray>();
+    switch (array.TypedArrayType()) {
+    case napi_int8_array:
+    case napi_uint8_array:
+    case napi_uint8_clamped_array:
+    case napi_int16_array:
+    case napi_uint16_array:
+    case napi_int32_array:
+    case napi_uint32_array:
+    case napi_float32_array:
+    case napi_float64_array:
+    case napi_bigint64_array:
+    case napi_biguint64_array:
+      break;
+    default:
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "Unsupported typed array type in \"columns\".");
+      return env.Undefined();
+    }
+
+    if (array.ElementLength() < row_count) {
+      std::string message = "Column " + std::to_string(i) +
+                            " has fewer than " + std::to_string(row_count) +
+                            " elements.";
+      node::THROW_ERR_OUT_OF_RANGE(env, message.c_str());
+      return env.Undefined();
+    }
+
+    arrays.push_back(array);
+  }
+
+  // Bind straight from each column's memory. User functions and aggregates
+  // run JavaScript inside sqlite3_step(), though, and could detach or shrink
+  // a column's buffer between two rows, so when any are registered the
+  // elements are copied up front instead.
+  bool copy_columns = database_->HasJavaScriptFunctions();
+  std::vector<BoundColumn> columns;
+  columns.reserve(column_count);
+  for (const Napi::TypedArray &array : arrays) {
+    BoundColumn column{
+        array.TypedArrayType(),
+        static_cast<const uint8_t *>(array.ArrayBuffer().Data()) +
+            array.ByteOffset(),
+        {}};
+    if (copy_columns) {
+      column.copy.assign(column.data,
+                         column.data + static_cast<size_t>(row_count) *
+                                           array.ElementSize());
+      column.data = column.copy.data();
+    }
+    columns.push_back(std::move(column));
+  }
+
+  if (!bulk.Begin()) {
+    return env.Undefined();
+  }
+
+  // Parameters without a column stay NULL for every row
+  Reset();
+
+  for (uint32_t row = 0; row < row_count; row++) {
+    sqlite3_reset(statement_);
+    for (uint32_t i = 0; i < column_count; i++) {
+      BindTypedArrayElement(static_cast<int>(i + 1), columns[i].type,
+                            columns[i].data, row);
+    }
+    if (!bulk.Step()) {
+      return bulk.FailPending(row);
+    }
+  }
+
+  return bulk.Finish();
+}
+
+Napi::Value StatementSync::Get(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateThread(env)) {
+    return env.Undefined();
+  }
+
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (!statement_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+    return env.Undefined();
+  }
+
+  QueryLimitScope limit_scope(env, database_, query_limits());
+
+  try {
+    Reset();
+    BindParameters(info);
+
+    int result = sqlite3_step(statement_);
+
+    if (result == SQLITE_ROW) {
+      return CreateResult();
+    } else if (result == SQLITE_DONE) {
+      return env.Undefined();
+    } else {
+      std::string error = sqlite3_errmsg(database_->connection());
+      node::ThrowEnhancedSqliteError(env, database_->connection(), result,
+                                     error);
+      return env.Undefined();
+    }
+  } catch (const std::exception &e) {
+    node::THROW_ERR_SQLITE_ERROR(env, e.what());
+    return env.Undefined();
+  }
+}
+
+Napi::Value StatementSync::All(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (!statement_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+    return env.Undefined();
+  }
+
+  QueryLimitScope limit_scope(env, database_, query_limits());
+
+  try {
+    Reset();
+    BindParameters(info);
+
+    Napi::Array results = Napi::Array::New(env);
+    uint32_t index = 0;
+    std::vector<napi_value> keys;
+
+    while (true) {
+      int result = sqlite3_step(statement_);
+
+      if (result == SQLITE_ROW) {
+        // Any re-prepare happens on the first step, so the keys resolved for
+        // the first row are valid for the rest of the result set.
+        if (index == 0 && !return_arrays_) {
+          ResolveColumnKeys(keys);
+        }
+        results.Set(index++, CreateResult(&keys));
+      } else if (result == SQLITE_DONE) {
+        break;
+      } else {
+        std::string error = sqlite3_errmsg(database_->connection());
+        node::THROW_ERR_SQLITE_ERROR(env, error.c_str());
+        return env.Undefined();
+      }
+    }
+
+    return results;
+  } catch (const std::exception &e) {
+    node::THROW_ERR_SQLITE_ERROR(env, e.what());
+    return env.Undefined();
+  }
+}
+
+// Per-column accumulator for StatementSync::AllColumns. Numeric cells are kept
+// as raw 64-bit payloads (integers, or the bit pattern of doubles) until the
+// whole result has been stepped, because the output array type depends on
+// every value in the column.
+struct ColumnarColumn {
+  std::vector<uint8_t> types;
+  std::vector<int64_t> raw;
+  Napi::Array objects; // Text and blob values, created while stepping
+  int type_mask = 0;
+  bool ints_fit_int32 = true;
+  bool ints_fit_double = true;
+};
+
+static Napi::Uint8Array ColumnarValidity(Napi::Env env,
+                                         const std::vector<uint8_t> &types) {
+  // Arrow-style validity bitmap: bit (row % 8) of byte (row / 8) is set when
+  // the value is not NULL. The backing ArrayBuffer is zero-filled.
+  size_t row_count = types.size();
+  Napi::Uint8Array validity = Napi::Uint8Array::New(env, (row_count + 7) / 8);
+  uint8_t *bits = validity.Data();
+  for (size_t row = 0; row < row_count; row++) {
+    if (types[row] != SQLITE_NULL) {
+      bits[row / 8] |= static_cast<uint8_t>(1u << (row % 8));
+    }
+  }
+  return validity;
+}
+
+static double ColumnarRawToDouble(uint8_t type, int64_t raw) {
+  if (type == SQLITE_FLOAT) {
+    double value;
+    std::memcpy(&value, &raw, sizeof(value));
+    return value;
+  }
+  return static_cast<double>(raw);
+}
+
+Napi::Value StatementSync::AllColumns(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateThread(env)) {
+    return env.Undefined();
+  }
+
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (!statement_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+    return env.Undefined();
+  }
+
+  QueryLimitScope limit_scope(env, database_, query_limits());
+
+  try {
+    Reset();
+    BindParameters(info);
+    if (env.IsExceptionPending()) {
+      return env.Undefined();
+    }
+
+    int column_count = sqlite3_column_count(statement_);
+    std::vector<ColumnarColumn> columns(column_count);
+    size_t row_count = 0;
+
+    while (true) {
+      int result = sqlite3_step(statement_);
+
+      if (result == SQLITE_DONE) {
+        break;
+      }
+
+      if (result != SQLITE_ROW) {
+        std::string error = sqlite3_errmsg(database_->connection());
+        node::ThrowEnhancedSqliteError(env, database_->connection(), result,
+                                       error);
+        return env.Undefined();
+      }
+
+      for (int i = 0; i < column_count; i++) {
+        ColumnarColumn &column = columns[i];
+        int type = sqlite3_column_type(statement_, i);
+        int64_t raw = 0;
+
+        switch (type) {
+        case SQLITE_INTEGER:
+          raw = sqlite3_column_int64(statement_, i);
+          if (raw < INT32_MIN || raw > INT32_MAX) {
+            column.ints_fit_int32 = false;
+          }
+          if (raw < JS_MIN_SAFE_INTEGER || raw > JS_MAX_SAFE_INTEGER) {
+            column.ints_fit_double = false;
+          }
+          break;
+        case SQLITE_FLOAT: {
+          double value = sqlite3_column_double(statement_, i);
+          std::memcpy(&raw, &value, sizeof(raw));
+          break;
+        }
+        case SQLITE_TEXT:
+        case SQLITE_BLOB:
+          if (column.objects.IsEmpty()) {
+            column.objects = Napi::Array::New(env);
+          }
+          column.objects.Set(static_cast<uint32_t>(row_count),
+                             ColumnToValue(i));
+          break;
+        default:
+          type = SQLITE_NULL;
+          break;
+        }
+
+        if (type != SQLITE_NULL) {
+          column.type_mask |= 1 << type;
+        }
+        column.types.push_back(static_cast<uint8_t>(type));
+        column.raw.push_back(raw);
+      }
+      row_count++;
+    }
+
+    const int kInteger = 1 << SQLITE_INTEGER;
+    const int kFloat = 1 << SQLITE_FLOAT;
+    const int kText = 1 << SQLITE_TEXT;
+    const int kBlob = 1 << SQLITE_BLOB;
+
+    Napi::Array column_results = Napi::Array::New(env, column_count);
+
+    for (int i = 0; i < column_count; i++) {
+      ColumnarColumn &column = columns[i];
+      const char *name = sqlite3_column_name(statement_, i);
+      const char *kind;
+      Napi::Value values;
+
+      if (column.type_mask == kInteger && !use_big_ints_ &&
+          column.ints_fit_int32) {
+        kind = "int32";
+        Napi::Int32Array array = Napi::Int32Array::New(env, row_count);
+        int32_t *data = array.Data();
+        for (size_t row = 0; row < row_count; row++) {
+          data[row] = static_cast<int32_t>(column.raw[row]);
+        }
+        values = array;
+      } else if (column.type_mask == kInteger &&
+                 (use_big_ints_ || !column.ints_fit_double)) {
+        kind = "bigint64";
+        Napi::BigInt64Array array = Napi::BigInt64Array::New(env, row_count);
+        std::memcpy(array.Data(), column.raw.data(),
+                    row_count * sizeof(int64_t));
+        values = array;
+      } else if ((column.type_mask & ~(kInteger | kFloat)) == 0 &&
+                 column.type_mask != 0 && column.ints_fit_double) {
+        kind = "float64";
+        Napi::Float64Array array = Napi::Float64Array::New(env, row_count);
+        double *data = array.Data();
+        for (size_t row = 0; row < row_count; row++) {
+          data[row] = ColumnarRawToDouble(column.types[row], column.raw[row]);
+        }
+        values = array;
+      } else {
+        // Text, blob, all-NULL and mixed-type columns are dense JS arrays with
+        // explicit nulls. Numbers in mixed columns use the same conversion
+        // rules as all().
+        if (column.type_mask == kText) {
+          kind = "text";
+        } else if (column.type_mask == kBlob) {
+          kind = "blob";
+        } else if (column.type_mask == 0) {
+          kind = "null";
+        } else {
+          kind = "mixed";
+        }
+
+        Napi::Array array = column.objects.IsEmpty()
+                                ? Napi::Array::New(env, row_count)
+                                : column.objects;
+        for (size_t row = 0; row < row_count; row++) {
+          uint32_t index = static_cast<uint32_t>(row);
+          int64_t raw = column.raw[row];
+          switch (column.types[row]) {
+          case SQLITE_NULL:
+            array.Set(index, env.Null());
+            break;
+          case SQLITE_INTEGER:
+            if (use_big_ints_ || raw < JS_MIN_SAFE_INTEGER ||
+                raw > JS_MAX_SAFE_INTEGER) {
+              array.Set(index, Napi::BigInt::New(env, raw));
+            } else {
+              array.Set(index,
+                        Napi::Number::New(env, static_cast<double>(raw)));
+            }
+            break;
+          case SQLITE_FLOAT:
+            array.Set(index, Napi::Number::New(
+                                 env, ColumnarRawToDouble(SQLITE_FLOAT, raw)));
+            break;
+          default:
+            // Text and blob values were stored while stepping
+            break;
+          }
+        }
+        values = array;
+      }
+
+      Napi::Object column_result = Napi::Object::New(env);
+      column_result.Set("name", Napi::String::New(env, name ? name : ""));
+      column_result.Set("kind", Napi::String::New(env, kind));
+      column_result.Set("values", values);
+      column_result.Set("validity", ColumnarValidity(env, column.types));
+      column_results.Set(static_cast<uint32_t>(i), column_result);
+
+      // Release the native accumulator as soon as the column is converted
+      std::vector<uint8_t>().swap(column.types);
+      std::vector<int64_t>().swap(column.raw);
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("rowCount",
+               Napi::Number::New(env, static_cast<double>(row_count)));
+    result.Set("columns", column_results);
+    return result;
+  } catch (const std::exception &e) {
+    node::THROW_ERR_SQLITE_ERROR(env, e.what());
+    return env.Undefined();
+  }
+}
+
+Napi::Value StatementSync::Iterate(const Napi::CallbackInfo &info) {
+  if (!ValidateIdle(info.Env())) {
+    return info.Env().Undefined();
+  }
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(info.Env(), "statement has been finalized");
+    return info.Env().Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(info.Env(), "Database connection is closed");
+    return info.Env().Undefined();
+  }
+
+  if (!statement_) {
+    node::THROW_ERR_INVALID_STATE(info.Env(),
+                                  "Statement is not properly initialized");
+    return info.Env().Undefined();
+  }
+
+  // Reset the statement first
+  int r = sqlite3_reset(statement_);
+  if (r != SQLITE_OK) {
+    node::THROW_ERR_SQLITE_ERROR(info.Env(),
+                                 sqlite3_errmsg(database_->connection()));
+    return info.Env().Undefined();
+  }
+
+  // Bind parameters if provided
+  BindParameters(info, 0);
+
+  // Create and return iterator
+  return StatementSyncIterator::Create(info.Env(), this);
+}
+
+Napi::Value StatementSync::FinalizeStatement(const Napi::CallbackInfo &info) {
+  if (!ValidateIdle(info.Env())) {
+    return info.Env().Undefined();
+  }
+
+  Finalize();
+  return info.Env().Undefined();
+}
+
+void StatementSync::Finalize() {
+  if (statement_ && !finalized_) {
+    // It's safe to finalize even if database is closed
+    // SQLite handles this gracefully
+    sqlite3_finalize(statement_);
+    statement_ = nullptr;
+    finalized_ = true;
+    ClearColumnKeys();
+    ClearBindings();
+  }
+}
+
+Napi::Value StatementSync::SourceSQLGetter(const Napi::CallbackInfo &info) {
+  return Napi::String::New(info.Env(), source_sql_);
+}
+
+Napi::Value StatementSync::ExpandedSQLGetter(const Napi::CallbackInfo &info) {
+  if (!ValidateIdle(info.Env())) {
+    return info.Env().Undefined();
+  }
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(info.Env(), "Statement has been finalized");
+    return info.Env().Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(info.Env(), "Database connection is closed");
+    return info.Env().Undefined();
+  }
+
+  if (statement_) {
+    char *expanded = sqlite3_expanded_sql(statement_);
+    if (expanded) {
+      Napi::String result = Napi::String::New(info.Env(), expanded);
+      sqlite3_free(expanded);
+      return result;
+    }
+  }
+  return info.Env().Undefined();
+}
+
+Napi::Value StatementSync::SetReadBigInts(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "The statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (info.Length() < 1 || !info[0].IsBoolean()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"readBigInts\" argument must be a boolean.");
+    return env.Undefined();
+  }
+
+  use_big_ints_ = info[0].As<Napi::Boolean>().Value();
+  return env.Undefined();
+}
+
+Napi::Value StatementSync::SetReturnArrays(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "The statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (info.Length() < 1 || !info[0].IsBoolean()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"returnArrays\" argument must be a boolean.");
+    return env.Undefined();
+  }
+
+  return_arrays_ = info[0].As<Napi::Boolean>().Value();
+  return env.Undefined();
+}
+
+Napi::Value
+StatementSync::SetAllowBareNamedParameters(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "The statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (info.Length() < 1 || !info[0].IsBoolean()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"allowBareNamedParameters\" argument must be a boolean.");
+    return env.Undefined();
+  }
+
+  allow_bare_named_params_ = info[0].As<Napi::Boolean>().Value();
+  return env.Undefined();
+}
+
+Napi::Value StatementSync::SetQueryLimits(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "The statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (info.Length() < 1 || info[0].IsUndefined() || info[0].IsNull()) {
+    query_limits_.reset();
+    return env.Undefined();
+  }
+
+  if (!info[0].IsObject()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"limits\" argument must be an object.");
+    return env.Undefined();
+  }
+
+  // Limits that are not given keep the connection's value
+  QueryLimits limits = database_->query_limits();
+  if (!ParseQueryLimits(env, info[0].As<Napi::Object>(), &limits)) {
+    return env.Undefined();
+  }
+  query_limits_ = limits;
+  return env.Undefined();
+}
+
+Napi::Value StatementSync::Status(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateThread(env)) {
+    return env.Undefined();
+  }
+
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (finalized_ || !statement_) {
+    node::THROW_ERR_INVALID_STATE(env, "The statement has been finalized");
+    return env.Undefined();
+  }
+
+  bool reset = false;
+  if (!ParseResetOption(env, info[0], &reset)) {
+    return env.Undefined();
+  }
+
+  return ReadStatementCounters(env, statement_, reset);
+}
+
+Napi::Value StatementSync::ScanStatus(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateThread(env)) {
+    return env.Undefined();
+  }
+
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (finalized_ || !statement_) {
+    node::THROW_ERR_INVALID_STATE(env, "The statement has been finalized");
+    return env.Undefined();
+  }
+
+  bool reset = false;
+  if (!ParseResetOption(env, info[0], &reset)) {
+    return env.Undefined();
+  }
+
+  // One entry per query plan loop, in the order of the EXPLAIN QUERY PLAN
+  // output. SQLite reports an error for the first index past the last loop.
+  Napi::Array loops = Napi::Array::New(env);
+  for (int index = 0;; index++) {
+    sqlite3_int64 loop_count = 0;
+    if (sqlite3_stmt_scanstatus_v2(statement_, index, SQLITE_SCANSTAT_NLOOP,
+                                   0, &loop_count) != 0) {
+      break;
+    }
+    sqlite3_int64 rows_visited = 0;
+    sqlite3_int64 cycles = 0;
+    double estimated_rows = 0;
+    const char *name = nullptr;
+    const char *explain = nullptr;
+    int select_id = 0;
+    int parent_id = 0;
+    sqlite3_stmt_scanstatus_v2(statement_, index, SQLITE_SCANSTAT_NVISIT, 0,
+                               &rows_visited);
+    sqlite3_stmt_scanstatus_v2(statement_, index, SQLITE_SCANSTAT_EST, 0,
+                               &estimated_rows);
+    sqlite3_stmt_scanstatus_v2(statement_, index, SQLITE_SCANSTAT_NAME, 0,
+                               &name);
+    sqlite3_stmt_scanstatus_v2(statement_, index, SQLITE_SCANSTAT_EXPLAIN, 0,
+                               &explain);
+    sqlite3_stmt_scanstatus_v2(statement_, index, SQLITE_SCANSTAT_SELECTID,
+                               0, &select_id);
+    sqlite3_stmt_scanstatus_v2(statement_, index, SQLITE_SCANSTAT_PARENTID,
+                               0, &parent_id);
+    sqlite3_stmt_scanstatus_v2(statement_, index, SQLITE_SCANSTAT_NCYCLE, 0,
+                               &cycles);
+
+    Napi::Object loop = Napi::Object::New(env);
+    loop.Set("explain", explain ? Napi::Value(Napi::String::New(env, explain))
+                                : env.Null());
+    loop.Set("name",
+             name ? Napi::Value(Napi::String::New(env, name)) : env.Null());
+    loop.Set("selectId", Napi::Number::New(env, select_id));
+    loop.Set("parentId", Napi::Number::New(env, parent_id));
+    loop.Set("loops",
+             Napi::Number::New(env, static_cast<double>(loop_count)));
+    loop.Set("rowsVisited",
+             Napi::Number::New(env, static_cast<double>(rows_visited)));
+    loop.Set("estimatedRows", Napi::Number::New(env, estimated_rows));
+    loop.Set("cycles", Napi::Number::New(env, static_cast<double>(cycles)));
+    loops.Set(static_cast<uint32_t>(index), loop);
+  }
+
+  if (reset) {
+    sqlite3_stmt_scanstatus_reset(statement_);
+  }
+  return loops;
+}
+
+Napi::Value StatementSync::Columns(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (!ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "The statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (!statement_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+    return env.Undefined();
+  }
+
+  int column_count = sqlite3_column_count(statement_);
+  Napi::Array columns = Napi::Array::New(env, column_count);
+
+  for (int i = 0; i < column_count; i++) {
+    Napi::Object column_info = Napi::Object::New(env);
+
+    // column: The original column name (sqlite3_column_origin_name)
+    const char *origin_name = sqlite3_column_origin_name(statement_, i);
+    if (origin_name) {
+      column_info.Set("column", Napi::String::New(env, origin_name));
+    } else {
+      column_info.Set("column", env.Null());
+    }
+
+    // database: The database name (sqlite3_column_database_name)
+    const char *database_name = sqlite3_column_database_name(statement_, i);
+    if (database_name) {
+      column_info.Set("database", Napi::String::New(env, database_name));
+    } else {
+      column_info.Set("database", env.Null());
+    }
+
+    // name: The column name/alias (sqlite3_column_name)
+    const char *column_name = sqlite3_column_name(statement_, i);
+    if (column_name) {
+      column_info.Set("name", Napi::String::New(env, column_name));
+    } else {
+      column_info.Set("name", env.Null());
+    }
+
+    // table: The table name (sqlite3_column_table_name)
+    const char *table_name = sqlite3_column_table_name(statement_, i);
+    if (table_name) {
+      column_info.Set("table", Napi::String::New(env, table_name));
+    } else {
+      column_info.Set("table", env.Null());
+    }
+
+    // type: The declared type (sqlite3_column_decltype)
+    const char *decl_type = sqlite3_column_decltype(statement_, i);
+    if (decl_type) {
+      column_info.Set("type", Napi::String::New(env, decl_type));
+    } else {
+      column_info.Set("type", env.Null());
+    }
+
+    columns.Set(i, column_info);
+  }
+
+  return columns;
+}
+
+template <typename Visit>
+bool StatementSync::VisitNamedParameters(Napi::Env env, Napi::Object obj,
+                                         Visit visit) {
+  if (!named_parameters_.has_value()) {
+    BuildNamedParameterPlan(env);
+  }
+
+  if (allow_bare_named_params_ && !bare_named_param_conflict_.empty()) {
+    node::THROW_ERR_INVALID_STATE(env, bare_named_param_conflict_.c_str());
+    return false;
+  }
+
+  // Walk the precompiled plan: one property load per parameter, using keys
+  // created when the plan was built. Parameters missing from the object are
+  // left unbound, as before.
+  Napi::Array keys = named_parameter_keys_.Value();
+  uint32_t slot = 0;
+  for (const NamedParameter &param : *named_parameters_) {
+    Napi::Value value = obj.Get(keys.Get(slot));
+    bool found = !value.IsUndefined();
+    if (!found && allow_bare_named_params_ && param.has_bare_key) {
+      value = obj.Get(keys.Get(slot + 1));
+      found = !value.IsUndefined();
+    }
+    slot += 2;
+
+    if (found && !visit(param, value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Args>
+void StatementSync::BindParameterList(Napi::Env env, const Args &args,
+                                      size_t start_index, size_t count) {
+  // Safety checks
+  if (finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+    return;
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return;
+  }
+
+  if (!statement_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement is not properly initialized");
+    return;
+  }
+
+  // Start from a clean slate, as Node.js does, so that no parameter is left
+  // pointing at memory from a previous call.
+  ClearBindings();
+
+  // Check if we have a single object for named parameters
+  if (count == start_index + 1 && args[start_index].IsObject() &&
+      !args[start_index].IsBuffer() && !args[start_index].IsArray()) {
+    // Named parameters binding
+    Napi::Object obj = args[start_index].As<Napi::Object>();
+    VisitNamedParameters(
+        env, obj, [this, &env](const NamedParameter &param, Napi::Value value) {
+          try {
+            BindSingleParameter(param.index, value);
+          } catch (const Napi::Error &e) {
+            // Re-throw with parameter info
+            std::string msg =
+                "Error binding parameter '" + param.name + "': " + e.Message();
+            node::THROW_ERR_INVALID_ARG_VALUE(env, msg.c_str());
+            return false;
+          }
+          return true;
+        });
+  } else {
+    // Positional parameters binding
+    for (size_t i = start_index; i < count; i++) {
+      int param_index = static_cast<int>(i - start_index + 1);
+      try {
+        BindSingleParameter(param_index, args[i]);
+      } catch (const Napi::Error &e) {
+        // Re-throw with parameter info
+        std::string msg = "Error binding parameter " +
+                          std::to_string(param_index) + ": " + e.Message();
+        node::THROW_ERR_INVALID_ARG_VALUE(env, msg.c_str());
+        return;
+      }
+    }
+  }
+}
+
+void StatementSync::BindParameters(const Napi::CallbackInfo &info,
+                                   size_t start_index) {
+  BindParameterList(info.Env(), info, start_index, info.Length());
+}
+
+void StatementSync::BuildNamedParameterPlan(Napi::Env env) {
+  named_parameters_.emplace();
+  bare_named_param_conflict_.clear();
+  Napi::Array keys = Napi::Array::New(env);
+  uint32_t slot = 0;
+
+  // Bare name (without the :, @ or $ prefix) -> full name, used only to
+  // detect ambiguous bare names such as ":id" and "$id" in one statement.
+  std::map<std::string, std::string> bare_names;
+  int param_count = sqlite3_bind_parameter_count(statement_);
+
+  // Parameter indexing starts at one
+  for (int i = 1; i <= param_count; ++i) {
+    const char *name = sqlite3_bind_parameter_name(statement_, i);
+    if (name == nullptr) {
+      // Anonymous "?" parameter, only bound positionally
+      continue;
+    }
+
+    NamedParameter param;
+    param.index = i;
+    param.name = name;
+    keys.Set(slot, Napi::String::New(env, name));
+
+    std::string bare_name = std::string(name + 1); // Skip the prefix
+    auto insertion = bare_names.insert({bare_name, param.name});
+    if (insertion.second) {
+      keys.Set(slot + 1, Napi::String::New(env, bare_name));
+      param.has_bare_key = true;
+    } else if (insertion.first->second != param.name &&
+               bare_named_param_conflict_.empty()) {
+      bare_named_param_conflict_ = "Cannot create bare named parameter '" +
+                                   bare_name +
+                                   "' because of conflicting names '" +
+                                   insertion.first->second + "' and '" +
+                                   param.name + "'.";
+    }
+
+    named_parameters_->push_back(std::move(param));
+    slot += 2;
+  }
+  named_parameter_keys_ = Napi::Persistent(keys);
+}
+
+// Integral numbers in the int32 range bind as integers, everything else as a
+// double (NaN binds as NULL).
+void StatementSync::BindNumber(int param_index, double value) {
+  if (value == std::floor(value) && value >= INT32_MIN && value <= INT32_MAX) {
+    sqlite3_bind_int(statement_, param_index, static_cast<int>(value));
+  } else {
+    sqlite3_bind_double(statement_, param_index, value);
+  }
+}
+
+// Binds element `row` of a typed array column using the same rules as
+// BindSingleParameter applies to the equivalent Number or BigInt value.
+void StatementSync::BindTypedArrayElement(int param_index,
+                                          napi_typedarray_type type,
+                                          const uint8_t *data, size_t row) {
+  switch (type) {
+  case napi_int8_array:
+    sqlite3_bind_int(statement_, param_index,
+                     reinterpret_cast<const int8_t *>(data)[row]);
+    break;
+  case napi_uint8_array:
+  case napi_uint8_clamped_array:
+    sqlite3_bind_int(statement_, param_index, data[row]);
+    break;
+  case napi_int16_array:
+    sqlite3_bind_int(statement_, param_index,
+                     reinterpret_cast<const int16_t *>(data)[row]);
+    break;
+  case napi_uint16_array:
+    sqlite3_bind_int(statement_, param_index,
+                     reinterpret_cast<const uint16_t *>(data)[row]);
+    break;
+  case napi_int32_array:
+    sqlite3_bind_int(statement_, param_index,
+                     reinterpret_cast<const int32_t *>(data)[row]);
+    break;
+  case napi_uint32_array:
+    BindNumber(param_index, reinterpret_cast<const uint32_t *>(data)[row]);
+    break;
+  case napi_float32_array:
+    BindNumber(param_index, reinterpret_cast<const float *>(data)[row]);
+    break;
+  case napi_float64_array:
+    BindNumber(param_index, reinterpret_cast<const double *>(data)[row]);
+    break;
+  case napi_bigint64_array:
+    sqlite3_bind_int64(statement_, param_index,
+                       reinterpret_cast<const int64_t *>(data)[row]);
+    break;
+  case napi_biguint64_array: {
+    uint64_t value = reinterpret_cast<const uint64_t *>(data)[row];
+    if (value <= static_cast<uint64_t>(INT64_MAX)) {
+      sqlite3_bind_int64(statement_, param_index,
+                         static_cast<sqlite3_int64>(value));
+    } else {
+      // Too large for int64, bind as text like an oversized BigInt
+      std::string text = std::to_string(value);
+      sqlite3_bind_text(statement_, param_index, text.c_str(), -1,
+                        SQLITE_TRANSIENT);
+    }
+    break;
+  }
+  default:
+    sqlite3_bind_null(statement_, param_index);
+    break;
+  }
+}
+
+void StatementSync::BindSingleParameter(int param_index, Napi::Value param) {
+  // Safety check - statement_ should be valid if we got here
+  if (!statement_ || finalized_) {
+    return; // Silent return since error was already thrown by caller
+  }
+
+  try {
+    if (param.IsNull() || param.IsUndefined()) {
+      sqlite3_bind_null(statement_, param_index);
+    } else if (param.IsBigInt()) {
+      // Handle BigInt before IsNumber since BigInt values should bind as int64
+      bool lossless;
+      int64_t bigint_val = param.As<Napi::BigInt>().Int64Value(&lossless);
+      if (lossless) {
+        sqlite3_bind_int64(statement_, param_index,
+                           static_cast<sqlite3_int64>(bigint_val));
+      } else {
+        // BigInt too large, convert to text
+        std::string bigint_str =
+            param.As<Napi::BigInt>().ToString().Utf8Value();
+        sqlite3_bind_text(statement_, param_index, bigint_str.c_str(), -1,
+                          SQLITE_TRANSIENT);
+      }
+    } else if (param.IsNumber()) {
+      BindNumber(param_index, param.As<Napi::Number>().DoubleValue());
+    } else if (param.IsString()) {
+      BindText(param_index, param);
+    } else if (param.IsBoolean()) {
+      sqlite3_bind_int(statement_, param_index,
+                       param.As<Napi::Boolean>().Value() ? 1 : 0);
+    } else if (param.IsBuffer()) {
+      // Copied into the arena: JavaScript can detach or modify the Buffer
+      // while the bindings are live, from a user function inside
+      // sqlite3_step() or between two calls to an iterator's next().
+      Napi::Buffer<uint8_t> buffer = param.As<Napi::Buffer<uint8_t>>();
+      char *data = bind_arena_.Allocate(buffer.Length());
+      if (buffer.Length() > 0) {
+        std::memcpy(data, buffer.Data(), buffer.Length());
+      }
+      sqlite3_bind_blob64(statement_, param_index, data,
+                          static_cast<sqlite3_uint64>(buffer.Length()),
+                          SQLITE_STATIC);
+    } else if (param.IsFunction()) {
+      // Functions cannot be stored in SQLite - bind as NULL
+      sqlite3_bind_null(statement_, param_index);
+    } else if (param.IsObject()) {
+      // Try to convert object to string
+      BindText(param_index, param.ToString());
+    } else {
+      // For any other type, bind as NULL
+      sqlite3_bind_null(statement_, param_index);
+    }
+  } catch (const Napi::Error &e) {
+    // Re-throw Napi errors
+    throw;
+  } catch (const std::exception &e) {
+    // Convert standard exceptions to Napi errors
+    throw Napi::Error::New(Env(), e.what());
+  }
+}
+
+Napi::Value StatementSync::ColumnToValue(int column) {
+  Napi::Env env = Env();
+
+  switch (sqlite3_column_type(statement_, column)) {
+  case SQLITE_INTEGER: {
+    sqlite3_int64 int_val = sqlite3_column_int64(statement_, column);
+    if (use_big_ints_) {
+      // Always return BigInt when readBigInts is true
+      return Napi::BigInt::New(env, static_cast<int64_t>(int_val));
+    } else if (int_val > JS_MAX_SAFE_INTEGER || int_val < JS_MIN_SAFE_INTEGER) {
+      // Return BigInt for values outside JavaScript's safe integer range
+      return Napi::BigInt::New(env, static_cast<int64_t>(int_val));
+    }
+    return Napi::Number::New(env, static_cast<double>(int_val));
+  }
+  case SQLITE_FLOAT:
+    return Napi::Number::New(env, sqlite3_column_double(statement_, column));
+  case SQLITE_TEXT: {
+    const char *text =
+        reinterpret_cast<const char *>(sqlite3_column_text(statement_, column));
+    int text_size = sqlite3_column_bytes(statement_, column);
+    return Napi::String::New(env, text, static_cast<size_t>(text_size));
+  }
+  case SQLITE_BLOB: {
+    const void *blob_data = sqlite3_column_blob(statement_, column);
+    int blob_size = sqlite3_column_bytes(statement_, column);
+    return Napi::Buffer<uint8_t>::Copy(
+        env, static_cast<const uint8_t *>(blob_data), blob_size);
+  }
+  case SQLITE_NULL:
+  default:
+    return env.Null();
+  }
+}
+
+void StatementSync::ResolveColumnKeys(std::vector<napi_value> &keys) {
+  // SQLite transparently re-prepares a statement on the first step after a
+  // schema change, which may rename, add or drop result columns. The
+  // REPREPARE counter is the only signal we get, so the key cache is keyed
+  // on it rather than rebuilt per call.
+  int reprepare_count =
+      sqlite3_stmt_status(statement_, SQLITE_STMTSTATUS_REPREPARE, 0);
+  int column_count = sqlite3_column_count(statement_);
+
+  if (!column_keys_valid_ || column_keys_reprepare_ != reprepare_count ||
+      column_key_count_ != static_cast<uint32_t>(column_count)) {
+    Napi::Env env = Env();
+    Napi::Array names = Napi::Array::New(env, column_count);
+    for (int i = 0; i < column_count; i++) {
+      const char *column_name = sqlite3_column_name(statement_, i);
+      // Created once per prepare; V8 internalizes the string the first time
+      // it is used as a property key, so later rows reuse the same key.
+      names.Set(static_cast<uint32_t>(i),
+                Napi::String::New(env, column_name ? column_name : ""));
+    }
+    column_keys_ = Napi::Persistent(names);
+    column_key_count_ = static_cast<uint32_t>(column_count);
+    column_keys_reprepare_ = reprepare_count;
+    column_keys_valid_ = true;
+  }
+
+  Napi::Array names = column_keys_.Value();
+  keys.resize(column_key_count_);
+  for (uint32_t i = 0; i < column_key_count_; i++) {
+    keys[i] = names.Get(i);
+  }
+}
+
+void StatementSync::ClearColumnKeys() {
+  column_keys_.Reset();
+  column_key_count_ = 0;
+  column_keys_valid_ = false;
+  row_properties_.clear();
+}
+
+Napi::Value StatementSync::CreateResult(const std::vector<napi_value> *keys) {
+  Napi::Env env = Env();
+
+  // Safety checks
+  if (!statement_ || finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  int column_count = sqlite3_column_count(statement_);
+
+  if (return_arrays_) {
+    // Return result as array when returnArrays is true
+    Napi::Array result = Napi::Array::New(env, column_count);
+
+    for (int i = 0; i < column_count; i++) {
+      result.Set(i, ColumnToValue(i));
+    }
+
+    return result;
+  }
+
+  // Return result as object (default behavior). Callers that materialize many
+  // rows resolve the column keys once and pass them in; single-row callers
+  // resolve them here.
+  std::vector<napi_value> local_keys;
+  if (keys == nullptr || keys->size() != static_cast<size_t>(column_count)) {
+    ResolveColumnKeys(local_keys);
+    keys = &local_keys;
+  }
+
+  row_properties_.resize(column_count);
+  for (int i = 0; i < column_count; i++) {
+    napi_property_descriptor &prop = row_properties_[i];
+    prop = {};
+    prop.name = (*keys)[i];
+    prop.value = ColumnToValue(i);
+    prop.attributes = napi_default_jsproperty;
+  }
+
+  // Defining every column in one call (in the same order, with the same keys)
+  // gives all rows of a statement the same hidden class.
+  Napi::Object result = Napi::Object::New(env);
+  napi_status status = napi_define_properties(
+      env, result, row_properties_.size(), row_properties_.data());
+  if (status != napi_ok) {
+    throw Napi::Error::New(env);
+  }
+
+  return result;
+}
+
+void StatementSync::Reset() {
+  // Safety check
+  if (!statement_ || finalized_) {
+    return; // Silent return, error should have been caught earlier
+  }
+
+  sqlite3_reset(statement_);
+  ClearBindings();
+}
+
+void StatementSync::ClearBindings() {
+  // Unbind first: text and blob parameters are bound with SQLITE_STATIC and
+  // point into the arena released below.
+  if (statement_ && !finalized_) {
+    sqlite3_clear_bindings(statement_);
+  }
+  bind_arena_.Reset();
+}
+
+void StatementSync::BindText(int param_index, Napi::Value value) {
+  napi_env env = Env();
+
+  // Measure, then transcode straight into the statement's scratch arena. The
+  // arena memory stays valid until ClearBindings(), so SQLite can use it
+  // without making its own copy.
+  size_t length = 0;
+  napi_status status =
+      napi_get_value_string_utf8(env, value, nullptr, 0, &length);
+  if (status != napi_ok) {
+    throw Napi::Error::New(env);
+  }
+
+  char *data = bind_arena_.Allocate(length + 1);
+  status = napi_get_value_string_utf8(env, value, data, length + 1, &length);
+  if (status != napi_ok) {
+    throw Napi::Error::New(env);
+  }
+
+  sqlite3_bind_text64(statement_, param_index, data,
+                      static_cast<sqlite3_uint64>(length), SQLITE_STATIC,
+                      SQLITE_UTF8);
+}
+
+char *BindArena::Allocate(size_t size) {
+  if (blocks_.empty() || blocks_.back().size - blocks_.back().used < size) {
+    Block block;
+    block.size = std::max(size, kBlockSize);
+    block.data.reset(new char[block.size]);
+    blocks_.push_back(std::move(block));
+  }
+
+  Block &block = blocks_.back();
+  char *result = block.data.get() + block.used;
+  block.used += size;
+  return result;
+}
+
+void BindArena::Reset() {
+  // Keep one block for the next set of bindings so steady-state binding does
+  // not allocate, but return oversized blocks to the allocator.
+  size_t keep = blocks_.size();
+  for (size_t i = 0; i < blocks_.size(); i++) {
+    if (blocks_[i].size <= kMaxRetainedSize &&
+        (keep == blocks_.size() || blocks_[i].size > blocks_[keep].size)) {
+      keep = i;
+    }
+  }
+
+  if (keep == blocks_.size()) {
+    blocks_.clear();
+    return;
+  }
+
+  if (blocks_.size() > 1) {
+    Block kept = std::move(blocks_[keep]);
+    blocks_.clear();
+    blocks_.push_back(std::move(kept));
+  }
+  blocks_.back().used = 0;
+}
+
+// ================================
+// StatementSyncIterator Implementation
+// ================================
+
+Napi::Object StatementSyncIterator::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func =
+      DefineClass(env, "StatementSyncIterator",
+                  {InstanceMethod("next", &StatementSyncIterator::Next),
+                   InstanceMethod("nextBatch",
+                                  &StatementSyncIterator::NextBatch),
+                   InstanceMethod("return", &StatementSyncIterator::Return)});
+
+  // Set up Symbol.iterator on the prototype to make it properly iterable
+  Napi::Object prototype = func.Get("prototype").As<Napi::Object>();
+  Napi::Symbol iteratorSymbol = Napi::Symbol::WellKnown(env, "iterator");
+
+  // Add [Symbol.iterator]() { return this; } to make it iterable
+  prototype.Set(iteratorSymbol,
+                Napi::Function::New(env, [](const Napi::CallbackInfo &info) {
+                  return info.This();
+                }));
+
+  // Store constructor in per-instance addon data instead of static variable
+  AddonData *addon_data = GetAddonData(env);
+  if (addon_data) {
+    addon_data->statementSyncIteratorConstructor =
+        Napi::Reference<Napi::Function>::New(func);
+  }
+
+  exports.Set("StatementSyncIterator", func);
+  return exports;
+}
+
+Napi::Object StatementSyncIterator::Create(Napi::Env env, StatementSync *stmt) {
+  AddonData *addon_data = GetAddonData(env);
+  if (!addon_data || addon_data->statementSyncIteratorConstructor.IsEmpty()) {
+    Napi::Error::New(env, "StatementSyncIterator constructor not initialized")
+        .ThrowAsJavaScriptException();
+    return Napi::Object::New(env);
+  }
+  Napi::Object obj = addon_data->statementSyncIteratorConstructor.New({});
+  StatementSyncIterator *iter =
+      Napi::ObjectWrap<StatementSyncIterator>::Unwrap(obj);
+  iter->SetStatement(stmt);
+  return obj;
+}
+
+StatementSyncIterator::StatementSyncIterator(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<StatementSyncIterator>(info), stmt_(nullptr),
+      done_(false) {}
+
+StatementSyncIterator::~StatementSyncIterator() {}
+
+void StatementSyncIterator::SetStatement(StatementSync *stmt) {
+  stmt_ = stmt;
+  done_ = false;
+}
+
+Napi::Value StatementSyncIterator::Next(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (stmt_ && !stmt_->ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (!stmt_ || stmt_->finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!stmt_->database_ || !stmt_->database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  if (done_) {
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("done", true);
+    result.Set("value", env.Null());
+    return result;
+  }
+
+  QueryLimitScope limit_scope(env, stmt_->database_, stmt_->query_limits());
+  int r = sqlite3_step(stmt_->statement_);
+
+  if (r != SQLITE_ROW) {
+    if (r != SQLITE_DONE) {
+      node::THROW_ERR_SQLITE_ERROR(
+          env, sqlite3_errmsg(stmt_->database_->connection()));
+      return env.Undefined();
+    }
+
+    // End of results
+    sqlite3_reset(stmt_->statement_);
+    done_ = true;
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("done", true);
+    result.Set("value", env.Null());
+    return result;
+  }
+
+  // Create row object using existing CreateResult method
+  Napi::Value row_value = stmt_->CreateResult();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("done", false);
+  result.Set("value", row_value);
+  return result;
+}
+
+Napi::Value StatementSyncIterator::NextBatch(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (stmt_ && !stmt_->ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (!stmt_ || stmt_->finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!stmt_->database_ || !stmt_->database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  uint32_t max_rows = kDefaultBatchSize;
+  if (info.Length() > 0 && !info[0].IsUndefined()) {
+    if (!info[0].IsNumber()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"count\" argument must be a number.");
+      return env.Undefined();
+    }
+    double count = info[0].As<Napi::Number>().DoubleValue();
+    if (!(count >= 1) || count > UINT32_MAX || count != std::floor(count)) {
+      node::THROW_ERR_OUT_OF_RANGE(
+          env, "The \"count\" argument must be a positive integer.");
+      return env.Undefined();
+    }
+    max_rows = static_cast<uint32_t>(count);
+  }
+
+  Napi::Array rows = Napi::Array::New(env);
+  if (done_) {
+    return rows;
+  }
+
+  // Step up to max_rows rows in this single native call. The cursor stays
+  // open between calls, so the next call continues where this one stopped.
+  QueryLimitScope limit_scope(env, stmt_->database_, stmt_->query_limits());
+  std::vector<napi_value> keys;
+  uint32_t index = 0;
+  while (index < max_rows) {
+    int r = sqlite3_step(stmt_->statement_);
+
+    if (r == SQLITE_DONE) {
+      sqlite3_reset(stmt_->statement_);
+      done_ = true;
+      break;
+    }
+
+    if (r != SQLITE_ROW) {
+      // A failed step can't be resumed, so end the iteration and release
+      // the statement instead of leaving a halted cursor open
+      sqlite3 *db = stmt_->database_->connection();
+      node::ThrowEnhancedSqliteError(env, db, r, sqlite3_errmsg(db));
+      sqlite3_reset(stmt_->statement_);
+      done_ = true;
+      return env.Undefined();
+    }
+
+    if (keys.empty() && !stmt_->return_arrays_) {
+      stmt_->ResolveColumnKeys(keys);
+    }
+    rows.Set(index++, stmt_->CreateResult(&keys));
+  }
+
+  return rows;
+}
+
+Napi::Value StatementSyncIterator::Return(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (stmt_ && !stmt_->ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (!stmt_ || stmt_->finalized_) {
+    node::THROW_ERR_INVALID_STATE(env, "statement has been finalized");
+    return env.Undefined();
+  }
+
+  if (!stmt_->database_ || !stmt_->database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    return env.Undefined();
+  }
+
+  // Reset the statement and mark as done
+  sqlite3_reset(stmt_->statement_);
+  done_ = true;
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("done", true);
+  result.Set("value", env.Null());
+  return result;
+}
+
+// Session Implementation
+Napi::Object Session::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func =
+      DefineClass(env, "Session",
+                  {InstanceMethod("changeset", &Session::Changeset),
+                   InstanceMethod("patchset", &Session::Patchset),
+                   InstanceMethod("streamChangeset", &Session::StreamChangeset),
+                   InstanceMethod("diff", &Session::Diff),
+                   InstanceMethod("close", &Session::Close)});
+
+  // Store constructor in per-instance addon data instead of static variable
+  AddonData *addon_data = GetAddonData(env);
+  if (addon_data) {
+    addon_data->sessionConstructor = Napi::Reference<Napi::Function>::New(func);
+  }
+
+  exports.Set("Session", func);
+  return exports;
+}
+
+Napi::Object Session::Create(Napi::Env env, DatabaseSync *database,
+                             sqlite3_session *session) {
+  AddonData *addon_data = GetAddonData(env);
+  if (!addon_data || addon_data->sessionConstructor.IsEmpty()) {
+    Napi::Error::New(env, "Session constructor not initialized")
+        .ThrowAsJavaScriptException();
+    return Napi::Object::New(env);
+  }
+  Napi::Object obj = addon_data->sessionConstructor.New({});
+  Session *sess = Napi::ObjectWrap<Session>::Unwrap(obj);
+  sess->SetSession(database, session);
+  return obj;
+}
+
+Session::Session(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<Session>(info), session_(nullptr) {}
+
+Session::~Session() { Delete(); }
+
+void Session::SetSession(DatabaseSync *database, sqlite3_session *session) {
+  database_ = database;
+  session_ = session;
+  if (database_) {
+    query_mutex_ = database_->query_mutex();
+    database_->AddSession(this);
+  }
+}
+
+void Session::Delete() {
+  if (session_ == nullptr)
+    return;
+
+  // Store the session pointer and clear our member immediately
+  // to prevent double-delete
+  sqlite3_session *session_to_delete = session_;
+  session_ = nullptr;
+
+  // Remove ourselves from the database's session list BEFORE deleting
+  // to avoid any potential issues with the database trying to access us
+  DatabaseSync *database = database_;
+  database_ = nullptr;
+
+  if (database) {
+    database->RemoveSession(this);
+  }
+
+  // Now it's safe to delete the SQLite session. GC may finalize a session
+  // while a query of the same connection runs on a worker thread, firing the
+  // pre-update hook that walks the connection's sessions.
+  std::unique_lock<std::mutex> lock;
+  if (query_mutex_) {
+    lock = std::unique_lock<std::mutex>(*query_mutex_);
+  }
+  sqlite3session_delete(session_to_delete);
+}
+
+template <int (*sqliteChangesetFunc)(sqlite3_session *, int *, void **)>
+Napi::Value Session::GenericChangeset(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (database_ && !database_->ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (session_ == nullptr) {
+    node::THROW_ERR_INVALID_STATE(env, "session is not open");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "database is not open");
+    return env.Undefined();
+  }
+
+  int nChangeset = 0;
+  void *pChangeset = nullptr;
+  int r = sqliteChangesetFunc(session_, &nChangeset, &pChangeset);
+
+  if (r != SQLITE_OK) {
+    const char *errMsg = sqlite3_errmsg(database_->connection());
+    Napi::Error::New(env,
+                     std::string("Failed to generate changeset: ") + errMsg)
+        .ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // Changesets can be hundreds of megabytes, so hand SQLite's allocation to
+  // the Buffer rather than copying it
+  return TakeSqliteBuffer(env, pChangeset, static_cast<size_t>(nChangeset));
+}
+
+Napi::Value Session::Changeset(const Napi::CallbackInfo &info) {
+  return GenericChangeset<sqlite3session_changeset>(info);
+}
+
+Napi::Value Session::Patchset(const Napi::CallbackInfo &info) {
+  return GenericChangeset<sqlite3session_patchset>(info);
+}
+
+Napi::Value Session::StreamChangeset(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+  if (session_ == nullptr) {
+    deferred.Reject(Napi::Error::New(env, "session is not open").Value());
+    return deferred.Promise();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    deferred.Reject(Napi::Error::New(env, "database is not open").Value());
+    return deferred.Promise();
+  }
+
+  if (!info[0].IsFunction()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"onChunk\" argument must be a function.");
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
+
+  bool patchset = false;
+  size_t chunk_size = ChangesetStreamJob::kDefaultChunkSize;
+  if (!info[1].IsUndefined()) {
+    if (!info[1].IsObject()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options\" argument must be an object.");
+      deferred.Reject(env.GetAndClearPendingException().Value());
+      return deferred.Promise();
+    }
+    Napi::Object options = info[1].As<Napi::Object>();
+
+    Napi::Value patchset_value = options.Get("patchset");
+    if (!patchset_value.IsUndefined()) {
+      if (!patchset_value.IsBoolean()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.patchset\" argument must be a boolean.");
+        deferred.Reject(env.GetAndClearPendingException().Value());
+        return deferred.Promise();
+      }
+      patchset = patchset_value.As<Napi::Boolean>().Value();
+    }
+
+    Napi::Value size_value = options.Get("chunkSize");
+    if (!size_value.IsUndefined()) {
+      if (!size_value.IsNumber()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.chunkSize\" argument must be a number.");
+        deferred.Reject(env.GetAndClearPendingException().Value());
+        return deferred.Promise();
+      }
+      double size = size_value.As<Napi::Number>().DoubleValue();
+      if (!std::isfinite(size) || size < 1 || size > INT32_MAX) {
+        node::THROW_ERR_OUT_OF_RANGE(
+            env, "The \"options.chunkSize\" argument must be a positive "
+                 "integer.");
+        deferred.Reject(env.GetAndClearPendingException().Value());
+        return deferred.Promise();
+      }
+      chunk_size = static_cast<size_t>(size);
+    }
+  }
+
+  return ChangesetStreamJob::Generate(env, this, patchset, chunk_size,
+                                      info[0].As<Napi::Function>());
+}
+
+Napi::Value Session::Diff(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (database_ && !database_->ValidateIdle(env)) {
+    return env.Undefined();
+  }
+
+  if (session_ == nullptr) {
+    node::THROW_ERR_INVALID_STATE(env, "session is not open");
+    return env.Undefined();
+  }
+
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "database is not open");
+    return env.Undefined();
+  }
+
+  if (!info[0].IsString()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"fromDb\" argument must be a string.");
+    return env.Undefined();
+  }
+  if (!info[1].IsString()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"table\" argument must be a string.");
+    return env.Undefined();
+  }
+  std::string from_db = info[0].As<Napi::String>().Utf8Value();
+  std::string table = info[1].As<Napi::String>().Utf8Value();
 
-    return result;
-  } else {
-    // Return result as object (default behavior)
-    Napi::Object result = Napi::Object::New(env);
+  // Compares the two tables with SQL inside SQLite and records the
+  // differences as changes, attaching the table to the session if needed
+  char *error = nullptr;
+  int r =
+      sqlite3session_diff(session_, from_db.c_str(), table.c_str(), &error);
+  if (r != SQLITE_OK) {
+    std::string message = "Failed to diff table: ";
+    message += error ? error : sqlite3_errstr(r);
+    sqlite3_free(error);
+    node::ThrowEnhancedSqliteError(env, database_->connection(), r, message);
+  }
+  return env.Undefined();
+}
 
-    for (int i = 0; i < column_count; i++) {
-      const char *column_name = sqlite3_column_name(statement_, i);
-      int column_type = sqlite3_column_type(statement_, i);
+Napi::Value Session::Close(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
 
-      Napi::Value value;
+  if (database_ && !database_->ValidateIdle(env)) {
+    return env.Undefined();
+  }
 
-      switch (column_type) {
-      case SQLITE_NULL:
-        value = env.Null();
-        break;
-      case SQLITE_INTEGER: {
-        sqlite3_int64 int_val = sqlite3_column_int64(statement_, i);
-        if (use_big_ints_) {
-          // Always return BigInt when readBigInts is true
-          value = Napi::BigInt::New(env, static_cast<int64_t>(int_val));
-        } else if (int_val > JS_MAX_SAFE_INTEGER ||
-                   int_val < JS_MIN_SAFE_INTEGER) {
-          // Return BigInt for values outside JavaScript's safe integer range
-          value = Napi::BigInt::New(env, static_cast<int64_t>(int_val));
-        } else {
-          value = Napi::Number::New(env, static_cast<double>(int_val));
+  if (session_ == nullptr) {
+    node::THROW_ERR_INVALID_STATE(env, "session is not open");
+    return env.Undefined();
+  }
+
+  Delete();
+  return env.Undefined();
+}
+
+// Static members for tracking active jobs
+std::atomic<int> BackupJob::active_jobs_(0);
+std::mutex BackupJob::active_jobs_mutex_;
+std::set<BackupJob *> BackupJob::active_job_instances_;
+
+// BackupJob Implementation
+BackupJob::BackupJob(Napi::Env env, DatabaseSync *source,
+                     const std::string &destination_path,
+                     const std::string &source_db, const std::string &dest_db,
+                     int pages, Napi::Function progress_func,
+                     Napi::Promise::Deferred deferred,
+                     const BackupPacing &pacing)
+    : Napi::AsyncProgressWorker<BackupProgress>(
+          !progress_func.IsEmpty() && !progress_func.IsUndefined()
+              ? progress_func
+              : Napi::Function::New(env, [](const Napi::CallbackInfo &) {})),
+      source_(source), destination_path_(destination_path),
+      source_db_(source_db), dest_db_(dest_db), pages_(pages),
+      pacing_(pacing), state_(std::make_shared<State>()),
+      deferred_(deferred) {
+  if (!progress_func.IsEmpty() && !progress_func.IsUndefined()) {
+    progress_func_ = Napi::Reference<Napi::Function>::New(progress_func);
+  }
+  active_jobs_++;
+}
+
+BackupJob::~BackupJob() { active_jobs_--; }
+
+void BackupJob::Execute(const ExecutionProgress &progress) {
+  // This method is executed on a worker thread, not the main thread
+  // Note: SQLite backup operations are thread-safe when the source database
+  // is only being read. The backup API creates its own read transaction
+  // and can safely operate across threads.
+  State &state = *state_;
+  using Clock = std::chrono::steady_clock;
+
+  // A paced backup returns from here whenever it has to pause, and the next
+  // job picks up where this one stopped
+  if (state.backup == nullptr) {
+    state.status = sqlite3_open_v2(
+        destination_path_.c_str(), &state.dest,
+        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, nullptr);
+
+    if (state.status != SQLITE_OK) {
+      SetError("Failed to open destination database");
+      return;
+    }
+
+    // Initialize backup
+    state.backup = sqlite3_backup_init(state.dest, dest_db_.c_str(),
+                                       source_->connection(),
+                                       source_db_.c_str());
+
+    if (!state.backup) {
+      SetError("Failed to initialize backup");
+      return;
+    }
+
+    state.started = Clock::now();
+    // If pages_ is negative, use -1 to copy all remaining pages
+    state.step_pages = pages_ < 0 ? -1 : pages_;
+  }
+
+  // Initial page count may be 0 until first step
+  int remaining_pages = sqlite3_backup_remaining(state.backup);
+  const int max_step_pages = pages_ < 0 ? -1 : pages_;
+  pause_ = 0;
+
+  while ((remaining_pages > 0 || state.total_pages == 0) &&
+         state.status == SQLITE_OK) {
+    Clock::time_point step_started = Clock::now();
+    state.status = sqlite3_backup_step(state.backup, state.step_pages);
+    double step_time = std::chrono::duration<double, std::milli>(
+                           Clock::now() - step_started)
+                           .count();
+
+    // Update total pages after first step (when SQLite knows the actual count)
+    if (state.total_pages == 0) {
+      state.total_pages = sqlite3_backup_pagecount(state.backup);
+    }
+    // The first step gave the destination the source's page size
+    if (state.page_size == 0 && state.status != SQLITE_BUSY &&
+        state.status != SQLITE_LOCKED) {
+      state.page_size = ReadPageSize();
+    }
+
+    if (state.status == SQLITE_OK || state.status == SQLITE_DONE) {
+      remaining_pages = sqlite3_backup_remaining(state.backup);
+      int current_page = state.total_pages - remaining_pages;
+      state.backoff = 0;
+
+      // A slow step held the source's lock for too long: shrink the next
+      // one. Fast steps grow it back by an eighth of the configured size.
+      if (pacing_.adaptive && state.step_pages > 0) {
+        if (step_time > pacing_.max_step_time) {
+          state.step_pages = std::max(1, state.step_pages / 2);
+        } else if (step_time < pacing_.max_step_time / 2.0) {
+          state.step_pages =
+              std::min(max_step_pages,
+                       state.step_pages + std::max(1, max_step_pages / 8));
         }
-        break;
       }
-      case SQLITE_FLOAT:
-        value = Napi::Number::New(env, sqlite3_column_double(statement_, i));
-        break;
-      case SQLITE_TEXT: {
-        const unsigned char *text = sqlite3_column_text(statement_, i);
-        value = Napi::String::New(env, reinterpret_cast<const char *>(text));
-        break;
+
+      // Send progress update to main thread
+      if (!progress_func_.IsEmpty() && state.total_pages > 0) {
+        double elapsed =
+            std::chrono::duration<double>(Clock::now() - state.started)
+                .count();
+        double pages_per_second = elapsed > 0 ? current_page / elapsed : 0;
+        BackupProgress prog = {current_page, state.total_pages,
+                               pages_per_second,
+                               pages_per_second * state.page_size,
+                               state.step_pages};
+        progress.Send(&prog, 1);
       }
-      case SQLITE_BLOB: {
-        const void *blob_data = sqlite3_column_blob(statement_, i);
-        int blob_size = sqlite3_column_bytes(statement_, i);
-        value = Napi::Buffer<uint8_t>::Copy(
-            env, static_cast<const uint8_t *>(blob_data), blob_size);
+
+      // Check if we're done
+      if (state.status == SQLITE_DONE) {
         break;
       }
-      default:
-        value = env.Null();
-        break;
+      pause_ = PauseTime(current_page);
+      if (pause_ > 0) {
+        return;
+      }
+    } else if (state.status == SQLITE_BUSY || state.status == SQLITE_LOCKED) {
+      // These are retryable errors - continue
+      state.status = SQLITE_OK;
+      if (pacing_.adaptive) {
+        // Writers are active: back off exponentially with smaller steps
+        if (state.step_pages > 1) {
+          state.step_pages /= 2;
+        }
+        state.backoff = std::min(std::max(1, state.backoff * 2),
+                                 BackupPacing::kMaxBackoff);
+        pause_ = state.backoff;
+        return;
       }
+    } else {
+      // Fatal error
+      break;
+    }
+  }
+
+  // Store final status for use in OnOK/OnError
+  if (state.status != SQLITE_DONE) {
+    std::string error = "Backup failed with SQLite error: ";
+    error += sqlite3_errmsg(state.dest);
+    SetError(error);
+  }
+}
 
-      result.Set(column_name, value);
+double BackupJob::PauseTime(int copied) const {
+  double delay = pacing_.sleep;
+
+  double rate = pacing_.pages_per_second;
+  if (pacing_.bytes_per_second > 0 && state_->page_size > 0) {
+    double byte_rate = pacing_.bytes_per_second / state_->page_size;
+    rate = rate > 0 ? std::min(rate, byte_rate) : byte_rate;
+  }
+  if (rate > 0) {
+    // Wait out whatever time the copy is ahead of the target rate
+    double elapsed = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - state_->started)
+                         .count();
+    delay = std::max(delay, copied * 1000.0 / rate - elapsed);
+  }
+  return delay;
+}
+
+void BackupJob::Resume() {
+  // Runs on the main thread. A JavaScript timer keeps the event loop alive
+  // through the pause, without holding a libuv pool thread.
+  Napi::Env env = Env();
+  BackupJob *next = new BackupJob(
+      env, source_, destination_path_, source_db_, dest_db_, pages_,
+      progress_func_.IsEmpty() ? Napi::Function() : progress_func_.Value(),
+      deferred_, pacing_);
+  next->state_ = state_;
+
+  Napi::Function set_timeout =
+      env.Global().Get("setTimeout").As<Napi::Function>();
+  set_timeout.Call(
+      {Napi::Function::New(env,
+                           [next](const Napi::CallbackInfo &) {
+                             // AsyncWorker deletes itself when complete
+                             next->Queue();
+                           }),
+       Napi::Number::New(env, pause_)});
+}
+
+int BackupJob::ReadPageSize() {
+  std::string sql = "PRAGMA \"";
+  for (char c : dest_db_) {
+    sql += c == '"' ? std::string("\"\"") : std::string(1, c);
+  }
+  sql += "\".page_size";
+
+  int page_size = 0;
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v2(state_->dest, sql.c_str(), -1, &stmt, nullptr) ==
+          SQLITE_OK &&
+      sqlite3_step(stmt) == SQLITE_ROW) {
+    page_size = sqlite3_column_int(stmt, 0);
+  }
+  sqlite3_finalize(stmt);
+  return page_size;
+}
+
+void BackupJob::OnProgress(const BackupProgress *data, size_t count) {
+  // This runs on the main thread
+  if (!progress_func_.IsEmpty() && count > 0) {
+    Napi::HandleScope scope(Env());
+    Napi::Function progress_fn = progress_func_.Value();
+    Napi::Object progress_info = Napi::Object::New(Env());
+    progress_info.Set("totalPages", Napi::Number::New(Env(), data->total));
+    progress_info.Set("remainingPages",
+                      Napi::Number::New(Env(), data->total - data->current));
+    progress_info.Set("pagesPerSecond",
+                      Napi::Number::New(Env(), data->pages_per_second));
+    if (data->bytes_per_second > 0) {
+      progress_info.Set("bytesPerSecond",
+                        Napi::Number::New(Env(), data->bytes_per_second));
     }
+    progress_info.Set("stepPages", Napi::Number::New(Env(), data->step_pages));
 
-    return result;
+    try {
+      progress_fn.Call(Env().Null(), {progress_info});
+    } catch (...) {
+      // Ignore errors in progress callback
+    }
   }
 }
 
-void StatementSync::Reset() {
-  // Safety check
-  if (!statement_ || finalized_) {
-    return; // Silent return, error should have been caught earlier
+void BackupJob::OnOK() {
+  // This runs on the main thread after Execute completes successfully
+  Napi::HandleScope scope(Env());
+
+  // Execute() paused a paced backup
+  if (state_->status != SQLITE_DONE) {
+    Resume();
+    return;
   }
 
-  sqlite3_reset(statement_);
-  sqlite3_clear_bindings(statement_);
+  // Cleanup SQLite resources
+  Cleanup();
+
+  // Resolve the promise with the total number of pages
+  deferred_.Resolve(Napi::Number::New(Env(), state_->total_pages));
 }
 
-// ================================
-// StatementSyncIterator Implementation
-// ================================
+void BackupJob::OnError(const Napi::Error &error) {
+  // This runs on the main thread if Execute encounters an error
+  Napi::HandleScope scope(Env());
 
-Napi::Object StatementSyncIterator::Init(Napi::Env env, Napi::Object exports) {
-  Napi::Function func =
-      DefineClass(env, "StatementSyncIterator",
-                  {InstanceMethod("next", &StatementSyncIterator::Next),
-                   InstanceMethod("return", &StatementSyncIterator::Return)});
+  // Cleanup SQLite resources
+  Cleanup();
 
-  // Set up Symbol.iterator on the prototype to make it properly iterable
-  Napi::Object prototype = func.Get("prototype").As<Napi::Object>();
-  Napi::Symbol iteratorSymbol = Napi::Symbol::WellKnown(env, "iterator");
+  // Create a more detailed error if we have SQLite error info
+  if (state_->dest && state_->status != SQLITE_OK) {
+    Napi::Error detailed_error = Napi::Error::New(Env(), error.Message());
+    detailed_error.Set(
+        "code", Napi::String::New(Env(), sqlite3_errstr(state_->status)));
+    detailed_error.Set("errno", Napi::Number::New(Env(), state_->status));
+    deferred_.Reject(detailed_error.Value());
+  } else {
+    deferred_.Reject(error.Value());
+  }
+}
 
-  // Add [Symbol.iterator]() { return this; } to make it iterable
-  prototype.Set(iteratorSymbol,
-                Napi::Function::New(env, [](const Napi::CallbackInfo &info) {
-                  return info.This();
-                }));
+// HandleBackupError method removed - error handling now done in OnError
+
+void BackupJob::Cleanup() {
+  State &state = *state_;
+  if (state.backup) {
+    sqlite3_backup_finish(state.backup);
+    state.backup = nullptr;
+  }
+
+  if (state.dest) {
+    state.status = sqlite3_errcode(state.dest);
+    sqlite3_close_v2(state.dest);
+    state.dest = nullptr;
+  }
+}
+
+// Reads { pagesPerSecond, bytesPerSecond, sleep, adaptive, maxStepTime }.
+// Returns false with a pending exception.
+static bool ParseBackupPacing(Napi::Env env, Napi::Object options,
+                              BackupPacing *pacing) {
+  struct NumberOption {
+    const char *name;
+    double minimum;
+    double *value;
+  };
+  double sleep = pacing->sleep;
+  double max_step_time = pacing->max_step_time;
+  NumberOption numbers[] = {
+      {"pagesPerSecond", 0, &pacing->pages_per_second},
+      {"bytesPerSecond", 0, &pacing->bytes_per_second},
+      {"sleep", 0, &sleep},
+      {"maxStepTime", 1, &max_step_time},
+  };
+  for (const NumberOption &option : numbers) {
+    Napi::Value value = options.Get(option.name);
+    if (value.IsUndefined()) {
+      continue;
+    }
+    std::string name = std::string("The \"options.") + option.name + "\"";
+    if (!value.IsNumber()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, (name + " argument must be a number.").c_str());
+      return false;
+    }
+    double number = value.As<Napi::Number>().DoubleValue();
+    if (!std::isfinite(number) || number < option.minimum ||
+        number > INT32_MAX) {
+      name += option.minimum > 0 ? " argument must be at least 1."
+                                 : " argument must not be negative.";
+      node::THROW_ERR_OUT_OF_RANGE(env, name.c_str());
+      return false;
+    }
+    *option.value = number;
+  }
+  pacing->sleep = static_cast<int>(sleep);
+  pacing->max_step_time = static_cast<int>(max_step_time);
+
+  Napi::Value adaptive = options.Get("adaptive");
+  if (!adaptive.IsUndefined()) {
+    if (!adaptive.IsBoolean()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options.adaptive\" argument must be a boolean.");
+      return false;
+    }
+    pacing->adaptive = adaptive.As<Napi::Boolean>().Value();
+  }
+  return true;
+}
+
+// DatabaseSync::Backup implementation
+Napi::Value DatabaseSync::Backup(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  // Create a promise early for error handling
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+  if (!IsOpen()) {
+    deferred.Reject(Napi::Error::New(env, "database is not open").Value());
+    return deferred.Promise();
+  }
+
+  if (info.Length() < 1) {
+    deferred.Reject(
+        Napi::TypeError::New(env, "The \"destination\" argument is required")
+            .Value());
+    return deferred.Promise();
+  }
+
+  std::optional<std::string> destination_path =
+      ValidateDatabasePath(env, info[0], "destination");
+  if (!destination_path.has_value()) {
+    deferred.Reject(Napi::Error::New(env, "Invalid destination path").Value());
+    return deferred.Promise();
+  }
+
+  // Default options matching Node.js API
+  int rate = 100;
+  std::string source_db = "main";
+  std::string target_db = "main";
+  Napi::Function progress_func;
+  BackupPacing pacing;
+
+  // Parse options if provided
+  if (info.Length() > 1) {
+    if (!info[1].IsObject()) {
+      deferred.Reject(Napi::TypeError::New(
+                          env, "The \"options\" argument must be an object")
+                          .Value());
+      return deferred.Promise();
+    }
+
+    Napi::Object options = info[1].As<Napi::Object>();
+
+    // Get rate option (number of pages per step)
+    Napi::Value rate_value = options.Get("rate");
+    if (!rate_value.IsUndefined()) {
+      if (!rate_value.IsNumber()) {
+        deferred.Reject(
+            Napi::TypeError::New(env, "The \"options.rate\" must be a number")
+                .Value());
+        return deferred.Promise();
+      }
+      rate = rate_value.As<Napi::Number>().Int32Value();
+      // Note: Node.js allows negative values for rate
+    }
+
+    // Get source database option
+    Napi::Value source_value = options.Get("source");
+    if (!source_value.IsUndefined()) {
+      if (!source_value.IsString()) {
+        deferred.Reject(
+            Napi::TypeError::New(env, "The \"options.source\" must be a string")
+                .Value());
+        return deferred.Promise();
+      }
+      source_db = source_value.As<Napi::String>().Utf8Value();
+    }
 
-  // Store constructor in per-instance addon data instead of static variable
-  AddonData *addon_data = GetAddonData(env);
-  if (addon_data) {
-    addon_data->statementSyncIteratorConstructor =
-        Napi::Reference<Napi::Function>::New(func);
-  }
+    // Get target database option
+    Napi::Value target_value = options.Get("target");
+    if (!target_value.IsUndefined()) {
+      if (!target_value.IsString()) {
+        deferred.Reject(
+            Napi::TypeError::New(env, "The \"options.target\" must be a string")
+                .Value());
+        return deferred.Promise();
+      }
+      target_db = target_value.As<Napi::String>().Utf8Value();
+    }
 
-  exports.Set("StatementSyncIterator", func);
-  return exports;
-}
+    // Get progress callback
+    Napi::Value progress_value = options.Get("progress");
+    if (!progress_value.IsUndefined()) {
+      if (!progress_value.IsFunction()) {
+        deferred.Reject(Napi::TypeError::New(
+                            env, "The \"options.progress\" must be a function")
+                            .Value());
+        return deferred.Promise();
+      }
+      progress_func = progress_value.As<Napi::Function>();
+    }
 
-Napi::Object StatementSyncIterator::Create(Napi::Env env, StatementSync *stmt) {
-  AddonData *addon_data = GetAddonData(env);
-  if (!addon_data || addon_data->statementSyncIteratorConstructor.IsEmpty()) {
-    Napi::Error::New(env, "StatementSyncIterator constructor not initialized")
-        .ThrowAsJavaScriptException();
-    return Napi::Object::New(env);
+    if (!ParseBackupPacing(env, options, &pacing)) {
+      deferred.Reject(env.GetAndClearPendingException().Value());
+      return deferred.Promise();
+    }
   }
-  Napi::Object obj = addon_data->statementSyncIteratorConstructor.New({});
-  StatementSyncIterator *iter =
-      Napi::ObjectWrap<StatementSyncIterator>::Unwrap(obj);
-  iter->SetStatement(stmt);
-  return obj;
-}
 
-StatementSyncIterator::StatementSyncIterator(const Napi::CallbackInfo &info)
-    : Napi::ObjectWrap<StatementSyncIterator>(info), stmt_(nullptr),
-      done_(false) {}
+  // Create and schedule backup job
+  BackupJob *job =
+      new BackupJob(env, this, destination_path.value(), source_db, target_db,
+                    rate, progress_func, deferred, pacing);
 
-StatementSyncIterator::~StatementSyncIterator() {}
+  // Queue the async work - AsyncWorker will delete itself when complete
+  job->Queue();
 
-void StatementSyncIterator::SetStatement(StatementSync *stmt) {
-  stmt_ = stmt;
-  done_ = false;
+  return deferred.Promise();
 }
 
-Napi::Value StatementSyncIterator::Next(const Napi::CallbackInfo &info) {
+Napi::Value DatabaseSync::StreamBackup(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
 
-  if (!stmt_ || stmt_->finalized_) {
-    node::THROW_ERR_INVALID_STATE(env, "statement has been finalized");
-    return env.Undefined();
+  if (!ValidateThread(env)) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
   }
 
-  if (!stmt_->database_ || !stmt_->database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
-    return env.Undefined();
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "database is not open");
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
   }
 
-  if (done_) {
-    Napi::Object result = Napi::Object::New(env);
-    result.Set("done", true);
-    result.Set("value", env.Null());
-    return result;
+  // The snapshot would include the uncommitted pages of an open transaction
+  if (!sqlite3_get_autocommit(connection())) {
+    node::THROW_ERR_INVALID_STATE(
+        env, "Cannot stream a backup inside a transaction.");
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
   }
 
-  int r = sqlite3_step(stmt_->statement_);
-
-  if (r != SQLITE_ROW) {
-    if (r != SQLITE_DONE) {
-      node::THROW_ERR_SQLITE_ERROR(
-          env, sqlite3_errmsg(stmt_->database_->connection()));
-      return env.Undefined();
+  // A function receives the chunks; a number is a file descriptor
+  Napi::Function on_chunk;
+  int fd = -1;
+  if (info[0].IsFunction()) {
+    on_chunk = info[0].As<Napi::Function>();
+  } else if (info[0].IsNumber()) {
+    double value = info[0].As<Napi::Number>().DoubleValue();
+    if (value < 0 || value > INT_MAX || value != std::floor(value)) {
+      node::THROW_ERR_OUT_OF_RANGE(
+          env, "The \"destination\" argument must be a valid file "
+               "descriptor.");
+      deferred.Reject(env.GetAndClearPendingException().Value());
+      return deferred.Promise();
     }
-
-    // End of results
-    sqlite3_reset(stmt_->statement_);
-    done_ = true;
-
-    Napi::Object result = Napi::Object::New(env);
-    result.Set("done", true);
-    result.Set("value", env.Null());
-    return result;
+    fd = static_cast<int>(value);
+  } else {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"destination\" argument must be a function or a file "
+             "descriptor.");
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
   }
 
-  // Create row object using existing CreateResult method
-  Napi::Value row_value = stmt_->CreateResult();
-
-  Napi::Object result = Napi::Object::New(env);
-  result.Set("done", false);
-  result.Set("value", row_value);
-  return result;
-}
+  std::string schema = "main";
+  size_t chunk_size = ChangesetStreamJob::kDefaultChunkSize;
+  Napi::Function on_progress;
+  if (!info[1].IsUndefined()) {
+    if (!info[1].IsObject()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options\" argument must be an object.");
+      deferred.Reject(env.GetAndClearPendingException().Value());
+      return deferred.Promise();
+    }
+    Napi::Object options = info[1].As<Napi::Object>();
 
-Napi::Value StatementSyncIterator::Return(const Napi::CallbackInfo &info) {
-  Napi::Env env = info.Env();
+    Napi::Value source_value = options.Get("source");
+    if (!source_value.IsUndefined()) {
+      if (!source_value.IsString()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.source\" argument must be a string.");
+        deferred.Reject(env.GetAndClearPendingException().Value());
+        return deferred.Promise();
+      }
+      schema = source_value.As<Napi::String>().Utf8Value();
+    }
 
-  if (!stmt_ || stmt_->finalized_) {
-    node::THROW_ERR_INVALID_STATE(env, "statement has been finalized");
-    return env.Undefined();
-  }
+    Napi::Value size_value = options.Get("chunkSize");
+    if (!size_value.IsUndefined()) {
+      if (!size_value.IsNumber()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.chunkSize\" argument must be a number.");
+        deferred.Reject(env.GetAndClearPendingException().Value());
+        return deferred.Promise();
+      }
+      double size = size_value.As<Napi::Number>().DoubleValue();
+      if (!std::isfinite(size) || size < 1 || size > INT32_MAX) {
+        node::THROW_ERR_OUT_OF_RANGE(
+            env, "The \"options.chunkSize\" argument must be a positive "
+                 "integer.");
+        deferred.Reject(env.GetAndClearPendingException().Value());
+        return deferred.Promise();
+      }
+      chunk_size = static_cast<size_t>(size);
+    }
 
-  if (!stmt_->database_ || !stmt_->database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
-    return env.Undefined();
+    Napi::Value progress_value = options.Get("progress");
+    if (!progress_value.IsUndefined()) {
+      if (!progress_value.IsFunction()) {
+        node::THROW_ERR_INVALID_ARG_TYPE(
+            env, "The \"options.progress\" argument must be a function.");
+        deferred.Reject(env.GetAndClearPendingException().Value());
+        return deferred.Promise();
+      }
+      on_progress = progress_value.As<Napi::Function>();
+    }
   }
 
-  // Reset the statement and mark as done
-  sqlite3_reset(stmt_->statement_);
-  done_ = true;
-
-  Napi::Object result = Napi::Object::New(env);
-  result.Set("done", true);
-  result.Set("value", env.Null());
-  return result;
+  return ChangesetStreamJob::Snapshot(env, this, schema, chunk_size, on_chunk,
+                                      fd, on_progress);
 }
 
-// Session Implementation
-Napi::Object Session::Init(Napi::Env env, Napi::Object exports) {
-  Napi::Function func =
-      DefineClass(env, "Session",
-                  {InstanceMethod("changeset", &Session::Changeset),
-                   InstanceMethod("patchset", &Session::Patchset),
-                   InstanceMethod("close", &Session::Close)});
+Napi::Value DatabaseSync::VacuumInto(const Napi::CallbackInfo &info) {
+  return MaintenanceJob::Start(info, this, MaintenanceJob::kVacuumInto);
+}
 
-  // Store constructor in per-instance addon data instead of static variable
-  AddonData *addon_data = GetAddonData(env);
-  if (addon_data) {
-    addon_data->sessionConstructor = Napi::Reference<Napi::Function>::New(func);
-  }
+Napi::Value DatabaseSync::IncrementalVacuum(const Napi::CallbackInfo &info) {
+  return MaintenanceJob::Start(info, this, MaintenanceJob::kIncrementalVacuum);
+}
 
-  exports.Set("Session", func);
-  return exports;
+Napi::Value DatabaseSync::Reindex(const Napi::CallbackInfo &info) {
+  return MaintenanceJob::Start(info, this, MaintenanceJob::kReindex);
 }
 
-Napi::Object Session::Create(Napi::Env env, DatabaseSync *database,
-                             sqlite3_session *session) {
-  AddonData *addon_data = GetAddonData(env);
-  if (!addon_data || addon_data->sessionConstructor.IsEmpty()) {
-    Napi::Error::New(env, "Session constructor not initialized")
-        .ThrowAsJavaScriptException();
-    return Napi::Object::New(env);
-  }
-  Napi::Object obj = addon_data->sessionConstructor.New({});
-  Session *sess = Napi::ObjectWrap<Session>::Unwrap(obj);
-  sess->SetSession(database, session);
-  return obj;
+Napi::Value DatabaseSync::Analyze(const Napi::CallbackInfo &info) {
+  return MaintenanceJob::Start(info, this, MaintenanceJob::kAnalyze);
 }
 
-Session::Session(const Napi::CallbackInfo &info)
-    : Napi::ObjectWrap<Session>(info), session_(nullptr) {}
+// Asynchronous query implementation
 
-Session::~Session() { Delete(); }
+void DatabaseSync::EnqueueQuery(QueryJob *job) {
+  EnqueueJob([job]() {
+    job->Start();
+    // AsyncWorker deletes itself when complete
+    job->Queue();
+  });
+}
 
-void Session::SetSession(DatabaseSync *database, sqlite3_session *session) {
-  database_ = database;
-  session_ = session;
-  if (database_) {
-    database_->AddSession(this);
+void DatabaseSync::EnqueueJob(std::function<void()> start) {
+  query_queue_.push_back(std::move(start));
+  if (!query_running_) {
+    StartNextQuery();
   }
 }
 
-void Session::Delete() {
-  if (session_ == nullptr)
+void DatabaseSync::StartNextQuery() {
+  if (query_queue_.empty()) {
     return;
+  }
+  std::function<void()> start = std::move(query_queue_.front());
+  query_queue_.pop_front();
+  query_running_ = true;
+  start();
+}
 
-  // Store the session pointer and clear our member immediately
-  // to prevent double-delete
-  sqlite3_session *session_to_delete = session_;
-  session_ = nullptr;
-
-  // Remove ourselves from the database's session list BEFORE deleting
-  // to avoid any potential issues with the database trying to access us
-  DatabaseSync *database = database_;
-  database_ = nullptr;
+void DatabaseSync::QueryFinished() {
+  query_running_ = false;
+  StartNextQuery();
+}
 
-  if (database) {
-    database->RemoveSession(this);
+bool DatabaseSync::ValidateIdle(Napi::Env env) const {
+  if (!IsIdle()) {
+    node::THROW_ERR_INVALID_STATE(
+        env, "Database connection is busy with an asynchronous query");
+    return false;
   }
-
-  // Now it's safe to delete the SQLite session
-  sqlite3session_delete(session_to_delete);
+  return true;
 }
 
-template <int (*sqliteChangesetFunc)(sqlite3_session *, int *, void **)>
-Napi::Value Session::GenericChangeset(const Napi::CallbackInfo &info) {
+Napi::Value DatabaseSync::ExecAsync(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
+  Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
 
-  if (session_ == nullptr) {
-    node::THROW_ERR_INVALID_STATE(env, "session is not open");
-    return env.Undefined();
+  if (!ValidateThread(env)) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
   }
 
-  if (!database_ || !database_->IsOpen()) {
-    node::THROW_ERR_INVALID_STATE(env, "database is not open");
-    return env.Undefined();
+  if (!IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database is not open");
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
   }
 
-  int nChangeset;
-  void *pChangeset;
-  int r = sqliteChangesetFunc(session_, &nChangeset, &pChangeset);
-
-  if (r != SQLITE_OK) {
-    const char *errMsg = sqlite3_errmsg(database_->connection());
-    Napi::Error::New(env,
-                     std::string("Failed to generate changeset: ") + errMsg)
-        .ThrowAsJavaScriptException();
-    return env.Undefined();
+  if (info.Length() < 1 || !info[0].IsString()) {
+    node::THROW_ERR_INVALID_ARG_TYPE(
+        env, "The \"sql\" argument must be a string.");
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
   }
 
-  // Create a Buffer from the changeset data
-  Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, nChangeset);
-  std::memcpy(buffer.Data(), pChangeset, nChangeset);
-
-  // Free the changeset allocated by SQLite
-  sqlite3_free(pChangeset);
-
-  return buffer;
-}
-
-Napi::Value Session::Changeset(const Napi::CallbackInfo &info) {
-  return GenericChangeset<sqlite3session_changeset>(info);
-}
-
-Napi::Value Session::Patchset(const Napi::CallbackInfo &info) {
-  return GenericChangeset<sqlite3session_patchset>(info);
-}
-
-Napi::Value Session::Close(const Napi::CallbackInfo &info) {
-  Napi::Env env = info.Env();
-
-  if (session_ == nullptr) {
-    node::THROW_ERR_INVALID_STATE(env, "session is not open");
-    return env.Undefined();
+  QueryLimits limits = query_limits_;
+  if (info.Length() > 1 && !info[1].IsUndefined()) {
+    if (!info[1].IsObject()) {
+      node::THROW_ERR_INVALID_ARG_TYPE(
+          env, "The \"options\" argument must be an object.");
+      deferred.Reject(env.GetAndClearPendingException().Value());
+      return deferred.Promise();
+    }
+    if (!ParseQueryLimits(env, info[1].As<Napi::Object>(), &limits)) {
+      deferred.Reject(env.GetAndClearPendingException().Value());
+      return deferred.Promise();
+    }
   }
 
-  Delete();
-  return env.Undefined();
+  EnqueueQuery(new QueryJob(env, this, info[0].As<Napi::String>().Utf8Value(),
+                            limits, deferred));
+  return deferred.Promise();
 }
 
-// Static members for tracking active jobs
-std::atomic<int> BackupJob::active_jobs_(0);
-std::mutex BackupJob::active_jobs_mutex_;
-std::set<BackupJob *> BackupJob::active_job_instances_;
+// Copies a JS value using the same type rules as BindSingleParameter
+static QueryValue MarshalQueryValue(Napi::Value param) {
+  QueryValue value;
+  if (param.IsNull() || param.IsUndefined() || param.IsFunction()) {
+    value.type = SQLITE_NULL;
+  } else if (param.IsBigInt()) {
+    bool lossless;
+    int64_t bigint_val = param.As<Napi::BigInt>().Int64Value(&lossless);
+    if (lossless) {
+      value.type = SQLITE_INTEGER;
+      value.int_value = bigint_val;
+    } else {
+      value.type = SQLITE_TEXT;
+      value.bytes = param.As<Napi::BigInt>().ToString().Utf8Value();
+    }
+  } else if (param.IsNumber()) {
+    double val = param.As<Napi::Number>().DoubleValue();
+    if (val == std::floor(val) && val >= INT32_MIN && val <= INT32_MAX) {
+      value.type = SQLITE_INTEGER;
+      value.int_value = static_cast<int64_t>(val);
+    } else {
+      value.type = SQLITE_FLOAT;
+      value.double_value = val;
+    }
+  } else if (param.IsString()) {
+    value.type = SQLITE_TEXT;
+    value.bytes = param.As<Napi::String>().Utf8Value();
+  } else if (param.IsBoolean()) {
+    value.type = SQLITE_INTEGER;
+    value.int_value = param.As<Napi::Boolean>().Value() ? 1 : 0;
+  } else if (param.IsBuffer()) {
+    Napi::Buffer<uint8_t> buffer = param.As<Napi::Buffer<uint8_t>>();
+    value.type = SQLITE_BLOB;
+    value.bytes.assign(reinterpret_cast<const char *>(buffer.Data()),
+                       buffer.Length());
+  } else if (param.IsObject()) {
+    value.type = SQLITE_TEXT;
+    value.bytes = param.ToString().Utf8Value();
+  }
+  return value;
+}
 
-// BackupJob Implementation
-BackupJob::BackupJob(Napi::Env env, DatabaseSync *source,
-                     const std::string &destination_path,
-                     const std::string &source_db, const std::string &dest_db,
-                     int pages, Napi::Function progress_func,
-                     Napi::Promise::Deferred deferred)
-    : Napi::AsyncProgressWorker<BackupProgress>(
-          !progress_func.IsEmpty() && !progress_func.IsUndefined()
-              ? progress_func
-              : Napi::Function::New(env, [](const Napi::CallbackInfo &) {})),
-      source_(source), destination_path_(destination_path),
-      source_db_(source_db), dest_db_(dest_db), pages_(pages),
-      deferred_(deferred) {
-  if (!progress_func.IsEmpty() && !progress_func.IsUndefined()) {
-    progress_func_ = Napi::Reference<Napi::Function>::New(progress_func);
+void MarshalQueryParameters(const Napi::CallbackInfo &info,
+                            size_t start_index, QueryParameters *parameters) {
+  Napi::Env env = info.Env();
+  size_t count = info.Length();
+  size_t param_index = start_index;
+  try {
+    if (count == start_index + 1 && info[start_index].IsObject() &&
+        !info[start_index].IsBuffer() && !info[start_index].IsArray()) {
+      Napi::Object obj = info[start_index].As<Napi::Object>();
+      Napi::Array names = obj.GetPropertyNames();
+      for (uint32_t i = 0; i < names.Length(); i++) {
+        Napi::Value key = names.Get(i);
+        Napi::Value value = obj.Get(key);
+        if (value.IsUndefined()) {
+          continue;
+        }
+        parameters->named.emplace_back(key.ToString().Utf8Value(),
+                                       MarshalQueryValue(value));
+      }
+    } else {
+      parameters->positional.reserve(count - start_index);
+      for (; param_index < count; param_index++) {
+        parameters->positional.push_back(
+            MarshalQueryValue(info[param_index]));
+      }
+    }
+  } catch (const Napi::Error &e) {
+    std::string msg = "Error binding parameter " +
+                      std::to_string(param_index - start_index + 1) + ": " +
+                      e.Message();
+    Napi::Error error = Napi::Error::New(env, msg);
+    error.Set("code", Napi::String::New(env, "ERR_INVALID_ARG_VALUE"));
+    throw error;
   }
-  active_jobs_++;
 }
 
-BackupJob::~BackupJob() { active_jobs_--; }
-
-void BackupJob::Execute(const ExecutionProgress &progress) {
-  // This method is executed on a worker thread, not the main thread
-  // Note: SQLite backup operations are thread-safe when the source database
-  // is only being read. The backup API creates its own read transaction
-  // and can safely operate across threads.
-
-  backup_status_ = sqlite3_open_v2(
-      destination_path_.c_str(), &dest_,
-      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, nullptr);
+bool BindQueryParameters(sqlite3_stmt *stmt, const QueryParameters &parameters,
+                         int *result_code, std::string *error) {
+  // Values are owned by `parameters`, which must outlive the bindings
+  auto bind = [stmt](int index, const QueryValue &value) {
+    switch (value.type) {
+    case SQLITE_INTEGER:
+      return sqlite3_bind_int64(stmt, index, value.int_value);
+    case SQLITE_FLOAT:
+      return sqlite3_bind_double(stmt, index, value.double_value);
+    case SQLITE_TEXT:
+      return sqlite3_bind_text64(stmt, index, value.bytes.data(),
+                                 value.bytes.size(), SQLITE_STATIC,
+                                 SQLITE_UTF8);
+    case SQLITE_BLOB:
+      return sqlite3_bind_blob64(stmt, index, value.bytes.data(),
+                                 value.bytes.size(), SQLITE_STATIC);
+    default:
+      return sqlite3_bind_null(stmt, index);
+    }
+  };
 
-  if (backup_status_ != SQLITE_OK) {
-    SetError("Failed to open destination database");
-    return;
+  for (size_t i = 0; i < parameters.positional.size(); i++) {
+    int r = bind(static_cast<int>(i + 1), parameters.positional[i]);
+    if (r != SQLITE_OK) {
+      *result_code = r;
+      return false;
+    }
   }
 
-  // Initialize backup
-  backup_ = sqlite3_backup_init(dest_, dest_db_.c_str(), source_->connection(),
-                                source_db_.c_str());
-
-  if (!backup_) {
-    SetError("Failed to initialize backup");
-    return;
+  for (const auto &entry : parameters.indexed) {
+    int r = bind(entry.first, entry.second);
+    if (r != SQLITE_OK) {
+      *result_code = r;
+      return false;
+    }
   }
 
-  // Initial page count may be 0 until first step
-  int remaining_pages = sqlite3_backup_remaining(backup_);
-  total_pages_ = 0; // Will be updated after first step
+  // Bare names are bound first so that a prefixed name for the same
+  // parameter takes precedence, as it does for synchronous calls
+  for (int pass = 0; pass < 2; pass++) {
+    for (const auto &entry : parameters.named) {
+      const std::string &name = entry.first;
+      bool prefixed =
+          !name.empty() && (name[0] == ':' || name[0] == '$' || name[0] == '@');
+      if (prefixed != (pass == 1)) {
+        continue;
+      }
 
-  while ((remaining_pages > 0 || total_pages_ == 0) &&
-         backup_status_ == SQLITE_OK) {
-    // If pages_ is negative, use -1 to copy all remaining pages
-    int pages_to_copy = pages_ < 0 ? -1 : pages_;
-    backup_status_ = sqlite3_backup_step(backup_, pages_to_copy);
+      int index = 0;
+      if (prefixed) {
+        index = sqlite3_bind_parameter_index(stmt, name.c_str());
+      } else if (parameters.allow_bare_names) {
+        std::string matched;
+        for (char prefix : {':', '$', '@'}) {
+          std::string full_name = prefix + name;
+          int candidate = sqlite3_bind_parameter_index(stmt, full_name.c_str());
+          if (candidate == 0) {
+            continue;
+          }
+          if (index != 0) {
+            *error = "Cannot create bare named parameter '" + name +
+                     "' because of conflicting names '" + matched + "' and '" +
+                     full_name + "'.";
+            return false;
+          }
+          index = candidate;
+          matched = full_name;
+        }
+      }
 
-    // Update total pages after first step (when SQLite knows the actual count)
-    if (total_pages_ == 0) {
-      total_pages_ = sqlite3_backup_pagecount(backup_);
+      if (index == 0) {
+        continue;
+      }
+
+      int r = bind(index, entry.second);
+      if (r != SQLITE_OK) {
+        *result_code = r;
+        return false;
+      }
     }
+  }
+  return true;
+}
 
-    if (backup_status_ == SQLITE_OK || backup_status_ == SQLITE_DONE) {
-      remaining_pages = sqlite3_backup_remaining(backup_);
-      int current_page = total_pages_ - remaining_pages;
+int StepQuery(sqlite3_stmt *stmt, size_t max_rows,
+              std::vector<std::string> *column_names,
+              std::vector<QueryValue> *cells) {
+  int column_count = 0;
+  size_t row_count = 0;
+  int r;
+  while ((r = sqlite3_step(stmt)) == SQLITE_ROW) {
+    // Like run() and get(), stop stepping once enough rows have been read
+    if (max_rows == 0) {
+      return SQLITE_DONE;
+    }
 
-      // Send progress update to main thread
-      if (!progress_func_.IsEmpty() && total_pages_ > 0) {
-        BackupProgress prog = {current_page, total_pages_};
-        progress.Send(&prog, 1);
+    if (column_names->empty()) {
+      column_count = sqlite3_column_count(stmt);
+      column_names->reserve(column_count);
+      for (int i = 0; i < column_count; i++) {
+        const char *name = sqlite3_column_name(stmt, i);
+        column_names->emplace_back(name ? name : "");
       }
+    }
 
-      // Check if we're done
-      if (backup_status_ == SQLITE_DONE) {
+    for (int i = 0; i < column_count; i++) {
+      QueryValue cell;
+      cell.type = sqlite3_column_type(stmt, i);
+      switch (cell.type) {
+      case SQLITE_INTEGER:
+        cell.int_value = sqlite3_column_int64(stmt, i);
+        break;
+      case SQLITE_FLOAT:
+        cell.double_value = sqlite3_column_double(stmt, i);
+        break;
+      case SQLITE_TEXT:
+      case SQLITE_BLOB: {
+        const char *data =
+            cell.type == SQLITE_TEXT
+                ? reinterpret_cast<const char *>(sqlite3_column_text(stmt, i))
+                : static_cast<const char *>(sqlite3_column_blob(stmt, i));
+        int size = sqlite3_column_bytes(stmt, i);
+        if (data != nullptr) {
+          cell.bytes.assign(data, static_cast<size_t>(size));
+        }
         break;
       }
-    } else if (backup_status_ == SQLITE_BUSY ||
-               backup_status_ == SQLITE_LOCKED) {
-      // These are retryable errors - continue
-      backup_status_ = SQLITE_OK;
-    } else {
-      // Fatal error
-      break;
+      default:
+        break;
+      }
+      cells->push_back(std::move(cell));
     }
-  }
 
-  // Store final status for use in OnOK/OnError
-  if (backup_status_ != SQLITE_DONE) {
-    std::string error = "Backup failed with SQLite error: ";
-    error += sqlite3_errmsg(dest_);
-    SetError(error);
+    if (++row_count == max_rows) {
+      return SQLITE_DONE;
+    }
   }
+  return r;
 }
 
-void BackupJob::OnProgress(const BackupProgress *data, size_t count) {
-  // This runs on the main thread
-  if (!progress_func_.IsEmpty() && count > 0) {
-    Napi::HandleScope scope(Env());
-    Napi::Function progress_fn = progress_func_.Value();
-    Napi::Object progress_info = Napi::Object::New(Env());
-    progress_info.Set("totalPages", Napi::Number::New(Env(), data->total));
-    progress_info.Set("remainingPages",
-                      Napi::Number::New(Env(), data->total - data->current));
-
-    try {
-      progress_fn.Call(Env().Null(), {progress_info});
-    } catch (...) {
-      // Ignore errors in progress callback
+// Mirrors StatementSync::ColumnToValue
+static Napi::Value QueryValueToJS(Napi::Env env, const QueryValue &cell,
+                                  bool use_big_ints) {
+  switch (cell.type) {
+  case SQLITE_INTEGER:
+    if (use_big_ints || cell.int_value > JS_MAX_SAFE_INTEGER ||
+        cell.int_value < JS_MIN_SAFE_INTEGER) {
+      return Napi::BigInt::New(env, cell.int_value);
     }
+    return Napi::Number::New(env, static_cast<double>(cell.int_value));
+  case SQLITE_FLOAT:
+    return Napi::Number::New(env, cell.double_value);
+  case SQLITE_TEXT:
+    return Napi::String::New(env, cell.bytes.data(), cell.bytes.size());
+  case SQLITE_BLOB:
+    return Napi::Buffer<uint8_t>::Copy(
+        env, reinterpret_cast<const uint8_t *>(cell.bytes.data()),
+        cell.bytes.size());
+  default:
+    return env.Null();
   }
 }
 
-void BackupJob::OnOK() {
-  // This runs on the main thread after Execute completes successfully
-  Napi::HandleScope scope(Env());
-
-  // Cleanup SQLite resources
-  Cleanup();
+Napi::Array BuildQueryRows(Napi::Env env,
+                           const std::vector<std::string> &column_names,
+                           const std::vector<QueryValue> &cells,
+                           bool use_big_ints, bool return_arrays,
+                           const std::vector<napi_value> *keys) {
+  size_t column_count = column_names.size();
+  size_t row_count = column_count == 0 ? 0 : cells.size() / column_count;
+  Napi::Array rows = Napi::Array::New(env, row_count);
+
+  std::vector<napi_value> created_keys;
+  if (!return_arrays && (keys == nullptr || keys->size() != column_count)) {
+    created_keys.reserve(column_count);
+    for (const std::string &name : column_names) {
+      created_keys.push_back(Napi::String::New(env, name));
+    }
+    keys = &created_keys;
+  }
+  std::vector<napi_property_descriptor> properties;
 
-  // Resolve the promise with the total number of pages
-  deferred_.Resolve(Napi::Number::New(Env(), total_pages_));
+  const QueryValue *cell = cells.data();
+  for (size_t row = 0; row < row_count; row++) {
+    if (return_arrays) {
+      Napi::Array values = Napi::Array::New(env, column_count);
+      for (size_t i = 0; i < column_count; i++) {
+        values.Set(static_cast<uint32_t>(i),
+                   QueryValueToJS(env, *cell++, use_big_ints));
+      }
+      rows.Set(static_cast<uint32_t>(row), values);
+    } else {
+      // Like StatementSync::CreateResult, define every column in one call
+      properties.resize(column_count);
+      for (size_t i = 0; i < column_count; i++) {
+        napi_property_descriptor &prop = properties[i];
+        prop = {};
+        prop.name = (*keys)[i];
+        prop.value = QueryValueToJS(env, *cell++, use_big_ints);
+        prop.attributes = napi_default_jsproperty;
+      }
+      Napi::Object values = Napi::Object::New(env);
+      napi_status status = napi_define_properties(
+          env, values, properties.size(), properties.data());
+      if (status != napi_ok) {
+        throw Napi::Error::New(env);
+      }
+      rows.Set(static_cast<uint32_t>(row), values);
+    }
+  }
+  return rows;
 }
 
-void BackupJob::OnError(const Napi::Error &error) {
-  // This runs on the main thread if Execute encounters an error
-  Napi::HandleScope scope(Env());
-
-  // Cleanup SQLite resources
-  Cleanup();
-
-  // Create a more detailed error if we have SQLite error info
-  if (dest_ && backup_status_ != SQLITE_OK) {
-    Napi::Error detailed_error = Napi::Error::New(Env(), error.Message());
-    detailed_error.Set(
-        "code", Napi::String::New(Env(), sqlite3_errstr(backup_status_)));
-    detailed_error.Set("errno", Napi::Number::New(Env(), backup_status_));
-    deferred_.Reject(detailed_error.Value());
-  } else {
-    deferred_.Reject(error.Value());
+// Copies the arguments of runAsync() or allAsync(). Named parameters are
+// resolved with the statement's binding plan, as for synchronous calls.
+void StatementSync::MarshalParameters(const Napi::CallbackInfo &info,
+                                      QueryParameters *parameters) {
+  Napi::Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsObject() || info[0].IsBuffer() ||
+      info[0].IsArray()) {
+    MarshalQueryParameters(info, 0, parameters);
+    return;
   }
-}
 
-// HandleBackupError method removed - error handling now done in OnError
+  VisitNamedParameters(
+      env, info[0].As<Napi::Object>(),
+      [&env, parameters](const NamedParameter &param, Napi::Value value) {
+        try {
+          parameters->indexed.emplace_back(param.index,
+                                           MarshalQueryValue(value));
+        } catch (const Napi::Error &e) {
+          std::string msg =
+              "Error binding parameter '" + param.name + "': " + e.Message();
+          node::THROW_ERR_INVALID_ARG_VALUE(env, msg.c_str());
+          return false;
+        }
+        return true;
+      });
+}
 
-void BackupJob::Cleanup() {
-  if (backup_) {
-    sqlite3_backup_finish(backup_);
-    backup_ = nullptr;
-  }
+Napi::Value StatementSync::RunAsync(const Napi::CallbackInfo &info) {
+  return QueueQuery(info, QueryJob::kRun);
+}
 
-  if (dest_) {
-    backup_status_ = sqlite3_errcode(dest_);
-    sqlite3_close_v2(dest_);
-    dest_ = nullptr;
-  }
+Napi::Value StatementSync::AllAsync(const Napi::CallbackInfo &info) {
+  return QueueQuery(info, QueryJob::kAll);
 }
 
-// DatabaseSync::Backup implementation
-Napi::Value DatabaseSync::Backup(const Napi::CallbackInfo &info) {
+Napi::Value StatementSync::QueueQuery(const Napi::CallbackInfo &info,
+                                      int kind) {
   Napi::Env env = info.Env();
-
-  // Create a promise early for error handling
   Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
 
-  if (!IsOpen()) {
-    deferred.Reject(Napi::Error::New(env, "database is not open").Value());
+  if (!ValidateThread(env)) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
     return deferred.Promise();
   }
 
-  if (info.Length() < 1) {
-    deferred.Reject(
-        Napi::TypeError::New(env, "The \"destination\" argument is required")
-            .Value());
+  if (finalized_ || !statement_) {
+    node::THROW_ERR_INVALID_STATE(env, "Statement has been finalized");
+    deferred.Reject(env.GetAndClearPendingException().Value());
     return deferred.Promise();
   }
 
-  std::optional<std::string> destination_path =
-      ValidateDatabasePath(env, info[0], "destination");
-  if (!destination_path.has_value()) {
-    deferred.Reject(Napi::Error::New(env, "Invalid destination path").Value());
+  if (!database_ || !database_->IsOpen()) {
+    node::THROW_ERR_INVALID_STATE(env, "Database connection is closed");
+    deferred.Reject(env.GetAndClearPendingException().Value());
     return deferred.Promise();
   }
 
-  // Default options matching Node.js API
-  int rate = 100;
-  std::string source_db = "main";
-  std::string target_db = "main";
-  Napi::Function progress_func;
+  // Parameters are copied now, so later changes to the arguments do not
+  // affect the query
+  QueryParameters parameters;
+  try {
+    MarshalParameters(info, &parameters);
+  } catch (const Napi::Error &e) {
+    deferred.Reject(e.Value());
+    return deferred.Promise();
+  }
+  if (env.IsExceptionPending()) {
+    deferred.Reject(env.GetAndClearPendingException().Value());
+    return deferred.Promise();
+  }
 
-  // Parse options if provided
-  if (info.Length() > 1) {
-    if (!info[1].IsObject()) {
-      deferred.Reject(Napi::TypeError::New(
-                          env, "The \"options\" argument must be an object")
-                          .Value());
-      return deferred.Promise();
-    }
+  database_->EnqueueQuery(new QueryJob(env, this,
+                                       static_cast<QueryJob::Kind>(kind),
+                                       std::move(parameters), deferred));
+  return deferred.Promise();
+}
 
-    Napi::Object options = info[1].As<Napi::Object>();
+QueryJob::QueryJob(Napi::Env env, DatabaseSync *database,
+                   const std::string &sql, const QueryLimits &limits,
+                   Napi::Promise::Deferred deferred)
+    : Napi::AsyncWorker(env, "SQLiteQuery"), kind_(kExec), database_(database),
+      database_ref_(Napi::Persistent(database->Value())),
+      query_mutex_(database->query_mutex()), sql_(sql), limits_(limits),
+      deferred_(deferred) {}
+
+QueryJob::QueryJob(Napi::Env env, StatementSync *statement, Kind kind,
+                   QueryParameters parameters,
+                   Napi::Promise::Deferred deferred)
+    : Napi::AsyncWorker(env, "SQLiteQuery"), kind_(kind),
+      database_(statement->database_), statement_(statement),
+      database_ref_(Napi::Persistent(statement->database_->Value())),
+      statement_ref_(Napi::Persistent(statement->Value())),
+      query_mutex_(statement->database_->query_mutex()),
+      parameters_(std::move(parameters)),
+      use_big_ints_(statement->use_big_ints_),
+      return_arrays_(statement->return_arrays_),
+      limits_(statement->query_limits()), deferred_(deferred) {}
+
+void QueryJob::Start() {
+  // The connection is idle here, so the statement can be reset from the JS
+  // thread. This also drops Buffer references held by earlier bindings.
+  if (statement_) {
+    statement_->Reset();
+  }
+}
 
-    // Get rate option (number of pages per step)
-    Napi::Value rate_value = options.Get("rate");
-    if (!rate_value.IsUndefined()) {
-      if (!rate_value.IsNumber()) {
-        deferred.Reject(
-            Napi::TypeError::New(env, "The \"options.rate\" must be a number")
-                .Value());
-        return deferred.Promise();
-      }
-      rate = rate_value.As<Napi::Number>().Int32Value();
-      // Note: Node.js allows negative values for rate
-    }
+void QueryJob::Execute() {
+  // Runs on a worker thread. The JS thread does not touch the connection
+  // while the job is running, apart from finalizers, which take this lock.
+  std::lock_guard<std::mutex> lock(*query_mutex_);
+  sqlite3 *db = database_->connection();
 
-    // Get source database option
-    Napi::Value source_value = options.Get("source");
-    if (!source_value.IsUndefined()) {
-      if (!source_value.IsString()) {
-        deferred.Reject(
-            Napi::TypeError::New(env, "The \"options.source\" must be a string")
-                .Value());
-        return deferred.Promise();
-      }
-      source_db = source_value.As<Napi::String>().Utf8Value();
-    }
+  // The time limit counts from here, not from when the job was queued
+  bool armed = database_->ArmQueryLimits(limits_);
+  ExecuteStatement(db);
+  if (armed) {
+    limit_exceeded_ = database_->DisarmQueryLimits();
+  }
+}
 
-    // Get target database option
-    Napi::Value target_value = options.Get("target");
-    if (!target_value.IsUndefined()) {
-      if (!target_value.IsString()) {
-        deferred.Reject(
-            Napi::TypeError::New(env, "The \"options.target\" must be a string")
-                .Value());
-        return deferred.Promise();
-      }
-      target_db = target_value.As<Napi::String>().Utf8Value();
+void QueryJob::ExecuteStatement(sqlite3 *db) {
+  if (kind_ == kExec) {
+    result_code_ = sqlite3_exec(db, sql_.c_str(), nullptr, nullptr, nullptr);
+    if (result_code_ != SQLITE_OK) {
+      SetError(sqlite3_errmsg(db));
     }
+    return;
+  }
 
-    // Get progress callback
-    Napi::Value progress_value = options.Get("progress");
-    if (!progress_value.IsUndefined()) {
-      if (!progress_value.IsFunction()) {
-        deferred.Reject(Napi::TypeError::New(
-                            env, "The \"options.progress\" must be a function")
-                            .Value());
-        return deferred.Promise();
-      }
-      progress_func = progress_value.As<Napi::Function>();
+  sqlite3_stmt *stmt = statement_->statement_;
+  std::string error;
+  if (!BindQueryParameters(stmt, parameters_, &result_code_, &error)) {
+    SetError(error.empty() ? sqlite3_errmsg(db) : error);
+    return;
+  }
+
+  size_t max_rows = kind_ == kAll ? SIZE_MAX : 0;
+  int r = StepQuery(stmt, max_rows, &column_names_, &cells_);
+  if (r != SQLITE_DONE) {
+    result_code_ = r;
+    SetError(sqlite3_errmsg(db));
+    return;
+  }
+
+  changes_ = sqlite3_changes64(db);
+}
+
+void QueryJob::OnOK() {
+  Napi::Env env = Env();
+  Napi::HandleScope scope(env);
+
+  Napi::Value result = env.Undefined();
+  if (kind_ == kRun) {
+    // Nothing else has used the connection since Execute(), so the last
+    // insert rowid still belongs to this query
+    result = CreateRunResult(env, database_->connection(), changes_);
+  } else if (kind_ == kAll) {
+    // The statement's cached column keys are valid here: a re-prepare during
+    // Execute() shows in the counter they are checked against
+    std::vector<napi_value> keys;
+    if (!return_arrays_ && !column_names_.empty() && !statement_->finalized_) {
+      statement_->ResolveColumnKeys(keys);
     }
+    result = BuildQueryRows(env, column_names_, cells_, use_big_ints_,
+                            return_arrays_, &keys);
+    cells_.clear();
   }
 
-  // Create and schedule backup job
-  BackupJob *job = new BackupJob(env, this, destination_path.value(), source_db,
-                                 target_db, rate, progress_func, deferred);
+  Finish();
+  deferred_.Resolve(result);
+  database_->QueryFinished();
+}
 
-  // Queue the async work - AsyncWorker will delete itself when complete
-  job->Queue();
+void QueryJob::OnError(const Napi::Error &error) {
+  Napi::Env env = Env();
+  Napi::HandleScope scope(env);
+
+  Napi::Value reason = error.Value();
+  if (result_code_ != SQLITE_OK) {
+    // The connection has been idle since the failure, so its error state
+    // still describes it
+    node::ThrowEnhancedSqliteError(env, database_->connection(), result_code_,
+                                   error.Message());
+    Napi::Error sqlite_error = env.GetAndClearPendingException();
+    if (limit_exceeded_ != QueryLimit::kNone) {
+      AnnotateQueryLimitError(sqlite_error, limit_exceeded_, limits_);
+    }
+    reason = sqlite_error.Value();
+  }
 
-  return deferred.Promise();
+  Finish();
+  deferred_.Reject(reason);
+  database_->QueryFinished();
+}
+
+void QueryJob::Finish() {
+  // Bindings point into parameters_, so clear them before the job goes away
+  if (statement_ && !statement_->finalized_) {
+    statement_->Reset();
+  }
 }
 
 // Thread validation implementations
@@ -4,8 +4,14 @@
 #include <napi.h>
 #include <sqlite3.h>
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <climits>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -14,6 +20,8 @@
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 // Include our shims
 #include "shims/base_object.h"
@@ -31,6 +39,8 @@ class DatabaseSync;
 class StatementSync;
 class StatementSyncIterator;
 class Session;
+class QueryJob;
+struct QueryParameters;
 
 // Per-worker instance data
 struct AddonData {
@@ -43,6 +53,7 @@ struct AddonData {
   Napi::FunctionReference statementSyncConstructor;
   Napi::FunctionReference statementSyncIteratorConstructor;
   Napi::FunctionReference sessionConstructor;
+  Napi::FunctionReference rebaserConstructor;
 };
 
 // Worker thread support functions
@@ -50,6 +61,22 @@ void RegisterDatabaseInstance(Napi::Env env, DatabaseSync *database);
 void UnregisterDatabaseInstance(Napi::Env env, DatabaseSync *database);
 AddonData *GetAddonData(napi_env env);
 
+// Process-wide memory counters from sqlite3_status64(), exported as
+// memoryStatus()
+Napi::Value MemoryStatus(const Napi::CallbackInfo &info);
+
+// Wraps memory from sqlite3_malloc() in a Buffer without copying it. The
+// Buffer takes ownership and releases it with sqlite3_free(). A null pointer
+// yields an empty Buffer.
+Napi::Buffer<uint8_t> TakeSqliteBuffer(Napi::Env env, void *data,
+                                       size_t size);
+
+// Denies writes to sqlite_dbpage on `db`. The addon is built with
+// SQLITE_ENABLE_DBPAGE_VTAB so that streamBackup() can read raw pages, and
+// SQL must not be able to use the same table to overwrite them. Returns the
+// result of sqlite3_set_authorizer().
+int DenyRawPageWrites(sqlite3 *db);
+
 // Path validation function
 std::optional<std::string> ValidateDatabasePath(Napi::Env env, Napi::Value path,
                                                 const std::string &field_name);
@@ -62,9 +89,49 @@ inline int SafeCastToInt(size_t value) {
   return static_cast<int>(value);
 }
 
+// Bounds on a single call into SQLite, enforced by a progress handler. Zero
+// means unlimited.
+struct QueryLimits {
+  int64_t time_limit = 0;        // Milliseconds
+  int64_t instruction_limit = 0; // Virtual machine instructions
+
+  bool IsSet() const { return time_limit > 0 || instruction_limit > 0; }
+};
+
+// Which query limit stopped a call
+enum class QueryLimit { kNone, kTime, kInstructions };
+
+// Reads { timeLimit, instructionLimit } from an options object. Returns false
+// with a pending exception if a value is invalid.
+bool ParseQueryLimits(Napi::Env env, Napi::Object options,
+                      QueryLimits *limits);
+
+// Turns the SQLITE_INTERRUPT error of a call stopped by a query limit into an
+// ERR_SQLITE_TIME_LIMIT or ERR_SQLITE_INSTRUCTION_LIMIT error.
+void AnnotateQueryLimitError(Napi::Error error, QueryLimit exceeded,
+                             const QueryLimits &limits);
+
+// Execution statistics for one normalized SQL shape, collected by the
+// profiler. Times are in nanoseconds.
+struct QueryProfile {
+  static constexpr size_t kHistogramBuckets = 24;
+
+  uint64_t count = 0;
+  int64_t total_time = 0;
+  int64_t min_time = INT64_MAX;
+  int64_t max_time = 0;
+  // Bucket i counts executions that took [2^i, 2^(i+1)) microseconds. The
+  // first bucket also counts faster ones and the last bucket slower ones.
+  std::array<uint64_t, kHistogramBuckets> histogram{};
+
+  void Record(int64_t nanoseconds);
+};
+
 // Database configuration
 class DatabaseOpenConfiguration {
 public:
+  static constexpr size_t kDefaultStatementCacheSize = 128;
+
   explicit DatabaseOpenConfiguration(std::string &&location)
       : location_(std::move(location)) {}
 
@@ -79,15 +146,45 @@ public:
   bool get_enable_dqs() const { return enable_dqs_; }
   void set_enable_dqs(bool flag) { enable_dqs_ = flag; }
 
+  bool get_defensive() const { return defensive_; }
+  void set_defensive(bool flag) { defensive_ = flag; }
+
   void set_timeout(int timeout) { timeout_ = timeout; }
   int get_timeout() const { return timeout_; }
 
+  void set_statement_cache_size(size_t size) { statement_cache_size_ = size; }
+  size_t get_statement_cache_size() const { return statement_cache_size_; }
+
+  void set_query_limits(const QueryLimits &limits) { query_limits_ = limits; }
+  const QueryLimits &get_query_limits() const { return query_limits_; }
+
+  // Serialized image loaded into "main" after opening. The bytes are borrowed
+  // and must outlive the open call.
+  void set_deserialize(const uint8_t *data, size_t size) {
+    deserialize_data_ = data;
+    deserialize_size_ = size;
+  }
+  const uint8_t *get_deserialize_data() const { return deserialize_data_; }
+  size_t get_deserialize_size() const { return deserialize_size_; }
+
 private:
   std::string location_;
   bool read_only_ = false;
   bool enable_foreign_keys_ = true;
   bool enable_dqs_ = false;
+  bool defensive_ = false;
   int timeout_ = 0;
+  size_t statement_cache_size_ = kDefaultStatementCacheSize;
+  QueryLimits query_limits_;
+  const uint8_t *deserialize_data_ = nullptr;
+  size_t deserialize_size_ = 0;
+};
+
+// Cached prepared statement held by DatabaseSync's LRU statement cache
+struct CachedStatement {
+  Napi::ObjectReference statement;
+  StatementSync *statement_ptr = nullptr;
+  std::list<std::string>::iterator lru_position;
 };
 
 // Main database class
@@ -104,16 +201,47 @@ public:
   Napi::Value Open(const Napi::CallbackInfo &info);
   Napi::Value Close(const Napi::CallbackInfo &info);
   Napi::Value Prepare(const Napi::CallbackInfo &info);
+  Napi::Value PrepareCached(const Napi::CallbackInfo &info);
   Napi::Value Exec(const Napi::CallbackInfo &info);
+  Napi::Value ExecAsync(const Napi::CallbackInfo &info);
+
+  // Statement cache
+  Napi::Value StatementCacheStats(const Napi::CallbackInfo &info);
+  Napi::Value ClearStatementCache(const Napi::CallbackInfo &info);
+
+  // Statement counters
+  static constexpr uint32_t kDefaultStatementStatusLimit = 10;
+  Napi::Value StatementStatus(const Napi::CallbackInfo &info);
+
+  // Connection status
+  Napi::Value Status(const Napi::CallbackInfo &info);
+
+  // Profiler
+  static constexpr uint32_t kDefaultProfileLimit = 10;
+  // Further SQL shapes are not recorded once this many are tracked
+  static constexpr size_t kMaxProfiledShapes = 10000;
+  Napi::Value EnableProfiler(const Napi::CallbackInfo &info);
+  Napi::Value Profile(const Napi::CallbackInfo &info);
+
+  // Serialization
+  Napi::Value Serialize(const Napi::CallbackInfo &info);
+
+  // Cancellation
+  Napi::Value Interrupt(const Napi::CallbackInfo &info);
+  static Napi::Value InterruptByHandle(const Napi::CallbackInfo &info);
 
   // Properties
   Napi::Value LocationMethod(const Napi::CallbackInfo &info);
   Napi::Value IsOpenGetter(const Napi::CallbackInfo &info);
   Napi::Value IsTransactionGetter(const Napi::CallbackInfo &info);
+  Napi::Value InterruptHandleGetter(const Napi::CallbackInfo &info);
 
   // SQLite handle access
   sqlite3 *connection() const { return connection_; }
   bool IsOpen() const { return connection_ != nullptr; }
+  // Whether user functions or aggregates, which call into JavaScript, have
+  // been registered on this connection
+  bool HasJavaScriptFunctions() const { return has_js_functions_; }
 
   // User-defined functions
   Napi::Value CustomFunction(const Napi::CallbackInfo &info);
@@ -128,32 +256,127 @@ public:
   // Session support
   Napi::Value CreateSession(const Napi::CallbackInfo &info);
   Napi::Value ApplyChangeset(const Napi::CallbackInfo &info);
+  Napi::Value ApplyChangesetStream(const Napi::CallbackInfo &info);
+  Napi::Value ApplyChangesetAsync(const Napi::CallbackInfo &info);
 
   // Backup support
   Napi::Value Backup(const Napi::CallbackInfo &info);
+  Napi::Value StreamBackup(const Napi::CallbackInfo &info);
+
+  // Maintenance on a separate connection
+  Napi::Value VacuumInto(const Napi::CallbackInfo &info);
+  Napi::Value IncrementalVacuum(const Napi::CallbackInfo &info);
+  Napi::Value Reindex(const Napi::CallbackInfo &info);
+  Napi::Value Analyze(const Napi::CallbackInfo &info);
 
   // Session management
   void AddSession(Session *session);
   void RemoveSession(Session *session);
   void DeleteAllSessions();
 
+  // Asynchronous queries run one at a time, in submission order. Synchronous
+  // calls fail while any are pending.
+  void EnqueueQuery(QueryJob *job);
+  // Queues other work that needs the connection to itself. `start` runs on
+  // the JS thread once the connection is idle, and the job calls
+  // QueryFinished() on the JS thread when it settles.
+  void EnqueueJob(std::function<void()> start);
+  void QueryFinished();
+  bool IsIdle() const { return !query_running_ && query_queue_.empty(); }
+  bool ValidateIdle(Napi::Env env) const;
+  std::shared_ptr<std::mutex> query_mutex() const { return query_mutex_; }
+
+  // Query limits. Arm() installs the progress handler for one call and
+  // returns false if there is nothing to enforce or a call is already armed
+  // (nested calls from user-defined functions run under the outer limits).
+  // Disarm() reports which limit, if any, stopped the call.
+  const QueryLimits &query_limits() const { return query_limits_; }
+  bool ArmQueryLimits(const QueryLimits &limits);
+  QueryLimit DisarmQueryLimits();
+
 private:
+  static int ProgressHandler(void *data);
+  static int TraceCallback(unsigned type, void *context, void *p, void *x);
+  void RegisterInterruptHandle();
+  void UnregisterInterruptHandle();
+
+  void StartNextQuery();
+
   void InternalOpen(DatabaseOpenConfiguration config);
   void InternalClose();
+  Napi::Object CreateStatement(Napi::Env env, const std::string &sql,
+                               unsigned int prepare_flags);
+  void EvictStatements(size_t capacity);
+  void ReleaseStatementCache(bool finalize_statements);
 
   sqlite3 *connection_ = nullptr;
   std::string location_;
   bool read_only_ = false;
   bool allow_load_extension_ = false;
   bool enable_load_extension_ = false;
-  std::map<std::string, std::unique_ptr<StatementSync>> prepared_statements_;
+  bool has_js_functions_ = false;
+  // LRU cache used by prepareCached(), keyed by SQL text. The most recently
+  // used entry is at the front of statement_lru_.
+  std::unordered_map<std::string, CachedStatement> statement_cache_;
+  std::list<std::string> statement_lru_;
+  size_t statement_cache_capacity_ =
+      DatabaseOpenConfiguration::kDefaultStatementCacheSize;
+  uint64_t statement_cache_hits_ = 0;
+  uint64_t statement_cache_misses_ = 0;
+  uint64_t statement_cache_evictions_ = 0;
+  // Default limits for every call on this connection
+  QueryLimits query_limits_;
+  // Limits of the armed call, read by the progress handler on whichever
+  // thread is stepping
+  bool query_limits_armed_ = false;
+  QueryLimits active_limits_;
+  std::chrono::steady_clock::time_point deadline_;
+  int64_t progress_interval_ = 0;
+  int64_t instructions_ = 0;
+  QueryLimit limit_exceeded_ = QueryLimit::kNone;
+  // Key of this connection in the interrupt registry, which lets other
+  // threads interrupt it through DatabaseSync.interrupt(handle)
+  uint64_t interrupt_handle_ = 0;
+  // Profiler results keyed by normalized SQL, and a scratch key reused by
+  // the trace callback
+  std::unordered_map<std::string, QueryProfile> profiles_;
+  std::string profile_key_;
   std::set<Session *> sessions_;      // Track all active sessions
   mutable std::mutex sessions_mutex_; // Protect sessions_ for thread safety
   std::thread::id creation_thread_;
   napi_env env_; // Store for cleanup purposes
 
+  // Start functions of pending asynchronous jobs. A job is running while
+  // query_running_ is set.
+  std::deque<std::function<void()>> query_queue_;
+  bool query_running_ = false;
+  // Held by the worker thread while it uses the connection. Shared with
+  // statements, whose finalizers may run while a query is in flight.
+  std::shared_ptr<std::mutex> query_mutex_ = std::make_shared<std::mutex>();
+
   bool ValidateThread(Napi::Env env) const;
   friend class Session;
+  friend class QueryJob;
+};
+
+// Scratch memory for text and blob parameters bound with SQLITE_STATIC.
+// Allocations stay valid until Reset(), which keeps one block around for
+// reuse.
+class BindArena {
+public:
+  char *Allocate(size_t size);
+  void Reset();
+
+private:
+  static constexpr size_t kBlockSize = 16 * 1024;
+  static constexpr size_t kMaxRetainedSize = 1024 * 1024;
+
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+    size_t used = 0;
+  };
+  std::vector<Block> blocks_;
 };
 
 // Statement class
@@ -167,14 +390,22 @@ public:
   virtual ~StatementSync();
 
   // Internal constructor for DatabaseSync to use
-  void InitStatement(DatabaseSync *database, const std::string &sql);
+  void InitStatement(DatabaseSync *database, const std::string &sql,
+                     unsigned int prepare_flags = 0);
+  bool IsFinalized() const { return finalized_; }
+  void Finalize();
 
   // Statement operations
   Napi::Value Run(const Napi::CallbackInfo &info);
+  Napi::Value RunMany(const Napi::CallbackInfo &info);
+  Napi::Value RunColumns(const Napi::CallbackInfo &info);
   Napi::Value Get(const Napi::CallbackInfo &info);
   Napi::Value All(const Napi::CallbackInfo &info);
+  Napi::Value AllColumns(const Napi::CallbackInfo &info);
   Napi::Value Iterate(const Napi::CallbackInfo &info);
   Napi::Value FinalizeStatement(const Napi::CallbackInfo &info);
+  Napi::Value RunAsync(const Napi::CallbackInfo &info);
+  Napi::Value AllAsync(const Napi::CallbackInfo &info);
 
   // Properties
   Napi::Value SourceSQLGetter(const Napi::CallbackInfo &info);
@@ -184,17 +415,40 @@ public:
   Napi::Value SetReadBigInts(const Napi::CallbackInfo &info);
   Napi::Value SetReturnArrays(const Napi::CallbackInfo &info);
   Napi::Value SetAllowBareNamedParameters(const Napi::CallbackInfo &info);
+  Napi::Value SetQueryLimits(const Napi::CallbackInfo &info);
 
   // Metadata methods
   Napi::Value Columns(const Napi::CallbackInfo &info);
+  Napi::Value Status(const Napi::CallbackInfo &info);
+  Napi::Value ScanStatus(const Napi::CallbackInfo &info);
 
 private:
   void BindParameters(const Napi::CallbackInfo &info, size_t start_index = 0);
+  Napi::Value QueueQuery(const Napi::CallbackInfo &info, int kind);
+  void MarshalParameters(const Napi::CallbackInfo &info,
+                         QueryParameters *parameters);
+  template <typename Args>
+  void BindParameterList(Napi::Env env, const Args &args, size_t start_index,
+                         size_t count);
+  // Walks the named-parameter plan over obj, calling visit(param, value) for
+  // each parameter the object provides. Returns false, with an exception
+  // pending, if bare names are ambiguous or visit returns false.
+  template <typename Visit>
+  bool VisitNamedParameters(Napi::Env env, Napi::Object obj, Visit visit);
   void BindSingleParameter(int param_index, Napi::Value param);
-  Napi::Value CreateResult();
+  void BindNumber(int param_index, double value);
+  void BindTypedArrayElement(int param_index, napi_typedarray_type type,
+                             const uint8_t *data, size_t row);
+  void BuildNamedParameterPlan(Napi::Env env);
+  void BindText(int param_index, Napi::Value value);
+  void ClearBindings();
+  Napi::Value ColumnToValue(int column);
+  Napi::Value CreateResult(const std::vector<napi_value> *keys = nullptr);
+  void ResolveColumnKeys(std::vector<napi_value> &keys);
+  void ClearColumnKeys();
   void Reset();
 
-  DatabaseSync *database_;
+  DatabaseSync *database_ = nullptr;
   sqlite3_stmt *statement_ = nullptr;
   std::string source_sql_;
   bool finalized_ = false;
@@ -204,12 +458,68 @@ private:
   bool use_big_ints_ = false;
   bool return_arrays_ = false;
   bool allow_bare_named_params_ = false;
-
-  // Bare named parameters mapping (bare name -> full name with prefix)
-  std::optional<std::map<std::string, std::string>> bare_named_params_;
+  // Overrides the connection's query limits when set
+  std::optional<QueryLimits> query_limits_;
+
+  // Named-parameter binding plan, built on the first named bind. Entry i
+  // maps a parameter index to the property keys at 2i and 2i+1 of
+  // named_parameter_keys_: its full name (":id") and, when unambiguous, its
+  // bare name ("id"). Held by an array, like column_keys_.
+  struct NamedParameter {
+    int index = 0;
+    std::string name;
+    bool has_bare_key = false;
+  };
+  std::optional<std::vector<NamedParameter>> named_parameters_;
+  Napi::Reference<Napi::Array> named_parameter_keys_;
+  std::string bare_named_param_conflict_;
+
+  // Backing memory for parameters bound with SQLITE_STATIC, released by
+  // ClearBindings()
+  BindArena bind_arena_;
+
+  // Result column names, created once per prepare and reused as property keys
+  // for every row. Rebuilt when SQLite re-prepares after a schema change.
+  // Node-API versions before 10 cannot reference strings directly, so the
+  // keys are held by a single array.
+  Napi::Reference<Napi::Array> column_keys_;
+  uint32_t column_key_count_ = 0;
+  int column_keys_reprepare_ = 0;
+  bool column_keys_valid_ = false;
+  // Scratch descriptors reused across rows to avoid a per-row allocation
+  std::vector<napi_property_descriptor> row_properties_;
+
+  // Shared with the database; see DatabaseSync::query_mutex_
+  std::shared_ptr<std::mutex> query_mutex_;
 
   bool ValidateThread(Napi::Env env) const;
+  bool ValidateIdle(Napi::Env env) const {
+    return database_ == nullptr || database_->ValidateIdle(env);
+  }
+  const QueryLimits &query_limits() const {
+    return query_limits_ ? *query_limits_ : database_->query_limits();
+  }
   friend class StatementSyncIterator;
+  friend class QueryJob;
+};
+
+// Applies query limits to one synchronous call. Declare it after the
+// argument checks; on exit it disarms the limits and, if one of them stopped
+// the call, rewrites the pending error.
+class QueryLimitScope {
+public:
+  QueryLimitScope(Napi::Env env, DatabaseSync *database,
+                  const QueryLimits &limits);
+  ~QueryLimitScope();
+
+  QueryLimitScope(const QueryLimitScope &) = delete;
+  QueryLimitScope &operator=(const QueryLimitScope &) = delete;
+
+private:
+  Napi::Env env_;
+  DatabaseSync *database_;
+  QueryLimits limits_;
+  bool armed_;
 };
 
 // Iterator class for StatementSync
@@ -221,8 +531,12 @@ public:
   explicit StatementSyncIterator(const Napi::CallbackInfo &info);
   virtual ~StatementSyncIterator();
 
+  // Number of rows returned by nextBatch() when no count is given
+  static constexpr uint32_t kDefaultBatchSize = 256;
+
   // Iterator methods
   Napi::Value Next(const Napi::CallbackInfo &info);
+  Napi::Value NextBatch(const Napi::CallbackInfo &info);
   Napi::Value Return(const Napi::CallbackInfo &info);
 
 private:
@@ -245,6 +559,8 @@ public:
   // Session methods
   Napi::Value Changeset(const Napi::CallbackInfo &info);
   Napi::Value Patchset(const Napi::CallbackInfo &info);
+  Napi::Value StreamChangeset(const Napi::CallbackInfo &info);
+  Napi::Value Diff(const Napi::CallbackInfo &info);
   Napi::Value Close(const Napi::CallbackInfo &info);
 
   // Get the underlying SQLite session
@@ -259,23 +575,54 @@ private:
 
   sqlite3_session *session_ = nullptr;
   DatabaseSync *database_ = nullptr; // Direct pointer to database
+  // Shared with the database; see DatabaseSync::query_mutex_
+  std::shared_ptr<std::mutex> query_mutex_;
 
   friend class DatabaseSync;
+  friend class ChangesetStreamJob;
 };
 
 // Progress data structure for backup progress updates
 struct BackupProgress {
   int current;
   int total;
+  double pages_per_second; // Average since the backup started
+  double bytes_per_second; // 0 if the page size is unknown
+  int step_pages;          // Pages per step currently in use
 };
 
-// Backup job for asynchronous database backup
+// Limits on how hard a backup may press on the source. Each step holds a
+// read lock on the source, so fewer, smaller or slower steps leave more room
+// for writers. Zero disables a limit.
+struct BackupPacing {
+  static constexpr int kDefaultMaxStepTime = 20; // Milliseconds
+  static constexpr int kMaxBackoff = 1000;       // Milliseconds
+
+  double pages_per_second = 0;
+  double bytes_per_second = 0;
+  int sleep = 0; // Milliseconds between steps
+  // Halve the step on SQLITE_BUSY/LOCKED or when a step takes longer than
+  // max_step_time, and grow it back while steps are fast
+  bool adaptive = false;
+  int max_step_time = kDefaultMaxStepTime;
+
+  bool IsSet() const {
+    return pages_per_second > 0 || bytes_per_second > 0 || sleep > 0 ||
+           adaptive;
+  }
+};
+
+// Backup job for asynchronous database backup. A paced backup runs as a
+// series of jobs: each copies until the pacing asks for a pause, and a timer
+// queues the next one when the pause is over, so that a slow backup does not
+// hold one of the few libuv pool threads while it waits.
 class BackupJob : public Napi::AsyncProgressWorker<BackupProgress> {
 public:
   BackupJob(Napi::Env env, DatabaseSync *source,
             const std::string &destination_path, const std::string &source_db,
             const std::string &dest_db, int pages, Napi::Function progress_func,
-            Napi::Promise::Deferred deferred);
+            Napi::Promise::Deferred deferred,
+            const BackupPacing &pacing = BackupPacing());
   ~BackupJob();
 
   void Execute(const ExecutionProgress &progress) override;
@@ -286,19 +633,37 @@ public:
   Napi::Promise GetPromise() { return deferred_.Promise(); }
 
 private:
+  // Carried from one job of a paced backup to the next. Only one of them
+  // runs at a time.
+  struct State {
+    int status = SQLITE_OK;
+    sqlite3 *dest = nullptr;
+    sqlite3_backup *backup = nullptr;
+    int total_pages = 0;
+    int page_size = 0; // Read from the destination after the first step
+    int step_pages = 0;
+    int backoff = 0; // Milliseconds, while the source is busy
+    std::chrono::steady_clock::time_point started;
+  };
+
   void Cleanup();
+  // Milliseconds the pacing asks to wait after `copied` pages
+  double PauseTime(int copied) const;
+  // Queues the next job of a paused backup once pause_ has elapsed
+  void Resume();
+  // page_size of the destination schema, or 0 if it can't be read
+  int ReadPageSize();
 
   DatabaseSync *source_;
   std::string destination_path_;
   std::string source_db_;
   std::string dest_db_;
   int pages_;
+  BackupPacing pacing_;
 
-  // These are only accessed in Execute() on worker thread
-  int backup_status_ = SQLITE_OK;
-  sqlite3 *dest_ = nullptr;
-  sqlite3_backup *backup_ = nullptr;
-  int total_pages_ = 0;
+  // Accessed in Execute() on a worker thread, then in OnOK() or OnError()
+  std::shared_ptr<State> state_;
+  double pause_ = 0; // Set when Execute() stops to pause
 
   Napi::FunctionReference progress_func_;
   Napi::Promise::Deferred deferred_;
@@ -308,6 +673,93 @@ private:
   static std::set<BackupJob *> active_job_instances_;
 };
 
+// A parameter or result value copied out of V8 or SQLite, so that it can be
+// handed between the JS thread and a worker thread.
+struct QueryValue {
+  int type = SQLITE_NULL; // SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, ...
+  int64_t int_value = 0;
+  double double_value = 0;
+  std::string bytes; // SQLITE_TEXT and SQLITE_BLOB
+};
+
+// Statement parameters captured at call time for an asynchronous query.
+struct QueryParameters {
+  std::vector<QueryValue> positional;
+  // Named parameters of a StatementSync, resolved to parameter indexes with
+  // its binding plan on the JS thread
+  std::vector<std::pair<int, QueryValue>> indexed;
+  // Named parameters of a statement prepared on the worker thread (as in a
+  // DatabasePool), which keep their property key and are resolved there
+  std::vector<std::pair<std::string, QueryValue>> named;
+  bool allow_bare_names = false;
+};
+
+// Helpers shared by the asynchronous query jobs. Parameters are copied on the
+// JS thread, bound and stepped on a worker, and rows are built back on the JS
+// thread.
+void MarshalQueryParameters(const Napi::CallbackInfo &info,
+                            size_t start_index, QueryParameters *parameters);
+bool BindQueryParameters(sqlite3_stmt *stmt, const QueryParameters &parameters,
+                         int *result_code, std::string *error);
+int StepQuery(sqlite3_stmt *stmt, size_t max_rows,
+              std::vector<std::string> *column_names,
+              std::vector<QueryValue> *cells);
+// Object rows use `keys` as property keys when given, such as a statement's
+// cached column keys, and keys created from column_names otherwise.
+Napi::Array BuildQueryRows(Napi::Env env,
+                           const std::vector<std::string> &column_names,
+                           const std::vector<QueryValue> &cells,
+                           bool use_big_ints, bool return_arrays,
+                           const std::vector<napi_value> *keys = nullptr);
+Napi::Object CreateRunResult(Napi::Env env, sqlite3 *db, int64_t changes);
+
+// Runs exec(), run() or all() on a worker thread. Jobs are queued through
+// DatabaseSync::EnqueueQuery() and rows are built on the JS thread once
+// stepping completes.
+class QueryJob : public Napi::AsyncWorker {
+public:
+  enum Kind { kExec, kRun, kAll };
+
+  QueryJob(Napi::Env env, DatabaseSync *database, const std::string &sql,
+           const QueryLimits &limits, Napi::Promise::Deferred deferred);
+  QueryJob(Napi::Env env, StatementSync *statement, Kind kind,
+           QueryParameters parameters, Napi::Promise::Deferred deferred);
+
+  // Called on the JS thread when the connection becomes idle, right before
+  // the job is queued on the thread pool.
+  void Start();
+
+  void Execute() override;
+  void OnOK() override;
+  void OnError(const Napi::Error &error) override;
+
+private:
+  void ExecuteStatement(sqlite3 *db);
+  void Finish();
+
+  Kind kind_;
+  DatabaseSync *database_;
+  StatementSync *statement_ = nullptr;
+  // Keep both objects alive until the job settles
+  Napi::ObjectReference database_ref_;
+  Napi::ObjectReference statement_ref_;
+  std::shared_ptr<std::mutex> query_mutex_;
+  std::string sql_;
+  QueryParameters parameters_;
+  bool use_big_ints_ = false;
+  bool return_arrays_ = false;
+  QueryLimits limits_;
+
+  // Written on the worker thread, read once the job settles
+  int result_code_ = SQLITE_OK;
+  QueryLimit limit_exceeded_ = QueryLimit::kNone;
+  std::vector<std::string> column_names_;
+  std::vector<QueryValue> cells_; // Row-major
+  int64_t changes_ = 0;
+
+  Napi::Promise::Deferred deferred_;
+};
+
 } // namespace sqlite
 } // namespace photostructure
 
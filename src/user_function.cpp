@@ -12,7 +12,8 @@ namespace sqlite {
 UserDefinedFunction::UserDefinedFunction(Napi::Env env, Napi::Function fn,
                                          DatabaseSync *db, bool use_bigint_args)
     : env_(env), fn_(Napi::Reference<Napi::Function>::New(fn, 1)),
-      use_bigint_args_(use_bigint_args) {
+      use_bigint_args_(use_bigint_args),
+      creation_thread_(std::this_thread::get_id()) {
   // No need for SuppressDestruct when using reference count
 }
 
@@ -33,6 +34,13 @@ void UserDefinedFunction::xFunc(sqlite3_context *ctx, int argc,
 
   UserDefinedFunction *self = static_cast<UserDefinedFunction *>(user_data);
 
+  if (std::this_thread::get_id() != self->creation_thread_) {
+    sqlite3_result_error(
+        ctx, "User-defined functions cannot run in asynchronous queries",
+        -1);
+    return;
+  }
+
   try {
     Napi::HandleScope scope(self->env_);
 
@@ -5,6 +5,7 @@
 #include <sqlite3.h>
 
 #include <string>
+#include <thread>
 
 namespace photostructure {
 namespace sqlite {
@@ -27,6 +28,8 @@ private:
   Napi::Env env_;
   Napi::FunctionReference fn_;
   bool use_bigint_args_;
+  // JavaScript can only be called on the thread that registered the function
+  std::thread::id creation_thread_;
 
   // Helper methods
   Napi::Value SqliteValueToJS(sqlite3_value *value);
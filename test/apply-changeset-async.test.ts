@@ -0,0 +1,145 @@
+import {
+  DatabaseSync,
+  constants,
+  type ChangesetApplyProgress,
+} from "../src";
+
+const schema = "CREATE TABLE items (id INTEGER PRIMARY KEY, payload TEXT)";
+
+describe("applyChangesetAsync()", () => {
+  let changeset: Buffer;
+  let target: InstanceType<typeof DatabaseSync>;
+
+  beforeAll(() => {
+    const source = new DatabaseSync(":memory:");
+    source.exec(schema);
+    const session = source.createSession();
+    source.exec(`
+      WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n LIMIT 5000)
+      INSERT INTO items (payload) SELECT printf('%.200c', 'x') FROM n;
+    `);
+    changeset = session.changeset();
+    session.close();
+    source.close();
+  });
+
+  beforeEach(() => {
+    target = new DatabaseSync(":memory:");
+    target.exec(schema);
+  });
+
+  afterEach(() => {
+    if (target.isOpen) {
+      target.close();
+    }
+  });
+
+  const count = () => target.prepare("SELECT count(*) AS n FROM items").get().n;
+
+  test("applies on a separate thread and reports progress", async () => {
+    const reports: ChangesetApplyProgress[] = [];
+    const applied = target.applyChangesetAsync(changeset, {
+      progress: (progress) => reports.push(progress),
+    });
+    expect(() => target.exec("SELECT 1")).toThrow(/busy/);
+    await expect(applied).resolves.toBe(true);
+    expect(count()).toBe(5000);
+
+    expect(reports.length).toBeGreaterThan(2);
+    for (let i = 1; i < reports.length; i++) {
+      expect(reports[i]!.bytes).toBeGreaterThan(reports[i - 1]!.bytes);
+      expect(reports[i]!.changes).toBeGreaterThanOrEqual(
+        reports[i - 1]!.changes,
+      );
+    }
+    const last = reports[reports.length - 1]!;
+    expect(last.bytes).toBe(changeset.length);
+    expect(last.totalBytes).toBe(changeset.length);
+  });
+
+  test("decides conflicts with native policies", async () => {
+    target.exec("INSERT INTO items VALUES (1, 'mine'), (2, 'mine')");
+    const result = await target.applyChangesetAsync(changeset, {
+      policies: { items: "omit" },
+    });
+    expect(result).toMatchObject({
+      applied: true,
+      conflicts: 2,
+      omitted: 2,
+      byPolicy: { omit: 2 },
+    });
+    expect(count()).toBe(5000);
+  });
+
+  test("falls back to an async onConflict", async () => {
+    target.exec("INSERT INTO items VALUES (1, 'mine')");
+    const conflicts: number[] = [];
+    await expect(
+      target.applyChangesetAsync(changeset, {
+        onConflict: async (type) => {
+          conflicts.push(type);
+          return constants.SQLITE_CHANGESET_ABORT;
+        },
+      }),
+    ).resolves.toBe(false);
+    expect(conflicts).toEqual([constants.SQLITE_CHANGESET_CONFLICT]);
+    expect(count()).toBe(1);
+  });
+
+  test("rolls back when a filter throws", async () => {
+    const source = new DatabaseSync(":memory:");
+    source.exec(`${schema}; CREATE TABLE tags (name TEXT PRIMARY KEY)`);
+    const session = source.createSession();
+    source.exec("INSERT INTO items (payload) VALUES ('a'), ('b')");
+    source.exec("INSERT INTO tags VALUES ('x')");
+    const mixed = session.changeset();
+    session.close();
+    source.close();
+
+    target.exec("CREATE TABLE tags (name TEXT PRIMARY KEY)");
+    const error = new Error("no tags");
+    const tables: string[] = [];
+    await expect(
+      target.applyChangesetAsync(mixed, {
+        filter: (table) => {
+          tables.push(table);
+          if (table === "tags") {
+            throw error;
+          }
+          return true;
+        },
+      }),
+    ).rejects.toBe(error);
+    // items was applied before the filter threw, and is rolled back
+    expect(tables).toEqual(["items", "tags"]);
+    expect(count()).toBe(0);
+    expect(target.isTransaction).toBe(false);
+  });
+
+  test("copies the changeset before returning", async () => {
+    const buffer = new ArrayBuffer(changeset.length);
+    const copy = new Uint8Array(buffer);
+    copy.set(changeset);
+    const applied = target.applyChangesetAsync(copy);
+    // Detaches the caller's buffer while the worker reads
+    structuredClone(buffer, { transfer: [buffer] });
+    expect(copy.length).toBe(0);
+    await expect(applied).resolves.toBe(true);
+    expect(count()).toBe(5000);
+  });
+
+  test("validates arguments", async () => {
+    await expect(target.applyChangesetAsync("nope" as any)).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    await expect(
+      target.applyChangesetAsync(changeset, { progress: 1 as any }),
+    ).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    target.close();
+    await expect(target.applyChangesetAsync(changeset)).rejects.toThrow(
+      /not open/,
+    );
+  });
+});
@@ -0,0 +1,154 @@
+import { DatabaseSync } from "../src";
+
+describe("Asynchronous queries", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec(`
+      CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT, data BLOB);
+      INSERT INTO items (name, data) VALUES ('apple', x'0102'), ('pear', NULL);
+    `);
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("allAsync resolves with rows", async () => {
+    const rows = await db
+      .prepare("SELECT id, name, data FROM items ORDER BY id")
+      .allAsync();
+    expect(rows).toEqual([
+      { id: 1, name: "apple", data: Buffer.from([1, 2]) },
+      { id: 2, name: "pear", data: null },
+    ]);
+  });
+
+  test("allAsync binds positional and named parameters", async () => {
+    const positional = db.prepare("SELECT name FROM items WHERE id = ?");
+    expect(await positional.allAsync(2)).toEqual([{ name: "pear" }]);
+
+    const named = db.prepare("SELECT id FROM items WHERE name = :name");
+    expect(await named.allAsync({ ":name": "apple" })).toEqual([{ id: 1 }]);
+
+    named.setAllowBareNamedParameters(true);
+    expect(await named.allAsync({ name: "pear" })).toEqual([{ id: 2 }]);
+  });
+
+  test("allAsync honors statement configuration", async () => {
+    const stmt = db.prepare("SELECT id, name FROM items ORDER BY id LIMIT 1");
+    stmt.setReturnArrays(true);
+    stmt.setReadBigInts(true);
+    expect(await stmt.allAsync()).toEqual([[1n, "apple"]]);
+  });
+
+  test("runAsync reports changes and last insert rowid", async () => {
+    const stmt = db.prepare("INSERT INTO items (name) VALUES (?)");
+    expect(await stmt.runAsync("plum")).toEqual({
+      changes: 1,
+      lastInsertRowid: 3,
+    });
+  });
+
+  test("parameters are copied when the query is queued", async () => {
+    const stmt = db.prepare("INSERT INTO items (name) VALUES (:name)");
+    const params = { name: "first" };
+    stmt.setAllowBareNamedParameters(true);
+    const pending = stmt.runAsync(params);
+    params.name = "changed";
+    await pending;
+    expect(db.prepare("SELECT name FROM items WHERE id = 3").get()).toEqual({
+      name: "first",
+    });
+  });
+
+  test("execAsync runs SQL and queries run in call order", async () => {
+    const count = db.prepare("SELECT COUNT(*) AS n FROM items");
+    const results = await Promise.all([
+      db.execAsync("INSERT INTO items (name) VALUES ('plum')"),
+      count.allAsync(),
+      db.execAsync("DELETE FROM items"),
+      count.allAsync(),
+    ]);
+    expect(results[1]).toEqual([{ n: 3 }]);
+    expect(results[3]).toEqual([{ n: 0 }]);
+  });
+
+  test("synchronous calls throw while a query is pending", async () => {
+    const stmt = db.prepare("SELECT name FROM items");
+    const pending = stmt.allAsync();
+    expect(() => stmt.all()).toThrow(/busy with an asynchronous query/);
+    expect(() => db.exec("SELECT 1")).toThrow(/busy/);
+    expect(() => db.close()).toThrow(/busy/);
+    await pending;
+    expect(stmt.all()).toHaveLength(2);
+  });
+
+  test("SQLite errors reject with enhanced error information", async () => {
+    await expect(db.execAsync("SELECT * FROM missing")).rejects.toMatchObject({
+      message: expect.stringMatching(/no such table/),
+      code: "SQLITE_ERROR",
+    });
+    db.exec("CREATE UNIQUE INDEX items_name ON items (name)");
+    await expect(
+      db.prepare("INSERT INTO items (name) VALUES (?)").runAsync("apple"),
+    ).rejects.toThrow(/UNIQUE/);
+    // The connection is usable again once the query has settled
+    expect(db.prepare("SELECT COUNT(*) AS n FROM items").get()).toEqual({
+      n: 2,
+    });
+  });
+
+  test("user-defined functions cannot run asynchronously", async () => {
+    db.function("double", (x: number) => x * 2);
+    expect(db.prepare("SELECT double(2) AS v").get()).toEqual({ v: 4 });
+    const stmt = db.prepare("SELECT double(2) AS v");
+    await expect(stmt.allAsync()).rejects.toThrow(
+      /cannot run in asynchronous queries/,
+    );
+  });
+
+  test("named parameters use the statement's binding plan", async () => {
+    const stmt = db.prepare("SELECT :a AS a, $a AS b");
+    expect(await stmt.allAsync({ ":a": 1, $a: 2 })).toEqual([{ a: 1, b: 2 }]);
+    // Same keys as synchronous rows, from the statement's cache
+    expect(await stmt.allAsync({ ":a": 3 })).toEqual([{ a: 3, b: null }]);
+    expect(stmt.get({ ":a": 4, $a: 5 })).toEqual({ a: 4, b: 5 });
+
+    stmt.setAllowBareNamedParameters(true);
+    await expect(stmt.allAsync({ a: 1 })).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_STATE" }),
+    );
+  });
+
+  test("finalized statements reject", async () => {
+    const stmt = db.prepare("SELECT 1");
+    stmt.finalize();
+    await expect(stmt.allAsync()).rejects.toThrow(
+      expect.objectContaining({
+        code: "ERR_INVALID_STATE",
+        message: expect.stringMatching(/finalized/),
+      }),
+    );
+  });
+
+  test("invalid calls reject with error codes", async () => {
+    await expect(db.execAsync(1 as any)).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    await expect(db.execAsync("SELECT 1", 1 as any)).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    const stmt = db.prepare("SELECT 1");
+    db.close();
+    await expect(db.execAsync("SELECT 1")).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_STATE" }),
+    );
+    await expect(stmt.allAsync()).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_STATE" }),
+    );
+  });
+});
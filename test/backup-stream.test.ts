@@ -0,0 +1,189 @@
+import * as fs from "node:fs";
+import { PassThrough, Writable } from "node:stream";
+import { DatabaseSync } from "../src";
+import { useTempDir } from "./test-utils";
+
+describe("backupTo()", () => {
+  const { getDbPath, closeDatabases } = useTempDir("sqlite-backup-stream-");
+  let db: InstanceType<typeof DatabaseSync>;
+  let dbPath: string;
+  const opened: InstanceType<typeof DatabaseSync>[] = [];
+
+  beforeEach(() => {
+    dbPath = getDbPath("source.db");
+    db = new DatabaseSync(dbPath);
+    db.exec(`
+      PRAGMA journal_mode = WAL;
+      CREATE TABLE items (id INTEGER PRIMARY KEY, payload TEXT);
+      WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n LIMIT 2000)
+      INSERT INTO items (payload) SELECT printf('%.200c', 'x') FROM n;
+    `);
+  });
+
+  afterEach(() => {
+    closeDatabases(db, ...opened.splice(0));
+  });
+
+  // Opens a database file image. A WAL-mode image needs a real file.
+  function open(image: Buffer) {
+    const copyPath = getDbPath(`copy-${opened.length}.db`);
+    fs.writeFileSync(copyPath, image);
+    const copy = new DatabaseSync(copyPath);
+    opened.push(copy);
+    return copy;
+  }
+
+  const count = (target: InstanceType<typeof DatabaseSync>) =>
+    target.prepare("SELECT count(*) AS n FROM items").get().n;
+
+  function collector(options?: { highWaterMark?: number; delay?: number }) {
+    const chunks: Buffer[] = [];
+    let onFirstChunk: () => void;
+    const firstChunk = new Promise<void>((resolve) => (onFirstChunk = resolve));
+    const stream = new Writable({
+      highWaterMark: options?.highWaterMark,
+      write(chunk: Buffer, _encoding, callback) {
+        chunks.push(chunk);
+        onFirstChunk();
+        setTimeout(callback, options?.delay ?? 0);
+      },
+    });
+    return { stream, firstChunk, image: () => Buffer.concat(chunks) };
+  }
+
+  test("writes a complete database file to a stream", async () => {
+    const { stream, image } = collector();
+    const reports: { totalPages: number; remainingPages: number }[] = [];
+    const pages = await db.backupTo(stream, {
+      chunkSize: 8192,
+      progress: (info) => reports.push(info),
+    });
+    expect(() => db.exec("SELECT 1")).not.toThrow();
+
+    const pageSize = db.prepare("PRAGMA page_size").get().page_size;
+    expect(image().length).toBe(pages * pageSize);
+    expect(stream.writableFinished).toBe(true);
+    expect(count(open(image()))).toBe(2000);
+
+    expect(reports.length).toBeGreaterThan(1);
+    expect(reports[reports.length - 1]).toEqual({
+      totalPages: pages,
+      remainingPages: 0,
+    });
+  });
+
+  test("waits for a slow stream and keeps its snapshot", async () => {
+    const { stream, firstChunk, image } = collector({
+      highWaterMark: 1024,
+      delay: 2,
+    });
+    const other = new DatabaseSync(dbPath);
+    opened.push(other);
+
+    const backup = db.backupTo(stream, { chunkSize: 4096 });
+    expect(() => db.exec("SELECT 1")).toThrow(/busy/);
+    // Committed by another connection while the backup's read transaction
+    // is open, so not part of the snapshot
+    await firstChunk;
+    other.exec("DELETE FROM items WHERE id > 1000");
+    await backup;
+
+    expect(count(open(image()))).toBe(2000);
+    expect(count(db)).toBe(1000);
+  });
+
+  test("writes to a file descriptor", async () => {
+    const target = getDbPath("copy.db");
+    const fd = fs.openSync(target, "w");
+    try {
+      await db.backupTo(fd);
+    } finally {
+      fs.closeSync(fd);
+    }
+    const copy = open(fs.readFileSync(target));
+    expect(count(copy)).toBe(2000);
+    expect(copy.prepare("PRAGMA integrity_check").get()).toEqual({
+      integrity_check: "ok",
+    });
+  });
+
+  test("leaves the stream open with end: false", async () => {
+    const stream = new PassThrough();
+    const chunks: Buffer[] = [];
+    stream.on("data", (chunk: Buffer) => chunks.push(chunk));
+    await db.backupTo(stream, { end: false });
+    expect(stream.writableEnded).toBe(false);
+    stream.end();
+    expect(count(open(Buffer.concat(chunks)))).toBe(2000);
+  });
+
+  test("rejects when the stream fails", async () => {
+    const stream = new Writable({
+      write(_chunk, _encoding, callback) {
+        callback(new Error("disk full"));
+      },
+    });
+    stream.on("error", () => {});
+    await expect(db.backupTo(stream, { chunkSize: 1024 })).rejects.toThrow(
+      /disk full|closed/,
+    );
+    expect(() => db.exec("SELECT 1")).not.toThrow();
+  });
+
+  test("rejects inside a transaction", async () => {
+    db.exec("BEGIN; DELETE FROM items;");
+    const { stream } = collector();
+    await expect(db.backupTo(stream)).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_STATE" }),
+    );
+    db.exec("ROLLBACK");
+    expect(count(db)).toBe(2000);
+  });
+
+  test("sqlite_dbpage is read-only, with or without defensive mode", () => {
+    const update = "UPDATE sqlite_dbpage SET data = data WHERE pgno = 1";
+    const insert = "INSERT INTO sqlite_dbpage VALUES (1, zeroblob(4096))";
+    const alias = "CREATE VIRTUAL TABLE temp.pages USING sqlite_dbpage";
+    for (const options of [{}, { defensive: true }]) {
+      const conn = new DatabaseSync(dbPath, options);
+      opened.push(conn);
+      const pages = conn.prepare("SELECT count(*) AS n FROM sqlite_dbpage");
+      expect(pages.get().n).toBeGreaterThan(0);
+      for (const sql of [update, insert, alias]) {
+        expect(() => conn.exec(sql)).toThrow(/not authorized/);
+      }
+    }
+
+    // Defensive mode is opt-in: without it writable_schema still works
+    const writableSchema = (conn: InstanceType<typeof DatabaseSync>) => {
+      conn.exec("PRAGMA writable_schema = ON");
+      const { writable_schema: value } = conn
+        .prepare("PRAGMA writable_schema")
+        .get();
+      conn.exec("PRAGMA writable_schema = OFF");
+      return value;
+    };
+    expect(writableSchema(db)).toBe(1);
+    expect(writableSchema(opened[opened.length - 1]!)).toBe(0);
+    expect(
+      () => new DatabaseSync(dbPath, { defensive: "no" as any }),
+    ).toThrow(expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }));
+  });
+
+  test("validates arguments", async () => {
+    await expect(db.streamBackup("nope" as any)).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    await expect(db.streamBackup(-1)).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_OUT_OF_RANGE" }),
+    );
+    await expect(
+      db.streamBackup(() => {}, { chunkSize: 0 }),
+    ).rejects.toThrow(expect.objectContaining({ code: "ERR_OUT_OF_RANGE" }));
+    await expect(
+      db.streamBackup(() => {}, { source: "missing" }),
+    ).rejects.toThrow(/unknown database missing/);
+    db.close();
+    await expect(db.streamBackup(() => {})).rejects.toThrow(/not open/);
+  });
+});
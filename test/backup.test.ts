@@ -1,6 +1,6 @@
 import { describe, expect, it } from "@jest/globals";
 import * as fs from "node:fs";
-import { DatabaseSync } from "../src";
+import { DatabaseSync, type BackupProgress } from "../src";
 import { createTestDb, getTestTimeout, rm, useTempDir } from "./test-utils";
 
 describe("Backup functionality", () => {
@@ -198,6 +198,99 @@ describe("Backup functionality", () => {
     ).rejects.toThrow("must be a function");
   });
 
+  it("should pace steps to a target rate", async () => {
+    sourceDb.exec(`
+      CREATE TABLE filler (data BLOB);
+      WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n LIMIT 40)
+      INSERT INTO filler SELECT randomblob(4096) FROM n;
+    `);
+    const progress: BackupProgress[] = [];
+
+    const started = Date.now();
+    const totalPages = await sourceDb.backup(destPath, {
+      rate: 10,
+      pagesPerSecond: 200,
+      progress: (info) => progress.push(info),
+    });
+    const elapsed = Date.now() - started;
+
+    // Every page after the first step waits its turn at 200 pages/s
+    expect(elapsed).toBeGreaterThanOrEqual(((totalPages - 10) / 200) * 1000);
+    expect(progress.length).toBeGreaterThan(1);
+    for (const info of progress) {
+      expect(info.stepPages).toBe(10);
+      expect(info.pagesPerSecond).toBeGreaterThan(0);
+      expect(info.bytesPerSecond).toBeGreaterThan(0);
+    }
+
+    const destDb = new DatabaseSync(destPath);
+    testDatabases.add(destDb);
+    expect(destDb.prepare("SELECT COUNT(*) AS c FROM filler").get()).toEqual({
+      c: 40,
+    });
+  });
+
+  it("should complete an adaptive backup", async () => {
+    const progress: BackupProgress[] = [];
+    const totalPages = await sourceDb.backup(destPath, {
+      rate: 4,
+      adaptive: true,
+      maxStepTime: 1,
+      sleep: 1,
+      progress: (info) => progress.push(info),
+    });
+    expect(totalPages).toBeGreaterThan(0);
+    for (const info of progress) {
+      expect(info.stepPages).toBeGreaterThanOrEqual(1);
+      expect(info.stepPages).toBeLessThanOrEqual(4);
+    }
+
+    const destDb = new DatabaseSync(destPath);
+    testDatabases.add(destDb);
+    const count = destDb
+      .prepare("SELECT COUNT(*) as count FROM users")
+      .get() as { count: number };
+    expect(count.count).toBe(3);
+  });
+
+  it("should not hold a pool thread while paused", async () => {
+    // One paced backup per libuv pool thread, each from its own connection
+    const poolSize = Number(process.env.UV_THREADPOOL_SIZE) || 4;
+    let finished = 0;
+    const backups = Array.from({ length: poolSize }, (_, i) => {
+      const db = new DatabaseSync(sourcePath);
+      testDatabases.add(db);
+      return db
+        .backup(getDbPath(`paced-${i}.db`), { rate: 1, sleep: 200 })
+        .then(() => finished++);
+    });
+
+    // File system work needs a pool thread of its own
+    await fs.promises.readFile(sourcePath);
+    expect(finished).toBe(0);
+    await Promise.all(backups);
+    expect(finished).toBe(poolSize);
+  });
+
+  it("should reject invalid pacing options", async () => {
+    await expect(
+      sourceDb.backup(destPath, { pagesPerSecond: "fast" as any }),
+    ).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    await expect(
+      sourceDb.backup(destPath, { bytesPerSecond: -1 }),
+    ).rejects.toThrow(expect.objectContaining({ code: "ERR_OUT_OF_RANGE" }));
+    await expect(
+      sourceDb.backup(destPath, { maxStepTime: 0 }),
+    ).rejects.toThrow(expect.objectContaining({ code: "ERR_OUT_OF_RANGE" }));
+    await expect(
+      sourceDb.backup(destPath, { adaptive: "yes" as any }),
+    ).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+  });
+
   it("should handle concurrent backups", async () => {
     const destPath2 = getDbPath("destination2.db");
 
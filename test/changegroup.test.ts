@@ -0,0 +1,160 @@
+import {
+  ChangeGroup,
+  DatabaseSync,
+  Rebaser,
+  constants,
+  invertChangeset,
+} from "../src";
+
+const schema =
+  "CREATE TABLE items (id INTEGER PRIMARY KEY, payload TEXT, n INTEGER)";
+
+async function collect(chunks: AsyncIterable<Buffer>): Promise<Buffer[]> {
+  const result: Buffer[] = [];
+  for await (const chunk of chunks) {
+    result.push(chunk);
+  }
+  return result;
+}
+
+describe("ChangeGroup, Rebaser and invertChangeset", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec(schema);
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  function record(sql: string): Buffer {
+    const session = db.createSession();
+    db.exec(sql);
+    const changeset = session.changeset();
+    session.close();
+    return changeset;
+  }
+
+  const items = (target: InstanceType<typeof DatabaseSync>) =>
+    target.prepare("SELECT * FROM items ORDER BY id").all();
+
+  test("merges changesets into one minimal changeset", () => {
+    const changesets = [
+      record("INSERT INTO items VALUES (1, 'a', 0), (2, 'b', 0)"),
+      record("UPDATE items SET payload = 'a2', n = 1 WHERE id = 1"),
+      record("UPDATE items SET n = 2 WHERE id = 1"),
+      record("DELETE FROM items WHERE id = 2"),
+    ];
+
+    const group = new ChangeGroup();
+    for (const changeset of changesets) {
+      group.add(changeset);
+    }
+    const combined = group.output();
+    group.close();
+
+    const total = changesets.reduce((sum, c) => sum + c.length, 0);
+    expect(combined.length).toBeLessThan(total);
+
+    const target = new DatabaseSync(":memory:");
+    try {
+      target.exec(schema);
+      expect(target.applyChangeset(combined)).toBe(true);
+      expect(items(target)).toEqual(items(db));
+    } finally {
+      target.close();
+    }
+  });
+
+  test("streams input and output", async () => {
+    db.exec(`
+      WITH RECURSIVE s(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM s LIMIT 300)
+      INSERT INTO items SELECT i, printf('%.100c', 'x'), i FROM s;
+    `);
+    const session = db.createSession();
+    db.exec("UPDATE items SET n = n + 1");
+    const group = new ChangeGroup();
+    try {
+      const adding = group.addStream(session.changesetStream());
+      expect(() => group.output()).toThrow(/busy/);
+      await adding;
+
+      const expected = group.output();
+      const chunks = await collect(group.outputStream({ chunkSize: 1024 }));
+      expect(chunks.length).toBeGreaterThan(1);
+      expect(Buffer.concat(chunks)).toEqual(expected);
+    } finally {
+      session.close();
+      group.close();
+    }
+  });
+
+  test("invertChangeset() undoes a changeset", () => {
+    db.exec("INSERT INTO items VALUES (1, 'a', 0), (2, 'b', 0)");
+    const before = items(db);
+    const changeset = record(`
+      UPDATE items SET payload = 'changed' WHERE id = 1;
+      DELETE FROM items WHERE id = 2;
+      INSERT INTO items VALUES (3, 'c', 0);
+    `);
+
+    expect(db.applyChangeset(invertChangeset(changeset))).toBe(true);
+    expect(items(db)).toEqual(before);
+  });
+
+  test("a Rebaser keeps remote conflict resolutions", () => {
+    const base = "INSERT INTO items VALUES (1, 'base', 0)";
+    db.exec(base);
+    const remote = new DatabaseSync(":memory:");
+    try {
+      remote.exec(schema);
+      remote.exec(base);
+
+      const local = record("UPDATE items SET payload = 'local', n = 5");
+      const session = remote.createSession();
+      remote.exec("UPDATE items SET payload = 'remote'");
+      const incoming = session.changeset();
+      session.close();
+
+      const rebaser = new Rebaser();
+      expect(
+        db.applyChangeset(incoming, {
+          rebaser,
+          onConflict: () => constants.SQLITE_CHANGESET_REPLACE,
+        }),
+      ).toBe(true);
+      const rebased = rebaser.rebase(local);
+      rebaser.close();
+
+      expect(remote.applyChangeset(rebased)).toBe(true);
+      expect(items(remote)).toEqual([{ id: 1, payload: "remote", n: 5 }]);
+      expect(items(db)).toEqual(items(remote));
+    } finally {
+      remote.close();
+    }
+  });
+
+  test("validates arguments and state", async () => {
+    const group = new ChangeGroup();
+    expect(() => group.add("nope" as any)).toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    expect(() => group.add(Buffer.from("not a changeset"))).toThrow();
+    await expect(group.addStream(42 as any)).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    group.close();
+    expect(() => group.output()).toThrow(/not open/);
+
+    expect(() =>
+      db.applyChangeset(Buffer.alloc(0), { rebaser: {} as any }),
+    ).toThrow(expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }));
+    expect(() => invertChangeset(null as any)).toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+  });
+});
@@ -0,0 +1,171 @@
+import { Readable } from "node:stream";
+import { DatabaseSync, constants, type Session } from "../src";
+
+const schema = "CREATE TABLE items (id INTEGER PRIMARY KEY, payload TEXT)";
+
+async function collect(chunks: AsyncIterable<Buffer>): Promise<Buffer[]> {
+  const result: Buffer[] = [];
+  for await (const chunk of chunks) {
+    result.push(chunk);
+  }
+  return result;
+}
+
+describe("Streaming changesets", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+  let session: Session;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec(schema);
+    session = db.createSession();
+    db.exec(`
+      WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n LIMIT 500)
+      INSERT INTO items (payload) SELECT printf('%.200c', 'x') FROM n;
+    `);
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("changesetStream() yields the same bytes as changeset()", async () => {
+    const expected = session.changeset();
+    const chunks = await collect(session.changesetStream({ chunkSize: 4096 }));
+    expect(chunks.length).toBeGreaterThan(10);
+    for (const chunk of chunks.slice(0, -1)) {
+      expect(chunk.length).toBeGreaterThanOrEqual(4096);
+      expect(chunk.length).toBeLessThan(8192);
+    }
+    expect(Buffer.concat(chunks)).toEqual(expected);
+
+    const patchset = await collect(session.patchsetStream());
+    expect(Buffer.concat(patchset)).toEqual(session.patchset());
+  });
+
+  test("a large chunkSize yields a single chunk", async () => {
+    const chunks = await collect(
+      session.changesetStream({ chunkSize: 2 ** 31 - 1 }),
+    );
+    expect(chunks).toEqual([session.changeset()]);
+  });
+
+  test("applyChangesetStream() applies chunks from a stream", async () => {
+    const chunks = await collect(session.changesetStream({ chunkSize: 1000 }));
+    const target = new DatabaseSync(":memory:");
+    try {
+      target.exec(schema);
+      const applied = target.applyChangesetStream(Readable.from(chunks));
+      expect(() => target.exec("SELECT 1")).toThrow(/busy/);
+      await expect(applied).resolves.toBe(true);
+      expect(target.prepare("SELECT count(*) AS n FROM items").get()).toEqual({
+        n: 500,
+      });
+    } finally {
+      target.close();
+    }
+  });
+
+  test("streams directly from one connection to another", async () => {
+    const target = new DatabaseSync(":memory:");
+    try {
+      target.exec(schema);
+      target.exec("INSERT INTO items (id, payload) VALUES (1, 'mine')");
+      const conflicts: number[] = [];
+      const applied = await target.applyChangesetStream(
+        session.changesetStream(),
+        {
+          onConflict: async (type) => {
+            conflicts.push(type);
+            return constants.SQLITE_CHANGESET_OMIT;
+          },
+          filter: (table) => table === "items",
+        },
+      );
+      expect(applied).toBe(true);
+      expect(conflicts).toEqual([constants.SQLITE_CHANGESET_CONFLICT]);
+      expect(
+        target.prepare("SELECT payload FROM items WHERE id = 1").get(),
+      ).toEqual({ payload: "mine" });
+      expect(target.prepare("SELECT count(*) AS n FROM items").get()).toEqual({
+        n: 500,
+      });
+    } finally {
+      target.close();
+    }
+  });
+
+  test("resolves false when a conflict handler aborts", async () => {
+    const changeset = session.changeset();
+    const target = new DatabaseSync(":memory:");
+    try {
+      target.exec(schema);
+      target.exec("INSERT INTO items (id, payload) VALUES (1, 'mine')");
+      await expect(
+        target.applyChangesetStream([changeset], {
+          onConflict: () => constants.SQLITE_CHANGESET_ABORT,
+        }),
+      ).resolves.toBe(false);
+      expect(target.prepare("SELECT count(*) AS n FROM items").get()).toEqual({
+        n: 1,
+      });
+    } finally {
+      target.close();
+    }
+  });
+
+  test("stopping early releases the connection", async () => {
+    for await (const chunk of session.changesetStream({ chunkSize: 512 })) {
+      expect(chunk.length).toBeGreaterThanOrEqual(512);
+      break;
+    }
+    expect(db.prepare("SELECT count(*) AS n FROM items").get()).toEqual({
+      n: 500,
+    });
+  });
+
+  test("callback errors reject the promise", async () => {
+    const error = new Error("disk full");
+    await expect(
+      session.streamChangeset(() => Promise.reject(error)),
+    ).rejects.toBe(error);
+
+    async function* broken() {
+      yield session.changeset().subarray(0, 10);
+      throw new Error("connection reset");
+    }
+    const target = new DatabaseSync(":memory:");
+    try {
+      target.exec(schema);
+      await expect(target.applyChangesetStream(broken())).rejects.toThrow(
+        "connection reset",
+      );
+      expect(target.prepare("SELECT count(*) AS n FROM items").get()).toEqual({
+        n: 0,
+      });
+    } finally {
+      target.close();
+    }
+  });
+
+  test("validates arguments", async () => {
+    await expect(session.streamChangeset("nope" as any)).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    await expect(
+      session.streamChangeset(() => undefined, { chunkSize: 0 }),
+    ).rejects.toThrow(expect.objectContaining({ code: "ERR_OUT_OF_RANGE" }));
+    await expect(db.applyChangesetStream(42 as any)).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    await expect(db.applyChangesetStream(["text" as any])).rejects.toThrow(
+      /Buffers or Uint8Arrays/,
+    );
+    // Strings are iterable, but not a changeset
+    await expect(db.applyChangesetStream("abc" as any)).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+  });
+});
@@ -0,0 +1,143 @@
+import { DatabaseSync } from "../src";
+
+function isValid(validity: Uint8Array, row: number): boolean {
+  return (validity[row >> 3]! & (1 << (row % 8))) !== 0;
+}
+
+describe("Columnar Result Tests", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec(`
+      CREATE TABLE samples (
+        id INTEGER PRIMARY KEY,
+        small INTEGER,
+        large INTEGER,
+        reading REAL,
+        label TEXT,
+        payload BLOB
+      );
+      INSERT INTO samples VALUES
+        (1, 10, 9007199254740993, 1.5, 'a', x'01'),
+        (2, NULL, 5000000000, NULL, 'b', x'0203'),
+        (3, -30, -9007199254740993, 3.25, NULL, NULL);
+    `);
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("returns typed arrays for numeric columns", () => {
+    const result = db
+      .prepare("SELECT id, small, large, reading FROM samples ORDER BY id")
+      .allColumns();
+
+    expect(result.rowCount).toBe(3);
+    expect(result.columns.map((c) => c.name)).toEqual([
+      "id",
+      "small",
+      "large",
+      "reading",
+    ]);
+
+    const [id, small, large, reading] = result.columns;
+    expect(id!.kind).toBe("int32");
+    expect(Array.from(id!.values as Int32Array)).toEqual([1, 2, 3]);
+
+    expect(small!.kind).toBe("int32");
+    expect(Array.from(small!.values as Int32Array)).toEqual([10, 0, -30]);
+
+    expect(large!.kind).toBe("bigint64");
+    expect(Array.from(large!.values as BigInt64Array)).toEqual([
+      9007199254740993n,
+      5000000000n,
+      -9007199254740993n,
+    ]);
+
+    expect(reading!.kind).toBe("float64");
+    expect(Array.from(reading!.values as Float64Array)).toEqual([1.5, 0, 3.25]);
+  });
+
+  test("reports NULLs through the validity bitmap", () => {
+    const result = db
+      .prepare("SELECT small, reading FROM samples ORDER BY id")
+      .allColumns();
+    const [small, reading] = result.columns;
+
+    expect(small!.validity).toBeInstanceOf(Uint8Array);
+    expect(small!.validity.length).toBe(1);
+    expect([0, 1, 2].map((row) => isValid(small!.validity, row))).toEqual([
+      true,
+      false,
+      true,
+    ]);
+    expect([0, 1, 2].map((row) => isValid(reading!.validity, row))).toEqual([
+      true,
+      false,
+      true,
+    ]);
+  });
+
+  test("returns dense arrays for text and blob columns", () => {
+    const result = db
+      .prepare("SELECT label, payload FROM samples ORDER BY id")
+      .allColumns();
+    const [label, payload] = result.columns;
+
+    expect(label!.kind).toBe("text");
+    expect(label!.values).toEqual(["a", "b", null]);
+
+    expect(payload!.kind).toBe("blob");
+    expect(payload!.values).toEqual([
+      Buffer.from([1]),
+      Buffer.from([2, 3]),
+      null,
+    ]);
+  });
+
+  test("integers within the safe range widen to float64 with floats", () => {
+    const result = db
+      .prepare("SELECT 1 AS v UNION ALL SELECT 2.5 UNION ALL SELECT 5000000000")
+      .allColumns();
+    expect(result.columns[0]!.kind).toBe("float64");
+    expect(Array.from(result.columns[0]!.values as Float64Array)).toEqual([
+      1, 2.5, 5000000000,
+    ]);
+  });
+
+  test("mixed columns fall back to a plain array", () => {
+    const result = db
+      .prepare("SELECT 1 AS v UNION ALL SELECT 'two' UNION ALL SELECT NULL")
+      .allColumns();
+    expect(result.columns[0]!.kind).toBe("mixed");
+    expect(result.columns[0]!.values).toEqual([1, "two", null]);
+  });
+
+  test("setReadBigInts produces BigInt64Array integer columns", () => {
+    const stmt = db.prepare("SELECT id FROM samples ORDER BY id");
+    stmt.setReadBigInts(true);
+    const [id] = stmt.allColumns().columns;
+    expect(id!.kind).toBe("bigint64");
+    expect(Array.from(id!.values as BigInt64Array)).toEqual([1n, 2n, 3n]);
+  });
+
+  test("binds parameters and handles empty results", () => {
+    const result = db
+      .prepare("SELECT id, label FROM samples WHERE id > ?")
+      .allColumns(10);
+    expect(result.rowCount).toBe(0);
+    expect(result.columns.map((c) => c.kind)).toEqual(["null", "null"]);
+    expect(result.columns[0]!.values).toEqual([]);
+    expect(result.columns[0]!.validity.length).toBe(0);
+  });
+
+  test("throws on a finalized statement", () => {
+    const stmt = db.prepare("SELECT 1");
+    stmt.finalize();
+    expect(() => stmt.allColumns()).toThrow(/finalized/);
+  });
+});
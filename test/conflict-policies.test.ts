@@ -0,0 +1,171 @@
+import { DatabaseSync, constants } from "../src";
+
+const schema = `
+  CREATE TABLE notes (id INTEGER PRIMARY KEY, body TEXT, mtime INTEGER);
+  CREATE TABLE tags (id INTEGER PRIMARY KEY, name TEXT);
+`;
+
+describe("Changeset conflict policies", () => {
+  let source: InstanceType<typeof DatabaseSync>;
+  let target: InstanceType<typeof DatabaseSync>;
+  let changeset: Buffer;
+
+  beforeEach(() => {
+    source = new DatabaseSync(":memory:");
+    target = new DatabaseSync(":memory:");
+    source.exec(schema);
+    target.exec(schema);
+
+    const session = source.createSession();
+    source.exec(`
+      INSERT INTO notes VALUES (1, 'remote-old', 100), (2, 'remote-new', 300),
+                               (3, 'remote-only', 100);
+      INSERT INTO tags VALUES (1, 'remote'), (2, 'remote-only');
+    `);
+    changeset = session.changeset();
+    session.close();
+
+    target.exec(`
+      INSERT INTO notes VALUES (1, 'local-new', 200), (2, 'local-old', 200);
+      INSERT INTO tags VALUES (1, 'local');
+    `);
+  });
+
+  afterEach(() => {
+    source.close();
+    target.close();
+  });
+
+  const rows = (db: InstanceType<typeof DatabaseSync>, table: string) =>
+    db.prepare(`SELECT * FROM ${table} ORDER BY id`).all();
+
+  test("lastWriterWins keeps the row with the greater timestamp", () => {
+    const result = target.applyChangeset(changeset, {
+      policies: { notes: { lastWriterWins: "mtime" }, tags: "replace" },
+    });
+
+    expect(result).toEqual({
+      applied: true,
+      conflicts: 3,
+      replaced: 2,
+      omitted: 1,
+      byPolicy: {
+        replace: 1,
+        omit: 0,
+        abort: 0,
+        lastWriterWins: 2,
+        onConflict: 0,
+        default: 0,
+      },
+    });
+    expect(rows(target, "notes")).toEqual([
+      { id: 1, body: "local-new", mtime: 200 },
+      { id: 2, body: "remote-new", mtime: 300 },
+      { id: 3, body: "remote-only", mtime: 100 },
+    ]);
+    expect(rows(target, "tags")).toEqual([
+      { id: 1, name: "remote" },
+      { id: 2, name: "remote-only" },
+    ]);
+  });
+
+  test("onConflict only sees conflicts without a policy", () => {
+    const conflicts: number[] = [];
+    const result = target.applyChangeset(changeset, {
+      policies: { tags: "omit" },
+      onConflict: (type) => {
+        conflicts.push(type);
+        return constants.SQLITE_CHANGESET_REPLACE;
+      },
+    });
+
+    expect(conflicts).toEqual([
+      constants.SQLITE_CHANGESET_CONFLICT,
+      constants.SQLITE_CHANGESET_CONFLICT,
+    ]);
+    expect(result.byPolicy).toMatchObject({ omit: 1, onConflict: 2 });
+    expect(result.replaced).toBe(2);
+    expect(rows(target, "tags")).toEqual([
+      { id: 1, name: "local" },
+      { id: 2, name: "remote-only" },
+    ]);
+  });
+
+  test('"*" sets the policy for other tables', () => {
+    const result = target.applyChangeset(changeset, {
+      policies: { tags: "replace", "*": "abort" },
+    });
+
+    expect(result.applied).toBe(false);
+    expect(result.byPolicy.abort).toBe(1);
+    expect(rows(target, "notes")).toHaveLength(2);
+    expect(rows(target, "tags")).toEqual([{ id: 1, name: "local" }]);
+  });
+
+  test('"*" lastWriterWins skips tables without the column', () => {
+    const result = target.applyChangeset(changeset, {
+      policies: { "*": { lastWriterWins: "mtime" } },
+    });
+
+    expect(result.byPolicy).toMatchObject({ lastWriterWins: 2, default: 1 });
+    expect(rows(target, "tags")[0]).toEqual({ id: 1, name: "local" });
+  });
+
+  test("update conflicts compare the incoming timestamp", () => {
+    source.exec("DELETE FROM notes; DELETE FROM tags");
+    source.exec("INSERT INTO notes VALUES (1, 'base', 100)");
+    target.exec("DELETE FROM notes; DELETE FROM tags");
+    target.exec("INSERT INTO notes VALUES (1, 'edited-locally', 150)");
+
+    const session = source.createSession();
+    source.exec("UPDATE notes SET body = 'edited-remotely', mtime = 180");
+    const update = session.changeset();
+    session.close();
+
+    const result = target.applyChangeset(update, {
+      policies: { notes: { lastWriterWins: "mtime" } },
+    });
+    expect(result.replaced).toBe(1);
+    expect(rows(target, "notes")).toEqual([
+      { id: 1, body: "edited-remotely", mtime: 180 },
+    ]);
+  });
+
+  test("applyChangesetStream() decides natively", async () => {
+    const result = await target.applyChangesetStream([changeset], {
+      policies: { notes: { lastWriterWins: "mtime" }, tags: "replace" },
+    });
+    expect(result).toMatchObject({ applied: true, conflicts: 3, replaced: 2 });
+    expect(rows(target, "notes")[1]).toEqual({
+      id: 2,
+      body: "remote-new",
+      mtime: 300,
+    });
+  });
+
+  test("without policies the boolean result is unchanged", () => {
+    expect(target.applyChangeset(changeset)).toBe(true);
+  });
+
+  test("validates policies", async () => {
+    expect(() =>
+      target.applyChangeset(changeset, { policies: "replace" as any }),
+    ).toThrow(expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }));
+    expect(() =>
+      target.applyChangeset(changeset, { policies: { notes: "merge" as any } }),
+    ).toThrow(expect.objectContaining({ code: "ERR_INVALID_ARG_VALUE" }));
+    expect(() =>
+      target.applyChangeset(changeset, {
+        policies: { notes: { lastWriterWins: "missing" } },
+      }),
+    ).toThrow(/no column "missing"/);
+    await expect(
+      target.applyChangesetStream([changeset], {
+        policies: { tags: { lastWriterWins: "mtime" } },
+      }),
+    ).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_VALUE" }),
+    );
+    expect(rows(target, "notes")).toHaveLength(2);
+  });
+});
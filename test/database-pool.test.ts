@@ -0,0 +1,172 @@
+import { DatabasePool, DatabaseSync } from "../src";
+import { uniqueDbName, useTempDirSuite } from "./test-utils";
+
+describe("DatabasePool", () => {
+  const { getDbPath } = useTempDirSuite("sqlite-pool-");
+  let dbPath: string;
+  let pool: InstanceType<typeof DatabasePool>;
+
+  beforeEach(async () => {
+    dbPath = getDbPath(uniqueDbName());
+    pool = new DatabasePool(dbPath, { readers: 2 });
+    await pool.exec(
+      "CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT NOT NULL)",
+    );
+  });
+
+  afterEach(() => {
+    if (pool.isOpen) {
+      pool.close();
+    }
+  });
+
+  test("opens the database in WAL mode", async () => {
+    expect(pool.isOpen).toBe(true);
+    expect(pool.readers).toBe(2);
+    expect(await pool.get("PRAGMA journal_mode")).toEqual({
+      journal_mode: "wal",
+    });
+  });
+
+  test("writes are visible to subsequent reads", async () => {
+    const result = await pool.run(
+      "INSERT INTO items (name) VALUES (?)",
+      "apple",
+    );
+    expect(result).toEqual({ changes: 1, lastInsertRowid: 1 });
+    await pool.run("INSERT INTO items (name) VALUES (:name)", {
+      name: "pear",
+    });
+
+    expect(await pool.all("SELECT name FROM items ORDER BY id")).toEqual([
+      { name: "apple" },
+      { name: "pear" },
+    ]);
+    expect(await pool.get("SELECT name FROM items WHERE id = ?", 2)).toEqual({
+      name: "pear",
+    });
+    expect(await pool.get("SELECT name FROM items WHERE id = 99")).toBe(
+      undefined,
+    );
+  });
+
+  test("runs concurrent reads across readers", async () => {
+    for (let i = 0; i < 10; i++) {
+      await pool.run("INSERT INTO items (name) VALUES (?)", `item-${i}`);
+    }
+    const counts = await Promise.all(
+      Array.from({ length: 20 }, () =>
+        pool.get("SELECT count(*) AS n FROM items"),
+      ),
+    );
+    expect(counts).toEqual(Array(20).fill({ n: 10 }));
+  });
+
+  test("routes statements that write to the writer", async () => {
+    // all() and get() start on a reader, which hands writes back
+    expect(
+      await pool.all("INSERT INTO items (name) VALUES ('a') RETURNING id"),
+    ).toEqual([{ id: 1 }]);
+    expect(
+      await pool.get("INSERT INTO items (name) VALUES ('b') RETURNING id"),
+    ).toEqual({ id: 2 });
+    // A repeated statement goes straight to the writer
+    expect(
+      await pool.all("INSERT INTO items (name) VALUES ('a') RETURNING id"),
+    ).toEqual([{ id: 3 }]);
+  });
+
+  test("runs transactions on the writer", async () => {
+    // Each of these is read-only as far as sqlite3_stmt_readonly() goes
+    await pool.run("BEGIN");
+    await pool.run("INSERT INTO items (name) VALUES ('pending')");
+    // Readers see the last committed state
+    expect(await pool.get("SELECT count(*) AS n FROM items")).toEqual({
+      n: 0,
+    });
+    await pool.run("COMMIT");
+    expect(await pool.get("SELECT count(*) AS n FROM items")).toEqual({
+      n: 1,
+    });
+
+    await pool.run("  -- comment\n savepoint sp");
+    await pool.run("INSERT INTO items (name) VALUES ('undone')");
+    await pool.run("ROLLBACK TO sp");
+    await pool.run("RELEASE sp");
+    expect(await pool.all("SELECT name FROM items")).toEqual([
+      { name: "pending" },
+    ]);
+  });
+
+  test("keeps writes in call order", async () => {
+    // None of these statements has been seen by the pool before
+    const calls = [
+      pool.exec("BEGIN"),
+      pool.run("INSERT INTO items (name) VALUES ('first')"),
+      pool.run("UPDATE items SET name = 'second' WHERE name = 'first'"),
+      pool.exec("ROLLBACK"),
+    ];
+    await Promise.all(calls);
+    expect(await pool.get("SELECT count(*) AS n FROM items")).toEqual({
+      n: 0,
+    });
+
+    await Promise.all([
+      pool.exec("BEGIN"),
+      pool.run("INSERT INTO items (name) VALUES ('kept')"),
+      pool.exec("COMMIT"),
+    ]);
+    expect(await pool.all("SELECT name FROM items")).toEqual([
+      { name: "kept" },
+    ]);
+  });
+
+  test("is visible to other connections", async () => {
+    await pool.run("INSERT INTO items (name) VALUES (?)", "shared");
+    const db = new DatabaseSync(dbPath);
+    try {
+      expect(db.prepare("SELECT name FROM items").all()).toEqual([
+        { name: "shared" },
+      ]);
+    } finally {
+      db.close();
+    }
+  });
+
+  test("rejects with SQLite errors", async () => {
+    await expect(pool.all("SELECT * FROM missing")).rejects.toThrow(
+      /no such table/,
+    );
+    await pool.run("INSERT INTO items (id, name) VALUES (1, 'x')");
+    await expect(
+      pool.run("INSERT INTO items (id, name) VALUES (1, 'y')"),
+    ).rejects.toMatchObject({ sqliteCode: 19, sqliteExtendedCode: 1555 });
+  });
+
+  test("honours readBigInts and returnArrays", async () => {
+    pool.close();
+    pool = new DatabasePool(dbPath, { readBigInts: true, returnArrays: true });
+    await pool.run("INSERT INTO items (name) VALUES ('a')");
+    expect(await pool.all("SELECT id, name FROM items")).toEqual([[1n, "a"]]);
+  });
+
+  test("close() throws while queries are pending", async () => {
+    const pending = pool.all("SELECT * FROM items");
+    expect(() => pool.close()).toThrow(/busy with asynchronous queries/);
+    await pending;
+    pool.close();
+    expect(pool.isOpen).toBe(false);
+    expect(() => pool.close()).toThrow(/not open/);
+    await expect(pool.all("SELECT 1")).rejects.toThrow(/not open/);
+  });
+
+  test("validates arguments", () => {
+    expect(() => new DatabasePool(":memory:")).toThrow(/database file/);
+    expect(() => new DatabasePool(dbPath, { readers: 0 })).toThrow(
+      /options\.readers/,
+    );
+    expect(
+      () => new DatabasePool(dbPath, { readers: "2" as unknown as number }),
+    ).toThrow(/options\.readers/);
+  });
+});
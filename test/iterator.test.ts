@@ -173,4 +173,78 @@ describe("Statement Iterator Tests", () => {
 
     expect(results).toEqual([{ value: 100 }, { value: 200 }, { value: 300 }]);
   });
+
+  test("nextBatch returns rows in chunks and keeps the cursor open", () => {
+    const stmt = db.prepare("SELECT name FROM test_data ORDER BY id");
+    const iterator = stmt.iterate();
+
+    expect(iterator.nextBatch(2)).toEqual([{ name: "alice" }, { name: "bob" }]);
+    expect(iterator.nextBatch(2)).toEqual([{ name: "charlie" }]);
+    expect(iterator.nextBatch(2)).toEqual([]);
+    expect(iterator.next().done).toBe(true);
+  });
+
+  test("nextBatch can be mixed with next()", () => {
+    const stmt = db.prepare("SELECT value FROM test_data ORDER BY id");
+    const iterator = stmt.iterate();
+
+    expect(iterator.next().value).toEqual({ value: 100 });
+    expect(iterator.nextBatch()).toEqual([{ value: 200 }, { value: 300 }]);
+  });
+
+  test("nextBatch honors setReturnArrays", () => {
+    const stmt = db.prepare("SELECT id, name FROM test_data ORDER BY id");
+    stmt.setReturnArrays(true);
+    expect(stmt.iterate().nextBatch(10)).toEqual([
+      [1, "alice"],
+      [2, "bob"],
+      [3, "charlie"],
+    ]);
+  });
+
+  test("nextBatch validates its count argument", () => {
+    const iterator = db.prepare("SELECT * FROM test_data").iterate();
+    expect(() => iterator.nextBatch(0)).toThrow(/positive integer/);
+    expect(() => iterator.nextBatch(1.5)).toThrow(/positive integer/);
+    expect(() => iterator.nextBatch("2" as any)).toThrow(/must be a number/);
+  });
+
+  test("nextBatch ends the iteration on a step error", () => {
+    const iterator = db
+      .prepare(
+        "SELECT json(CASE WHEN id = 3 THEN '{' ELSE '1' END) AS j " +
+          "FROM test_data ORDER BY id",
+      )
+      .iterate();
+    expect(iterator.nextBatch(1)).toEqual([{ j: "1" }]);
+    let error: any;
+    try {
+      iterator.nextBatch(5);
+    } catch (e) {
+      error = e;
+    }
+    expect(error.message).toMatch(/malformed JSON/);
+    expect(error.code).toBe("SQLITE_ERROR");
+    expect(error.sqliteCode).toBe(1);
+    expect(iterator.nextBatch(5)).toEqual([]);
+    expect(iterator.next()).toEqual({ done: true, value: null });
+  });
+
+  test("iterator supports for await", async () => {
+    const stmt = db.prepare("SELECT name FROM test_data ORDER BY id");
+    const names: string[] = [];
+    for await (const row of stmt.iterate()) {
+      names.push(row.name);
+    }
+    expect(names).toEqual(["alice", "bob", "charlie"]);
+  });
+
+  test("for await resets the statement when the loop exits early", async () => {
+    const stmt = db.prepare("SELECT name FROM test_data ORDER BY id");
+    for await (const row of stmt.iterate()) {
+      expect(row.name).toBe("alice");
+      break;
+    }
+    expect(stmt.all()).toHaveLength(3);
+  });
 });
@@ -0,0 +1,155 @@
+import * as fs from "node:fs";
+import { DatabaseSync, type MaintenanceProgress } from "../src";
+import { useTempDir } from "./test-utils";
+
+describe("maintenance methods", () => {
+  const { getDbPath, closeDatabases } = useTempDir("sqlite-maintenance-");
+  let db: InstanceType<typeof DatabaseSync>;
+  const opened: InstanceType<typeof DatabaseSync>[] = [];
+
+  function create(autoVacuum = "NONE") {
+    db = new DatabaseSync(getDbPath("source.db"));
+    db.exec(`
+      PRAGMA auto_vacuum = ${autoVacuum};
+      CREATE TABLE items (id INTEGER PRIMARY KEY, kind INTEGER, payload TEXT);
+      CREATE INDEX items_kind ON items (kind);
+      CREATE TABLE tags (id INTEGER PRIMARY KEY, name TEXT UNIQUE);
+      WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n LIMIT 4000)
+      INSERT INTO items (kind, payload)
+        SELECT i % 10, printf('%.200c', 'x') FROM n;
+      INSERT INTO tags (name) VALUES ('a'), ('b'), ('c');
+    `);
+  }
+
+  afterEach(() => {
+    closeDatabases(db, ...opened.splice(0));
+  });
+
+  const pragma = (name: string) =>
+    db.prepare(`PRAGMA ${name}`).get()[name] as number;
+
+  test("vacuumInto() writes a compacted copy", async () => {
+    create();
+    db.exec("DELETE FROM items WHERE id > 1000");
+    const reports: MaintenanceProgress[] = [];
+    const target = getDbPath("copy.db");
+    const vacuum = db.vacuumInto(target, {
+      progress: (info) => reports.push(info),
+    });
+    expect(() => db.exec("SELECT 1")).not.toThrow();
+    const pages = await vacuum;
+
+    expect(pages).toBeLessThan(pragma("page_count"));
+    expect(fs.statSync(target).size).toBe(pages * pragma("page_size"));
+    const copy = new DatabaseSync(target);
+    opened.push(copy);
+    expect(copy.prepare("SELECT count(*) AS n FROM items").get().n).toBe(1000);
+
+    expect(reports.length).toBeGreaterThan(0);
+    expect(reports[reports.length - 1]).toEqual({ done: pages, total: pages });
+  });
+
+  test("vacuumInto() does not overwrite an existing file", async () => {
+    create();
+    const target = getDbPath("existing.db");
+    fs.writeFileSync(target, "not empty");
+    await expect(db.vacuumInto(target)).rejects.toThrow(
+      expect.objectContaining({ code: "SQLITE_ERROR" }),
+    );
+  });
+
+  test("incrementalVacuum() empties the free list in steps", async () => {
+    create("INCREMENTAL");
+    db.exec("DELETE FROM items WHERE id > 1000");
+    const free = pragma("freelist_count");
+    expect(free).toBeGreaterThan(100);
+
+    const reports: MaintenanceProgress[] = [];
+    const released = await db.incrementalVacuum({
+      pages: 32,
+      progress: (info) => reports.push(info),
+    });
+    expect(released).toBe(free);
+    expect(pragma("freelist_count")).toBe(0);
+    expect(db.prepare("SELECT count(*) AS n FROM items").get().n).toBe(1000);
+
+    expect(reports.length).toBeGreaterThan(2);
+    expect(reports[reports.length - 1]).toEqual({ done: free, total: free });
+  });
+
+  test("incrementalVacuum() stops at maxPages", async () => {
+    create("INCREMENTAL");
+    db.exec("DELETE FROM items WHERE id > 1000");
+    const free = pragma("freelist_count");
+    await expect(db.incrementalVacuum({ maxPages: 10 })).resolves.toBe(10);
+    expect(pragma("freelist_count")).toBe(free - 10);
+  });
+
+  test("incrementalVacuum() needs auto_vacuum = INCREMENTAL", async () => {
+    create();
+    await expect(db.incrementalVacuum()).rejects.toThrow(
+      /auto_vacuum = INCREMENTAL/,
+    );
+  });
+
+  test("reindex() reports each table", async () => {
+    create();
+    const reports: MaintenanceProgress[] = [];
+    await expect(
+      db.reindex({ progress: (info) => reports.push(info) }),
+    ).resolves.toBe(2);
+    expect(reports[reports.length - 1]).toEqual({ done: 2, total: 2 });
+    await expect(db.reindex({ target: "items_kind" })).resolves.toBe(1);
+  });
+
+  test("reindex() explains indexes on app-defined functions", async () => {
+    create();
+    db.function("parity", { deterministic: true }, (kind: number) => kind % 2);
+    db.exec("CREATE INDEX items_parity ON items (parity(kind))");
+    await expect(db.reindex()).rejects.toThrow(
+      /items: no such function: parity\. Maintenance runs on a separate/,
+    );
+    expect(() => db.exec("REINDEX items")).not.toThrow();
+  });
+
+  test("analyze() refreshes statistics on this connection", async () => {
+    create();
+    await expect(db.analyze({ analysisLimit: 100 })).resolves.toBe(2);
+    const stats = db
+      .prepare("SELECT tbl, idx FROM sqlite_stat1 ORDER BY idx")
+      .all();
+    expect(stats).toEqual([
+      { tbl: "items", idx: "items_kind" },
+      { tbl: "tags", idx: "sqlite_autoindex_tags_1" },
+    ]);
+    await expect(db.analyze({ target: "tags" })).resolves.toBe(1);
+  });
+
+  test("validates arguments", async () => {
+    create();
+    await expect(db.vacuumInto(1 as any)).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    await expect(db.analyze({ timeout: "1" as any })).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    await expect(db.incrementalVacuum({ pages: 0 })).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_OUT_OF_RANGE" }),
+    );
+    await expect(db.reindex({ progress: 1 as any })).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    await expect(db.analyze({ schema: "missing" })).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_VALUE" }),
+    );
+    db.close();
+    await expect(db.reindex()).rejects.toThrow(/not open/);
+  });
+
+  test("needs a database file", async () => {
+    db = new DatabaseSync(":memory:");
+    await expect(db.analyze()).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_STATE" }),
+    );
+  });
+});
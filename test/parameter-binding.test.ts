@@ -0,0 +1,85 @@
+import { DatabaseSync } from "../src";
+
+describe("Parameter Binding Tests", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec("CREATE TABLE docs (id INTEGER PRIMARY KEY, body TEXT, data BLOB)");
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("round-trips large text and blob parameters", () => {
+    const body = JSON.stringify({ items: "x".repeat(100_000) });
+    const data = Buffer.alloc(64 * 1024, 7);
+    db.prepare("INSERT INTO docs (body, data) VALUES (?, ?)").run(body, data);
+
+    const row = db.prepare("SELECT body, data FROM docs").get();
+    expect(row.body).toBe(body);
+    expect(Buffer.compare(row.data, data)).toBe(0);
+  });
+
+  test("round-trips text with multi-byte characters and embedded NULs", () => {
+    const text = "héllo 🌍 \u0000 wörld";
+    const row = db.prepare("SELECT ? AS value").get(text);
+    expect(row.value).toBe(text);
+  });
+
+  test("binds empty strings as empty text", () => {
+    const row = db.prepare("SELECT typeof(?) AS t, ? AS v").get("", "");
+    expect(row).toEqual({ t: "text", v: "" });
+  });
+
+  test("reusing a statement does not leak earlier text parameters", () => {
+    const insert = db.prepare("INSERT INTO docs (body) VALUES (?)");
+    for (let i = 0; i < 1000; i++) {
+      insert.run(`document ${i} `.repeat(i % 50));
+    }
+    const rows = db.prepare("SELECT body FROM docs ORDER BY id").all();
+    expect(rows).toHaveLength(1000);
+    for (let i = 0; i < 1000; i++) {
+      expect(rows[i].body).toBe(`document ${i} `.repeat(i % 50));
+    }
+  });
+
+  test("iterate keeps bound strings and Buffers valid across next()", () => {
+    db.exec("INSERT INTO docs (body, data) VALUES ('a', x'01'), ('b', x'02')");
+    const stmt = db.prepare(
+      "SELECT body FROM docs WHERE body >= ? AND data >= ? ORDER BY id",
+    );
+    const iterator = stmt.iterate("a".slice(0), Buffer.from([1]));
+    expect(iterator.next().value).toEqual({ body: "a" });
+    expect(iterator.next().value).toEqual({ body: "b" });
+    expect(iterator.next().done).toBe(true);
+  });
+
+  test("bound Buffers survive being detached or modified", () => {
+    db.exec("INSERT INTO docs (data) VALUES (x'0102'), (x'0102')");
+    const key = Buffer.from(new Uint8Array([1, 2]).buffer);
+    const stmt = db.prepare("SELECT id FROM docs WHERE data = ? ORDER BY id");
+    const iterator = stmt.iterate(key);
+    expect(iterator.next().value).toEqual({ id: 1 });
+    key[0] = 9;
+    structuredClone(key.buffer, { transfer: [key.buffer] });
+    expect(key.length).toBe(0);
+    expect(iterator.next().value).toEqual({ id: 2 });
+    expect(iterator.next().done).toBe(true);
+  });
+
+  test("parameters not given on a later call are unbound", () => {
+    const stmt = db.prepare("SELECT ? AS a, ? AS b");
+    expect(stmt.get("x", "y")).toEqual({ a: "x", b: "y" });
+    expect(stmt.iterate("z").next().value).toEqual({ a: "z", b: null });
+  });
+
+  test("expandedSQL reflects the bound values", () => {
+    const stmt = db.prepare("SELECT ? AS a, ? AS b");
+    stmt.get("text", Buffer.from("hi"));
+    expect(stmt.expandedSQL).toBe("SELECT 'text' AS a, x'6869' AS b");
+  });
+});
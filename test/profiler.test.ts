@@ -0,0 +1,91 @@
+import { DatabaseSync } from "../src";
+
+describe("Query profiler", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec("CREATE TABLE t (id INTEGER PRIMARY KEY, v TEXT)");
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("records nothing until enabled", () => {
+    db.exec("SELECT * FROM t");
+    expect(db.profile()).toEqual([]);
+  });
+
+  test("groups executions by normalized SQL", () => {
+    db.enableProfiler();
+    const insert = db.prepare("INSERT INTO t (v) VALUES (?)");
+    for (let i = 0; i < 50; i++) {
+      insert.run(`value-${i}`);
+    }
+    db.exec("SELECT * FROM t WHERE id = 1");
+    db.exec("SELECT * FROM t WHERE id = 2");
+
+    const profile = db.profile({ limit: 100 });
+    const inserts = profile.find((entry) => /INSERT/i.test(entry.sql));
+    expect(inserts?.count).toBe(50);
+
+    const selects = profile.find((entry) => /WHERE/i.test(entry.sql));
+    expect(selects?.count).toBe(2);
+    expect(selects?.sql).toContain("?");
+    expect(selects?.sql).not.toMatch(/[12]/);
+
+    for (const entry of profile) {
+      expect(entry.histogram).toHaveLength(24);
+      expect(entry.histogram.reduce((a, b) => a + b, 0)).toBe(entry.count);
+      expect(entry.minTime).toBeGreaterThanOrEqual(0);
+      expect(entry.maxTime).toBeGreaterThanOrEqual(entry.minTime);
+      expect(entry.totalTime).toBeGreaterThanOrEqual(entry.maxTime);
+    }
+    for (let i = 1; i < profile.length; i++) {
+      expect(profile[i - 1]!.totalTime).toBeGreaterThanOrEqual(
+        profile[i]!.totalTime,
+      );
+    }
+  });
+
+  test("profile() honours limit and reset", () => {
+    db.enableProfiler();
+    db.exec("SELECT 1; SELECT 'a'; SELECT * FROM t");
+
+    expect(db.profile({ limit: 1 })).toHaveLength(1);
+    expect(db.profile({ reset: true }).length).toBeGreaterThanOrEqual(3);
+    expect(db.profile()).toEqual([]);
+  });
+
+  test("enableProfiler(false) stops recording but keeps data", () => {
+    db.enableProfiler();
+    db.exec("SELECT * FROM t");
+    db.enableProfiler(false);
+    db.exec("SELECT * FROM t");
+    db.exec("SELECT v FROM t");
+
+    const profile = db.profile();
+    expect(profile).toHaveLength(1);
+    expect(profile[0]!.count).toBe(1);
+  });
+
+  test("profiles asynchronous queries", async () => {
+    db.enableProfiler();
+    await db.execAsync("SELECT * FROM t WHERE id = 5");
+    expect(db.profile()[0]?.count).toBe(1);
+  });
+
+  test("validates arguments", () => {
+    expect(() => db.enableProfiler("yes" as any)).toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    expect(() => db.profile({ limit: -1 })).toThrow(
+      expect.objectContaining({ code: "ERR_OUT_OF_RANGE" }),
+    );
+    db.close();
+    expect(() => db.enableProfiler()).toThrow(/not open/);
+  });
+});
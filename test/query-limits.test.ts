@@ -0,0 +1,135 @@
+import { DatabaseSync } from "../src";
+
+// Never finishes on its own
+const endless = `
+  WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c)
+  SELECT count(*) FROM c`;
+
+// Runs a few million instructions
+const counting = `
+  WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c LIMIT 100000)
+  SELECT count(*) AS n FROM c`;
+
+describe("Query limits and interruption", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("exec() stops at a per-call time limit", () => {
+    const start = Date.now();
+    expect(() => db.exec(endless, { timeLimit: 50 })).toThrow(
+      expect.objectContaining({
+        code: "ERR_SQLITE_TIME_LIMIT",
+        sqliteCode: 9,
+        message: "Query exceeded its time limit of 50 ms",
+      }),
+    );
+    expect(Date.now() - start).toBeLessThan(5000);
+
+    // The connection stays usable
+    expect(db.prepare("SELECT 1 AS one").get()).toEqual({ one: 1 });
+  });
+
+  test("connection limits apply to statements", () => {
+    db.close();
+    db = new DatabaseSync(":memory:", { instructionLimit: 10000 });
+    const stmt = db.prepare(counting);
+    expect(() => stmt.get()).toThrow(
+      expect.objectContaining({ code: "ERR_SQLITE_INSTRUCTION_LIMIT" }),
+    );
+    expect(() => stmt.all()).toThrow(/limit of 10000 instructions/);
+    expect(() => stmt.iterate().next()).toThrow(/10000 instructions/);
+
+    // Small queries are unaffected
+    expect(db.prepare("SELECT 1 AS one").get()).toEqual({ one: 1 });
+  });
+
+  test("setQueryLimits() overrides the connection's limits", () => {
+    db.close();
+    db = new DatabaseSync(":memory:", { instructionLimit: 10000 });
+    const stmt = db.prepare(counting);
+
+    stmt.setQueryLimits({ instructionLimit: 0 });
+    expect(stmt.get()).toEqual({ n: 100000 });
+
+    stmt.setQueryLimits();
+    expect(() => stmt.get()).toThrow(/10000 instructions/);
+  });
+
+  test("per-call limits override connection limits", () => {
+    db.close();
+    db = new DatabaseSync(":memory:", { timeLimit: 60000 });
+    expect(() => db.exec(counting, { instructionLimit: 1000 })).toThrow(
+      expect.objectContaining({ code: "ERR_SQLITE_INSTRUCTION_LIMIT" }),
+    );
+    expect(() => db.exec(counting)).not.toThrow();
+  });
+
+  test("limits apply to asynchronous queries", async () => {
+    await expect(db.execAsync(endless, { timeLimit: 50 })).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_SQLITE_TIME_LIMIT" }),
+    );
+
+    const stmt = db.prepare(counting);
+    stmt.setQueryLimits({ instructionLimit: 1000 });
+    await expect(stmt.allAsync()).rejects.toThrow(
+      expect.objectContaining({ code: "ERR_SQLITE_INSTRUCTION_LIMIT" }),
+    );
+  });
+
+  test("interrupt() stops a running asynchronous query", async () => {
+    const stmt = db.prepare(endless);
+    const query = stmt.allAsync();
+    let settled = false;
+    query.catch(() => undefined).finally(() => (settled = true));
+
+    // The query may not have started stepping yet, so keep interrupting
+    const timer = setInterval(() => {
+      if (!settled) db.interrupt();
+    }, 10);
+    try {
+      await expect(query).rejects.toThrow(
+        expect.objectContaining({ code: "SQLITE_INTERRUPT" }),
+      );
+    } finally {
+      clearInterval(timer);
+    }
+
+    expect(db.prepare("SELECT 1 AS one").get()).toEqual({ one: 1 });
+  });
+
+  test("DatabaseSync.interrupt() finds connections by handle", () => {
+    const other = new DatabaseSync(":memory:");
+    const handle = other.interruptHandle;
+    expect(typeof handle).toBe("number");
+    expect(handle).not.toBe(db.interruptHandle);
+
+    // Nothing is running, so this is a no-op
+    expect(DatabaseSync.interrupt(handle)).toBe(true);
+    expect(other.prepare("SELECT 1 AS one").get()).toEqual({ one: 1 });
+
+    other.close();
+    expect(DatabaseSync.interrupt(handle)).toBe(false);
+    expect(DatabaseSync.interrupt(0)).toBe(false);
+  });
+
+  test("validates limits", () => {
+    expect(() => db.exec("SELECT 1", { timeLimit: -1 })).toThrow(
+      expect.objectContaining({ code: "ERR_OUT_OF_RANGE" }),
+    );
+    expect(
+      () => new DatabaseSync(":memory:", { instructionLimit: "1" as any }),
+    ).toThrow(expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }));
+    expect(() => db.prepare("SELECT 1").setQueryLimits(5 as any)).toThrow(
+      /"limits" argument must be an object/,
+    );
+  });
+});
@@ -0,0 +1,83 @@
+import { DatabaseSync } from "../src";
+
+describe("Result Row Shape Tests", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec(`
+      CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT, price REAL);
+      INSERT INTO items (name, price) VALUES ('apple', 1.5), ('pear', 2.25);
+    `);
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("rows have column names as keys in column order", () => {
+    const rows = db.prepare("SELECT id, name, price FROM items").all();
+    expect(rows).toEqual([
+      { id: 1, name: "apple", price: 1.5 },
+      { id: 2, name: "pear", price: 2.25 },
+    ]);
+    for (const row of rows) {
+      expect(Object.keys(row)).toEqual(["id", "name", "price"]);
+    }
+  });
+
+  test("row properties are ordinary writable and enumerable properties", () => {
+    const row = db.prepare("SELECT id, name FROM items WHERE id = 1").get();
+    const descriptor = Object.getOwnPropertyDescriptor(row, "name");
+    expect(descriptor).toEqual({
+      value: "apple",
+      writable: true,
+      enumerable: true,
+      configurable: true,
+    });
+    row.name = "changed";
+    delete row.id;
+    expect(row).toEqual({ name: "changed" });
+  });
+
+  test("duplicate column names keep the last value", () => {
+    const row = db.prepare("SELECT 1 AS a, 2 AS a").get();
+    expect(row).toEqual({ a: 2 });
+  });
+
+  test("get, all and iterate share cached column keys", () => {
+    const stmt = db.prepare("SELECT name AS fruit FROM items ORDER BY id");
+    expect(stmt.get()).toEqual({ fruit: "apple" });
+    expect(stmt.all()).toEqual([{ fruit: "apple" }, { fruit: "pear" }]);
+    expect([...stmt.iterate()]).toEqual([
+      { fruit: "apple" },
+      { fruit: "pear" },
+    ]);
+  });
+
+  test("all() reuses cached column keys across calls", () => {
+    const stmt = db.prepare("SELECT id, name FROM items ORDER BY id");
+    const expected = [
+      { id: 1, name: "apple" },
+      { id: 2, name: "pear" },
+    ];
+    expect(stmt.all()).toEqual(expected);
+    expect(stmt.all()).toEqual(expected);
+    expect(stmt.get()).toEqual(expected[0]);
+  });
+
+  test("column keys are rebuilt after a schema change re-prepares", () => {
+    const stmt = db.prepare("SELECT * FROM items ORDER BY id LIMIT 1");
+    expect(stmt.get()).toEqual({ id: 1, name: "apple", price: 1.5 });
+
+    db.exec("ALTER TABLE items ADD COLUMN color TEXT DEFAULT 'green'");
+    expect(stmt.get()).toEqual({
+      id: 1,
+      name: "apple",
+      price: 1.5,
+      color: "green",
+    });
+  });
+});
@@ -0,0 +1,157 @@
+import { DatabaseSync } from "../src";
+
+describe("StatementSync.runColumns", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec(`
+      CREATE TABLE samples (sensor INTEGER, ts INTEGER, value REAL, note TEXT)
+    `);
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("binds each row from parallel typed arrays", () => {
+    const stmt = db.prepare(
+      "INSERT INTO samples (sensor, ts, value) VALUES (?, ?, ?)",
+    );
+    const sensor = new Int32Array([1, 2, 3]);
+    const ts = new BigInt64Array([
+      1700000000000n,
+      1700000000001n,
+      9007199254740993n,
+    ]);
+    const value = new Float64Array([0.5, 2, -1.25]);
+
+    const result = stmt.runColumns([sensor, ts, value], 3);
+    expect(result).toEqual({ changes: 3, lastInsertRowid: 3 });
+
+    const rows = db
+      .prepare(
+        "SELECT sensor, ts, value, typeof(value) AS kind FROM samples " +
+          "ORDER BY rowid",
+      )
+      .all();
+    expect(rows).toEqual([
+      { sensor: 1, ts: 1700000000000, value: 0.5, kind: "real" },
+      // Integral doubles bind as integers, like numbers passed to run()
+      { sensor: 2, ts: 1700000000001, value: 2, kind: "integer" },
+      { sensor: 3, ts: 9007199254740993n, value: -1.25, kind: "real" },
+    ]);
+  });
+
+  test("honors typed array views and row count", () => {
+    const stmt = db.prepare(
+      "INSERT INTO samples (sensor, value) VALUES (?, ?)",
+    );
+    const buffer = new Float64Array([9, 9, 1.5, 2.5, 3.5]);
+    const view = new Float64Array(buffer.buffer, 2 * 8, 3);
+    const sensors = new Uint16Array([7, 8, 9, 10]);
+
+    expect(stmt.runColumns([sensors, view], 2).changes).toBe(2);
+    expect(
+      db.prepare("SELECT sensor, value FROM samples ORDER BY rowid").all(),
+    ).toEqual([
+      { sensor: 7, value: 1.5 },
+      { sensor: 8, value: 2.5 },
+    ]);
+  });
+
+  test("NaN and missing columns bind as NULL", () => {
+    const stmt = db.prepare(
+      "INSERT INTO samples (value, sensor, note) VALUES (?, ?, ?)",
+    );
+    stmt.runColumns([new Float32Array([NaN, 0.5])], 2);
+    const rows = db
+      .prepare("SELECT value, sensor, note FROM samples ORDER BY rowid")
+      .all();
+    expect(rows).toEqual([
+      { value: null, sensor: null, note: null },
+      { value: 0.5, sensor: null, note: null },
+    ]);
+  });
+
+  test("large unsigned values bind as text", () => {
+    const stmt = db.prepare("INSERT INTO samples (note) VALUES (?)");
+    stmt.runColumns([new BigUint64Array([18446744073709551615n])], 1);
+    expect(db.prepare("SELECT note FROM samples").get()).toEqual({
+      note: "18446744073709551615",
+    });
+  });
+
+  test("keeps binding after a function detaches a column", () => {
+    const sensors = new Int32Array([1, 2, 3]);
+    db.function("detach", (value: number) => {
+      if (sensors.length > 0) {
+        structuredClone(sensors.buffer, { transfer: [sensors.buffer] });
+      }
+      return value;
+    });
+    const stmt = db.prepare(
+      "INSERT INTO samples (sensor, value) VALUES (?, detach(?))",
+    );
+    stmt.runColumns([sensors, new Float64Array([0.5, 1.5, 2.5])], 3);
+    expect(sensors.length).toBe(0);
+    expect(
+      db.prepare("SELECT sensor, value FROM samples ORDER BY rowid").all(),
+    ).toEqual([
+      { sensor: 1, value: 0.5 },
+      { sensor: 2, value: 1.5 },
+      { sensor: 3, value: 2.5 },
+    ]);
+  });
+
+  test("reads options before binding from the columns", () => {
+    const sensors = new Int32Array([1, 2]);
+    const stmt = db.prepare("INSERT INTO samples (sensor) VALUES (?)");
+    const options = {
+      get transaction() {
+        structuredClone(sensors.buffer, { transfer: [sensors.buffer] });
+        return false;
+      },
+    };
+    expect(() => stmt.runColumns([sensors], 2, options)).toThrow(
+      /fewer than 2 elements/,
+    );
+    expect(db.prepare("SELECT COUNT(*) AS n FROM samples").get().n).toBe(0);
+  });
+
+  test("transaction option rolls back on failure", () => {
+    db.exec("CREATE UNIQUE INDEX samples_sensor ON samples (sensor)");
+    const stmt = db.prepare("INSERT INTO samples (sensor) VALUES (?)");
+    let error: any;
+    try {
+      stmt.runColumns([new Int32Array([1, 2, 1])], 3, { transaction: true });
+    } catch (e) {
+      error = e;
+    }
+    expect(error.message).toMatch(/UNIQUE/);
+    expect(error.failedIndex).toBe(2);
+    expect(error.changes).toBe(0);
+    expect(db.prepare("SELECT COUNT(*) AS n FROM samples").get().n).toBe(0);
+  });
+
+  test("validates arguments", () => {
+    const stmt = db.prepare("INSERT INTO samples (sensor) VALUES (?)");
+    expect(() => stmt.runColumns([[1, 2] as any], 2)).toThrow(
+      /only typed arrays/,
+    );
+    expect(() => stmt.runColumns([new Int32Array(1)], 2)).toThrow(
+      /fewer than 2 elements/,
+    );
+    expect(() =>
+      stmt.runColumns([new Int32Array(1), new Int32Array(1)], 1),
+    ).toThrow(/more entries than the statement has parameters/);
+    expect(() => stmt.runColumns([new Int32Array(1)], -1)).toThrow(
+      /non-negative integer/,
+    );
+    expect(() => (stmt as any).runColumns([new Int32Array(1)])).toThrow(
+      /must be a number/,
+    );
+  });
+});
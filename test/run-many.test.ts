@@ -0,0 +1,150 @@
+import { DatabaseSync } from "../src";
+
+describe("StatementSync.runMany", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec(`
+      CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT UNIQUE, qty INTEGER)
+    `);
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  const count = () =>
+    db.prepare("SELECT COUNT(*) AS n FROM items").get().n as number;
+
+  test("executes positional rows and aggregates changes", () => {
+    const stmt = db.prepare("INSERT INTO items (name, qty) VALUES (?, ?)");
+    const result = stmt.runMany([
+      ["apple", 1],
+      ["pear", 2],
+      ["plum", 3],
+    ]);
+    expect(result).toEqual({ changes: 3, lastInsertRowid: 3 });
+    expect(db.prepare("SELECT name, qty FROM items ORDER BY id").all()).toEqual(
+      [
+        { name: "apple", qty: 1 },
+        { name: "pear", qty: 2 },
+        { name: "plum", qty: 3 },
+      ],
+    );
+  });
+
+  test("accepts named-parameter objects and single values", () => {
+    const named = db.prepare("INSERT INTO items (name, qty) VALUES (:n, :q)");
+    expect(
+      named.runMany([
+        { n: "apple", q: 1 },
+        { ":n": "pear", ":q": 2 },
+      ]).changes,
+    ).toBe(2);
+
+    const single = db.prepare("DELETE FROM items WHERE name = ?");
+    expect(single.runMany(["apple", "missing", "pear"]).changes).toBe(2);
+    expect(count()).toBe(0);
+  });
+
+  test("counts only the changes each row made", () => {
+    db.exec("INSERT INTO items (name, qty) VALUES ('apple', 1), ('pear', 2)");
+    // The last INSERT's count must not leak into statements that change
+    // nothing
+    const select = db.prepare("SELECT qty FROM items WHERE name = ?");
+    expect(select.runMany(["apple", "pear"]).changes).toBe(0);
+    const noMatch = db.prepare("UPDATE items SET qty = 0 WHERE name = ?");
+    expect(noMatch.runMany(["fig", "kiwi"]).changes).toBe(0);
+
+    const returning = db.prepare(
+      "UPDATE items SET qty = qty + 1 WHERE qty >= ? RETURNING id",
+    );
+    expect(returning.runMany([2, 1]).changes).toBe(3);
+    expect(
+      db.prepare("SELECT qty FROM items ORDER BY id").all(),
+    ).toEqual([{ qty: 2 }, { qty: 4 }]);
+  });
+
+  test("empty batch is a no-op", () => {
+    const stmt = db.prepare("INSERT INTO items (name) VALUES (?)");
+    expect(stmt.runMany([]).changes).toBe(0);
+    expect(count()).toBe(0);
+  });
+
+  test("reports the failing row and keeps earlier rows by default", () => {
+    const stmt = db.prepare("INSERT INTO items (name) VALUES (?)");
+    let error: any;
+    try {
+      stmt.runMany([["a"], ["b"], ["a"], ["c"]]);
+    } catch (e) {
+      error = e;
+    }
+    expect(error).toBeDefined();
+    expect(error.message).toMatch(/UNIQUE/);
+    expect(error.failedIndex).toBe(2);
+    expect(error.changes).toBe(2);
+    expect(count()).toBe(2);
+  });
+
+  test("transaction option rolls back the whole batch on failure", () => {
+    const stmt = db.prepare("INSERT INTO items (name) VALUES (?)");
+    let error: any;
+    try {
+      stmt.runMany([["a"], ["b"], ["a"]], { transaction: true });
+    } catch (e) {
+      error = e;
+    }
+    expect(error.failedIndex).toBe(2);
+    expect(error.changes).toBe(0);
+    expect(count()).toBe(0);
+    expect(db.isTransaction).toBe(false);
+
+    expect(stmt.runMany([["a"], ["b"]], { transaction: true }).changes).toBe(2);
+    expect(db.isTransaction).toBe(false);
+    expect(count()).toBe(2);
+  });
+
+  test("transaction option nests in an open transaction", () => {
+    const stmt = db.prepare("INSERT INTO items (name) VALUES (?)");
+    db.exec("BEGIN");
+    stmt.run("outer");
+    expect(() =>
+      stmt.runMany([["x"], ["outer"]], { transaction: true }),
+    ).toThrow(/UNIQUE/);
+    expect(db.isTransaction).toBe(true);
+    db.exec("COMMIT");
+    expect(db.prepare("SELECT name FROM items").all()).toEqual([
+      { name: "outer" },
+    ]);
+  });
+
+  test("binding errors report the failing row", () => {
+    const stmt = db.prepare("INSERT INTO items (name) VALUES (?)");
+    let error: any;
+    try {
+      const bad = {
+        toString() {
+          throw new Error("boom");
+        },
+      };
+      stmt.runMany([["ok"], [bad]]);
+    } catch (e) {
+      error = e;
+    }
+    expect(error.message).toBe("boom");
+    expect(error.failedIndex).toBe(1);
+    expect(error.changes).toBe(1);
+  });
+
+  test("validates arguments", () => {
+    const stmt = db.prepare("INSERT INTO items (name) VALUES (?)");
+    expect(() => (stmt as any).runMany()).toThrow(/must be an array/);
+    expect(() => (stmt as any).runMany("a")).toThrow(/must be an array/);
+    expect(() => stmt.runMany([], { transaction: "yes" } as any)).toThrow(
+      /must be a boolean/,
+    );
+  });
+});
@@ -0,0 +1,80 @@
+import { DatabaseSync } from "../src";
+
+describe("StatementSync.scanStatus()", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec(`
+      CREATE TABLE users (id INTEGER PRIMARY KEY, team INTEGER, name TEXT);
+      CREATE TABLE teams (id INTEGER PRIMARY KEY, name TEXT);
+      CREATE INDEX users_team ON users (team);
+    `);
+    const insertTeam = db.prepare("INSERT INTO teams (name) VALUES (?)");
+    const insertUser = db.prepare(
+      "INSERT INTO users (team, name) VALUES (?, ?)",
+    );
+    for (let i = 1; i <= 10; i++) {
+      insertTeam.run(`team-${i}`);
+    }
+    for (let i = 0; i < 200; i++) {
+      insertUser.run((i % 10) + 1, `user-${i}`);
+    }
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("reports one entry per query plan loop", () => {
+    const stmt = db.prepare(`
+      SELECT t.name, count(*) FROM teams t
+      JOIN users u ON u.team = t.id
+      GROUP BY t.id`);
+    stmt.all();
+
+    const loops = stmt.scanStatus();
+    expect(loops).toHaveLength(2);
+    const names = loops.map((loop) => loop.name);
+    expect(names).toContain("teams");
+    expect(names).toContain("users_team");
+
+    const users = loops.find((loop) => loop.name === "users_team")!;
+    expect(users.explain).toMatch(/users_team/);
+    expect(users.loops).toBe(10);
+    expect(users.rowsVisited).toBe(200);
+    expect(users.estimatedRows).toBeGreaterThan(0);
+
+    const teams = loops.find((loop) => loop.name === "teams")!;
+    expect(teams.loops).toBe(1);
+    expect(teams.rowsVisited).toBe(10);
+  });
+
+  test("counters accumulate across runs and can be reset", () => {
+    const stmt = db.prepare("SELECT * FROM users WHERE team = ?");
+    stmt.all(1);
+    stmt.all(2);
+    const [loop] = stmt.scanStatus({ reset: true });
+    expect(loop!.loops).toBe(2);
+    expect(loop!.rowsVisited).toBe(40);
+
+    const [after] = stmt.scanStatus();
+    expect(after!.loops).toBe(0);
+    expect(after!.rowsVisited).toBe(0);
+    expect(after!.explain).toBe(loop!.explain);
+  });
+
+  test("statements without loops report nothing", () => {
+    const stmt = db.prepare("SELECT 1");
+    stmt.get();
+    expect(stmt.scanStatus()).toEqual([]);
+  });
+
+  test("throws on a finalized statement", () => {
+    const stmt = db.prepare("SELECT * FROM users");
+    stmt.finalize();
+    expect(() => stmt.scanStatus()).toThrow(/finalized/);
+  });
+});
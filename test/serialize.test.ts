@@ -0,0 +1,124 @@
+import { DatabaseSync } from "../src";
+import { uniqueDbName, useTempDirSuite } from "./test-utils";
+
+describe("Serialization", () => {
+  const { getDbPath } = useTempDirSuite("sqlite-serialize-");
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec(`
+      CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT);
+      INSERT INTO items (name) VALUES ('apple'), ('pear');
+    `);
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("serialize() returns a database image", () => {
+    const image = db.serialize();
+    expect(Buffer.isBuffer(image)).toBe(true);
+    expect(image.length % 4096).toBe(0);
+    expect(image.subarray(0, 16).toString("latin1")).toBe(
+      "SQLite format 3\0",
+    );
+  });
+
+  test("deserialize round-trips an image", () => {
+    const copy = new DatabaseSync(":memory:", {
+      deserialize: db.serialize(),
+    });
+    try {
+      expect(copy.prepare("SELECT name FROM items ORDER BY id").all()).toEqual(
+        [{ name: "apple" }, { name: "pear" }],
+      );
+
+      // The copy is independent and can grow
+      copy.exec(`
+        WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n LIMIT 500)
+        INSERT INTO items (name) SELECT printf('%.200c', 'x') FROM n;
+      `);
+      expect(copy.prepare("SELECT count(*) AS n FROM items").get()).toEqual({
+        n: 502,
+      });
+      expect(db.prepare("SELECT count(*) AS n FROM items").get()).toEqual({
+        n: 2,
+      });
+    } finally {
+      copy.close();
+    }
+  });
+
+  test("serializes file databases and attached schemas", () => {
+    const file = new DatabaseSync(getDbPath(uniqueDbName()));
+    try {
+      file.exec("CREATE TABLE t (v); INSERT INTO t VALUES (42)");
+      const copy = new DatabaseSync(":memory:", {
+        deserialize: new Uint8Array(file.serialize()),
+      });
+      expect(copy.prepare("SELECT v FROM t").get()).toEqual({ v: 42 });
+      copy.close();
+    } finally {
+      file.close();
+    }
+
+    db.exec("ATTACH ':memory:' AS aux; CREATE TABLE aux.t (v)");
+    const aux = new DatabaseSync();
+    aux.open({ location: ":memory:", deserialize: db.serialize("aux") });
+    expect(aux.prepare("SELECT name FROM sqlite_schema").all()).toEqual([
+      { name: "t" },
+    ]);
+    aux.close();
+  });
+
+  test("readOnly images reject writes", () => {
+    const copy = new DatabaseSync(":memory:", {
+      deserialize: db.serialize(),
+      readOnly: true,
+    });
+    try {
+      expect(copy.prepare("SELECT count(*) AS n FROM items").get()).toEqual({
+        n: 2,
+      });
+      expect(() => copy.exec("INSERT INTO items (name) VALUES ('x')")).toThrow(
+        /readonly/,
+      );
+    } finally {
+      copy.close();
+    }
+  });
+
+  test("rejects invalid images", () => {
+    expect(
+      () =>
+        new DatabaseSync(":memory:", {
+          deserialize: Buffer.alloc(4096, 7),
+        }),
+    ).toThrow(/Failed to deserialize database/);
+  });
+
+  test("validates arguments", () => {
+    expect(() => db.serialize("missing")).toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_VALUE" }),
+    );
+    expect(() => db.serialize(1 as any)).toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    expect(
+      () =>
+        new DatabaseSync(getDbPath(uniqueDbName()), {
+          deserialize: db.serialize(),
+        }),
+    ).toThrow(expect.objectContaining({ code: "ERR_INVALID_ARG_VALUE" }));
+    expect(
+      () => new DatabaseSync(":memory:", { deserialize: "x" as any }),
+    ).toThrow(expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }));
+
+    db.close();
+    expect(() => db.serialize()).toThrow(/not open/);
+  });
+});
@@ -249,6 +249,26 @@ describe("SQLite Sessions", () => {
       expect(patchset.length).toBeLessThanOrEqual(changeset.length);
     });
 
+    it("should keep large changesets valid after the session closes", () => {
+      db.exec(`
+        WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n LIMIT 2000)
+        INSERT INTO test (id, value) SELECT i, printf('%.1000c', 'v') FROM n
+      `);
+      const changeset = session.changeset();
+      expect(changeset.length).toBeGreaterThan(2000 * 1000);
+      session.close();
+      db.close();
+
+      const testDb = new DatabaseSync(":memory:");
+      testDb.exec("CREATE TABLE test (id INTEGER PRIMARY KEY, value TEXT)");
+      expect(testDb.applyChangeset(changeset)).toBe(true);
+      expect(
+        testDb.prepare("SELECT count(*) AS n, sum(length(value)) AS b FROM test")
+          .get(),
+      ).toEqual({ n: 2000, b: 2000 * 1000 });
+      testDb.close();
+    });
+
     it("should throw error when session is closed", () => {
       session.close();
       expect(() => session.changeset()).toThrow(/session is not open/);
@@ -792,6 +812,64 @@ describe("SQLite Sessions", () => {
     });
   });
 
+  describe("diff", () => {
+    beforeEach(() => {
+      db.open({ location: ":memory:" });
+      db.exec(`
+        ATTACH DATABASE ':memory:' AS fresh;
+        CREATE TABLE main.items (id INTEGER PRIMARY KEY, value TEXT);
+        CREATE TABLE fresh.items (id INTEGER PRIMARY KEY, value TEXT);
+        INSERT INTO main.items VALUES (1, 'a'), (2, 'b'), (3, 'c');
+        INSERT INTO fresh.items VALUES (1, 'a'), (2, 'B'), (4, 'd');
+      `);
+    });
+
+    const rows = (schema: string) =>
+      db.prepare(`SELECT * FROM ${schema}.items ORDER BY id`).all();
+
+    it("should record only the rows that differ", () => {
+      const session = db.createSession({ db: "fresh" });
+      session.diff("main", "items");
+      const changeset = session.changeset();
+      session.close();
+
+      const conflicts: number[] = [];
+      expect(
+        db.applyChangeset(changeset, {
+          onConflict: (type) => {
+            conflicts.push(type);
+            return constants.SQLITE_CHANGESET_ABORT;
+          },
+        }),
+      ).toBe(true);
+      expect(conflicts).toEqual([]);
+      expect(rows("main")).toEqual(rows("fresh"));
+
+      // Nothing differs any more
+      const again = db.createSession({ db: "fresh" });
+      again.diff("main", "items");
+      expect(again.changeset().length).toBe(0);
+      again.close();
+    });
+
+    it("should reject incompatible tables and bad arguments", () => {
+      db.exec("CREATE TABLE fresh.other (id INTEGER PRIMARY KEY, x, y)");
+      db.exec("CREATE TABLE main.other (id INTEGER PRIMARY KEY, x)");
+      const session = db.createSession({ db: "fresh" });
+
+      expect(() => session.diff("main", "other")).toThrow(
+        expect.objectContaining({ code: "SQLITE_SCHEMA" }),
+      );
+      expect(() => session.diff("main", 42 as any)).toThrow(
+        expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+      );
+      session.close();
+      expect(() => session.diff("main", "items")).toThrow(
+        /session is not open/,
+      );
+    });
+  });
+
   describe("Session lifecycle", () => {
     it("should handle multiple sessions", () => {
       db.open({ location: ":memory:" });
@@ -0,0 +1,117 @@
+import { DatabaseSync } from "../src";
+
+describe("Statement Cache Tests", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:", { statementCacheSize: 2 });
+    db.exec("CREATE TABLE kv (k TEXT PRIMARY KEY, v INTEGER)");
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("returns the same statement for identical SQL", () => {
+    const a = db.prepareCached("SELECT * FROM kv");
+    const b = db.prepareCached("SELECT * FROM kv");
+    expect(a).toBe(b);
+    expect(db.statementCacheStats()).toEqual({
+      size: 1,
+      capacity: 2,
+      hits: 1,
+      misses: 1,
+      evictions: 0,
+    });
+  });
+
+  test("prepare() never uses the cache", () => {
+    const a = db.prepare("SELECT * FROM kv");
+    const b = db.prepare("SELECT * FROM kv");
+    expect(a).not.toBe(b);
+    expect(db.statementCacheStats().size).toBe(0);
+  });
+
+  test("evicts the least recently used statement", () => {
+    const first = db.prepareCached("SELECT 1");
+    db.prepareCached("SELECT 2");
+    db.prepareCached("SELECT 1"); // SELECT 2 is now least recently used
+    db.prepareCached("SELECT 3");
+
+    const stats = db.statementCacheStats();
+    expect(stats.size).toBe(2);
+    expect(stats.evictions).toBe(1);
+    expect(db.prepareCached("SELECT 1")).toBe(first);
+    expect(db.statementCacheStats().misses).toBe(3);
+
+    // SELECT 2 was evicted, so this is a miss
+    db.prepareCached("SELECT 2");
+    expect(db.statementCacheStats().misses).toBe(4);
+  });
+
+  test("evicted statements remain usable", () => {
+    const stmt = db.prepareCached("INSERT INTO kv VALUES (?, ?)");
+    db.prepareCached("SELECT 1");
+    db.prepareCached("SELECT 2");
+    expect(db.statementCacheStats().evictions).toBe(1);
+    expect(stmt.run("a", 1).changes).toBe(1);
+  });
+
+  test("finalized statements are replaced on the next lookup", () => {
+    const stmt = db.prepareCached("SELECT 1 AS one");
+    stmt.finalize();
+    const fresh = db.prepareCached("SELECT 1 AS one");
+    expect(fresh).not.toBe(stmt);
+    expect(fresh.get()).toEqual({ one: 1 });
+  });
+
+  test("a cache size of 0 disables caching", () => {
+    const uncached = new DatabaseSync(":memory:", { statementCacheSize: 0 });
+    try {
+      const a = uncached.prepareCached("SELECT 1");
+      const b = uncached.prepareCached("SELECT 1");
+      expect(a).not.toBe(b);
+      expect(uncached.statementCacheStats()).toMatchObject({
+        size: 0,
+        capacity: 0,
+        misses: 2,
+      });
+    } finally {
+      uncached.close();
+    }
+  });
+
+  test("validates statementCacheSize", () => {
+    const open = (statementCacheSize: any) =>
+      new DatabaseSync(":memory:", { statementCacheSize }).close();
+    expect(() => open("8")).toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    for (const size of [-1, NaN, Infinity, 1.5]) {
+      expect(() => open(size)).toThrow(
+        expect.objectContaining({ code: "ERR_OUT_OF_RANGE" }),
+      );
+    }
+
+    const later = new DatabaseSync();
+    expect(() =>
+      later.open({ location: ":memory:", statementCacheSize: -1 }),
+    ).toThrow(expect.objectContaining({ code: "ERR_OUT_OF_RANGE" }));
+    expect(later.isOpen).toBe(false);
+  });
+
+  test("clearStatementCache drops all entries", () => {
+    db.prepareCached("SELECT 1");
+    db.prepareCached("SELECT 2");
+    db.clearStatementCache();
+    expect(db.statementCacheStats()).toMatchObject({ size: 0, evictions: 2 });
+  });
+
+  test("close finalizes cached statements", () => {
+    const stmt = db.prepareCached("SELECT 1");
+    db.close();
+    expect(() => stmt.get()).toThrow(/finalized/);
+  });
+});
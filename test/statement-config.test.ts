@@ -144,6 +144,47 @@ describe("Statement Configuration Tests", () => {
 
       expect(() => stmt.get({ id: 1 })).toThrow("conflicting names");
     });
+
+    test("binding plan is reused across calls and objects", () => {
+      const stmt = db.prepare("SELECT name FROM test WHERE id = :id");
+      stmt.setAllowBareNamedParameters(true);
+
+      expect(stmt.get({ id: 1 })).toEqual({ name: "Alice" });
+      expect(stmt.get({ ":id": 2 })).toEqual({ name: "Bob" });
+      expect(stmt.get({ id: 3, unrelated: "ignored" })).toEqual({
+        name: "Charlie",
+      });
+    });
+
+    test("binds several prefixed names without bare names", () => {
+      const stmt = db.prepare("SELECT :a AS a, $a AS b, @c AS c");
+      stmt.setAllowBareNamedParameters(false);
+
+      for (let i = 0; i < 2; i++) {
+        expect(stmt.get({ ":a": 1, $a: 2, "@c": i })).toEqual({
+          a: 1,
+          b: 2,
+          c: i,
+        });
+      }
+    });
+
+    test("prefixed names take precedence over bare names", () => {
+      const stmt = db.prepare("SELECT name FROM test WHERE id = :id");
+      stmt.setAllowBareNamedParameters(true);
+
+      expect(stmt.get({ id: 1, ":id": 2 })).toEqual({ name: "Bob" });
+    });
+
+    test("toggling bare names after the first bind takes effect", () => {
+      const stmt = db.prepare("SELECT name FROM test WHERE id = :id");
+      stmt.setAllowBareNamedParameters(true);
+      expect(stmt.get({ id: 1 })).toEqual({ name: "Alice" });
+
+      // Without bare names, { id } no longer binds and :id stays NULL
+      stmt.setAllowBareNamedParameters(false);
+      expect(stmt.get({ id: 1 })).toBeUndefined();
+    });
   });
 
   describe("combined configuration", () => {
@@ -0,0 +1,127 @@
+import { DatabaseSync } from "../src";
+
+describe("Statement status counters", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec(`
+      CREATE TABLE a (id INTEGER PRIMARY KEY, x INTEGER, label TEXT);
+      CREATE TABLE b (id INTEGER PRIMARY KEY, x INTEGER);
+      CREATE INDEX a_label ON a (label);
+    `);
+    const insertA = db.prepare("INSERT INTO a (x, label) VALUES (?, ?)");
+    const insertB = db.prepare("INSERT INTO b (x) VALUES (?)");
+    for (let i = 0; i < 100; i++) {
+      insertA.run(i % 10, `label-${i}`);
+      insertB.run(i);
+    }
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("reports every counter", () => {
+    const status = db.prepare("SELECT 1").status();
+    expect(Object.keys(status)).toEqual([
+      "fullscanStep",
+      "sort",
+      "autoindex",
+      "vmStep",
+      "reprepare",
+      "run",
+      "filterHit",
+      "filterMiss",
+      "memUsed",
+    ]);
+    expect(status.vmStep).toBe(0);
+    expect(status.memUsed).toBeGreaterThan(0);
+  });
+
+  test("counts full scans, sorts and automatic indexes", () => {
+    const scan = db.prepare("SELECT * FROM a WHERE x = ? ORDER BY label DESC");
+    scan.all(3);
+    const scanStatus = scan.status();
+    expect(scanStatus.fullscanStep).toBeGreaterThan(0);
+    expect(scanStatus.vmStep).toBeGreaterThan(0);
+
+    const sorted = db.prepare("SELECT * FROM b ORDER BY x DESC");
+    sorted.all();
+    expect(sorted.status().sort).toBeGreaterThan(0);
+
+    const join = db.prepare("SELECT count(*) FROM a JOIN b ON a.x = b.x");
+    join.get();
+    expect(join.status().autoindex).toBeGreaterThan(0);
+
+    const lookup = db.prepare("SELECT * FROM a WHERE label = ?");
+    lookup.get("label-5");
+    expect(lookup.status().fullscanStep).toBe(0);
+  });
+
+  test("reset clears the counters after reading them", () => {
+    const scan = db.prepare("SELECT * FROM a WHERE x = 1");
+    scan.all();
+    const before = scan.status({ reset: true });
+    expect(before.fullscanStep).toBeGreaterThan(0);
+    expect(scan.status().fullscanStep).toBe(0);
+    expect(scan.status().vmStep).toBe(0);
+  });
+
+  test("reset keeps reprepare, so column names follow schema changes", () => {
+    const stmt = db.prepare("SELECT * FROM b ORDER BY id LIMIT 1");
+    expect(stmt.get()).toEqual({ id: 1, x: 0 });
+    db.exec("ALTER TABLE b ADD COLUMN y INTEGER DEFAULT 1");
+    expect(stmt.get()).toEqual({ id: 1, x: 0, y: 1 });
+    expect(stmt.status({ reset: true }).reprepare).toBe(1);
+    expect(stmt.status().reprepare).toBe(1);
+
+    db.statementStatus({ reset: true });
+    db.exec("ALTER TABLE b ADD COLUMN z INTEGER DEFAULT 2");
+    expect(stmt.get()).toEqual({ id: 1, x: 0, y: 1, z: 2 });
+    expect(stmt.status().reprepare).toBe(2);
+  });
+
+  test("statementStatus() ranks the connection's statements", () => {
+    const scan = db.prepare("SELECT * FROM a WHERE x = 1");
+    const lookup = db.prepare("SELECT * FROM a WHERE label = 'label-1'");
+    const cached = db.prepareCached("SELECT count(*) FROM b WHERE x > 50");
+    scan.all();
+    lookup.all();
+    cached.get();
+
+    const report = db.statementStatus({ sortBy: "fullscanStep" });
+    const sqls = report.map((entry) => entry.sql);
+    expect(sqls).toContain(scan.sourceSQL);
+    expect(sqls).toContain(cached.sourceSQL);
+    expect(sqls).not.toContain(lookup.sourceSQL);
+    for (let i = 1; i < report.length; i++) {
+      expect(report[i - 1]!.fullscanStep).toBeGreaterThanOrEqual(
+        report[i]!.fullscanStep,
+      );
+    }
+
+    expect(db.statementStatus({ limit: 1 })).toHaveLength(1);
+
+    db.statementStatus({ reset: true });
+    expect(db.statementStatus({ sortBy: "fullscanStep" })).toEqual([]);
+  });
+
+  test("validates arguments", () => {
+    const stmt = db.prepare("SELECT 1");
+    expect(() => stmt.status({ reset: "yes" as any })).toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    expect(() => db.statementStatus({ sortBy: "bogus" as any })).toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_VALUE" }),
+    );
+    expect(() => db.statementStatus({ limit: 0 })).toThrow(
+      expect.objectContaining({ code: "ERR_OUT_OF_RANGE" }),
+    );
+
+    stmt.finalize();
+    expect(() => stmt.status()).toThrow(/finalized/);
+  });
+});
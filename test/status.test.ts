@@ -0,0 +1,95 @@
+import { DatabaseSync, memoryStatus } from "../src";
+
+describe("Connection and memory status", () => {
+  let db: InstanceType<typeof DatabaseSync>;
+
+  beforeEach(() => {
+    db = new DatabaseSync(":memory:");
+    db.exec(`
+      CREATE TABLE items (id INTEGER PRIMARY KEY, payload TEXT);
+      WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n LIMIT 200)
+      INSERT INTO items (payload) SELECT printf('%.500c', 'x') FROM n;
+    `);
+  });
+
+  afterEach(() => {
+    if (db.isOpen) {
+      db.close();
+    }
+  });
+
+  test("db.status() reports connection counters", () => {
+    db.prepare("SELECT count(*) FROM items").get();
+    const status = db.status();
+    expect(Object.keys(status)).toEqual([
+      "cacheHit",
+      "cacheMiss",
+      "cacheWrite",
+      "cacheSpill",
+      "cacheUsed",
+      "cacheUsedShared",
+      "lookasideUsed",
+      "lookasideUsedHighwater",
+      "lookasideHit",
+      "lookasideMissSize",
+      "lookasideMissFull",
+      "schemaUsed",
+      "stmtUsed",
+    ]);
+    expect(status.cacheHit).toBeGreaterThan(0);
+    expect(status.cacheUsed).toBeGreaterThan(0);
+    expect(status.schemaUsed).toBeGreaterThan(0);
+  });
+
+  test("db.status({ reset: true }) resets the cache counters", () => {
+    db.prepare("SELECT count(*) FROM items").get();
+    expect(db.status({ reset: true }).cacheHit).toBeGreaterThan(0);
+    expect(db.status().cacheHit).toBe(0);
+  });
+
+  test("db.status() requires an open connection", () => {
+    db.close();
+    expect(() => db.status()).toThrow(/not open/);
+  });
+
+  test("memoryStatus() reports process-wide counters", () => {
+    const status = memoryStatus();
+    expect(Object.keys(status)).toEqual([
+      "memoryUsed",
+      "mallocSize",
+      "mallocCount",
+      "pagecacheUsed",
+      "pagecacheOverflow",
+      "pagecacheSize",
+    ]);
+    expect(status.memoryUsed.current).toBeGreaterThan(0);
+    expect(status.memoryUsed.highwater).toBeGreaterThanOrEqual(
+      status.memoryUsed.current,
+    );
+    expect(status.mallocCount.current).toBeGreaterThan(0);
+  });
+
+  test("memoryStatus({ reset: true }) resets high-water marks", () => {
+    const big = new DatabaseSync(":memory:");
+    big.exec(`
+      CREATE TABLE t (v BLOB);
+      WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n LIMIT 20)
+      INSERT INTO t SELECT randomblob(100000) FROM n;
+    `);
+    big.close();
+
+    const before = memoryStatus({ reset: true }).memoryUsed;
+    const after = memoryStatus().memoryUsed;
+    expect(after.highwater).toBeLessThanOrEqual(before.highwater);
+    expect(after.highwater).toBeGreaterThanOrEqual(after.current);
+  });
+
+  test("validates options", () => {
+    expect(() => db.status({ reset: 1 as any })).toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+    expect(() => memoryStatus("reset" as any)).toThrow(
+      expect.objectContaining({ code: "ERR_INVALID_ARG_TYPE" }),
+    );
+  });
+});